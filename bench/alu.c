@@ -0,0 +1,210 @@
+/*
+ * Interpreter benchmark for register-heavy code. Writes temporary ELFs whose
+ * entry is an endless loop of integer ALU instructions, a few of them nops
+ * (addi x0, x0, 0), and reports the time per instruction once `count`
+ * million of them retired. A second loop turns a quarter of them into loads
+ * and stores to the stack, and runs with both flat and checked memory. The
+ * JIT is off, so this measures the handlers.
+ */
+#include <time.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <elf.h>
+#include "riscv.h"
+#include "insn.h"
+#include "proc.h"
+
+#define ROUNDS 5
+#define ELF_BASE 0x10000
+#define ELF_OFFSET 0x1000
+#define LOOP_LEN 48
+
+static insn_t rtype(insn_t match, unsigned rd, unsigned rs1, unsigned rs2);
+static insn_t itype(insn_t match, unsigned rd, unsigned rs1, int32_t imm);
+static insn_t stype(insn_t match, unsigned rs1, unsigned rs2, int32_t imm);
+static int writeelf(FILE *fp, bool ldst) __attribute__((nonnull));
+static double now(void);
+static double timerun(const char *path, const struct procopts *opts,
+		      uint64_t count, uint64_t *retired) __attribute__((nonnull));
+
+static insn_t rtype(insn_t match, unsigned rd, unsigned rs1, unsigned rs2)
+{
+	return match | rd << 7 | rs1 << 15 | rs2 << 20;
+}
+
+static insn_t itype(insn_t match, unsigned rd, unsigned rs1, int32_t imm)
+{
+	return match | rd << 7 | rs1 << 15 | ((insn_t)imm & 0xfff) << 20;
+}
+
+static insn_t stype(insn_t match, unsigned rs1, unsigned rs2, int32_t imm)
+{
+	return match | ((insn_t)imm & 0x1f) << 7 | rs1 << 15 | rs2 << 20 |
+	       ((insn_t)imm & 0xfe0) << 20;
+}
+
+static int writeelf(FILE *fp, bool ldst)
+{
+	insn_t code[LOOP_LEN + 1];
+	Elf64_Ehdr elfh = {
+		.e_ident = {ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS64,
+			    ELFDATA2LSB, EV_CURRENT, ELFOSABI_SYSV},
+		.e_type = ET_EXEC,
+		.e_machine = EM_RISCV,
+		.e_version = EV_CURRENT,
+		.e_entry = ELF_BASE,
+		.e_phoff = sizeof(Elf64_Ehdr),
+		.e_ehsize = sizeof(Elf64_Ehdr),
+		.e_phentsize = sizeof(Elf64_Phdr),
+		.e_phnum = 1,
+	};
+	Elf64_Phdr elfph = {
+		.p_type = PT_LOAD,
+		.p_flags = PF_R | PF_X,
+		.p_offset = ELF_OFFSET,
+		.p_vaddr = ELF_BASE,
+		.p_paddr = ELF_BASE,
+		.p_filesz = sizeof(code),
+		.p_memsz = sizeof(code),
+		.p_align = 0x1000,
+	};
+	unsigned rd, rs1, rs2;
+	uint32_t j;
+
+	// Chains through t0-t6 and a0-a7, every eighth instruction is a nop
+	for (unsigned i = 0; i < LOOP_LEN; ++i) {
+		rd = 10 + i % 8;
+		rs1 = 5 + i % 3;
+		rs2 = 10 + (i + 3) % 8;
+
+		switch (i % 8) {
+		case 0:
+			code[i] = rtype(MATCH_ADD, rd, rs1, rs2);
+			break;
+		case 1:
+			code[i] = rtype(MATCH_XOR, rd, rs1, rs2);
+			break;
+		case 2:
+			code[i] = itype(MATCH_ADDI, rd, rs2, (int32_t)i);
+			break;
+		case 3:
+			code[i] = rtype(MATCH_SUB, rd, rs2, rs1);
+			break;
+		case 4:
+			if (ldst)
+				code[i] = stype(MATCH_SD, REG_SP, rs2,
+						-8 * (int32_t)(i % 4 + 1));
+			else
+				code[i] = itype(MATCH_SLLI, rd, rs2, 3);
+			break;
+		case 5:
+			if (ldst)
+				code[i] = itype(MATCH_LD, rd, REG_SP,
+						-8 * (int32_t)(i % 4 + 1));
+			else
+				code[i] = rtype(MATCH_SLTU, rd, rs1, rs2);
+			break;
+		case 6:
+			code[i] = rtype(MATCH_ADDW, rd, rs2, rs1);
+			break;
+		default:
+			code[i] = itype(MATCH_ADDI, 0, 0, 0);
+			break;
+		}
+	}
+	// jal x0, -LOOP_LEN * 4
+	j = (uint32_t)(-LOOP_LEN * 4);
+	code[LOOP_LEN] = MATCH_JAL | (j & 0x100000) << 11 | (j & 0x7fe) << 20 |
+			 (j & 0x800) << 9 | (j & 0xff000);
+
+	if (fwrite(&elfh, sizeof(elfh), 1, fp) != 1 ||
+	    fwrite(&elfph, sizeof(elfph), 1, fp) != 1 ||
+	    fseek(fp, ELF_OFFSET, SEEK_SET) == -1 ||
+	    fwrite(code, sizeof(code), 1, fp) != 1)
+		return -1;
+	return fflush(fp);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Best time of ROUNDS runs of `count` instructions, in seconds
+static double timerun(const char *path, const struct procopts *opts,
+		      uint64_t count, uint64_t *retired)
+{
+	struct proc *proc;
+	double t0, best = 0;
+
+	for (int i = 0; i < ROUNDS; ++i) {
+		if (!(proc = loadproc(path, opts)))
+			return -1;
+		t0 = now();
+		if (proc_run(proc, count) == -1) {
+			perror("bench_alu: proc_run");
+			freeproc(proc);
+			return -1;
+		}
+		t0 = now() - t0;
+		if (i == 0 || t0 < best)
+			best = t0;
+		*retired = proc->instret;
+		freeproc(proc);
+	}
+	return best;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct {
+		const char *name;
+		bool ldst;
+		struct procopts opts;
+	} runs[] = {
+		{"alu, flat", false, {.flatmem = true}},
+		{"ldst, flat", true, {.flatmem = true}},
+		{"ldst, checked", true, {.flatmem = false}},
+	};
+	char path[] = "/tmp/rvrun-bench-XXXXXX";
+	uint64_t count = 200;
+	uint64_t retired = 0;
+	double best;
+	FILE *fp;
+	int fd;
+
+	if (argc > 1)
+		count = strtoull(argv[1], NULL, 0);
+	count *= 1000000;
+
+	printf("best of %d\n", ROUNDS);
+	for (size_t i = 0; i < sizeof(runs) / sizeof(*runs); ++i) {
+		if ((fd = mkstemp(path)) == -1 || !(fp = fdopen(fd, "w+b"))) {
+			perror("bench_alu: temporary ELF");
+			return 1;
+		}
+		if (writeelf(fp, runs[i].ldst) == -1) {
+			perror("bench_alu: writing ELF");
+			unlink(path);
+			return 1;
+		}
+		fclose(fp);
+		best = timerun(path, &runs[i].opts, count, &retired);
+		unlink(path);
+		memcpy(path + sizeof(path) - 7, "XXXXXX", 6);
+		if (best < 0)
+			return 1;
+
+		printf("%-14s %lu instructions, %.3f ns/insn, %.1f MIPS\n",
+		       runs[i].name, retired, best * 1e9 / (double)retired,
+		       (double)retired / best / 1e6);
+	}
+	return 0;
+}
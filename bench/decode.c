@@ -0,0 +1,144 @@
+/*
+ * Microbenchmark comparing insn_decode() with the linear mask/match chain it
+ * replaced. Both decoders are fed the same pseudo-random mix of supported
+ * instructions, and throughput is reported in Minsn/s.
+ */
+#include <time.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "riscv.h"
+#include "rv_i.h"
+#include "insn.h"
+
+#define MIX_LEN 4096
+#define ROUNDS 20000
+
+static insn_func_t decode_chain(insn_t insn) __attribute__((noinline));
+static double now(void);
+
+// The decoder as it was before the decode tables, with every instruction
+#define ADD_INSN(name, fname) if (IS_INSN(insn, name)) return (fname)
+static insn_func_t decode_chain(insn_t insn)
+{
+	ADD_INSN(LUI, insn_lui);
+	ADD_INSN(AUIPC, insn_auipc);
+	ADD_INSN(JAL, insn_jal);
+	ADD_INSN(JALR, insn_jalr);
+	ADD_INSN(BEQ, insn_beq);
+	ADD_INSN(BNE, insn_bne);
+	ADD_INSN(BLT, insn_blt);
+	ADD_INSN(BGE, insn_bge);
+	ADD_INSN(BLTU, insn_bltu);
+	ADD_INSN(BGEU, insn_bgeu);
+	ADD_INSN(LB, insn_lb);
+	ADD_INSN(LH, insn_lh);
+	ADD_INSN(LW, insn_lw);
+	ADD_INSN(LD, insn_ld);
+	ADD_INSN(LBU, insn_lbu);
+	ADD_INSN(LHU, insn_lhu);
+	ADD_INSN(LWU, insn_lwu);
+	ADD_INSN(SB, insn_sb);
+	ADD_INSN(SH, insn_sh);
+	ADD_INSN(SW, insn_sw);
+	ADD_INSN(SD, insn_sd);
+	ADD_INSN(ADDI, insn_addi);
+	ADD_INSN(SLTI, insn_slti);
+	ADD_INSN(SLTIU, insn_sltiu);
+	ADD_INSN(XORI, insn_xori);
+	ADD_INSN(ORI, insn_ori);
+	ADD_INSN(ANDI, insn_andi);
+	ADD_INSN(SLLI, insn_slli);
+	ADD_INSN(SRLI, insn_srli);
+	ADD_INSN(SRAI, insn_srai);
+	ADD_INSN(ADD, insn_add);
+	ADD_INSN(SLT, insn_slt);
+	ADD_INSN(SLTU, insn_sltu);
+	ADD_INSN(AND, insn_and);
+	ADD_INSN(OR, insn_or);
+	ADD_INSN(XOR, insn_xor);
+	ADD_INSN(SLL, insn_sll);
+	ADD_INSN(SRL, insn_srl);
+	ADD_INSN(SRA, insn_sra);
+	ADD_INSN(SUB, insn_sub);
+	ADD_INSN(ADDIW, insn_addiw);
+	ADD_INSN(SLLIW, insn_slliw);
+	ADD_INSN(SRLIW, insn_srliw);
+	ADD_INSN(SRAIW, insn_sraiw);
+	ADD_INSN(ADDW, insn_addw);
+	ADD_INSN(SUBW, insn_subw);
+	ADD_INSN(SLLW, insn_sllw);
+	ADD_INSN(SRLW, insn_srlw);
+	ADD_INSN(SRAW, insn_sraw);
+	ADD_INSN(FENCE, insn_fence);
+	ADD_INSN(FENCE_I, insn_fence_i);
+
+	errno = ENOSYS;
+	return NULL;
+}
+#undef ADD_INSN
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+int main(void)
+{
+	static const insn_t templates[] = {
+		MATCH_LUI, MATCH_AUIPC, MATCH_JAL, MATCH_JALR,
+		MATCH_BEQ, MATCH_BNE, MATCH_BLT, MATCH_BGE, MATCH_BLTU,
+		MATCH_BGEU, MATCH_LB, MATCH_LH, MATCH_LW, MATCH_LD, MATCH_LBU,
+		MATCH_LHU, MATCH_LWU, MATCH_SB, MATCH_SH, MATCH_SW, MATCH_SD,
+		MATCH_ADDI, MATCH_SLTI, MATCH_SLTIU, MATCH_XORI, MATCH_ORI,
+		MATCH_ANDI, MATCH_SLLI, MATCH_SRLI, MATCH_SRAI, MATCH_ADD,
+		MATCH_SLT, MATCH_SLTU, MATCH_AND, MATCH_OR, MATCH_XOR,
+		MATCH_SLL, MATCH_SRL, MATCH_SRA, MATCH_SUB, MATCH_ADDIW,
+		MATCH_SLLIW, MATCH_SRLIW, MATCH_SRAIW, MATCH_ADDW, MATCH_SUBW,
+		MATCH_SLLW, MATCH_SRLW, MATCH_SRAW, MATCH_FENCE, MATCH_FENCE_I,
+	};
+	static insn_t mix[MIX_LEN];
+	volatile uintptr_t sink = 0;
+	uintptr_t acc;
+	double t0, tchain, ttab;
+	size_t ntemplates = sizeof(templates) / sizeof(*templates);
+
+	// Random instructions with random rd, rs1 and rs2
+	srandom(42);
+	for (size_t i = 0; i < MIX_LEN; ++i)
+		mix[i] = templates[(size_t)random() % ntemplates] |
+			 ((insn_t)random() & 0x1ff8f80);
+
+	for (size_t i = 0; i < MIX_LEN; ++i)
+		if (decode_chain(mix[i]) != insn_decode(mix[i])) {
+			fprintf(stderr, "decoders disagree on 0x%.8x\n",
+				mix[i]);
+			return 1;
+		}
+
+	acc = 0;
+	t0 = now();
+	for (size_t r = 0; r < ROUNDS; ++r)
+		for (size_t i = 0; i < MIX_LEN; ++i)
+			acc += (uintptr_t)decode_chain(mix[i]);
+	tchain = now() - t0;
+	sink = acc;
+
+	acc = 0;
+	t0 = now();
+	for (size_t r = 0; r < ROUNDS; ++r)
+		for (size_t i = 0; i < MIX_LEN; ++i)
+			acc += (uintptr_t)insn_decode(mix[i]);
+	ttab = now() - t0;
+	sink = acc;
+	(void)sink;
+
+	printf("chain: %8.1f Minsn/s\n", MIX_LEN * ROUNDS / tchain / 1e6);
+	printf("table: %8.1f Minsn/s\n", MIX_LEN * ROUNDS / ttab / 1e6);
+	printf("speedup: %.2fx\n", tchain / ttab);
+	return 0;
+}
@@ -0,0 +1,703 @@
+/*
+ * Floating-point benchmark. Writes temporary ELFs whose entry sets a few f
+ * registers then loops over F and D arithmetic, and reports the time per
+ * instruction once `count` million of them retired: with the rounding mode of
+ * frm, with a static one that differs so that every instruction switches the
+ * host's, and reading fflags every eighth instruction.
+ *
+ * Then compares, on the host, how rv_f.c computes with two alternatives:
+ * setting the rounding mode and testing the exception flags around every
+ * operation, and a softfloat-style one with integer arithmetic as emulators
+ * do without a host FPU to rely on. The latter is checked to give the same
+ * results and flags as the host in every rounding mode first.
+ */
+#include <time.h>
+#include <fenv.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <elf.h>
+#include "riscv.h"
+#include "insn.h"
+#include "proc.h"
+
+#define ROUNDS 5
+#define ELF_BASE 0x10000
+#define ELF_OFFSET 0x1000
+#define LOOP_LEN 48
+#define PROLOGUE_LEN 18
+#define RM_RTZ 1
+#define RM_DYN 7
+
+// Operands of the host comparison, and how many are checked
+#define NOPS 4096
+#define NCHECK 200000
+
+__extension__ typedef unsigned __int128 u128;
+
+// Keeps `x` from being computed across calls that change the host FPU
+#define BARRIER(x) __asm__ volatile("" : "+m"(x) : : "memory")
+
+// A binary operation of the host comparison, `flags` are FE_* ones
+typedef double fpop_t(double a, double b, int mode, int *flags);
+
+static insn_t rtype(insn_t match, unsigned rd, unsigned rs1, unsigned rs2,
+		    unsigned rm);
+static int writeelf(FILE *fp, unsigned rm, bool fflags)
+	__attribute__((nonnull));
+static double now(void);
+static double timerun(const char *path, uint64_t count, uint64_t *retired)
+	__attribute__((nonnull));
+
+static uint64_t bits(double x);
+static double fromb(uint64_t b);
+static uint64_t jam(uint64_t sig, unsigned dist);
+static uint64_t sf_pack(bool sign, int exp, uint64_t sig, int mode,
+			int *flags) __attribute__((nonnull));
+static uint64_t sf_normpack(bool sign, int exp, uint64_t sig, int mode,
+			    int *flags) __attribute__((nonnull));
+static uint64_t sf_nan(uint64_t a, uint64_t b, int *flags)
+	__attribute__((nonnull));
+static int sf_unpack(uint64_t *sig);
+static uint64_t sf_addmags(uint64_t a, uint64_t b, bool sign, int mode,
+			   int *flags) __attribute__((nonnull));
+static uint64_t sf_submags(uint64_t a, uint64_t b, bool sign, int mode,
+			   int *flags) __attribute__((nonnull));
+static double sf_add(double a, double b, int mode, int *flags)
+	__attribute__((nonnull, noinline));
+static double sf_mul(double a, double b, int mode, int *flags)
+	__attribute__((nonnull, noinline));
+static double host_add(double a, double b, int mode, int *flags)
+	__attribute__((nonnull, noinline));
+static double host_mul(double a, double b, int mode, int *flags)
+	__attribute__((nonnull, noinline));
+static double eager_add(double a, double b, int mode, int *flags)
+	__attribute__((nonnull, noinline));
+static double eager_mul(double a, double b, int mode, int *flags)
+	__attribute__((nonnull, noinline));
+static uint64_t randbits(uint64_t *state) __attribute__((nonnull));
+static double randop(uint64_t *state) __attribute__((nonnull));
+static int check(fpop_t *sf, fpop_t *host, const char *name)
+	__attribute__((nonnull));
+static double timeop(fpop_t *op, const double *a, const double *b,
+		     uint64_t count) __attribute__((nonnull));
+
+static insn_t rtype(insn_t match, unsigned rd, unsigned rs1, unsigned rs2,
+		    unsigned rm)
+{
+	return match | rd << 7 | rm << 12 | rs1 << 15 | rs2 << 20;
+}
+
+static int writeelf(FILE *fp, unsigned rm, bool fflags)
+{
+	insn_t code[PROLOGUE_LEN + LOOP_LEN + 1];
+	Elf64_Ehdr elfh = {
+		.e_ident = {ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS64,
+			    ELFDATA2LSB, EV_CURRENT, ELFOSABI_SYSV},
+		.e_type = ET_EXEC,
+		.e_machine = EM_RISCV,
+		.e_version = EV_CURRENT,
+		.e_entry = ELF_BASE,
+		.e_phoff = sizeof(Elf64_Ehdr),
+		.e_ehsize = sizeof(Elf64_Ehdr),
+		.e_phentsize = sizeof(Elf64_Phdr),
+		.e_phnum = 1,
+	};
+	Elf64_Phdr elfph = {
+		.p_type = PT_LOAD,
+		.p_flags = PF_R | PF_X,
+		.p_offset = ELF_OFFSET,
+		.p_vaddr = ELF_BASE,
+		.p_paddr = ELF_BASE,
+		.p_filesz = sizeof(code),
+		.p_memsz = sizeof(code),
+		.p_align = 0x1000,
+	};
+	static const int32_t init[PROLOGUE_LEN / 2] = {
+		3, 7, 11, 13, 17, 19, 23, 5, 29
+	};
+	insn_t *loop = code + PROLOGUE_LEN;
+	unsigned rd;
+	uint32_t j;
+
+	// Doubles 3 to 23 in f1-f7, floats 5 and 29 in f8 and f9
+	for (unsigned i = 0; i < PROLOGUE_LEN / 2; ++i) {
+		code[2 * i] = MATCH_ADDI | 5 << 7 |
+			      ((insn_t)init[i] & 0xfff) << 20;
+		code[2 * i + 1] = rtype(i < 7 ? MATCH_FCVT_D_L : MATCH_FCVT_S_L,
+					i + 1, 5, 0, RM_DYN);
+	}
+
+	// Only reads f1-f9, so that the values stay the same
+	for (unsigned i = 0; i < LOOP_LEN; ++i) {
+		rd = 10 + i % 8;
+
+		switch (i % 8) {
+		case 0:
+			loop[i] = rtype(MATCH_FMADD_D, rd, 1, 2, rm) | 3 << 27;
+			break;
+		case 1:
+			loop[i] = rtype(MATCH_FADD_D, rd, 2, 4, rm);
+			break;
+		case 2:
+			loop[i] = rtype(MATCH_FMUL_D, rd, 3, 5, rm);
+			break;
+		case 3:
+			loop[i] = rtype(MATCH_FSUB_D, rd, 6, 1, rm);
+			break;
+		case 4:
+			loop[i] = rtype(MATCH_FDIV_D, rd, 7, 2, rm);
+			break;
+		case 5:
+			loop[i] = rtype(MATCH_FMUL_S, rd, 8, 9, rm);
+			break;
+		case 6:
+			loop[i] = rtype(MATCH_FMADD_S, rd, 8, 9, rm) | 8 << 27;
+			break;
+		default:
+			if (fflags)
+				loop[i] = MATCH_CSRRS | 5 << 7 |
+					  CSR_FFLAGS << 20;
+			else
+				loop[i] = rtype(MATCH_FMIN_D, rd, 1, 2, 0);
+			break;
+		}
+	}
+	// jal x0, -LOOP_LEN * 4
+	j = (uint32_t)(-LOOP_LEN * 4);
+	loop[LOOP_LEN] = MATCH_JAL | (j & 0x100000) << 11 | (j & 0x7fe) << 20 |
+			 (j & 0x800) << 9 | (j & 0xff000);
+
+	if (fwrite(&elfh, sizeof(elfh), 1, fp) != 1 ||
+	    fwrite(&elfph, sizeof(elfph), 1, fp) != 1 ||
+	    fseek(fp, ELF_OFFSET, SEEK_SET) == -1 ||
+	    fwrite(code, sizeof(code), 1, fp) != 1)
+		return -1;
+	return fflush(fp);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Best time of ROUNDS runs of `count` instructions, in seconds
+static double timerun(const char *path, uint64_t count, uint64_t *retired)
+{
+	static const struct procopts opts = {.flatmem = true};
+	struct proc *proc;
+	double t0, best = 0;
+
+	for (int i = 0; i < ROUNDS; ++i) {
+		if (!(proc = loadproc(path, &opts)))
+			return -1;
+		t0 = now();
+		if (proc_run(proc, count) == -1) {
+			perror("bench_fpu: proc_run");
+			freeproc(proc);
+			return -1;
+		}
+		t0 = now() - t0;
+		if (i == 0 || t0 < best)
+			best = t0;
+		*retired = proc->instret;
+		freeproc(proc);
+	}
+	return best;
+}
+
+static uint64_t bits(double x)
+{
+	uint64_t b;
+
+	memcpy(&b, &x, sizeof(b));
+	return b;
+}
+
+static double fromb(uint64_t b)
+{
+	double x;
+
+	memcpy(&x, &b, sizeof(x));
+	return x;
+}
+
+// Shifts `sig` right, setting the low bit if any that were shifted out were
+static uint64_t jam(uint64_t sig, unsigned dist)
+{
+	if (dist >= 63)
+		return sig != 0;
+	return sig >> dist | ((sig << (-dist & 63)) != 0);
+}
+
+/*
+ * Rounds and packs a double of significand `sig`, with its leading one at
+ * bit 62 and ten rounding bits, and biased exponent `exp` minus one.
+ * Tininess is detected after rounding, as on the host.
+ */
+static uint64_t sf_pack(bool sign, int exp, uint64_t sig, int mode,
+			int *flags)
+{
+	uint64_t inc = 0x200;
+	uint64_t rbits;
+	bool tiny;
+
+	if (mode == FE_TOWARDZERO)
+		inc = 0;
+	else if (mode == FE_DOWNWARD)
+		inc = sign ? 0x3ff : 0;
+	else if (mode == FE_UPWARD)
+		inc = sign ? 0 : 0x3ff;
+
+	rbits = sig & 0x3ff;
+	if ((unsigned)exp >= 0x7fd) {
+		if (exp < 0) {
+			tiny = exp < -1 || sig + inc < UINT64_C(1) << 63;
+			sig = jam(sig, (unsigned)-exp);
+			exp = 0;
+			rbits = sig & 0x3ff;
+			if (tiny && rbits)
+				*flags |= FE_UNDERFLOW;
+		} else if (exp > 0x7fd || sig + inc >= UINT64_C(1) << 63) {
+			*flags |= FE_OVERFLOW | FE_INEXACT;
+			return ((uint64_t)sign << 63 | UINT64_C(0x7ff) << 52) -
+			       !inc;
+		}
+	}
+	if (rbits)
+		*flags |= FE_INEXACT;
+	sig = (sig + inc) >> 10;
+	// Ties to even
+	if (rbits == 0x200 && mode == FE_TONEAREST)
+		sig &= ~UINT64_C(1);
+	if (!sig)
+		exp = 0;
+	// Adds so that a significand that rounded up carries into the exponent
+	return ((uint64_t)sign << 63) + ((uint64_t)exp << 52) + sig;
+}
+
+// sf_pack() for a significand whose leading one is at any bit
+static uint64_t sf_normpack(bool sign, int exp, uint64_t sig, int mode,
+			    int *flags)
+{
+	int shift = __builtin_clzll(sig) - 1;
+
+	exp -= shift;
+	if (shift >= 10 && (unsigned)exp < 0x7fd)
+		return ((uint64_t)sign << 63) + ((uint64_t)exp << 52) +
+		       (sig << (shift - 10));
+	return sf_pack(sign, exp, sig << shift, mode, flags);
+}
+
+// The canonical NaN, raising invalid if either operand is a signaling NaN
+static uint64_t sf_nan(uint64_t a, uint64_t b, int *flags)
+{
+	const uint64_t inf = UINT64_C(0x7ff) << 52;
+	const uint64_t quiet = UINT64_C(1) << 51;
+
+	if (((a & ~(UINT64_C(1) << 63)) > inf && !(a & quiet)) ||
+	    ((b & ~(UINT64_C(1) << 63)) > inf && !(b & quiet)))
+		*flags |= FE_INVALID;
+	return UINT64_C(0x7ff8000000000000);
+}
+
+/*
+ * Normalizes the significand of a non-zero subnormal in `sig`, returns its
+ * exponent
+ */
+static int sf_unpack(uint64_t *sig)
+{
+	int shift = __builtin_clzll(*sig) - 11;
+
+	*sig <<= shift;
+	return 1 - shift;
+}
+
+static uint64_t sf_addmags(uint64_t a, uint64_t b, bool sign, int mode,
+			   int *flags)
+{
+	int expa = (int)(a >> 52 & 0x7ff), expb = (int)(b >> 52 & 0x7ff);
+	uint64_t siga = a & ((UINT64_C(1) << 52) - 1);
+	uint64_t sigb = b & ((UINT64_C(1) << 52) - 1);
+	int diff = expa - expb;
+	int exp;
+	uint64_t sig;
+
+	if (!diff) {
+		if (!expa)
+			return a + sigb;
+		if (expa == 0x7ff)
+			return siga | sigb ? sf_nan(a, b, flags) : a;
+		exp = expa;
+		sig = (UINT64_C(0x0020000000000000) + siga + sigb) << 9;
+	} else {
+		siga <<= 9;
+		sigb <<= 9;
+		if (diff < 0) {
+			if (expb == 0x7ff)
+				return sigb ? sf_nan(a, b, flags) :
+				       (uint64_t)sign << 63 |
+				       UINT64_C(0x7ff) << 52;
+			exp = expb;
+			siga = expa ? siga + (UINT64_C(1) << 61) : siga << 1;
+			siga = jam(siga, (unsigned)-diff);
+		} else {
+			if (expa == 0x7ff)
+				return siga ? sf_nan(a, b, flags) : a;
+			exp = expa;
+			sigb = expb ? sigb + (UINT64_C(1) << 61) : sigb << 1;
+			sigb = jam(sigb, (unsigned)diff);
+		}
+		sig = (UINT64_C(1) << 61) + siga + sigb;
+		if (sig < UINT64_C(1) << 62) {
+			--exp;
+			sig <<= 1;
+		}
+	}
+	return sf_pack(sign, exp, sig, mode, flags);
+}
+
+static uint64_t sf_submags(uint64_t a, uint64_t b, bool sign, int mode,
+			   int *flags)
+{
+	int expa = (int)(a >> 52 & 0x7ff), expb = (int)(b >> 52 & 0x7ff);
+	uint64_t siga = a & ((UINT64_C(1) << 52) - 1);
+	uint64_t sigb = b & ((UINT64_C(1) << 52) - 1);
+	int diff = expa - expb;
+	int exp, shift;
+	uint64_t sig;
+
+	if (!diff) {
+		if (expa == 0x7ff) {
+			if (siga | sigb)
+				return sf_nan(a, b, flags);
+			*flags |= FE_INVALID;
+			return UINT64_C(0x7ff8000000000000);
+		}
+		if (siga == sigb)
+			return (uint64_t)(mode == FE_DOWNWARD) << 63;
+		if (expa)
+			--expa;
+		if (siga < sigb) {
+			sign = !sign;
+			sig = sigb - siga;
+		} else {
+			sig = siga - sigb;
+		}
+		shift = __builtin_clzll(sig) - 11;
+		exp = expa - shift;
+		if (exp < 0) {
+			shift = expa;
+			exp = 0;
+		}
+		return ((uint64_t)sign << 63) + ((uint64_t)exp << 52) +
+		       (sig << shift);
+	}
+	siga <<= 10;
+	sigb <<= 10;
+	if (diff < 0) {
+		sign = !sign;
+		if (expb == 0x7ff)
+			return sigb ? sf_nan(a, b, flags) :
+			       (uint64_t)sign << 63 | UINT64_C(0x7ff) << 52;
+		siga += expa ? UINT64_C(1) << 62 : siga;
+		siga = jam(siga, (unsigned)-diff);
+		exp = expb;
+		sig = (sigb | UINT64_C(1) << 62) - siga;
+	} else {
+		if (expa == 0x7ff)
+			return siga ? sf_nan(a, b, flags) : a;
+		sigb += expb ? UINT64_C(1) << 62 : sigb;
+		sigb = jam(sigb, (unsigned)diff);
+		exp = expa;
+		sig = (siga | UINT64_C(1) << 62) - sigb;
+	}
+	return sf_normpack(sign, exp - 1, sig, mode, flags);
+}
+
+static double sf_add(double a, double b, int mode, int *flags)
+{
+	uint64_t ua = bits(a), ub = bits(b);
+	bool sign = ua >> 63;
+
+	if (sign == ub >> 63)
+		return fromb(sf_addmags(ua, ub, sign, mode, flags));
+	return fromb(sf_submags(ua, ub, sign, mode, flags));
+}
+
+static double sf_mul(double a, double b, int mode, int *flags)
+{
+	uint64_t ua = bits(a), ub = bits(b);
+	bool sign = (ua ^ ub) >> 63;
+	int expa = (int)(ua >> 52 & 0x7ff), expb = (int)(ub >> 52 & 0x7ff);
+	uint64_t siga = ua & ((UINT64_C(1) << 52) - 1);
+	uint64_t sigb = ub & ((UINT64_C(1) << 52) - 1);
+	uint64_t sig;
+	u128 prod;
+	int exp;
+
+	if (expa == 0x7ff || expb == 0x7ff) {
+		if ((expa == 0x7ff && siga) || (expb == 0x7ff && sigb))
+			return fromb(sf_nan(ua, ub, flags));
+		// Infinity times zero
+		if (!((uint64_t)expa | siga) || !((uint64_t)expb | sigb)) {
+			*flags |= FE_INVALID;
+			return fromb(UINT64_C(0x7ff8000000000000));
+		}
+		return fromb((uint64_t)sign << 63 | UINT64_C(0x7ff) << 52);
+	}
+	if (!expa) {
+		if (!siga)
+			return fromb((uint64_t)sign << 63);
+		expa = sf_unpack(&siga);
+	}
+	if (!expb) {
+		if (!sigb)
+			return fromb((uint64_t)sign << 63);
+		expb = sf_unpack(&sigb);
+	}
+
+	exp = expa + expb - 0x3ff;
+	siga = (siga | UINT64_C(1) << 52) << 10;
+	sigb = (sigb | UINT64_C(1) << 52) << 11;
+	prod = (u128)siga * sigb;
+	sig = (uint64_t)(prod >> 64) | ((uint64_t)prod != 0);
+	if (sig < UINT64_C(1) << 62) {
+		--exp;
+		sig <<= 1;
+	}
+	return fromb(sf_pack(sign, exp, sig, mode, flags));
+}
+
+// As rv_f.c: the host is already in the mode and accrues the flags
+static double host_add(double a, double b, int mode, int *flags)
+{
+	(void)mode;
+	(void)flags;
+	return a + b;
+}
+
+static double host_mul(double a, double b, int mode, int *flags)
+{
+	(void)mode;
+	(void)flags;
+	return a * b;
+}
+
+// Sets the mode and gathers the flags of each operation
+static double eager_add(double a, double b, int mode, int *flags)
+{
+	double res;
+
+	fesetround(mode);
+	feclearexcept(FE_ALL_EXCEPT);
+	BARRIER(a);
+	res = a + b;
+	BARRIER(res);
+	*flags |= fetestexcept(FE_ALL_EXCEPT);
+	return res;
+}
+
+static double eager_mul(double a, double b, int mode, int *flags)
+{
+	double res;
+
+	fesetround(mode);
+	feclearexcept(FE_ALL_EXCEPT);
+	BARRIER(a);
+	res = a * b;
+	BARRIER(res);
+	*flags |= fetestexcept(FE_ALL_EXCEPT);
+	return res;
+}
+
+// xorshift64*
+static uint64_t randbits(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+/*
+ * A random double, with exponents mostly near each other so that operations
+ * round, and otherwise at the extremes or special
+ */
+static double randop(uint64_t *state)
+{
+	uint64_t r = randbits(state);
+	uint64_t sign = r & UINT64_C(1) << 63;
+	uint64_t man = randbits(state) & ((UINT64_C(1) << 52) - 1);
+	uint64_t exp;
+
+	switch (r & 7) {
+	case 0:
+		exp = r >> 8 & 3; // Subnormals and the smallest normals
+		break;
+	case 1:
+		exp = 0x7fc + (r >> 8 & 3); // The largest, infinities, NaNs
+		break;
+	case 2:
+		exp = r >> 8 & 0x7ff;
+		break;
+	case 3:
+		man &= ~((UINT64_C(1) << 40) - 1); // Few bits, some exact
+		exp = 0x3ff + (r >> 8 & 7);
+		break;
+	default:
+		exp = 0x3fc + (r >> 8 & 7);
+		break;
+	}
+	return fromb(sign | exp << 52 | man);
+}
+
+// Compares `sf` with `host`, in every rounding mode
+static int check(fpop_t *sf, fpop_t *host, const char *name)
+{
+	static const int modes[] = {
+		FE_TONEAREST, FE_TOWARDZERO, FE_DOWNWARD, FE_UPWARD
+	};
+	uint64_t state = 0x9e3779b97f4a7c15;
+	uint64_t got, want;
+	double a, b;
+	int fgot, fwant;
+
+	for (size_t m = 0; m < sizeof(modes) / sizeof(*modes); ++m) {
+		for (int i = 0; i < NCHECK; ++i) {
+			a = randop(&state);
+			b = randop(&state);
+			fgot = fwant = 0;
+			got = bits(sf(a, b, modes[m], &fgot));
+			want = bits(host(a, b, modes[m], &fwant));
+			if ((want & ~(UINT64_C(1) << 63)) > UINT64_C(0x7ff) << 52)
+				want = UINT64_C(0x7ff8000000000000);
+			if (got != want || fgot != fwant) {
+				fprintf(stderr, "bench_fpu: %s of %a and %a in "
+					"mode %d: %a flags 0x%x, host %a "
+					"flags 0x%x\n", name, a, b, modes[m],
+					fromb(got), (unsigned)fgot, fromb(want),
+					(unsigned)fwant);
+				fesetround(FE_TONEAREST);
+				return -1;
+			}
+		}
+	}
+	fesetround(FE_TONEAREST);
+	return 0;
+}
+
+/*
+ * Best time of ROUNDS of `count` operations over NOPS operands, in seconds.
+ * Every one goes through a pointer, as instructions do through their handler.
+ */
+static double timeop(fpop_t *op, const double *a, const double *b,
+		     uint64_t count)
+{
+	fpop_t *volatile call = op;
+	volatile double sink = 0;
+	double t0, best = 0, acc;
+	int flags;
+
+	for (int r = 0; r < ROUNDS; ++r) {
+		acc = 0;
+		flags = 0;
+		feclearexcept(FE_ALL_EXCEPT);
+		t0 = now();
+		for (uint64_t i = 0; i < count; ++i)
+			acc += call(a[i % NOPS], b[i % NOPS], FE_TONEAREST,
+				    &flags);
+		// Only the lazy one leaves its flags in the host
+		flags |= fetestexcept(FE_ALL_EXCEPT);
+		t0 = now() - t0;
+		sink = acc + flags;
+		if (r == 0 || t0 < best)
+			best = t0;
+	}
+	(void)sink;
+	return best;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct {
+		const char *name;
+		unsigned rm;
+		bool fflags;
+	} runs[] = {
+		{"fp, frm", RM_DYN, false},
+		{"fp, static rm", RM_RTZ, false},
+		{"fp, fflags", RM_DYN, true},
+	};
+	static const struct {
+		const char *name;
+		fpop_t *host;
+		fpop_t *eager;
+		fpop_t *sf;
+	} ops[] = {
+		{"add", host_add, eager_add, sf_add},
+		{"mul", host_mul, eager_mul, sf_mul},
+	};
+	static double a[NOPS], b[NOPS];
+	char path[] = "/tmp/rvrun-bench-XXXXXX";
+	uint64_t count = 100;
+	uint64_t retired = 0;
+	uint64_t state = 1;
+	double best, host, eager, sf;
+	FILE *fp;
+	int fd;
+
+	if (argc > 1)
+		count = strtoull(argv[1], NULL, 0);
+	count *= 1000000;
+
+	printf("best of %d\n", ROUNDS);
+	for (size_t i = 0; i < sizeof(runs) / sizeof(*runs); ++i) {
+		if ((fd = mkstemp(path)) == -1 || !(fp = fdopen(fd, "w+b"))) {
+			perror("bench_fpu: temporary ELF");
+			return 1;
+		}
+		if (writeelf(fp, runs[i].rm, runs[i].fflags) == -1) {
+			perror("bench_fpu: writing ELF");
+			unlink(path);
+			return 1;
+		}
+		fclose(fp);
+		best = timerun(path, count, &retired);
+		unlink(path);
+		memcpy(path + sizeof(path) - 7, "XXXXXX", 6);
+		if (best < 0)
+			return 1;
+
+		printf("%-14s %lu instructions, %.3f ns/insn, %.1f MIPS\n",
+		       runs[i].name, retired, best * 1e9 / (double)retired,
+		       (double)retired / best / 1e6);
+	}
+
+	// Normal operands, as most are
+	for (size_t i = 0; i < NOPS; ++i) {
+		a[i] = fromb(UINT64_C(0x3fc) << 52 | (randbits(&state) &
+			     ((UINT64_C(1) << 55) - 1)));
+		b[i] = fromb(UINT64_C(0x3fc) << 52 | (randbits(&state) &
+			     ((UINT64_C(1) << 55) - 1)));
+	}
+	count /= 10;
+	for (size_t i = 0; i < sizeof(ops) / sizeof(*ops); ++i) {
+		if (check(ops[i].sf, ops[i].eager, ops[i].name) == -1)
+			return 1;
+		host = timeop(ops[i].host, a, b, count);
+		eager = timeop(ops[i].eager, a, b, count);
+		sf = timeop(ops[i].sf, a, b, count);
+		printf("%s: host %.3f ns/op, mode and flags per op %.3f "
+		       "ns/op, softfloat %.3f ns/op\n", ops[i].name,
+		       host * 1e9 / (double)count, eager * 1e9 / (double)count,
+		       sf * 1e9 / (double)count);
+	}
+	return 0;
+}
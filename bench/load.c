@@ -0,0 +1,121 @@
+/*
+ * Startup benchmark for loadproc(), compares mapping ELF segments with
+ * mapseg() against copying them with fread(). Writes a temporary ELF whose
+ * single PT_LOAD segment is `size` MiB of code followed by as much .bss.
+ */
+#include <time.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <elf.h>
+#include "proc.h"
+
+#define ROUNDS 5
+#define ELF_BASE 0x10000
+#define ELF_OFFSET 0x1000
+
+static int writeelf(FILE *fp, uint64_t size) __attribute__((nonnull));
+static double now(void);
+static double timeload(const char *path, const struct procopts *opts)
+	__attribute__((nonnull));
+
+static int writeelf(FILE *fp, uint64_t size)
+{
+	static const unsigned char chunk[1 << 16];
+	Elf64_Ehdr elfh = {
+		.e_ident = {ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS64,
+			    ELFDATA2LSB, EV_CURRENT, ELFOSABI_SYSV},
+		.e_type = ET_EXEC,
+		.e_machine = EM_RISCV,
+		.e_version = EV_CURRENT,
+		.e_entry = ELF_BASE,
+		.e_phoff = sizeof(Elf64_Ehdr),
+		.e_ehsize = sizeof(Elf64_Ehdr),
+		.e_phentsize = sizeof(Elf64_Phdr),
+		.e_phnum = 1,
+	};
+	Elf64_Phdr elfph = {
+		.p_type = PT_LOAD,
+		.p_flags = PF_R | PF_X,
+		.p_offset = ELF_OFFSET,
+		.p_vaddr = ELF_BASE,
+		.p_paddr = ELF_BASE,
+		.p_filesz = size,
+		.p_memsz = 2 * size,
+		.p_align = 0x1000,
+	};
+
+	if (fwrite(&elfh, sizeof(elfh), 1, fp) != 1 ||
+	    fwrite(&elfph, sizeof(elfph), 1, fp) != 1 ||
+	    fseek(fp, ELF_OFFSET, SEEK_SET) == -1)
+		return -1;
+	for (uint64_t i = 0; i < size; i += sizeof(chunk))
+		if (fwrite(chunk, sizeof(chunk), 1, fp) != 1)
+			return -1;
+	return fflush(fp);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Average time to load and free a process, in seconds
+static double timeload(const char *path, const struct procopts *opts)
+{
+	struct proc *proc;
+	double t0, total = 0;
+
+	for (int i = 0; i < ROUNDS; ++i) {
+		t0 = now();
+		if (!(proc = loadproc(path, opts)))
+			return -1;
+		total += now() - t0;
+		freeproc(proc);
+	}
+	return total / ROUNDS;
+}
+
+int main(int argc, char *argv[])
+{
+	char path[] = "/tmp/rvrun-bench-XXXXXX";
+	struct procopts mapped = {.flatmem = true};
+	struct procopts copied = {.flatmem = true, .elfread = true};
+	uint64_t size = 256;
+	double tmap, tread;
+	FILE *fp;
+	int fd;
+
+	if (argc > 1)
+		size = strtoull(argv[1], NULL, 0);
+	size <<= 20;
+
+	if ((fd = mkstemp(path)) == -1 || !(fp = fdopen(fd, "w+b"))) {
+		perror("bench_load: temporary ELF");
+		return 1;
+	}
+	if (writeelf(fp, size) == -1) {
+		perror("bench_load: writing ELF");
+		unlink(path);
+		return 1;
+	}
+	fclose(fp);
+
+	// Once to get the file in the page cache
+	timeload(path, &copied);
+	tread = timeload(path, &copied);
+	tmap = timeload(path, &mapped);
+	unlink(path);
+	if (tread < 0 || tmap < 0)
+		return 1;
+
+	printf("%lu MiB segment\n", size >> 20);
+	printf("fread:  %10.3f ms\n", tread * 1e3);
+	printf("mapseg: %10.3f ms\n", tmap * 1e3);
+	printf("speedup: %.1fx\n", tread / tmap);
+	return 0;
+}
@@ -0,0 +1,885 @@
+/*
+ * Benchmark suite, run by `make bench`. Times the core paths one by one:
+ * insn_decode(), memloadN() and memstoreN() for every size in flat and
+ * checked memory, is_memseg() over few and many segments, resizeseg() growing
+ * a heap, loadproc(), and whole guest kernels, interpreted and translated, in MIPS. Every result is
+ * the best of ROUNDS runs, and they are written as one JSON object.
+ *
+ * With -b, results are compared to those of an earlier run, and the ones more
+ * than -t percent worse are reported as regressions, which makes the suite
+ * exit with status 2. -s scales the work of every benchmark, for quick runs
+ * or steadier numbers.
+ */
+#include <time.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <elf.h>
+#include "riscv.h"
+#include "debug.h"
+#include "insn.h"
+#include "memory.h"
+#include "proc.h"
+
+#define ROUNDS 5
+#define ELF_BASE 0x10000
+#define ELF_OFFSET 0x1000
+#define MAX_RESULTS 64
+#define NAME_LEN 48
+
+// Instructions of the decode mix
+#define MIX_LEN 4096
+// Accessed by the memory benchmarks, few enough pages to always hit the TLB
+#define MEM_BASE 0x10000000
+#define MEM_SPAN 0x10000
+// Pages a heap grows by, one at a time
+#define BRK_PAGES 4096
+// Text and as much .bss of the ELF loadproc() is timed with, in MiB
+#define LOAD_SIZE 64
+// Longest guest kernel, in instructions
+#define KERNEL_MAX 64
+
+struct result {
+	char name[NAME_LEN];
+	const char *unit;
+	bool higher; // Higher is better, e.g. throughput and not time
+	double value;
+};
+
+struct suite {
+	struct result results[MAX_RESULTS];
+	size_t n;
+	uint64_t scale; // Of the work of every benchmark, see -s
+};
+
+// Writes the loop of a guest kernel in `code`, returns its length
+typedef size_t kernel_t(insn_t *code);
+
+static void usage(const char *argv0) __attribute__((nonnull, cold));
+static double now(void);
+static uint64_t randbits(uint64_t *state) __attribute__((nonnull));
+static void report(struct suite *s, const char *name, const char *unit,
+		   bool higher, double value) __attribute__((nonnull));
+
+static insn_t rtype(insn_t match, unsigned rd, unsigned rs1, unsigned rs2);
+static insn_t itype(insn_t match, unsigned rd, unsigned rs1, int32_t imm);
+static insn_t stype(insn_t match, unsigned rs1, unsigned rs2, int32_t imm);
+static insn_t btype(insn_t match, unsigned rs1, unsigned rs2, int32_t imm);
+static insn_t jtype(unsigned rd, int32_t imm);
+static int writeelf(FILE *fp, const insn_t *code, size_t len, uint64_t size)
+	__attribute__((nonnull(1)));
+static int tmpelf(char *path, const insn_t *code, size_t len, uint64_t size)
+	__attribute__((nonnull(1)));
+
+static size_t kernel_alu(insn_t *code) __attribute__((nonnull));
+static size_t kernel_ldst(insn_t *code) __attribute__((nonnull));
+static size_t kernel_branch(insn_t *code) __attribute__((nonnull));
+static size_t kernel_call(insn_t *code) __attribute__((nonnull));
+
+static int bench_decode(struct suite *s) __attribute__((nonnull));
+static double timeload8(struct memory *mem, uint64_t count, uint64_t *acc)
+	__attribute__((nonnull));
+static double timeload16(struct memory *mem, uint64_t count, uint64_t *acc)
+	__attribute__((nonnull));
+static double timeload32(struct memory *mem, uint64_t count, uint64_t *acc)
+	__attribute__((nonnull));
+static double timeload64(struct memory *mem, uint64_t count, uint64_t *acc)
+	__attribute__((nonnull));
+static double timestore8(struct memory *mem, uint64_t count)
+	__attribute__((nonnull));
+static double timestore16(struct memory *mem, uint64_t count)
+	__attribute__((nonnull));
+static double timestore32(struct memory *mem, uint64_t count)
+	__attribute__((nonnull));
+static double timestore64(struct memory *mem, uint64_t count)
+	__attribute__((nonnull));
+static int bench_mem(struct suite *s, bool flat) __attribute__((nonnull));
+static int bench_memseg(struct suite *s, unsigned nsegs)
+	__attribute__((nonnull));
+static int bench_brk(struct suite *s, bool flat) __attribute__((nonnull));
+static int bench_loadproc(struct suite *s) __attribute__((nonnull));
+static int bench_kernel(struct suite *s, const char *name, kernel_t *kernel)
+	__attribute__((nonnull));
+
+static int write_json(const struct suite *s, const struct suite *base,
+		      double threshold, FILE *fp)
+	__attribute__((nonnull(1, 4)));
+static int read_json(struct suite *s, const char *path)
+	__attribute__((nonnull));
+static const struct result *find(const struct suite *s, const char *name)
+	__attribute__((nonnull));
+static double change(const struct result *r, const struct result *old)
+	__attribute__((nonnull));
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [-o output] [-b baseline] [-t threshold] "
+		"[-s scale]\n", argv0);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// xorshift64*
+static uint64_t randbits(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+static void report(struct suite *s, const char *name, const char *unit,
+		   bool higher, double value)
+{
+	struct result *r;
+
+	fprintf(stderr, "%-24s %12.3f %s\n", name, value, unit);
+	if (s->n == MAX_RESULTS)
+		return;
+	r = &s->results[s->n++];
+	snprintf(r->name, sizeof(r->name), "%s", name);
+	r->unit = unit;
+	r->higher = higher;
+	r->value = value;
+}
+
+static insn_t rtype(insn_t match, unsigned rd, unsigned rs1, unsigned rs2)
+{
+	return match | rd << 7 | rs1 << 15 | rs2 << 20;
+}
+
+static insn_t itype(insn_t match, unsigned rd, unsigned rs1, int32_t imm)
+{
+	return match | rd << 7 | rs1 << 15 | ((insn_t)imm & 0xfff) << 20;
+}
+
+static insn_t stype(insn_t match, unsigned rs1, unsigned rs2, int32_t imm)
+{
+	return match | ((insn_t)imm & 0x1f) << 7 | rs1 << 15 | rs2 << 20 |
+	       ((insn_t)imm & 0xfe0) << 20;
+}
+
+static insn_t btype(insn_t match, unsigned rs1, unsigned rs2, int32_t imm)
+{
+	const insn_t u = (insn_t)imm;
+
+	return match | (u >> 12 & 0x1) << 31 | (u >> 5 & 0x3f) << 25 |
+	       rs2 << 20 | rs1 << 15 | (u >> 1 & 0xf) << 8 |
+	       (u >> 11 & 0x1) << 7;
+}
+
+static insn_t jtype(unsigned rd, int32_t imm)
+{
+	const insn_t u = (insn_t)imm;
+
+	return MATCH_JAL | (u & 0x100000) << 11 | (u & 0x7fe) << 20 |
+	       (u & 0x800) << 9 | (u & 0xff000) | rd << 7;
+}
+
+/*
+ * Writes an ELF whose single PT_LOAD segment, at its entry, holds `code` or
+ * `size` bytes of zeroes if it is NULL, followed by as much .bss
+ */
+static int writeelf(FILE *fp, const insn_t *code, size_t len, uint64_t size)
+{
+	static const unsigned char chunk[1 << 16];
+	Elf64_Ehdr elfh = {
+		.e_ident = {ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS64,
+			    ELFDATA2LSB, EV_CURRENT, ELFOSABI_SYSV},
+		.e_type = ET_EXEC,
+		.e_machine = EM_RISCV,
+		.e_version = EV_CURRENT,
+		.e_entry = ELF_BASE,
+		.e_phoff = sizeof(Elf64_Ehdr),
+		.e_ehsize = sizeof(Elf64_Ehdr),
+		.e_phentsize = sizeof(Elf64_Phdr),
+		.e_phnum = 1,
+	};
+	Elf64_Phdr elfph = {
+		.p_type = PT_LOAD,
+		.p_flags = PF_R | PF_X,
+		.p_offset = ELF_OFFSET,
+		.p_vaddr = ELF_BASE,
+		.p_paddr = ELF_BASE,
+		.p_align = 0x1000,
+	};
+
+	if (code)
+		size = len * sizeof(*code);
+	elfph.p_filesz = size;
+	elfph.p_memsz = code ? size : 2 * size;
+	if (fwrite(&elfh, sizeof(elfh), 1, fp) != 1 ||
+	    fwrite(&elfph, sizeof(elfph), 1, fp) != 1 ||
+	    fseek(fp, ELF_OFFSET, SEEK_SET) == -1)
+		return -1;
+	if (code && fwrite(code, sizeof(*code), len, fp) != len)
+		return -1;
+	for (uint64_t i = 0; !code && i < size; i += sizeof(chunk))
+		if (fwrite(chunk, sizeof(chunk), 1, fp) != 1)
+			return -1;
+	return fflush(fp);
+}
+
+/*
+ * writeelf() to a new temporary file, whose name goes to `path`, which must
+ * hold "/tmp/rvrun-bench-XXXXXX". The caller unlinks it.
+ */
+static int tmpelf(char *path, const insn_t *code, size_t len, uint64_t size)
+{
+	FILE *fp;
+	int fd;
+
+	strcpy(path, "/tmp/rvrun-bench-XXXXXX");
+	if ((fd = mkstemp(path)) == -1)
+		return -1;
+	if (!(fp = fdopen(fd, "w+b"))) {
+		close(fd);
+		unlink(path);
+		return -1;
+	}
+	if (writeelf(fp, code, len, size) == -1) {
+		fclose(fp);
+		unlink(path);
+		return -1;
+	}
+	fclose(fp);
+	return 0;
+}
+
+// Integer ALU instructions chained through t0-t2 and a0-a7, some of them nops
+static size_t kernel_alu(insn_t *code)
+{
+	static const insn_t ops[] = {
+		MATCH_ADD, MATCH_XOR, MATCH_ADDI, MATCH_SUB, MATCH_SLLI,
+		MATCH_SLTU, MATCH_ADDW, MATCH_ADDI,
+	};
+	const size_t len = 48;
+	unsigned rd, rs1, rs2;
+
+	for (unsigned i = 0; i < len; ++i) {
+		rd = 10 + i % 8;
+		rs1 = 5 + i % 3;
+		rs2 = 10 + (i + 3) % 8;
+		if (i % 8 == 7)
+			code[i] = itype(MATCH_ADDI, 0, 0, 0);
+		else if (ops[i % 8] == MATCH_ADDI)
+			code[i] = itype(MATCH_ADDI, rd, rs2, (int32_t)i);
+		else if (ops[i % 8] == MATCH_SLLI)
+			code[i] = itype(MATCH_SLLI, rd, rs2, 3);
+		else
+			code[i] = rtype(ops[i % 8], rd, rs1, rs2);
+	}
+	code[len] = jtype(0, -(int32_t)len * 4);
+	return len + 1;
+}
+
+// Stores and loads of every size below the stack pointer, and their uses
+static size_t kernel_ldst(insn_t *code)
+{
+	static const insn_t stores[] = {MATCH_SD, MATCH_SW, MATCH_SH, MATCH_SB};
+	static const insn_t loads[] = {MATCH_LD, MATCH_LW, MATCH_LHU, MATCH_LB};
+	const size_t len = 48;
+	unsigned rd, k;
+	int32_t off;
+
+	for (unsigned i = 0; i < len; ++i) {
+		k = i / 3;
+		rd = 10 + k % 8;
+		off = -8 * (int32_t)(k % 8 + 1);
+		switch (i % 3) {
+		case 0:
+			code[i] = stype(stores[k % 4], REG_SP, rd, off);
+			break;
+		case 1:
+			code[i] = itype(loads[k % 4], 5, REG_SP, off);
+			break;
+		default:
+			code[i] = rtype(MATCH_ADD, rd, rd, 5);
+			break;
+		}
+	}
+	code[len] = jtype(0, -(int32_t)len * 4);
+	return len + 1;
+}
+
+/*
+ * Branches taken at random, on the bits of a xorshift generator in a0, so
+ * that blocks exit one way or the other
+ */
+static size_t kernel_branch(insn_t *code)
+{
+	size_t len = 0;
+
+	code[len++] = itype(MATCH_ADDI, 10, 0, 1);
+	code[len++] = itype(MATCH_SLLI, 5, 10, 13);
+	code[len++] = rtype(MATCH_XOR, 10, 10, 5);
+	code[len++] = itype(MATCH_SRLI, 5, 10, 7);
+	code[len++] = rtype(MATCH_XOR, 10, 10, 5);
+	code[len++] = itype(MATCH_SLLI, 5, 10, 17);
+	code[len++] = rtype(MATCH_XOR, 10, 10, 5);
+	for (unsigned i = 0; i < 4; ++i) {
+		code[len++] = itype(MATCH_ANDI, 6, 10, 1 << i);
+		code[len++] = btype(i % 2 ? MATCH_BNE : MATCH_BEQ, 6, 0, 8);
+		code[len++] = itype(MATCH_ADDI, 11 + i, 11 + i, 1);
+	}
+	// Back to the first slli
+	code[len] = jtype(0, -(int32_t)(len - 1) * 4);
+	return len + 1;
+}
+
+// Calls to a leaf function that increments a1, and its returns
+static size_t kernel_call(insn_t *code)
+{
+	const size_t ncalls = 8;
+
+	for (unsigned i = 0; i < ncalls; ++i)
+		code[i] = jtype(REG_RA, (int32_t)(ncalls + 1 - i) * 4);
+	code[ncalls] = jtype(0, -(int32_t)ncalls * 4);
+	code[ncalls + 1] = itype(MATCH_ADDI, 11, 11, 1);
+	code[ncalls + 2] = itype(MATCH_JALR, 0, REG_RA, 0);
+	return ncalls + 3;
+}
+
+// insn_decode() of random operands of the instructions of every extension
+static int bench_decode(struct suite *s)
+{
+	static const insn_t templates[] = {
+		MATCH_LUI, MATCH_AUIPC, MATCH_JAL, MATCH_JALR, MATCH_BEQ,
+		MATCH_BNE, MATCH_BLT, MATCH_BGEU, MATCH_LB, MATCH_LW, MATCH_LD,
+		MATCH_LBU, MATCH_SB, MATCH_SW, MATCH_SD, MATCH_ADDI,
+		MATCH_SLTIU, MATCH_XORI, MATCH_ANDI, MATCH_SLLI, MATCH_SRAI,
+		MATCH_ADD, MATCH_SUB, MATCH_SLTU, MATCH_OR, MATCH_SRL,
+		MATCH_ADDIW, MATCH_ADDW, MATCH_SRAW, MATCH_FENCE, MATCH_MUL,
+		MATCH_MULHU, MATCH_DIV, MATCH_REMUW, MATCH_LR_D, MATCH_SC_D,
+		MATCH_AMOADD_W, MATCH_AMOMAXU_D, MATCH_SH1ADD, MATCH_ANDN,
+		MATCH_CLZ, MATCH_BSET, MATCH_FADD_D, MATCH_FMUL_S,
+		MATCH_FMADD_D, MATCH_FLD, MATCH_FSD, MATCH_FEQ_D,
+	};
+	const size_t ntemplates = sizeof(templates) / sizeof(*templates);
+	const uint64_t rounds = 2000 * s->scale;
+	static insn_t mix[MIX_LEN];
+	volatile uintptr_t sink = 0;
+	uint64_t state = 42;
+	uintptr_t acc = 0;
+	double t0, best = 0;
+
+	// Random rd, rs1 and rs2, unless rs2 is part of the opcode
+	for (size_t i = 0; i < MIX_LEN; ++i) {
+		mix[i] = templates[randbits(&state) % ntemplates];
+		if (mix[i] == MATCH_LR_D || mix[i] == MATCH_CLZ)
+			mix[i] |= (insn_t)(randbits(&state) & 0xf8f80);
+		else
+			mix[i] |= (insn_t)(randbits(&state) & 0x1ff8f80);
+		if (!insn_decode(mix[i])) {
+			fprintf(stderr, "bench_suite: cannot decode 0x%.8x\n",
+				mix[i]);
+			return -1;
+		}
+	}
+
+	for (int r = 0; r < ROUNDS; ++r) {
+		t0 = now();
+		for (uint64_t j = 0; j < rounds; ++j)
+			for (size_t i = 0; i < MIX_LEN; ++i)
+				acc += (uintptr_t)insn_decode(mix[i]);
+		t0 = now() - t0;
+		if (r == 0 || t0 < best)
+			best = t0;
+	}
+	sink = acc;
+	(void)sink;
+	report(s, "insn_decode", "Minsn/s", true,
+	       (double)(rounds * MIX_LEN) / best / 1e6);
+	return 0;
+}
+
+/*
+ * timeload8() to timeload64() and timestore8() to timestore64(), best time of
+ * ROUNDS of `count` accesses in sequence over MEM_SPAN bytes at MEM_BASE. The
+ * size is a constant, as it is in the handlers.
+ */
+#define TIME_MEM(bits, type)						\
+static double timeload##bits(struct memory *mem, uint64_t count,	\
+			     uint64_t *acc)				\
+{									\
+	double t0, best = 0;						\
+	uint64_t sum = 0;						\
+	rvaddr_t addr;							\
+	type val;							\
+									\
+	for (int r = 0; r < ROUNDS; ++r) {				\
+		t0 = now();						\
+		for (uint64_t j = 0; j < count; ++j) {			\
+			addr = MEM_BASE +				\
+			       (j * sizeof(val) & (MEM_SPAN - 1));	\
+			memload(mem, addr, &val);			\
+			sum += val;					\
+		}							\
+		t0 = now() - t0;					\
+		if (r == 0 || t0 < best)				\
+			best = t0;					\
+	}								\
+	*acc += sum;							\
+	return best;							\
+}									\
+									\
+static double timestore##bits(struct memory *mem, uint64_t count)	\
+{									\
+	double t0, best = 0;						\
+	rvaddr_t addr;							\
+	type val;							\
+									\
+	for (int r = 0; r < ROUNDS; ++r) {				\
+		t0 = now();						\
+		for (uint64_t j = 0; j < count; ++j) {			\
+			addr = MEM_BASE +				\
+			       (j * sizeof(val) & (MEM_SPAN - 1));	\
+			val = (type)j;					\
+			memstore(mem, addr, &val);			\
+		}							\
+		t0 = now() - t0;					\
+		if (r == 0 || t0 < best)				\
+			best = t0;					\
+	}								\
+	return best;							\
+}
+TIME_MEM(8, uint8_t)
+TIME_MEM(16, uint16_t)
+TIME_MEM(32, uint32_t)
+TIME_MEM(64, uint64_t)
+#undef TIME_MEM
+
+// memloadN() and memstoreN() of every size, in one segment
+static int bench_mem(struct suite *s, bool flat)
+{
+	static const struct {
+		unsigned bits;
+		double (*load)(struct memory *, uint64_t, uint64_t *);
+		double (*store)(struct memory *, uint64_t);
+	} sizes[] = {
+		{8, timeload8, timestore8},
+		{16, timeload16, timestore16},
+		{32, timeload32, timestore32},
+		{64, timeload64, timestore64},
+	};
+	const uint64_t count = 20000000 * s->scale;
+	const char *mode = flat ? "flat" : "checked";
+	volatile uint64_t sink = 0;
+	struct memory mem;
+	struct memseg *seg;
+	char name[NAME_LEN];
+	double tload, tstore;
+	uint64_t acc = 0;
+
+	initmem(&mem, flat);
+	if (flat && !mem.flat) {
+		fprintf(stderr, "bench_suite: no flat memory, skipping it\n");
+		freemem(&mem);
+		return 0;
+	}
+	if (!(seg = addseg(&mem, MEM_BASE, MEM_BASE + MEM_SPAN,
+			   MEM_READ | MEM_WRITE)) ||
+	    protectseg(&mem, seg) == -1) {
+		perror("bench_suite: segment");
+		freemem(&mem);
+		return -1;
+	}
+
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i) {
+		tload = sizes[i].load(&mem, count, &acc);
+		tstore = sizes[i].store(&mem, count);
+		snprintf(name, sizeof(name), "memload%u_%s", sizes[i].bits,
+			 mode);
+		report(s, name, "Maccess/s", true, (double)count / tload / 1e6);
+		snprintf(name, sizeof(name), "memstore%u_%s", sizes[i].bits,
+			 mode);
+		report(s, name, "Maccess/s", true,
+		       (double)count / tstore / 1e6);
+	}
+	sink = acc;
+	(void)sink;
+	freemem(&mem);
+	return 0;
+}
+
+// is_memseg() of 8 bytes in a random one of `nsegs` one-page segments
+static int bench_memseg(struct suite *s, unsigned nsegs)
+{
+	const uint64_t count = (UINT64_C(1) << 24) / nsegs * s->scale;
+	volatile uintptr_t sink = 0;
+	uintptr_t acc = 0;
+	uint64_t state = 7;
+	struct memory mem;
+	char name[NAME_LEN];
+	double t0, best = 0;
+	rvaddr_t addr;
+
+	initmem(&mem, false);
+	// With a page between each, so that none can merge
+	for (unsigned i = 0; i < nsegs; ++i) {
+		addr = MEM_BASE + 2 * i * PGSIZE;
+		if (!addseg(&mem, addr, addr + PGSIZE, MEM_READ)) {
+			perror("bench_suite: segment");
+			freemem(&mem);
+			return -1;
+		}
+	}
+
+	for (int r = 0; r < ROUNDS; ++r) {
+		t0 = now();
+		for (uint64_t j = 0; j < count; ++j) {
+			addr = randbits(&state);
+			addr = MEM_BASE + 2 * (addr % nsegs) * PGSIZE +
+			       (addr >> 32 & (PGSIZE - 8));
+			acc += (uintptr_t)is_memseg(&mem, addr, addr + 8);
+		}
+		t0 = now() - t0;
+		if (r == 0 || t0 < best)
+			best = t0;
+	}
+	sink = acc;
+	(void)sink;
+	freemem(&mem);
+	snprintf(name, sizeof(name), "is_memseg_%u", nsegs);
+	report(s, name, "Mlookup/s", true, (double)count / best / 1e6);
+	return 0;
+}
+
+/*
+ * resizeseg() of a heap growing by BRK_PAGES pages one at a time, which stores
+ * to its top page after each, as sys_brk() and a guest do. Fails if a resize
+ * does, or if a page lost what was stored to it.
+ */
+static int bench_brk(struct suite *s, bool flat)
+{
+	const uint64_t npages = BRK_PAGES * s->scale;
+	char name[NAME_LEN];
+	struct memory mem;
+	struct memseg *seg;
+	double t0, best = 0;
+	rvaddr_t top;
+	uint64_t val;
+
+	for (int r = 0; r < ROUNDS; ++r) {
+		initmem(&mem, flat);
+		if (flat && !mem.flat) {
+			fprintf(stderr, "bench_suite: no flat memory, "
+				"skipping it\n");
+			freemem(&mem);
+			return 0;
+		}
+		if (!(seg = addseg(&mem, MEM_BASE, MEM_BASE + PGSIZE,
+				   MEM_READ | MEM_WRITE)) ||
+		    protectseg(&mem, seg) == -1) {
+			perror("bench_suite: segment");
+			freemem(&mem);
+			return -1;
+		}
+
+		t0 = now();
+		for (uint64_t i = 0; i < npages; ++i) {
+			top = MEM_BASE + (i + 2) * PGSIZE;
+			if (resizeseg(&mem, seg, top) == -1) {
+				perror("bench_suite: resizeseg");
+				freemem(&mem);
+				return -1;
+			}
+			val = i;
+			memstore(&mem, top - 8, &val);
+		}
+		t0 = now() - t0;
+		if (r == 0 || t0 < best)
+			best = t0;
+
+		for (uint64_t i = 0; i < npages; ++i) {
+			memload(&mem, MEM_BASE + (i + 2) * PGSIZE - 8, &val);
+			if (val != i) {
+				fprintf(stderr, "bench_suite: heap page %lu "
+					"lost its contents\n", i + 1);
+				freemem(&mem);
+				return -1;
+			}
+		}
+		freemem(&mem);
+	}
+	snprintf(name, sizeof(name), "resizeseg_grow_%s",
+		 flat ? "flat" : "checked");
+	report(s, name, "Kresize/s", true, (double)npages / best / 1e3);
+	return 0;
+}
+
+/*
+ * loadproc() of an ELF with LOAD_SIZE MiB of text and as much .bss, mapping
+ * it and copying it
+ */
+static int bench_loadproc(struct suite *s)
+{
+	static const struct {
+		const char *name;
+		struct procopts opts;
+	} runs[] = {
+		{"loadproc", {.flatmem = true}},
+		{"loadproc_fread", {.flatmem = true, .elfread = true}},
+	};
+	char path[sizeof("/tmp/rvrun-bench-XXXXXX")];
+	struct proc *proc;
+	double t0, best;
+
+	if (tmpelf(path, NULL, 0, (uint64_t)LOAD_SIZE << 20) == -1) {
+		perror("bench_suite: temporary ELF");
+		return -1;
+	}
+	for (size_t i = 0; i < sizeof(runs) / sizeof(*runs); ++i) {
+		best = 0;
+		// Once more first, to get the file in the page cache
+		for (int r = -1; r < ROUNDS; ++r) {
+			t0 = now();
+			if (!(proc = loadproc(path, &runs[i].opts))) {
+				perror("bench_suite: loadproc");
+				unlink(path);
+				return -1;
+			}
+			t0 = now() - t0;
+			freeproc(proc);
+			if (r == 0 || (r > 0 && t0 < best))
+				best = t0;
+		}
+		report(s, runs[i].name, "ms", false, best * 1e3);
+	}
+	unlink(path);
+	return 0;
+}
+
+// Runs an endless guest kernel with flat memory, with and without the JIT
+static int bench_kernel(struct suite *s, const char *name, kernel_t *kernel)
+{
+	// Translated code runs longer, so that it is timed long enough too
+	static const struct {
+		const char *name;
+		uint64_t count;
+		struct procopts opts;
+	} runs[] = {
+		{"interp", 50000000, {.flatmem = true}},
+		{"jit", 200000000, {.flatmem = true, .jit = true}},
+	};
+	char path[sizeof("/tmp/rvrun-bench-XXXXXX")];
+	char rname[NAME_LEN];
+	insn_t code[KERNEL_MAX];
+	struct proc *proc;
+	double t0, best;
+	uint64_t retired = 0;
+	size_t len;
+
+	len = kernel(code);
+	if (tmpelf(path, code, len, 0) == -1) {
+		perror("bench_suite: temporary ELF");
+		return -1;
+	}
+	for (size_t i = 0; i < sizeof(runs) / sizeof(*runs); ++i) {
+		best = 0;
+		for (int r = 0; r < ROUNDS; ++r) {
+			if (!(proc = loadproc(path, &runs[i].opts))) {
+				perror("bench_suite: loadproc");
+				unlink(path);
+				return -1;
+			}
+			t0 = now();
+			if (proc_run(proc, runs[i].count * s->scale) == -1) {
+				perror("bench_suite: proc_run");
+				freeproc(proc);
+				unlink(path);
+				return -1;
+			}
+			t0 = now() - t0;
+			retired = proc->instret;
+			freeproc(proc);
+			if (r == 0 || t0 < best)
+				best = t0;
+		}
+		snprintf(rname, sizeof(rname), "mips_%s_%s", name,
+			 runs[i].name);
+		report(s, rname, "MIPS", true, (double)retired / best / 1e6);
+	}
+	unlink(path);
+	return 0;
+}
+
+/*
+ * Writes the results of `s`, one per line, with how they changed since those
+ * of `base` if it isn't NULL
+ */
+static int write_json(const struct suite *s, const struct suite *base,
+		      double threshold, FILE *fp)
+{
+	const struct result *r, *old;
+	double diff;
+
+	fprintf(fp, "{\n  \"rounds\": %d,\n  \"scale\": %lu,\n", ROUNDS,
+		s->scale);
+	if (base)
+		fprintf(fp, "  \"threshold\": %.1f,\n", threshold);
+	fprintf(fp, "  \"results\": [\n");
+	for (size_t i = 0; i < s->n; ++i) {
+		r = &s->results[i];
+		fprintf(fp, "    {\"name\": \"%s\", \"unit\": \"%s\", "
+			"\"better\": \"%s\", \"value\": %.3f", r->name, r->unit,
+			r->higher ? "higher" : "lower", r->value);
+		if (base && (old = find(base, r->name))) {
+			diff = change(r, old);
+			fprintf(fp, ", \"baseline\": %.3f, \"change\": %.2f, "
+				"\"regression\": %s", old->value, diff,
+				diff < -threshold ? "true" : "false");
+		}
+		fprintf(fp, "}%s\n", i + 1 < s->n ? "," : "");
+	}
+	fprintf(fp, "  ]\n}\n");
+	return fflush(fp);
+}
+
+/*
+ * Reads the results of an earlier run, as write_json() wrote them: only the
+ * name and value of every line that has them
+ */
+static int read_json(struct suite *s, const char *path)
+{
+	static const char name_key[] = "\"name\": \"";
+	static const char value_key[] = "\"value\": ";
+	struct result *r;
+	char line[512];
+	char *name, *value, *end;
+	FILE *fp;
+
+	if (!(fp = fopen(path, "r")))
+		return -1;
+	s->n = 0;
+	while (s->n < MAX_RESULTS && fgets(line, sizeof(line), fp)) {
+		if (!(name = strstr(line, name_key)) ||
+		    !(value = strstr(line, value_key)))
+			continue;
+		name += sizeof(name_key) - 1;
+		if (!(end = strchr(name, '"')))
+			continue;
+		r = &s->results[s->n++];
+		snprintf(r->name, sizeof(r->name), "%.*s", (int)(end - name),
+			 name);
+		r->value = strtod(value + sizeof(value_key) - 1, NULL);
+	}
+	fclose(fp);
+	return 0;
+}
+
+static const struct result *find(const struct suite *s, const char *name)
+{
+	for (size_t i = 0; i < s->n; ++i)
+		if (!strcmp(s->results[i].name, name))
+			return &s->results[i];
+	return NULL;
+}
+
+// How much better `r` is than `old`, in percent, negative if it is worse
+static double change(const struct result *r, const struct result *old)
+{
+	double diff;
+
+	if (old->value <= 0 || r->value <= 0)
+		return 0;
+	diff = (r->value - old->value) / old->value * 100;
+	// Times that doubled are as much worse as throughputs that halved
+	if (!r->higher)
+		diff = (old->value - r->value) / r->value * 100;
+	return diff;
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct {
+		const char *name;
+		kernel_t *kernel;
+	} kernels[] = {
+		{"alu", kernel_alu},
+		{"ldst", kernel_ldst},
+		{"branch", kernel_branch},
+		{"call", kernel_call},
+	};
+	static struct suite s = {.scale = 1};
+	static struct suite base;
+	const char *out = NULL;
+	const char *baseline = NULL;
+	const struct result *old;
+	double threshold = 5;
+	double diff;
+	unsigned regressions = 0;
+	FILE *fp = stdout;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "o:b:t:s:")) != -1) {
+		switch (opt) {
+		case 'o':
+			out = optarg;
+			break;
+		case 'b':
+			baseline = optarg;
+			break;
+		case 't':
+			threshold = strtod(optarg, NULL);
+			break;
+		case 's':
+			s.scale = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind < argc || s.scale == 0 || threshold < 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (baseline && read_json(&base, baseline) == -1) {
+		perror(baseline);
+		return 1;
+	}
+	log_setlevel(LOG_LVL_ERR);
+
+	if (bench_decode(&s) == -1 || bench_mem(&s, true) == -1 ||
+	    bench_mem(&s, false) == -1 || bench_memseg(&s, 16) == -1 ||
+	    bench_memseg(&s, 1024) == -1 || bench_brk(&s, true) == -1 ||
+	    bench_brk(&s, false) == -1 || bench_loadproc(&s) == -1)
+		return 1;
+	for (size_t i = 0; i < sizeof(kernels) / sizeof(*kernels); ++i)
+		if (bench_kernel(&s, kernels[i].name, kernels[i].kernel) == -1)
+			return 1;
+
+	if (out && !(fp = fopen(out, "w"))) {
+		perror(out);
+		return 1;
+	}
+	if (write_json(&s, baseline ? &base : NULL, threshold, fp) != 0) {
+		perror(out ? out : "bench_suite: stdout");
+		return 1;
+	}
+	if (out)
+		fclose(fp);
+
+	for (size_t i = 0; baseline && i < s.n; ++i) {
+		if (!(old = find(&base, s.results[i].name)))
+			continue;
+		diff = change(&s.results[i], old);
+		if (diff >= -threshold)
+			continue;
+		fprintf(stderr, "regression: %s %.3f %s, was %.3f (%.1f%%)\n",
+			s.results[i].name, s.results[i].value,
+			s.results[i].unit, old->value, diff);
+		++regressions;
+	}
+	return regressions ? 2 : 0;
+}
@@ -0,0 +1,83 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "proc.h"
+
+/*
+ * Runs many guests on a pool of worker threads. Every worker has a deque of
+ * the guests it runs, it pushes them at the bottom and takes them from the
+ * top, like the thieves do, so that its guests get time slices of `slice`
+ * instructions round robin. A worker whose deque is empty steals from the
+ * others. No lock is taken between slices, only atomics.
+ *
+ * Guests are loaded lazily, by the worker that starts them, and freed once
+ * they are done, so that at most about `max_live` are in memory at once
+ * (every flat memory reserves FLAT_SIZE of host address space).
+ */
+#define BATCH_SLICE_DEFAULT 1000000
+#define BATCH_LIVE_PER_WORKER 16
+
+// Options of batch_run(), a zeroed structure gives the defaults
+struct batchopts {
+	unsigned workers; // 0 for one per online CPU
+	uint64_t slice; // Instructions per time slice, 0 for the default
+	unsigned max_live; // Guests loaded at once, 0 for the default
+	struct procopts procopts; // Of every guest, which can't be traced
+};
+
+enum guest_state {
+	GUEST_PENDING,
+	GUEST_EXITED, // `exit_code` is set
+	GUEST_TRAPPED, // `trap` and `pc` are set
+	GUEST_FAILED, // Couldn't be loaded or run, `err` is its errno
+};
+
+/*
+ * A guest of the batch, the caller sets `path`, or `image` to spawn it from
+ * one, and batch_run() the rest. Times are in seconds since the batch
+ * started.
+ */
+struct guest {
+	const char *path;
+	const struct image *image; // NULL to load `path`
+	struct proc *proc; // While it is live
+	enum guest_state state;
+	int exit_code;
+	struct trap trap;
+	rvaddr_t pc;
+	int err;
+	uint64_t instret;
+	double start; // Started loading
+	double loaded;
+	double end; // Done
+};
+
+struct batchstats {
+	unsigned workers;
+	double secs; // Wall clock time of the batch
+	uint64_t instret; // Of every guest
+	uint64_t slices;
+	uint64_t steals;
+	size_t exited;
+	size_t trapped;
+	size_t failed;
+	double load_mean; // Time to load a guest
+	// Time from load to the end of each guest
+	double lat_mean;
+	double lat_p50;
+	double lat_p99;
+	double lat_max;
+};
+
+/*
+ * Runs the `n` guests to completion and fills `stats`. Returns 0 once every
+ * guest is done, whatever their state, or -1 with errno set if the workers
+ * can't be started.
+ */
+int batch_run(struct guest *guests, size_t n, const struct batchopts *opts,
+	      struct batchstats *stats) __attribute__((nonnull));
+
+#endif // BATCH_H
@@ -0,0 +1,192 @@
+#ifndef BBCACHE_H
+#define BBCACHE_H
+
+#include <stdint.h>
+#include "riscv.h"
+#include "proc.h"
+#include "insn.h"
+#include "jit.h"
+
+// Maximum number of instructions in a basic block
+#define BB_MAXLEN 64
+#define BBCACHE_BITS 12
+#define BBCACHE_SIZE (1 << BBCACHE_BITS)
+
+// Sizes of the jump cache and return address stack, can be tuned with -D
+#ifndef BB_JCACHE_BITS
+#define BB_JCACHE_BITS 10
+#endif
+#define BB_JCACHE_SIZE (1 << BB_JCACHE_BITS)
+#ifndef BB_RAS_LEN
+#define BB_RAS_LEN 16
+#endif
+
+// How the last instruction of a block links, following the JAL/JALR hints
+enum bb_flags {
+	BB_CALL=0x1, // Pushes its return address
+	BB_RET=0x2, // Pops one, both for a coroutine swap
+};
+
+/*
+ * Predecoded basic block, covers the `len` instructions in [start, end[. If
+ * the last one doesn't have INSN_TERM set, because the block was cut short
+ * (too long, or the next instruction can't be decoded), insns[len] is an extra
+ * entry that isn't an instruction and only sends execution to `end`.
+ */
+struct bblock {
+	struct bblock *next;
+	rvaddr_t start;
+	rvaddr_t end;
+	uint32_t len;
+	uint32_t execs; // Interpreted executions, up to JIT_THRESHOLD
+	uint32_t flags; // See enum bb_flags
+	struct bblock *ret; // Block at `end`, pushed by BB_CALL once looked up
+	jit_func_t jit; // Native code, see jit.h
+	struct dinsn insns[];
+};
+
+struct bbstats {
+	uint64_t jc_hits;
+	uint64_t jc_misses;
+	uint64_t ras_hits;
+	uint64_t ras_misses;
+};
+
+/*
+ * Cache of basic blocks, hashed by their starting address. Block transitions
+ * first go through `jcache`, which maps a target pc to its block with a single
+ * probe, and returns through `ras`, which holds the blocks at the return
+ * addresses of the calls in flight. Both only hold predictions, checked
+ * against the actual pc, and are cleared whenever blocks are dropped.
+ */
+struct bbcache {
+	struct bblock *tab[BBCACHE_SIZE];
+	struct bblock *jcache[BB_JCACHE_SIZE];
+	struct bblock *ras[BB_RAS_LEN]; // Circular, overflows drop the oldest
+	uint32_t ras_top;
+	struct bblock *pred; // Popped by the last return, for bb_next()
+	struct bbstats stats;
+};
+
+struct bbcache *bbcache_alloc(void) __attribute__((cold));
+void bbcache_free(struct bbcache *cache) __attribute__((nonnull, cold));
+
+/*
+ * Returns the basic block starting at `pc`, predecoding it on first use. Will
+ * return NULL and set errno if the first instruction can't be fetched or
+ * decoded.
+ */
+struct bblock *bb_lookup(struct proc *proc, rvaddr_t pc)
+	__attribute__((nonnull));
+
+// Drops every block that overlaps [start, end[
+void bb_invalidate(struct bbcache *cache, rvaddr_t start, rvaddr_t end)
+	__attribute__((nonnull));
+
+/*
+ * Same as bb_lookup(), through the jump cache. Returns NULL and sets errno
+ * likewise.
+ */
+static inline struct bblock *bb_find(struct proc *proc, rvaddr_t pc)
+	__attribute__((nonnull));
+
+// The block at `proc->pc`, predicted by the return address stack if possible
+static inline struct bblock *bb_next(struct proc *proc)
+	__attribute__((nonnull));
+
+// Updates the return address stack once the last instruction of `blk` ran
+static inline void bb_link(struct proc *proc, struct bblock *blk)
+	__attribute__((nonnull));
+
+/*
+ * Drops the blocks whose code was modified since the last call, according to
+ * the dirty range of `proc->mem`. Must not be called while a block executes.
+ */
+static inline void bb_sync(struct proc *proc) __attribute__((nonnull));
+
+// Interprets a block, traps unwind to proc_run() like in its handlers
+static inline void bb_exec(struct proc *proc, const struct bblock *blk)
+	__attribute__((nonnull));
+
+static inline struct bblock *bb_find(struct proc *proc, rvaddr_t pc)
+{
+	struct bbcache *cache = proc->bbcache;
+	struct bblock **slot = &cache->jcache[(pc >> 2) & (BB_JCACHE_SIZE - 1)];
+
+	if (*slot && (*slot)->start == pc) {
+		++cache->stats.jc_hits;
+		return *slot;
+	}
+	++cache->stats.jc_misses;
+	if (!(*slot = bb_lookup(proc, pc)))
+		return NULL;
+	return *slot;
+}
+
+static inline struct bblock *bb_next(struct proc *proc)
+{
+	struct bbcache *cache = proc->bbcache;
+	struct bblock *pred = cache->pred;
+
+	if (pred) {
+		cache->pred = NULL;
+		if (pred->start == proc->pc) {
+			++cache->stats.ras_hits;
+			return pred;
+		}
+		++cache->stats.ras_misses;
+	}
+	return bb_find(proc, proc->pc);
+}
+
+static inline void bb_link(struct proc *proc, struct bblock *blk)
+{
+	struct bbcache *cache = proc->bbcache;
+
+	if (__builtin_expect(!blk->flags, 1))
+		return;
+	if (blk->flags & BB_RET) {
+		cache->ras_top = (cache->ras_top + BB_RAS_LEN - 1) % BB_RAS_LEN;
+		cache->pred = cache->ras[cache->ras_top];
+		cache->ras[cache->ras_top] = NULL;
+	}
+	// A failed lookup pushes NULL, and is retried by the next call
+	if (blk->flags & BB_CALL) {
+		if (!blk->ret)
+			blk->ret = bb_find(proc, blk->end);
+		cache->ras[cache->ras_top] = blk->ret;
+		cache->ras_top = (cache->ras_top + 1) % BB_RAS_LEN;
+	}
+}
+
+static inline void bb_sync(struct proc *proc)
+{
+	if (proc->mem.xdirty_start >= proc->mem.xdirty_end)
+		return;
+	bb_invalidate(proc->bbcache, proc->mem.xdirty_start,
+		      proc->mem.xdirty_end);
+	proc->mem.xdirty_start = proc->mem.xdirty_end = 0;
+}
+
+#ifdef RVRUN_DISPATCH_CALL
+static inline void bb_exec(struct proc *proc, const struct bblock *blk)
+{
+	const struct dinsn *di = blk->insns;
+
+	for (;;) {
+		di->func(proc, di);
+		// The second instruction of a pair already ran
+		if (di->flags & INSN_FUSED)
+			++di;
+		if (di++->flags & INSN_TERM)
+			return;
+	}
+}
+#else
+static inline void bb_exec(struct proc *proc, const struct bblock *blk)
+{
+	blk->insns[0].func(proc, blk->insns);
+}
+#endif
+
+#endif // BBCACHE_H
@@ -1,19 +1,56 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
+#include <stdio.h>
+
+// Log levels, messages below the current level are dropped
+enum log_level {
+	LOG_LVL_DEBUG,
+	LOG_LVL_INFO,
+	LOG_LVL_WARN,
+	LOG_LVL_ERR,
+	LOG_LVL_NONE,
+};
+
+/*
+ * Messages below RVRUN_LOG_MIN are compiled out, arguments included. It is
+ * set with `make LOGLEVEL=...`, and defaults to keeping every message.
+ */
+#ifndef RVRUN_LOG_MIN
+#define RVRUN_LOG_MIN LOG_LVL_DEBUG
+#endif
+
+// Current log level and log stream, see log_setlevel() and log_open()
+extern enum log_level log_level;
+extern FILE *log_stream;
+
+/*
+ * Logging macros, work like fprintf(log_stream, fmt, ...) but display a message
+ * such as "[DEBUG]", "[INFO]", etc. Arguments are only evaluated when the
+ * message is logged.
+ */
+#define dbg_log(...) rvlog_if(LOG_LVL_DEBUG, __VA_ARGS__)
+#define info_log(...) rvlog_if(LOG_LVL_INFO, __VA_ARGS__)
+#define warn_log(...) rvlog_if(LOG_LVL_WARN, __VA_ARGS__)
+#define err_log(...) rvlog_if(LOG_LVL_ERR, __VA_ARGS__)
+
+#define rvlog_if(level, ...) ((level) >= RVRUN_LOG_MIN &&		\
+	__builtin_expect((level) >= log_level, 0) ?			\
+	rvlog(level, __VA_ARGS__) : (void)0)
+
+void rvlog(enum log_level level, const char *restrict fmt, ...)
+	__attribute__((nonnull, cold, format(printf, 2, 3)));
+
+// Sets the log level, levels below RVRUN_LOG_MIN stay compiled out
+void log_setlevel(enum log_level level);
+
 /*
- * Logging functions, work like fprintf(stderr, fmt, ...) but display a message
- * such as "[DEBUG]", "[INFO]", etc. Should be preferred as log-file, filtering,
- * and other features might be added later
+ * Sends the log to the file at `path` through a large buffer instead of to
+ * stderr, which is unbuffered. Returns 0 on success and -1 with errno set.
  */
-void dbg_log(const char *restrict fmt, ...)
-	__attribute__((nonnull, format(printf, 1, 2)));
-void info_log(const char *restrict fmt, ...)
-	__attribute__((nonnull, format(printf, 1, 2)));
-void warn_log(const char *restrict fmt, ...)
-	__attribute__((nonnull, format(printf, 1, 2)));
-void err_log(const char *restrict fmt, ...)
-	__attribute__((nonnull, format(printf, 1, 2)));
+int log_open(const char *path) __attribute__((nonnull, cold));
+// Flushes and closes the log file, if any, logging goes back to stderr
+void log_close(void) __attribute__((cold));
 
 /*
  * Panics, sends a message to stderr with a reason, and the exact file,
@@ -4,22 +4,115 @@
 #include "opcodes.h"
 #define IS_INSN(insn, name) (((insn) & MASK_##name) == (MATCH_##name))
 
+// True if the FENCE `insn` orders earlier stores (pred W) before later loads
+#define FENCE_STORE_LOAD(insn) (((insn) >> 24 & 0x1) && ((insn) >> 21 & 0x1))
+
+#include <stdint.h>
 #include "riscv.h"
 #include "proc.h"
+
+struct dinsn;
+typedef void (*insn_func_t)(struct proc *, const struct dinsn *);
+
+// Flags of a predecoded instruction
+enum insn_flags {
+	INSN_TERM=0x1, // Ends a basic block, sets `proc->pc` itself
+	INSN_LOAD=0x2, // Loads from rs1 + imm
+	INSN_STORE=0x4, // Stores to rs1 + imm
+	INSN_WRD=0x8, // Writes rd, which isn't x0
+	INSN_FUSED=0x10, // Runs the next instruction too, see insn_fuse()
+	INSN_RVC=0x20, // Was compressed, `insn` is its 32-bit expansion
+};
+
+/*
+ * Predecoded instruction, its operands are extracted once by insn_predecode()
+ * so that handlers don't have to. `imm` is already sign-extended (or is the
+ * shift amount for shifts by an immediate), and `rd` is REG_SINK instead of
+ * x0. Compressed instructions are expanded, `len` is 2 for them and `insn` is
+ * the 32-bit instruction they stand for.
+ */
+struct dinsn {
+	insn_func_t func;
+	ireg_t imm;
+	rvaddr_t pc;
+	insn_t insn;
+	uint8_t rd;
+	uint8_t rs1;
+	uint8_t rs2;
+	uint8_t len;
+	uint8_t flags;
+};
+
 /*
- * fetches the next instruction from a process and returns it's size in bytes,
- * will return -1 and set errno if it fails, analogous to memload() but checks
- * for the MEM_EXEC flag, and `addr` is `proc->pc`.
+ * fetches the instruction at `addr` from a process and returns it's size in
+ * bytes, 2 for compressed instructions (which are stored as is in the low half
+ * of `insn`) and 4 otherwise, will return -1 and set errno if it fails,
+ * analogous to memload() but checks for the MEM_EXEC flag. The two halves of
+ * a 32-bit instruction may be on different pages or segments.
  */
-int insn_fetch(struct proc *proc, insn_t *insn) __attribute__((nonnull));
+int insn_fetch(struct proc *proc, rvaddr_t addr, insn_t *insn)
+	__attribute__((nonnull));
 
 /*
  * Decodes an instruction and returns the function that simulates it, will
  * return NULL and set errno to ENOSYS if the instruction is not supported
  */
-int (*insn_decode(insn_t insn))(struct proc *, insn_t);
+insn_func_t insn_decode(insn_t insn);
+
+/*
+ * Decodes the instruction `insn` found at address `pc` into `di`, expanding it
+ * first if it is compressed, returns 0 on success and -1 with errno set to
+ * ENOSYS if the instruction is not supported
+ */
+int insn_predecode(insn_t insn, rvaddr_t pc, struct dinsn *di)
+	__attribute__((nonnull));
+
+/*
+ * Fuses the predecoded instructions di[0] and di[1] if they form a known
+ * idiom, e.g. lui+addi, by pointing di[0] at a handler that simulates both.
+ * Returns 1 if they were fused, the second one must then not be dispatched on
+ * its own, and 0 otherwise. Both entries keep their operands.
+ */
+int insn_fuse(struct dinsn *di) __attribute__((nonnull));
+
+/*
+ * Returns the name of an instruction as in opcodes.h (e.g. "ADDI"), or NULL
+ * with errno set to ENOSYS if the instruction is not supported
+ */
+const char *insn_name(insn_t insn);
+
+/*
+ * Every handler that doesn't end a basic block ends with insn_next(). With
+ * threaded dispatch, the default, it tail-calls the handler of the next
+ * predecoded instruction so a whole block runs without returning to
+ * proc_run(). Building with -DRVRUN_DISPATCH_CALL (make DISPATCH=call) keeps
+ * the plain loop that calls every handler through its pointer instead.
+ * Blocks always end with an INSN_TERM entry, so the chain is bounded by
+ * BB_MAXLEN even if the compiler doesn't turn the calls into jumps.
+ */
+#ifdef RVRUN_DISPATCH_CALL
+#define insn_next(proc, di) ((void)(proc), (void)(di))
+#else
+#define insn_next(proc, di) ((di)[1].func((proc), (di) + 1))
+#endif
+
+/*
+ * Traps on the instruction `di`, leaving `proc->pc` on it. Faulting loads and
+ * stores don't need it, memory faults unwind on their own, see ldst_addr().
+ */
+_Noreturn static inline void insn_trap(struct proc *proc,
+				       const struct dinsn *di,
+				       enum trap_cause cause, rvaddr_t tval)
+	__attribute__((nonnull));
+
+_Noreturn static inline void insn_trap(struct proc *proc,
+				       const struct dinsn *di,
+				       enum trap_cause cause, rvaddr_t tval)
+{
+	proc->pc = di->pc;
+	proc_trap(proc, cause, tval);
+}
 
 #include "rv_i.h"
-typedef int (*insn_func_t)(struct proc *, insn_t);
 
 #endif // INSN_H
@@ -0,0 +1,73 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "riscv.h"
+#include "proc.h"
+
+struct bblock;
+
+/*
+ * Native code of a basic block, runs it on `proc` and returns the number of
+ * instructions retired with `proc->pc` on the next one. It stops early, with
+ * the pc on the instruction, before any instruction it can't run itself, and
+ * flat memory faults go through memfault_arm() as they do for handlers.
+ *
+ * Blocks that branch back to their start keep looping while `budget` allows,
+ * and add the instructions of all but the last iteration to `proc->instret`
+ * themselves.
+ */
+typedef uint32_t (*jit_func_t)(struct proc *proc, uint64_t budget);
+
+// Blocks are translated once they have been executed this many times
+#define JIT_THRESHOLD 64
+#define JIT_CACHE_DEFAULT (16 * 1024 * 1024)
+// Stores a verified block can make, at least BB_MAXLEN
+#define JIT_JOURNAL_LEN 64
+
+/*
+ * Translator of hot basic blocks to x86-64 code, which is appended to an
+ * executable code cache. When the cache is full, it is flushed and every
+ * translation is dropped. Blocks invalidated by bb_sync() just leave their
+ * code behind until the next flush.
+ *
+ * With `verify` set, jit_run() executes blocks with both tiers and panics if
+ * they disagree on the registers, pc, or stored memory. Blocks don't loop
+ * then.
+ */
+struct jit {
+	unsigned char *code;
+	size_t size;
+	size_t used;
+	bool verify;
+	uint64_t compiled; // Blocks translated
+	uint64_t flushes;
+	uint64_t verified; // Blocks checked against the interpreter
+	// Address, old and new value of the stores of the verified block
+	uint64_t journal[JIT_JOURNAL_LEN][3];
+};
+
+/*
+ * Allocates a JIT with a code cache of `size` bytes, JIT_CACHE_DEFAULT if 0.
+ * Returns NULL and sets errno on failure, to ENOSYS if the host isn't x86-64.
+ */
+struct jit *jit_alloc(size_t size, bool verify) __attribute__((cold));
+void jit_free(struct jit *jit) __attribute__((nonnull, cold));
+
+/*
+ * Translates `blk`, whose `jit` is set on success. Blocks whose first
+ * instruction can't be translated are left to the interpreter for good.
+ */
+void jit_compile(struct proc *proc, struct bblock *blk)
+	__attribute__((nonnull));
+
+/*
+ * Runs the translated block `blk` like its jit_func_t, returns the number of
+ * retired instructions. Traps unwind to proc_run() like in the interpreter.
+ */
+uint32_t jit_run(struct proc *proc, struct bblock *blk, uint64_t budget)
+	__attribute__((nonnull));
+
+#endif // JIT_H
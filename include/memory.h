@@ -12,6 +12,18 @@ enum memflags {
 			MEM_WRITE | MEM_EXEC)))
 #include "riscv.h"
 #include <stdint.h>
+#include <stdbool.h>
+#include <setjmp.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <string.h>
+#include <stdlib.h> // abort() in memload() and memstore()
+
+// Guest pages, the granularity of the software TLB
+#define PGSHIFT 12
+#define PGSIZE ((rvaddr_t)1 << PGSHIFT)
+#define PGOFFSET (PGSIZE - 1)
 
 // Memory segments, map addresses in range [start, end[
 struct memseg {
@@ -20,17 +32,138 @@ struct memseg {
 	rvaddr_t start;
 	rvaddr_t end;
 	uint8_t flags;
+	bool snap; // Mapped from the last checkpoint, see snapshot.h
+	bool mapped; // Has had pages mapped from a file, see mapseg()
+};
+
+/*
+ * Software TLB entry, guest page `tag` is at host address `addend + addr`.
+ * Entries only cache pages that are entirely inside one segment, so a hit
+ * needs no bounds check. Invalid entries have a tag that isn't page aligned.
+ */
+struct tlb_entry {
+	rvaddr_t tag;
+	uintptr_t addend;
 };
 
-// Memory structure, linked list of segments
+#define TLB_BITS 8
+#define TLB_SIZE (1 << TLB_BITS)
+#define TLB_INVALID ((rvaddr_t)1)
+
+/*
+ * Direct mapped software TLB, with one table per access type: a page is only
+ * cached in the tables its segment permits, so a hit is also a permission
+ * check. Writable MEM_EXEC pages are never cached for writing so that stores
+ * to them still reach mark_xdirty().
+ */
+struct tlb {
+	struct tlb_entry read[TLB_SIZE];
+	struct tlb_entry write[TLB_SIZE];
+	struct tlb_entry exec[TLB_SIZE];
+};
+
+/*
+ * Host range reserved for flat memory, guest addresses must be below it (this
+ * is the Sv39 user address space).
+ */
+#define FLAT_SIZE ((rvaddr_t)1 << 38)
+
+/*
+ * Memory structure, linked list of segments. Stores to, and removal of,
+ * MEM_EXEC segments grow [xdirty_start, xdirty_end[ so that code predecoded
+ * from there can be dropped, see bb_sync(). The range is empty when
+ * xdirty_start >= xdirty_end.
+ *
+ * With flat memory, guest address `addr` is at host address `flat + addr`
+ * and segments are mapped there with their permissions. Accesses below
+ * `flat_limit` (0 without flat memory) skip every check and rely on host
+ * faults, see memfault_arm(). Stores overlapping [wx_start, wx_end[, which
+ * bounds the writable MEM_EXEC segments, still take the checked path.
+ *
+ * Guest threads each have their own struct memory, for their own TLB and
+ * dirty range, over the same segments and flat memory, see thread.h. Their
+ * `lock` is then the same, and the functions below take it to walk the
+ * segments: changes to them must hold it.
+ */
 struct memory {
 	struct memseg *segments;
+	rvaddr_t xdirty_start;
+	rvaddr_t xdirty_end;
+	unsigned char *flat;
+	rvaddr_t flat_limit;
+	rvaddr_t wx_start;
+	rvaddr_t wx_end;
+	pthread_mutex_t *lock; // NULL without threads, see mem_lock()
+	struct tlb tlb;
 };
 
-// Adds a memory segment
+// Take and release the lock of the segments, no-ops without threads
+static inline void mem_lock(const struct memory *mem) __attribute__((nonnull));
+static inline void mem_unlock(const struct memory *mem)
+	__attribute__((nonnull));
+
+// Adds [start, end[ to the range of modified executable memory
+static inline void mark_xdirty(struct memory *mem, rvaddr_t start,
+			       rvaddr_t end) __attribute__((nonnull));
+
+/*
+ * Initializes an empty memory, must be called before any other function. If
+ * `flat` is set, tries to reserve flat memory and falls back to checked
+ * segments if it can't.
+ */
+void initmem(struct memory *mem, bool flat) __attribute__((nonnull, cold));
+
+/*
+ * Adds a zero-filled memory segment, its host memory is only allocated as it is
+ * touched. With flat memory, its pages stay readable and writable by the host
+ * until protectseg() is called, so that it can be filled.
+ */
 struct memseg *addseg(struct memory *mem, rvaddr_t start, rvaddr_t end,
 		      uint8_t flags) __attribute__((nonnull));
 
+/*
+ * Same as addseg(), for callers that know [start, end[ is free, e.g. because
+ * they hand out addresses above every segment. Doesn't walk the segments.
+ */
+struct memseg *addseg_unchecked(struct memory *mem, rvaddr_t start,
+				rvaddr_t end, uint8_t flags)
+	__attribute__((nonnull));
+
+/*
+ * Moves the end of a segment to `end`, after its start. Added bytes are zero,
+ * and the caller must know they are free. Returns 0 on success and -1 with
+ * errno set.
+ */
+int resizeseg(struct memory *mem, struct memseg *seg, rvaddr_t end)
+	__attribute__((nonnull));
+
+/*
+ * Maps `filesz` bytes of file `fd`, from `offset`, at the start of a segment.
+ * The mapping is private so the file is never written to, and the rest of the
+ * segment stays zero pages that are only allocated when touched. Returns 0 on
+ * success and -1 with errno set if the file can't be mapped there (e.g. its
+ * offset isn't congruent to the segment start modulo PGSIZE), in which case
+ * the caller should copy the data instead.
+ */
+int mapseg(struct memory *mem, struct memseg *seg, int fd, off_t offset,
+	   size_t filesz) __attribute__((nonnull));
+
+/*
+ * Maps `len` bytes of file `fd`, from `offset`, over the pages of a segment
+ * from `addr`, both page aligned, privately like mapseg(). Pages the segment
+ * shares with another one are left alone, the mapping would replace their
+ * contents, so the caller copies them if needed. The file must hold all of
+ * the bytes. With flat memory, the pages stay readable and writable by the
+ * host until protectseg() is called. Returns 0 on success and -1 with errno
+ * set.
+ */
+int mappages(struct memory *mem, struct memseg *seg, rvaddr_t addr,
+	     size_t len, int fd, off_t offset) __attribute__((nonnull));
+
+// Applies the permissions of a segment to flat memory, no-op without it
+int protectseg(struct memory *mem, struct memseg *seg)
+	__attribute__((nonnull));
+
 // Frees a memory segment
 void freeseg(struct memory *mem, struct memseg *seg) __attribute__((nonnull));
 
@@ -38,27 +171,98 @@ void freeseg(struct memory *mem, struct memseg *seg) __attribute__((nonnull));
 void freemem(struct memory *mem);
 
 // Returns the segment that maps addresses in range [start, end[
-struct memseg *is_memseg(struct memory mem, rvaddr_t start, rvaddr_t end)
+struct memseg *is_memseg(const struct memory *mem, rvaddr_t start,
+			 rvaddr_t end) __attribute__((nonnull));
+
+// Returns a segment that maps any address in range [start, end[
+struct memseg *overlap_memseg(const struct memory *mem, rvaddr_t start,
+			      rvaddr_t end) __attribute__((nonnull));
+
+/*
+ * Fills `iov` with the host ranges holding the `len` guest bytes at `addr`,
+ * one per segment, so that system calls can access guest memory without a
+ * copy. Every range must be in a segment that permits `access`, MEM_READ or
+ * MEM_WRITE, and writes to MEM_EXEC segments are marked dirty. Stops early at
+ * the first one that isn't, or once `iovcnt` entries are used, as a short
+ * read or write would. Returns the number of entries, or -1 with errno set to
+ * EFAULT if not even the first byte is accessible.
+ */
+int memiov(struct memory *mem, rvaddr_t addr, size_t len, uint8_t access,
+	   struct iovec *iov, int iovcnt) __attribute__((nonnull));
+
+// Invalidates every entry of the software TLB
+void tlb_flush(struct tlb *tlb) __attribute__((nonnull));
+
+/*
+ * Caches the page of `addr` in `tab`, one of the tables of a struct tlb, if
+ * `seg` maps all of it. The caller checks that `seg` permits the access type.
+ */
+void tlb_fill(struct tlb_entry *tab, const struct memseg *seg, rvaddr_t addr)
+	__attribute__((nonnull));
+
+/*
+ * Returns the TLB entry that may map `addr`, and the tag it must have to map
+ * an access of `size` bytes. Misaligned accesses can never match the tag, so
+ * a hit also guarantees that the access doesn't cross a page.
+ */
+#define TLB_IDX(addr) (((addr) >> PGSHIFT) & (TLB_SIZE - 1))
+#define TLB_TAG(addr, size) ((addr) & (~PGOFFSET | ((rvaddr_t)(size) - 1)))
+
+/*
+ * Slow paths of memloadN() and memstoreN(), look the segment up and refill the
+ * TLB. The value goes by value, in host order, so that the guest accesses of
+ * handlers don't take the address of a local, which would keep the compiler
+ * from turning insn_next() into a jump.
+ */
+uint64_t memloadN_tlbmiss(struct memory *mem, rvaddr_t addr, uint8_t size)
 	__attribute__((nonnull));
+void memstoreN_tlbmiss(struct memory *mem, rvaddr_t addr, uint8_t size,
+		       uint64_t val) __attribute__((nonnull));
+void *memxlate_tlbmiss(struct memory *mem, rvaddr_t addr, uint8_t size)
+	__attribute__((nonnull));
+
+/*
+ * Guest accesses don't return errors, a fault makes the current thread
+ * siglongjmp() to the `env` armed with memfault_arm(), with 1 as the value.
+ * Flat memory accesses are unchecked and get there from the host fault, the
+ * checked ones through memfault_raise(). memfault_addr() and memfault_errno()
+ * then tell the guest address and what went wrong: EINVAL if nothing is
+ * mapped there, EPERM if the segment doesn't permit the access. Passing a
+ * NULL `env` disarms it, accesses must not fault then.
+ */
+void memfault_arm(const struct memory *mem, sigjmp_buf *env);
+_Noreturn void memfault_raise(rvaddr_t addr, int err) __attribute__((cold));
+rvaddr_t memfault_addr(void) __attribute__((cold));
+int memfault_errno(const struct memory *mem) __attribute__((nonnull, cold));
 
 /*
- * Loads `size` bits at address `addr` in `out`, returns 0 if the load suceeds,
- * and -1 if it fails, setting errno before returning.
+ * Loads `size` bits at address `addr` in `out`, faults as described above
+ * memfault_arm() if it can't.
  * Size must be either 8, 16, 32, or 64. You can use the `memload()` macro to
  * call this function with the correct `size` parameter and a uintN_t * pointer
  */
-int memloadN(struct memory mem, rvaddr_t addr, uint8_t size, void *out)
-	__attribute__((nonnull));
+static inline void memloadN(struct memory *mem, rvaddr_t addr, uint8_t size,
+			    void *out) __attribute__((nonnull));
 
 /*
- * Stores `size` bits from `in` in address `addr`, returns 0 if the store
- * suceeds, and -1 if it fails, setting errno before returning.
+ * Stores `size` bits from `in` in address `addr`, faults as described above
+ * memfault_arm() if it can't.
  * Size must be either 8, 16, 32, or 64. You can use the `memstore()` macro to
  * call this function with the correct `size` paramater and a uintN_t * pointer
  */
-int memstoreN(struct memory mem, rvaddr_t addr, uint8_t size, const void *in)
+static inline void memstoreN(struct memory *mem, rvaddr_t addr, uint8_t size,
+			     const void *in)
 	__attribute__((nonnull, access(read_only, 4)));
 
+/*
+ * Returns the host address of the `size` bits at address `addr`, aligned,
+ * which the guest may read and write, for atomic accesses. Faults as
+ * memloadN() and memstoreN() do, and marks writable code dirty as if it was
+ * stored to.
+ */
+static inline void *memxlate(struct memory *mem, rvaddr_t addr, uint8_t size)
+	__attribute__((nonnull));
+
 #define memload(mem, addr, ptr) (_Generic(ptr,				\
 		uint8_t *:  memloadN(mem, addr, 8,  (void *)ptr),	\
 		uint16_t *: memloadN(mem, addr, 16, (void *)ptr),	\
@@ -73,4 +277,123 @@ int memstoreN(struct memory mem, rvaddr_t addr, uint8_t size, const void *in)
 		uint64_t *: memstoreN(mem, addr, 64, (const void *)ptr),\
 		default   : abort()))
 
+static inline void mem_lock(const struct memory *mem)
+{
+	if (mem->lock)
+		pthread_mutex_lock(mem->lock);
+}
+
+static inline void mem_unlock(const struct memory *mem)
+{
+	if (mem->lock)
+		pthread_mutex_unlock(mem->lock);
+}
+
+static inline void mark_xdirty(struct memory *mem, rvaddr_t start,
+			       rvaddr_t end)
+{
+	if (mem->xdirty_start >= mem->xdirty_end) {
+		mem->xdirty_start = start;
+		mem->xdirty_end = end;
+		return;
+	}
+
+	if (start < mem->xdirty_start)
+		mem->xdirty_start = start;
+	if (end > mem->xdirty_end)
+		mem->xdirty_end = end;
+}
+
+// Copies a `size` bits integer between host order and guest little-endian
+static inline void memcpy_le(void *dst, const void *src, uint8_t size)
+	__attribute__((nonnull));
+
+static inline void memcpy_le(void *dst, const void *src, uint8_t size)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	for (uint8_t i = 0; i < size / 8; ++i)
+		((unsigned char *)dst)[i] =
+			((const unsigned char *)src)[size / 8 - 1 - i];
+#else
+	memcpy(dst, src, size / 8);
+#endif
+}
+
+// Converts between a `size` bits host integer and a uint64_t
+static inline void memput(void *out, uint64_t val, uint8_t size)
+	__attribute__((nonnull));
+static inline uint64_t memget(const void *in, uint8_t size)
+	__attribute__((nonnull));
+
+static inline void memput(void *out, uint64_t val, uint8_t size)
+{
+	switch (size) {
+	case 8:
+		*(uint8_t *)out = (uint8_t)val;
+		break;
+	case 16:
+		*(uint16_t *)out = (uint16_t)val;
+		break;
+	case 32:
+		*(uint32_t *)out = (uint32_t)val;
+		break;
+	default:
+		*(uint64_t *)out = val;
+		break;
+	}
+}
+
+static inline uint64_t memget(const void *in, uint8_t size)
+{
+	switch (size) {
+	case 8:
+		return *(const uint8_t *)in;
+	case 16:
+		return *(const uint16_t *)in;
+	case 32:
+		return *(const uint32_t *)in;
+	default:
+		return *(const uint64_t *)in;
+	}
+}
+
+static inline void memloadN(struct memory *mem, rvaddr_t addr, uint8_t size,
+			    void *out)
+{
+	const struct tlb_entry *e = &mem->tlb.read[TLB_IDX(addr)];
+
+	if (addr < mem->flat_limit)
+		memcpy_le(out, mem->flat + addr, size);
+	else if (e->tag != TLB_TAG(addr, size / 8))
+		memput(out, memloadN_tlbmiss(mem, addr, size), size);
+	else
+		memcpy_le(out, (const void *)(e->addend + addr), size);
+}
+
+static inline void memstoreN(struct memory *mem, rvaddr_t addr, uint8_t size,
+			     const void *in)
+{
+	const struct tlb_entry *e = &mem->tlb.write[TLB_IDX(addr)];
+
+	if (addr < mem->flat_limit &&
+	    (addr >= mem->wx_end || addr + size / 8 <= mem->wx_start))
+		memcpy_le(mem->flat + addr, in, size);
+	else if (e->tag != TLB_TAG(addr, size / 8))
+		memstoreN_tlbmiss(mem, addr, size, memget(in, size));
+	else
+		memcpy_le((void *)(e->addend + addr), in, size);
+}
+
+static inline void *memxlate(struct memory *mem, rvaddr_t addr, uint8_t size)
+{
+	const struct tlb_entry *e = &mem->tlb.write[TLB_IDX(addr)];
+
+	if (addr < mem->flat_limit &&
+	    (addr >= mem->wx_end || addr + size / 8 <= mem->wx_start))
+		return mem->flat + addr;
+	if (e->tag != TLB_TAG(addr, size / 8))
+		return memxlate_tlbmiss(mem, addr, size);
+	return (void *)(e->addend + addr);
+}
+
 #endif // MEMORY_H
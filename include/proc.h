@@ -1,43 +1,219 @@
 #ifndef LOADER_H
 #define LOADER_H
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <setjmp.h>
+#include <sys/types.h>
 #include "riscv.h"
 #include "memory.h"
 
+struct bbcache;
+struct trace;
+struct jit;
+struct thread;
+
+/*
+ * Writes to x0 go to regs[REG_SINK] instead, insn_predecode() points them
+ * there, so regs[0] always reads as zero and getreg() and mvreg() don't have
+ * to check for it.
+ */
+#define REG_SINK 32
+
+/*
+ * A trap taken by the process, `pending` until whoever called proc_run()
+ * handles it. `tval` is the faulting address, or the instruction itself if it
+ * is illegal, as in the stval CSR.
+ */
+struct trap {
+	bool pending;
+	enum trap_cause cause;
+	rvaddr_t tval;
+};
+
+/*
+ * Floating-point state. Registers hold doubles, or floats NaN-boxed in their
+ * low half. While the process runs the host FPU is in the rounding mode of
+ * frm and accrues its exception flags, which only reach `fflags` when they
+ * are read, see rv_f.h.
+ */
+struct fstate {
+	uint64_t regs[32];
+	int mode; // Host rounding mode of frm, FE_*
+	uint8_t frm;
+	uint8_t fflags;
+};
+
+// vtype of a process that hasn't set a valid one, see rv_v.h
+#define VTYPE_VILL ((reg_t)1 << (XLEN - 1))
+
+/*
+ * Vector state. Elements of register group vN, of any width, are packed in
+ * host order from regs[N], the groups are contiguous.
+ */
+struct vstate {
+	uint8_t regs[32][VLENB]; // First, so that elements are aligned
+	reg_t vl;
+	reg_t vtype;
+	reg_t vstart;
+	uint8_t vxrm;
+	uint8_t vxsat;
+};
+
 // Process structure
 struct proc {
-	reg_t regs[32]; // reg[N] is register xN
+	reg_t regs[REG_SINK + 1]; // reg[N] is register xN
 	reg_t pc;
 	struct memory mem;
+	struct bbcache *bbcache; // Predecoded basic blocks, see bbcache.h
+	uint64_t instret; // Number of retired instructions
+	uint64_t fused; // Instructions interpreted fused, see insn_fuse()
+	struct trace *trace; // Execution trace, NULL unless tracing
+	struct jit *jit; // Translates hot blocks, NULL to only interpret
+	struct trap trap; // Last trap, see proc_run()
+	sigjmp_buf *trap_env; // Where proc_trap() unwinds to while running
+	bool exited; // Called exit, see proc_exit()
+	int exit_code;
+	// Program break, in [brk_start, brk_max[, and heap segment, see sys_brk()
+	rvaddr_t brk_start;
+	rvaddr_t brk;
+	rvaddr_t brk_max;
+	struct memseg *heap; // NULL until the break moves up
+	rvaddr_t mmap_next; // Where the next mmap() goes, see syscall.h
+	// Last checkpoint, NULL if none, the parent of the next incremental one
+	char *snap_path;
+	uint32_t snap_depth;
+	bool clone; // May start threads, see procopts
+	struct thread *thread; // NULL until the first clone(), see thread.h
+	rvaddr_t clear_tid; // From set_tid_address(), see thread_exit()
+	// Reservation of the last LR, see rv_a.h
+	bool resv;
+	rvaddr_t resv_addr;
+	uint64_t resv_val;
+	struct fstate f;
+	struct vstate v;
 };
 
-// Free's a process allocated by loadproc
+// Options of loadproc(), a zeroed structure gives the defaults
+struct procopts {
+	bool flatmem; // Map guest memory flat in the host, see initmem()
+	bool elfread; // Copy ELF segments with fread() instead of mapseg()
+	uint64_t stack_max; // Stack size limit, 0 for the RLIMIT_STACK one
+	uint64_t seed; // Seeds the stack placement, which is deterministic
+	const char *trace; // Traces execution to this file if set, see trace.h
+	bool jit; // Translates hot blocks to host code, unless tracing
+	bool jit_verify; // Checks every translated block against the interpreter
+	size_t jit_cache; // Size of the JIT code cache, 0 for the default
+	bool threads; // Lets the guest clone() threads, in flat memory untraced
+};
+
+// Loadable segment of an image, at `offset` in its memfd
+struct imageseg {
+	rvaddr_t start;
+	rvaddr_t end;
+	off_t offset;
+	size_t filesz;
+	uint8_t flags;
+};
+
+/*
+ * An ELF file parsed and loaded once, to start many processes from it with
+ * proc_spawn(). Its segments are copied in a sealed memfd, page aligned like
+ * in the guest, which every process maps privately: pages the guest never
+ * writes, e.g. all of the text, stay shared by every process and the writable
+ * ones are copied on write. Images are immutable so processes may be spawned
+ * from several threads at once.
+ */
+struct image {
+	char *path;
+	int fd; // The memfd
+	size_t size; // Bytes in the memfd, shared by every process
+	rvaddr_t entry;
+	rvaddr_t brk_start;
+	size_t nsegs;
+	struct imageseg segs[];
+};
+
+// Free's a process allocated by loadproc or proc_spawn
 void freeproc(struct proc *proc) __attribute__((nonnull, cold));
 // Loades a process from an ELF file
-struct proc *loadproc(const char *path)
+struct proc *loadproc(const char *path, const struct procopts *opts)
 	__attribute__((nonnull, cold, malloc(freeproc, 1)));
 
+/*
+ * For loaders, once the memory, registers and system call state of `proc`
+ * are set: allocates its block cache, trace and JIT. Returns 0 on success or
+ * -1 after logging why, the caller then frees `proc` with proc_discard().
+ */
+int proc_setup(struct proc *proc, const char *path,
+	       const struct procopts *opts) __attribute__((nonnull, cold));
+// Frees a process allocated with calloc() by a loader
+void proc_discard(struct proc *proc) __attribute__((nonnull, cold));
+
+/*
+ * Free's an image, processes spawned from it keep their mappings and stay
+ * valid
+ */
+void image_close(struct image *img) __attribute__((nonnull, cold));
+// Loades an image from an ELF file, returns NULL with errno set on failure
+struct image *image_open(const char *path)
+	__attribute__((nonnull, cold, malloc(image_close, 1)));
+
+/*
+ * Starts a process from an image, like loadproc() but only maps its segments,
+ * so it takes the same time whatever the size of the ELF file.
+ * `opts->elfread` is ignored.
+ */
+struct proc *proc_spawn(const struct image *img, const struct procopts *opts)
+	__attribute__((nonnull, malloc(freeproc, 1)));
+
+/*
+ * Runs a process for about `budget` instructions, the budget is only checked
+ * between basic blocks so it can be overrun by up to BB_MAXLEN instructions.
+ * Returns 0 once the budget is spent or the process exited, which sets
+ * `proc->exited`, or -1 with errno set if the process can't continue. If
+ * that is because it trapped, `proc->trap` describes the trap, `proc->pc` is
+ * on the trapping instruction, and errno is EINVAL for page faults, EPERM for
+ * access faults, and ENOSYS for anything else.
+ */
+int proc_run(struct proc *proc, uint64_t budget) __attribute__((nonnull));
 
-// set and get a process's registers
+/*
+ * Takes a trap from an instruction handler, `proc->pc` must already be on the
+ * instruction. Unwinds to proc_run(), so handlers never return errors.
+ */
+_Noreturn void proc_trap(struct proc *proc, enum trap_cause cause,
+			 rvaddr_t tval) __attribute__((nonnull, cold));
+
+/*
+ * Ends the process with status `code` from an instruction handler, with
+ * `proc->pc` already past the instruction. Unwinds to proc_run() like
+ * proc_trap().
+ */
+_Noreturn void proc_exit(struct proc *proc, int code)
+	__attribute__((nonnull, cold));
+
+// Describes a trap cause, e.g. "Load page fault"
+const char *trap_name(enum trap_cause cause) __attribute__((cold));
+
+
+/*
+ * Set and get a process's registers, `reg` is below 32, or REG_SINK for
+ * mvreg()
+ */
 static inline void mvreg(struct proc *proc, enum ABI_REG reg, reg_t val)
 	__attribute__((nonnull));
 static inline reg_t getreg(const struct proc *proc, enum ABI_REG reg)
 	__attribute__((nonnull));
 
-#include <assert.h>
 static inline void mvreg(struct proc *proc, enum ABI_REG reg, reg_t val)
 {
-	assert(reg < 32);
-
-	if (reg != 0)
-		proc->regs[reg] = val;
+	proc->regs[reg] = val;
 }
 
 static inline reg_t getreg(const struct proc *proc, enum ABI_REG reg)
 {
-	assert(reg < 32);
-	if (reg == 0)
-		return 0;
 	return proc->regs[reg];
 }
 
@@ -2,6 +2,8 @@
 #define RISCV_H
 
 #define XLEN 64
+#define VLEN 256 // Bits in a vector register, see rv_v.h
+#define VLENB (VLEN / 8)
 
 #include <stdint.h>
 typedef uint64_t reg_t;
@@ -10,6 +12,22 @@ typedef int64_t ireg_t;
 typedef uint64_t rvaddr_t;
 typedef uint32_t insn_t;
 
+// Exception causes, as reported in the scause CSR
+enum trap_cause {
+	CAUSE_FETCH_MISALIGNED=0,
+	CAUSE_FETCH_ACCESS=1,
+	CAUSE_ILLEGAL_INSN=2,
+	CAUSE_BREAKPOINT=3,
+	CAUSE_LOAD_MISALIGNED=4,
+	CAUSE_LOAD_ACCESS=5,
+	CAUSE_STORE_MISALIGNED=6,
+	CAUSE_STORE_ACCESS=7,
+	CAUSE_USER_ECALL=8,
+	CAUSE_FETCH_PAGE=12,
+	CAUSE_LOAD_PAGE=13,
+	CAUSE_STORE_PAGE=15,
+};
+
 enum ABI_REG {
 	REG_ZERO=0,
 	REG_RA,
@@ -0,0 +1,68 @@
+#ifndef RISCV_RVA_H
+#define RISCV_RVA_H
+
+#include "riscv.h"
+#include "proc.h"
+
+struct dinsn;
+
+/*
+ * The A extension. AMOs are single host atomic operations on the host address
+ * of the guest word, see memxlate(), and min and max are compare-and-swap
+ * loops, so threads (see thread.h) never take a lock for them. Every one is
+ * sequentially consistent whatever its aq and rl bits, as the host's locked
+ * instructions are.
+ *
+ * LR records the address and the value it loaded, and SC is a compare-and-
+ * swap against that value: it fails if another write changed the word in
+ * between, but not if one wrote the same value back. The reservation is lost
+ * on any SC, as the ISA allows.
+ */
+
+// Functions returned by insn_decode(), as in rv_i.h
+void insn_lr_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sc_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amoswap_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amoadd_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amoxor_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amoand_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amoor_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amomin_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amomax_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amominu_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amomaxu_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_lr_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sc_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amoswap_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amoadd_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amoxor_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amoand_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amoor_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amomin_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amomax_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amominu_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_amomaxu_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+
+#endif // RISCV_RVA_H
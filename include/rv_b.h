@@ -0,0 +1,97 @@
+#ifndef RISCV_RVB_H
+#define RISCV_RVB_H
+
+#include "riscv.h"
+#include "proc.h"
+
+struct dinsn;
+
+/*
+ * The Zba, Zbb and Zbs bit-manipulation extensions. Shifted adds and rotates
+ * are what the host's lea and rol instructions do, and counting bits uses the
+ * host's lzcnt, tzcnt and popcnt instructions when it has them, see rv_b.c.
+ */
+
+// Functions returned by insn_decode(), as in rv_i.h
+void insn_sh1add(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sh2add(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sh3add(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_add_uw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sh1add_uw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sh2add_uw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sh3add_uw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_slli_uw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_andn(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_orn(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_xnor(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_clz(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_ctz(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_cpop(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_clzw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_ctzw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_cpopw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_max(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_maxu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_min(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_minu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sext_b(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sext_h(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_zext_h(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_rol(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_ror(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_rori(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_rolw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_rorw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_roriw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_orc_b(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_rev8(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_bclr(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_bclri(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_bext(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_bexti(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_binv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_binvi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_bset(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_bseti(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+
+#endif // RISCV_RVB_H
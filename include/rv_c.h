@@ -0,0 +1,23 @@
+#ifndef RISCV_RVC_H
+#define RISCV_RVC_H
+
+#include <stdint.h>
+#include "riscv.h"
+
+/*
+ * The C extension. Compressed instructions have no handlers of their own,
+ * insn_predecode() expands each one once into the 32-bit instruction it
+ * stands for, which then runs as any other, with a length of 2.
+ */
+
+// True if `insn` (at least its low 16 bits) is a compressed instruction
+#define RVC_IS_COMPRESSED(insn) (((insn) & 0x3) != 0x3)
+
+/*
+ * Returns the 32-bit equivalent of the compressed instruction `cinsn` for
+ * RV64, or 0, which isn't a valid instruction either, if it is reserved or
+ * not supported.
+ */
+insn_t rvc_expand(uint16_t cinsn);
+
+#endif // RISCV_RVC_H
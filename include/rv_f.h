@@ -0,0 +1,169 @@
+#ifndef RISCV_RVF_H
+#define RISCV_RVF_H
+
+#include "riscv.h"
+#include "proc.h"
+
+struct dinsn;
+
+/*
+ * The F and D extensions, on the scalar SSE instructions of the host.
+ * proc_run() puts the host FPU in the rounding mode of frm with fp_enter()
+ * and instructions only switch it when their rm is another one, so writes to
+ * frm are the only other place that sets it. Exception flags accrue in the
+ * host status register and are only gathered into fflags when fcsr is read,
+ * and by fp_leave(). Results that are NaNs are made canonical, and floats
+ * that aren't NaN-boxed read as the canonical NaN. The host has no rounding
+ * to nearest with ties away from zero, so under RMM conversions to integers
+ * round right and arithmetic rounds its ties to even.
+ */
+
+// Fields of fcsr
+#define FCSR_FFLAGS 0x1f
+#define FCSR_FRM_SHIFT 5
+#define FCSR_FRM 0x7
+
+// Gives a new process the floating-point state `fcsr`, with zero registers
+void fp_init(struct proc *proc, reg_t fcsr) __attribute__((nonnull, cold));
+
+/*
+ * Hand the host FPU to `proc` before it runs, and back once it stops. Out of
+ * them the host rounds to nearest, and its flags aren't the guest's.
+ */
+void fp_enter(struct proc *proc) __attribute__((nonnull));
+void fp_leave(struct proc *proc) __attribute__((nonnull));
+
+/*
+ * Reads and writes fcsr, with the flags the host accrued, while `proc` is
+ * running
+ */
+reg_t fp_fcsr(struct proc *proc) __attribute__((nonnull));
+void fp_set_fcsr(struct proc *proc, reg_t fcsr) __attribute__((nonnull));
+
+// Functions returned by insn_decode(), as in rv_i.h
+void insn_flw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fld(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsd(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fadd_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsub_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmul_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fdiv_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsqrt_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmin_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmax_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmadd_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmsub_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fnmsub_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fnmadd_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsgnj_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsgnjn_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsgnjx_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_feq_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_flt_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fle_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fclass_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_w_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_wu_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_l_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_lu_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_s_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_s_wu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_s_l(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_s_lu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fadd_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsub_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmul_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fdiv_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsqrt_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmin_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmax_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmadd_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmsub_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fnmsub_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fnmadd_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsgnj_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsgnjn_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fsgnjx_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_feq_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_flt_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fle_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fclass_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_w_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_wu_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_l_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_lu_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_d_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_d_wu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_d_l(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_d_lu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_s_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fcvt_d_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmv_x_w(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmv_w_x(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmv_x_d(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fmv_d_x(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+
+#endif // RISCV_RVF_H
@@ -4,20 +4,166 @@
 #include "riscv.h"
 #include "proc.h"
 
+struct dinsn;
+
 /*
  * These are the functions returned by insn_decode(), they simulate the
- * instruction with their name on the process `proc`. `insn` should be their
- * 32bit verbatim representation
+ * instruction with their name on the process `proc`. `di` is the instruction
+ * as predecoded by insn_predecode(). Faults don't return, they unwind to
+ * proc_run(), see insn_next() and insn_trap().
+ */
+void insn_lui(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_auipc(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_jal(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_jalr(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_beq(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_bne(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_blt(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_bge(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_bltu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_bgeu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_lb(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_lh(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_lw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_ld(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_lbu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_lhu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_lwu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sb(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sh(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sd(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_addi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_slti(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sltiu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_xori(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_ori(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_andi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_slli(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_srli(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_srai(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_add(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_slt(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sltu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_and(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_or(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_xor(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sll(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_srl(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sra(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sub(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_addiw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_slliw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_srliw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sraiw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_addw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_subw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sllw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_srlw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sraw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fence(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_fence_i(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_ecall(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_ebreak(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull, noreturn));
+void insn_csrrw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_csrrs(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_csrrc(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_csrrwi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_csrrsi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_csrrci(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+
+/*
+ * Variants used instead when rd is x0: jal and jalr without the link, and
+ * every computational instruction, which is then a nop or a hint
+ */
+void insn_j(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_jr(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_hint(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+
+/*
+ * Fused handlers, installed by insn_fuse() on the first of two instructions
+ * that compilers emit together. They simulate both, so the second is never
+ * dispatched, and count them in `proc->fused`.
  */
-int insn_add(struct proc *proc, insn_t insn) __attribute__((nonnull));
-int insn_slt(struct proc *proc, insn_t insn) __attribute__((nonnull));
-int insn_sltu(struct proc *proc, insn_t insn) __attribute__((nonnull));
-int insn_and(struct proc *proc, insn_t insn) __attribute__((nonnull));
-int insn_or(struct proc *proc, insn_t insn) __attribute__((nonnull));
-int insn_xor(struct proc *proc, insn_t insn) __attribute__((nonnull));
-int insn_sll(struct proc *proc, insn_t insn) __attribute__((nonnull));
-int insn_srl(struct proc *proc, insn_t insn) __attribute__((nonnull));
-int insn_sra(struct proc *proc, insn_t insn) __attribute__((nonnull));
-int insn_sub(struct proc *proc, insn_t insn) __attribute__((nonnull));
+void insn_lui_addi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_lui_addiw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_auipc_addi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_auipc_jalr(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_auipc_ld(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_slt_bz(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sltu_bz(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_slti_bz(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_sltiu_bz(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
 
 #endif // RISCV_RV64I_H
@@ -0,0 +1,43 @@
+#ifndef RISCV_RVM_H
+#define RISCV_RVM_H
+
+#include "riscv.h"
+#include "proc.h"
+
+struct dinsn;
+
+/*
+ * The M extension. Every instruction is a single host multiplication or
+ * division, 128 bits wide for the high halves of products. Divisions by zero
+ * and overflowing ones give the results the ISA defines without branching.
+ */
+
+// Functions returned by insn_decode(), as in rv_i.h
+void insn_mul(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_mulh(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_mulhsu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_mulhu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_div(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_divu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_rem(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_remu(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_mulw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_divw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_divuw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_remw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_remuw(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+
+#endif // RISCV_RVM_H
@@ -0,0 +1,246 @@
+#ifndef RISCV_RVV_H
+#define RISCV_RVV_H
+
+#include "riscv.h"
+#include "proc.h"
+
+struct dinsn;
+
+/*
+ * The V extension, with ELEN = 64 and the VLEN of riscv.h, on the register
+ * file of struct vstate. Element-wise arithmetic runs the kernels of vkern.h
+ * on whole register groups, the rest goes one element at a time. Tails and
+ * masked off elements are always left undisturbed, and nothing is ever
+ * interrupted, so vstart must be 0. Fixed-point and floating-point
+ * instructions, widening and narrowing ones, fault-only-first loads and
+ * vcompress aren't supported.
+ */
+
+// Gives a new process its initial vector state, with vill set
+void vec_init(struct proc *proc) __attribute__((nonnull, cold));
+
+/*
+ * Functions returned by insn_decode(), as in rv_i.h. Handlers shared by
+ * several encodings take what differs from the instruction, e.g. insn_vle_v()
+ * the element width and insn_vred() the operation.
+ */
+void insn_vsetvli(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsetivli(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsetvl(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vle_v(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vse_v(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vlm_v(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsm_v(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vlr_v(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsr_v(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vadd_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vadd_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vadd_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsub_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsub_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vrsub_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vrsub_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vminu_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vminu_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmin_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmin_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmaxu_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmaxu_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmax_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmax_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vand_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vand_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vand_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vor_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vor_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vor_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vxor_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vxor_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vxor_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsll_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsll_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsll_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsrl_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsrl_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsrl_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsra_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsra_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vsra_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmul_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmul_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmv_v_v(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmv_v_x(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmv_v_i(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmerge_vvm(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmerge_vxm(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmerge_vim(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmulh_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmulh_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmulhu_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmulhu_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmulhsu_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmulhsu_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vdivu_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vdivu_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vdiv_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vdiv_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vremu_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vremu_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vrem_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vrem_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmacc_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmacc_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vnmsac_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vnmsac_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmadd_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmadd_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vnmsub_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vnmsub_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsltu_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsltu_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmslt_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmslt_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vrgather_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vrgather_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmseq_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmseq_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmseq_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsne_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsne_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsne_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsleu_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsleu_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsleu_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsle_vv(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsle_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsle_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsgtu_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsgtu_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsgt_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmsgt_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vrgather_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vred(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmlogic(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vslideup_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vslideup_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vslidedown_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vslidedown_vi(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vslide1up_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vslide1down_vx(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmv_x_s(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmv_s_x(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vcpop_m(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vfirst_m(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vid_v(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+void insn_vmvr_v(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+
+#endif // RISCV_RVV_H
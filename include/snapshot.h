@@ -0,0 +1,96 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "riscv.h"
+#include "proc.h"
+
+/*
+ * Checkpoints of a process, to restore it later, e.g. past a long
+ * initialization. The file, in host byte order, starts with a page holding
+ * a struct snap_hdr, then the segment table and its runs, then the pages of
+ * every segment from PGDOWN(start), each at a page aligned offset so that
+ * proc_restore() only maps them and takes the same time whatever the size of
+ * memory. Pages that aren't written are holes, which read as zero.
+ *
+ * Once a checkpoint is written, the segments of the process are mapped from
+ * it, privately, so that the pages the guest writes afterwards are the only
+ * ones that aren't backed by a file. An incremental checkpoint finds them in
+ * /proc/self/pagemap and only writes those, its other pages are those of its
+ * parent, the previous checkpoint, which must be kept where it was.
+ *
+ * Host file descriptors and the translated code aren't saved.
+ */
+#define SNAP_MAGIC "RVSNAP"
+#define SNAP_VERSION 3
+#define SNAP_PATH_MAX 2048
+#define SNAP_DEPTH_MAX 64 // Parents of an incremental checkpoint, at most
+
+struct snap_hdr {
+	char magic[8];
+	uint64_t version;
+	uint64_t depth; // Number of parents, 0 for a full checkpoint
+	char parent[SNAP_PATH_MAX]; // Absolute path, if depth > 0
+	uint64_t regs[32];
+	uint64_t pc;
+	uint64_t instret;
+	uint64_t brk_start;
+	uint64_t brk;
+	uint64_t brk_max;
+	uint64_t heap; // Start of the heap segment, 0 if there is none
+	uint64_t mmap_next;
+	uint64_t nsegs;
+	uint64_t fcsr;
+	uint64_t fregs[32];
+	// Vector state, see struct vstate
+	uint64_t vl;
+	uint64_t vtype;
+	uint64_t vcsr;
+	uint8_t vregs[32][VLENB];
+};
+
+enum snap_seg_flags {
+	SNAP_FULL=0x100, // Pages that aren't in runs are zero, not the parent's
+};
+
+/*
+ * A segment, its pages are at `offset` in the file. Those written are in the
+ * `nruns` runs at `runs`, those of SNAP_FULL segments are all there, others
+ * are the same as in the parent, which has the same segment.
+ */
+struct snap_seg {
+	uint64_t start;
+	uint64_t end;
+	uint64_t flags; // MEM_* and SNAP_FULL
+	uint64_t offset;
+	uint64_t runs;
+	uint64_t nruns;
+};
+
+// Pages [page, page + npages[ of a segment, from PGDOWN(start)
+struct snap_run {
+	uint64_t page;
+	uint64_t npages;
+};
+
+/*
+ * Writes a checkpoint of `proc`, which isn't running, to `path`. It is
+ * incremental if `incremental` is set and `proc` was checkpointed or
+ * restored before, from another file than `path`, and the chain isn't
+ * SNAP_DEPTH_MAX long. An existing file at `path` is replaced, not
+ * overwritten, so pages mapped from it stay as they were. Returns 0 on
+ * success or -1 with errno set, to ENOTSUP if `proc` has threads, `proc` can
+ * keep running either way.
+ */
+int proc_checkpoint(struct proc *proc, const char *path, bool incremental)
+	__attribute__((nonnull, cold));
+
+/*
+ * Restores a process from a checkpoint and its parents, as it was when it was
+ * written. Returns NULL with errno set on failure.
+ */
+struct proc *proc_restore(const char *path, const struct procopts *opts)
+	__attribute__((nonnull, cold, malloc(freeproc, 1)));
+
+#endif // SNAPSHOT_H
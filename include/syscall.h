@@ -0,0 +1,55 @@
+#ifndef SYSCALL_H
+#define SYSCALL_H
+
+#include "riscv.h"
+#include "proc.h"
+
+// RV64 Linux system call numbers, from the generic table
+enum sys_nr {
+	SYS_OPENAT=56,
+	SYS_CLOSE=57,
+	SYS_LSEEK=62,
+	SYS_READ=63,
+	SYS_WRITE=64,
+	SYS_READV=65,
+	SYS_WRITEV=66,
+	SYS_FSTAT=80,
+	SYS_EXIT=93,
+	SYS_EXIT_GROUP=94,
+	SYS_SET_TID_ADDRESS=96,
+	SYS_FUTEX=98,
+	SYS_CLOCK_GETTIME=113,
+	SYS_SCHED_YIELD=124,
+	SYS_GETPID=172,
+	SYS_GETTID=178,
+	SYS_BRK=214,
+	SYS_MUNMAP=215,
+	SYS_CLONE=220,
+	SYS_MMAP=222,
+};
+
+/*
+ * Guest addresses handed out by mmap() start at SYS_MMAP_BASE, or above the
+ * highest segment if that is higher, and only grow, so that new segments
+ * never need an overlap check.
+ */
+#define SYS_MMAP_BASE ((rvaddr_t)1 << 32)
+// Host ranges a single call passes to readv() or writev(), more is short I/O
+#define SYS_IOV_MAX 64
+
+/*
+ * Sets up the program break after the highest ELF segment, `proc->brk`, and
+ * the mmap() area, once every segment of the image is loaded.
+ */
+void sys_init(struct proc *proc) __attribute__((nonnull, cold));
+
+/*
+ * Runs the system call in a7 with the arguments in a0-a5 and puts the result
+ * in a0, a negated errno on failure as Linux does. Unsupported calls fail with
+ * ENOSYS. File descriptors are the host's, and buffers are accessed in place
+ * through memiov(). exit and exit_group don't return, see proc_exit(), and
+ * clone only starts threads, see thread.h.
+ */
+void sys_ecall(struct proc *proc) __attribute__((nonnull));
+
+#endif // SYSCALL_H
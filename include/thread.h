@@ -0,0 +1,147 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include "riscv.h"
+#include "proc.h"
+
+/*
+ * Guest threads, started with clone(). Each one is a struct proc of its own,
+ * with its own registers, block cache and JIT, run by proc_run() on a host
+ * thread of its own, and all of them share the memory of the first one, the
+ * leader, which is the process that loadproc() returned.
+ *
+ * Threads need flat memory, where guest memory is the same host memory for
+ * all of them and needs no lock: loads and stores go straight to it, and the
+ * A extension uses host atomics on it, see rv_a.h. The segments are shared
+ * too, every thread's struct memory points to the same list, which only
+ * changes under the lock of the group and its mem_lock(), see
+ * thread_mmap_lock(). Other threads pick the changes up, and drop their TLB
+ * and the code that was unmapped, at their next thread_poll().
+ *
+ * Code a thread writes is only dropped from its own block cache, the others
+ * see it after their own fence.i, as on hardware.
+ */
+
+/*
+ * Instructions a translated block may loop for between two thread_poll(), so
+ * that threads notice the process ending, see jit_run()
+ */
+#define THREAD_SLICE 1000000
+
+// A thread, see struct proc
+struct thread {
+	struct thgroup *group;
+	struct proc *proc;
+	struct thread *next; // In the group
+	pthread_t host;
+	pid_t tid;
+	uint64_t gen; // Of the group, last seen by thread_poll()
+	// Executable memory other threads unmapped, see mark_xdirty()
+	rvaddr_t xdirty_start;
+	rvaddr_t xdirty_end;
+};
+
+/*
+ * The threads of a process. `gen` is bumped whenever the others must look at
+ * the group, after memory layout changes and once the process is ending,
+ * which `exiting` tells. `lock` is also the lock of every thread's memory.
+ */
+struct thgroup {
+	pthread_mutex_t lock;
+	pthread_cond_t cond; // Signaled when a thread finishes
+	struct thread *threads;
+	struct thread *leader;
+	unsigned live; // Threads other than the leader
+	uint64_t gen;
+	pid_t next_tid;
+	bool exiting;
+	int exit_code; // Of exit_group()
+	// A thread other than the leader that couldn't continue, see proc_run()
+	bool failed;
+	struct trap trap;
+	rvaddr_t pc;
+	int err;
+	uint64_t instret; // Of the threads that finished
+	rvaddr_t wx_start; // See struct memory
+	rvaddr_t wx_end;
+};
+
+/*
+ * Starts a thread as clone() with CLONE_VM and CLONE_THREAD would, copying the
+ * registers of `proc`, which is in the ecall, with `stack` as sp (unless 0)
+ * and `tls` as tp if CLONE_SETTLS is set. Returns the new thread's id, or -1
+ * with errno set to ENOSYS if the process can't have threads, e.g. it isn't
+ * in flat memory, or if `flags` asks for a new process.
+ */
+int64_t thread_clone(struct proc *proc, uint64_t flags, rvaddr_t stack,
+		     rvaddr_t ptid, rvaddr_t tls, rvaddr_t ctid)
+	__attribute__((nonnull));
+
+/*
+ * exit() and, if `all` is set, exit_group() of a process with threads.
+ * Threads other than the leader end, after clearing and waking the address
+ * set with set_tid_address() if exit() ended them. The leader's exit()
+ * waits for the others to end first, as the process only ends with its last
+ * thread, and only returns if another thread ended the process meanwhile,
+ * thread_poll() then stops the leader.
+ */
+void thread_exit(struct proc *proc, int code, bool all)
+	__attribute__((nonnull));
+
+// Returns the id of a thread, the process id for the leader
+pid_t thread_tid(const struct proc *proc) __attribute__((nonnull));
+
+/*
+ * Waits on the guest futex at host address `uaddr` while it holds `val`, as
+ * FUTEX_WAIT_BITSET with `mask` would, until `timeout` (absolute, on
+ * CLOCK_REALTIME if `realtime` is set and CLOCK_MONOTONIC otherwise) if it
+ * isn't NULL. Fails with EINTR once the process is ending, so that threads
+ * never wait for good on threads that are gone.
+ */
+int thread_futex_wait(struct proc *proc, uint32_t *uaddr, uint32_t val,
+		      const struct timespec *timeout, bool realtime,
+		      uint32_t mask) __attribute__((nonnull(1, 2)));
+
+/*
+ * Take and release the lock of the group around changes to the segments and
+ * the program break, no-ops without threads. thread_mmap_unlock() copies them
+ * to every other thread.
+ */
+void thread_mmap_lock(struct proc *proc) __attribute__((nonnull));
+void thread_mmap_unlock(struct proc *proc) __attribute__((nonnull));
+
+/*
+ * Called by proc_run() between blocks of a process that has threads. Returns
+ * true if `proc` must stop because the process is ending, with `*ret` set to
+ * what proc_run() returns: 0 with `proc->exited` set, or -1 with errno and
+ * `proc->trap` and `proc->pc` set to those of the thread that trapped.
+ */
+static inline bool thread_poll(struct proc *proc, int *ret)
+	__attribute__((nonnull));
+bool thread_sync(struct proc *proc, int *ret) __attribute__((nonnull, cold));
+
+/*
+ * Ends every other thread of the leader `proc` and waits for them, their
+ * retired instructions are then added to `proc->instret`. No-op without
+ * threads.
+ */
+void thread_stop(struct proc *proc) __attribute__((nonnull, cold));
+
+// Frees the group of the leader `proc`, after thread_stop(), for freeproc()
+void thread_free(struct proc *proc) __attribute__((nonnull, cold));
+
+static inline bool thread_poll(struct proc *proc, int *ret)
+{
+	const struct thread *t = proc->thread;
+
+	if (__atomic_load_n(&t->group->gen, __ATOMIC_ACQUIRE) == t->gen)
+		return false;
+	return thread_sync(proc, ret);
+}
+
+#endif // THREAD_H
@@ -0,0 +1,127 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "riscv.h"
+#include "insn.h"
+
+/*
+ * Execution traces, one record per retired instruction. The file is a gzip
+ * stream of a struct trace_hdr, in host byte order, followed by the records
+ * encoded by trace_encode(). Read them back with trace_ropen() and
+ * trace_read(), as tools/rvtrace.c does.
+ */
+#define TRACE_MAGIC "RVTRACE"
+#define TRACE_VERSION 2
+
+struct trace_hdr {
+	char magic[8];
+	uint64_t version;
+	uint64_t start; // pcdelta of the first record is relative to it
+};
+
+/*
+ * `pcdelta` is relative to the previous record. `rdval` is the value written
+ * to `rd` if `flags` has INSN_WRD, and `addr` the accessed address if it has
+ * INSN_LOAD or INSN_STORE, they are 0 otherwise.
+ */
+struct trace_rec {
+	int64_t pcdelta;
+	uint64_t rdval;
+	uint64_t addr;
+	uint32_t insn;
+	uint8_t rd;
+	uint8_t flags;
+	uint8_t pad[2];
+};
+
+/*
+ * Records go to a ring of TRACE_NCHUNKS chunks, a writer thread compresses
+ * full chunks to the file while the next one fills. The emulator waits for
+ * the writer if the ring is full, so no record is dropped.
+ */
+#define TRACE_CHUNK 4096
+#define TRACE_NCHUNKS 16
+
+struct trace {
+	struct trace_rec *ring;
+	unsigned char *enc; // Chunk encoded by the writer
+	struct trace_rec *cur; // Next record of the chunk being filled
+	struct trace_rec *chunk_end;
+	rvaddr_t lastpc;
+	bool enc_rvc; // If the last record encoded was INSN_RVC
+	uint64_t head; // Chunks filled, under `lock`
+	uint64_t tail; // Chunks written, under `lock`
+	bool done;
+	int err; // errno of the first failed write, under `lock`
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	pthread_t writer;
+	gzFile out;
+};
+
+/*
+ * Creates the trace file at `path` and starts its writer thread, `start` is
+ * the initial pc. Returns NULL and sets errno on failure.
+ */
+struct trace *trace_open(const char *path, rvaddr_t start)
+	__attribute__((nonnull, cold));
+/*
+ * Writes the pending records and closes the trace. Returns 0 on success, or
+ * -1 with errno set if any write failed.
+ */
+int trace_close(struct trace *trace) __attribute__((nonnull, cold));
+
+// Reads a trace file
+struct trace_reader {
+	gzFile in;
+	rvaddr_t pc; // Of the last record read
+	bool rvc; // If the last record read was INSN_RVC
+};
+
+/*
+ * Opens the trace file at `path` for trace_read(). Returns NULL and sets errno
+ * on failure, to EINVAL if it isn't a trace.
+ */
+struct trace_reader *trace_ropen(const char *path)
+	__attribute__((nonnull, cold));
+/*
+ * Reads the next record into `rec`, and its pc into `pc`. Returns 1 on
+ * success, 0 at the end of the trace and -1 with errno set on failure.
+ */
+int trace_read(struct trace_reader *rd, struct trace_rec *rec, rvaddr_t *pc)
+	__attribute__((nonnull));
+void trace_rclose(struct trace_reader *rd) __attribute__((nonnull, cold));
+
+// Hands the full chunk to the writer, see trace_record()
+void trace_push(struct trace *trace) __attribute__((nonnull));
+
+/*
+ * Records the retired instruction `di`, `rdval` is the value of its rd after
+ * it executed and `addr` the address it accessed.
+ */
+static inline void trace_record(struct trace *trace, const struct dinsn *di,
+				reg_t rdval, rvaddr_t addr)
+	__attribute__((nonnull));
+
+static inline void trace_record(struct trace *trace, const struct dinsn *di,
+				reg_t rdval, rvaddr_t addr)
+{
+	struct trace_rec *rec = trace->cur;
+
+	rec->pcdelta = (int64_t)(di->pc - trace->lastpc);
+	rec->rdval = di->flags & INSN_WRD ? rdval : 0;
+	rec->addr = di->flags & (INSN_LOAD | INSN_STORE) ? addr : 0;
+	rec->insn = di->insn;
+	rec->rd = di->rd;
+	rec->flags = di->flags;
+	rec->pad[0] = rec->pad[1] = 0;
+	trace->lastpc = di->pc;
+
+	if (++trace->cur == trace->chunk_end)
+		trace_push(trace);
+}
+
+#endif // TRACE_H
@@ -0,0 +1,57 @@
+#ifndef VKERN_H
+#define VKERN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Element-wise kernels of the vector instructions, see rv_v.h. Each one
+ * exists for the scalar fallback, the baseline SSE2 of x86-64 hosts and
+ * AVX2, and `vkern` points at the best set the host supports, as told by
+ * CPUID when the program starts.
+ */
+enum vk_op {
+	VK_ADD,
+	VK_SUB,
+	VK_RSUB, // b - a
+	VK_AND,
+	VK_OR,
+	VK_XOR,
+	VK_MIN,
+	VK_MINU,
+	VK_MAX,
+	VK_MAXU,
+	VK_MUL, // Low half
+	VK_SLL, // Shift amounts are taken modulo the element width
+	VK_SRL,
+	VK_SRA,
+	VK_MV, // b
+	VK_NOPS,
+};
+
+/*
+ * vd[i] = vs2[i] op vs1[i], or vs2[i] op x with x truncated to the element
+ * width, for `n` elements. vd may be the same as either source but mustn't
+ * partially overlap them.
+ */
+typedef void (*vk_vv_t)(void *vd, const void *vs2, const void *vs1,
+			size_t n);
+typedef void (*vk_vx_t)(void *vd, const void *vs2, uint64_t x, size_t n);
+
+struct vkern {
+	const char *name;
+	// Indexed by log2 of the element size in bytes
+	vk_vv_t vv[VK_NOPS][4];
+	vk_vx_t vx[VK_NOPS][4];
+};
+
+extern const struct vkern *vkern;
+
+/*
+ * Makes `vkern` point at the kernels called `name`, "scalar", "sse2" or
+ * "avx2". Returns 0 on success, -1 with errno set to EINVAL if there are no
+ * such kernels or ENOTSUP if the host can't run them.
+ */
+int vkern_select(const char *name) __attribute__((nonnull, cold));
+
+#endif // VKERN_H
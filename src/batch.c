@@ -0,0 +1,326 @@
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "riscv.h"
+#include "proc.h"
+#include "debug.h"
+#include "batch.h"
+
+// Keeps what workers write often on their own cache lines
+#define CACHELINE 64
+
+/*
+ * Chase-Lev work-stealing deque of live guests. Its capacity bounds the
+ * number of live guests, so it never has to grow.
+ */
+struct deque {
+	_Alignas(CACHELINE) atomic_size_t top;
+	_Alignas(CACHELINE) atomic_size_t bottom;
+	_Atomic(struct guest *) *buf;
+	size_t mask;
+};
+
+struct worker {
+	struct deque dq;
+	struct batch *batch;
+	pthread_t thread;
+	uint64_t rand; // Picks the victims of steals
+	uint64_t slices;
+	uint64_t steals;
+};
+
+struct batch {
+	struct guest *guests;
+	size_t n;
+	const struct batchopts *opts;
+	uint64_t slice;
+	size_t max_live;
+	double t0;
+	struct worker *workers;
+	unsigned nworkers;
+	_Alignas(CACHELINE) atomic_size_t next; // First guest not started yet
+	_Alignas(CACHELINE) atomic_size_t live;
+	_Alignas(CACHELINE) atomic_size_t done;
+};
+
+static void *batch_worker(void *arg) __attribute__((nonnull));
+static struct guest *guest_next(struct worker *w) __attribute__((nonnull));
+static bool guest_slice(struct worker *w, struct guest *g)
+	__attribute__((nonnull));
+static void guest_done(struct batch *b, struct guest *g)
+	__attribute__((nonnull));
+static void dq_push(struct deque *dq, struct guest *g)
+	__attribute__((nonnull));
+static struct guest *dq_steal(struct deque *dq) __attribute__((nonnull));
+static void batch_stats(const struct batch *b, struct batchstats *stats)
+	__attribute__((nonnull));
+static int cmp_double(const void *a, const void *b);
+static double now(void);
+
+int batch_run(struct guest *guests, size_t n, const struct batchopts *opts,
+	      struct batchstats *stats)
+{
+	struct batch b = {
+		.guests = guests,
+		.n = n,
+		.opts = opts,
+		.slice = opts->slice ? opts->slice : BATCH_SLICE_DEFAULT,
+	};
+	long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t cap = 1;
+	unsigned started;
+	int err = 0;
+
+	if (opts->procopts.trace) {
+		errno = EINVAL;
+		return -1;
+	}
+	b.nworkers = opts->workers ? opts->workers : ncpus > 0 ?
+		     (unsigned)ncpus : 1;
+	b.max_live = opts->max_live ? opts->max_live :
+		     (size_t)b.nworkers * BATCH_LIVE_PER_WORKER;
+	// Every worker may start one guest past max_live
+	while (cap < b.max_live + b.nworkers)
+		cap <<= 1;
+
+	if (!(b.workers = aligned_alloc(CACHELINE, ((b.nworkers *
+	    sizeof(*b.workers) + CACHELINE - 1) & ~(size_t)(CACHELINE - 1)))))
+		return -1;
+	memset(b.workers, 0, b.nworkers * sizeof(*b.workers));
+	for (unsigned i = 0; i < b.nworkers; ++i) {
+		b.workers[i].batch = &b;
+		b.workers[i].rand = i + 1;
+		b.workers[i].dq.mask = cap - 1;
+		if (!(b.workers[i].dq.buf = calloc(cap,
+		    sizeof(*b.workers[i].dq.buf)))) {
+			err = ENOMEM;
+			goto out;
+		}
+	}
+
+	for (size_t i = 0; i < n; ++i)
+		guests[i].state = GUEST_PENDING;
+	b.t0 = now();
+	for (started = 0; started < b.nworkers; ++started)
+		if ((err = pthread_create(&b.workers[started].thread, NULL,
+		    batch_worker, &b.workers[started])) != 0)
+			break;
+	// The started workers still finish the batch
+	if (started == 0)
+		goto out;
+	for (unsigned i = 0; i < started; ++i)
+		pthread_join(b.workers[i].thread, NULL);
+	batch_stats(&b, stats);
+	stats->workers = started;
+	err = 0;
+
+out:
+	for (unsigned i = 0; i < b.nworkers; ++i)
+		free(b.workers[i].dq.buf);
+	free(b.workers);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+
+static void *batch_worker(void *arg)
+{
+	struct worker *w = arg;
+	struct batch *b = w->batch;
+	struct guest *g;
+
+	while (atomic_load_explicit(&b->done, memory_order_acquire) < b->n) {
+		if (!(g = guest_next(w))) {
+			sched_yield();
+			continue;
+		}
+		if (guest_slice(w, g))
+			dq_push(&w->dq, g);
+	}
+	return NULL;
+}
+
+/*
+ * Starts a new guest while there is room for it, or else takes one from the
+ * worker's own deque, or steals one.
+ */
+static struct guest *guest_next(struct worker *w)
+{
+	struct batch *b = w->batch;
+	struct guest *g;
+	size_t i;
+
+	if (atomic_load_explicit(&b->live, memory_order_relaxed) < b->max_live &&
+	    atomic_load_explicit(&b->next, memory_order_relaxed) < b->n &&
+	    (i = atomic_fetch_add_explicit(&b->next, 1,
+					   memory_order_relaxed)) < b->n) {
+		atomic_fetch_add_explicit(&b->live, 1, memory_order_relaxed);
+		return &b->guests[i];
+	}
+
+	if ((g = dq_steal(&w->dq)))
+		return g;
+
+	// xorshift64, from a random victim on
+	w->rand ^= w->rand << 13;
+	w->rand ^= w->rand >> 7;
+	w->rand ^= w->rand << 17;
+	for (unsigned k = 0; k < b->nworkers; ++k) {
+		struct worker *v = &b->workers[(w->rand + k) % b->nworkers];
+
+		if (v != w && (g = dq_steal(&v->dq))) {
+			++w->steals;
+			return g;
+		}
+	}
+	return NULL;
+}
+
+// Runs a time slice of `g`, loading it first, returns true if it isn't done
+static bool guest_slice(struct worker *w, struct guest *g)
+{
+	struct batch *b = w->batch;
+	int ret;
+
+	if (!g->proc) {
+		g->start = now() - b->t0;
+		g->proc = g->image ? proc_spawn(g->image, &b->opts->procopts) :
+			  loadproc(g->path, &b->opts->procopts);
+		if (!g->proc) {
+			g->err = errno;
+			g->state = GUEST_FAILED;
+			guest_done(b, g);
+			return false;
+		}
+		g->loaded = now() - b->t0;
+	}
+
+	++w->slices;
+	if ((ret = proc_run(g->proc, b->slice)) == 0 && !g->proc->exited)
+		return true;
+
+	if (g->proc->exited) {
+		g->state = GUEST_EXITED;
+		g->exit_code = g->proc->exit_code;
+	} else if (g->proc->trap.pending) {
+		g->state = GUEST_TRAPPED;
+		g->trap = g->proc->trap;
+	} else {
+		g->state = GUEST_FAILED;
+		g->err = errno;
+	}
+	guest_done(b, g);
+	return false;
+}
+
+static void guest_done(struct batch *b, struct guest *g)
+{
+	if (g->proc) {
+		g->pc = g->proc->pc;
+		g->instret = g->proc->instret;
+		freeproc(g->proc);
+		g->proc = NULL;
+	}
+	g->end = now() - b->t0;
+	atomic_fetch_sub_explicit(&b->live, 1, memory_order_relaxed);
+	// Publishes the guest to batch_run()
+	atomic_fetch_add_explicit(&b->done, 1, memory_order_release);
+}
+
+// Only called by the owner of `dq`
+static void dq_push(struct deque *dq, struct guest *g)
+{
+	size_t bottom = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+
+	atomic_store_explicit(&dq->buf[bottom & dq->mask], g,
+			      memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&dq->bottom, bottom + 1, memory_order_relaxed);
+}
+
+/*
+ * Takes the guest at the top, by the owner or a thief. Returns NULL if the
+ * deque is empty or another worker got it first.
+ */
+static struct guest *dq_steal(struct deque *dq)
+{
+	size_t top = atomic_load_explicit(&dq->top, memory_order_acquire);
+	size_t bottom;
+	struct guest *g;
+
+	atomic_thread_fence(memory_order_seq_cst);
+	bottom = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+	if (top >= bottom)
+		return NULL;
+	g = atomic_load_explicit(&dq->buf[top & dq->mask],
+				 memory_order_relaxed);
+	if (!atomic_compare_exchange_strong_explicit(&dq->top, &top, top + 1,
+	    memory_order_seq_cst, memory_order_relaxed))
+		return NULL;
+	return g;
+}
+
+static void batch_stats(const struct batch *b, struct batchstats *stats)
+{
+	double *lat;
+	size_t nlat = 0;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->secs = now() - b->t0;
+	for (unsigned i = 0; i < b->nworkers; ++i) {
+		stats->slices += b->workers[i].slices;
+		stats->steals += b->workers[i].steals;
+	}
+
+	lat = malloc(b->n * sizeof(*lat));
+	for (size_t i = 0; i < b->n; ++i) {
+		const struct guest *g = &b->guests[i];
+
+		stats->instret += g->instret;
+		stats->exited += g->state == GUEST_EXITED;
+		stats->trapped += g->state == GUEST_TRAPPED;
+		stats->failed += g->state == GUEST_FAILED;
+		if (g->state == GUEST_FAILED)
+			continue;
+		stats->load_mean += g->loaded - g->start;
+		stats->lat_mean += g->end - g->start;
+		if (lat)
+			lat[nlat++] = g->end - g->start;
+	}
+	if (b->n > stats->failed) {
+		stats->load_mean /= (double)(b->n - stats->failed);
+		stats->lat_mean /= (double)(b->n - stats->failed);
+	}
+	if (!lat || nlat == 0) {
+		free(lat);
+		return;
+	}
+	qsort(lat, nlat, sizeof(*lat), cmp_double);
+	stats->lat_p50 = lat[nlat / 2];
+	stats->lat_p99 = lat[nlat * 99 / 100];
+	stats->lat_max = lat[nlat - 1];
+	free(lat);
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
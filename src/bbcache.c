@@ -0,0 +1,148 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "riscv.h"
+#include "proc.h"
+#include "insn.h"
+#include "debug.h"
+#include "bbcache.h"
+
+#define BB_HASH(pc) (((pc) >> 2) & (BBCACHE_SIZE - 1))
+// Link registers, as in the return address stack hints of the spec
+#define IS_LINK(reg) ((reg) == REG_RA || (reg) == REG_T0)
+
+static struct bblock *bb_build(struct proc *proc, rvaddr_t pc)
+	__attribute__((nonnull));
+static uint32_t bb_flags(const struct dinsn *di) __attribute__((nonnull));
+static void bb_fallthrough(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+
+struct bbcache *bbcache_alloc(void)
+{
+	return calloc(1, sizeof(struct bbcache));
+}
+
+void bbcache_free(struct bbcache *cache)
+{
+	bb_invalidate(cache, 0, UINT64_MAX);
+	free(cache);
+}
+
+struct bblock *bb_lookup(struct proc *proc, rvaddr_t pc)
+{
+	struct bblock *blk;
+
+	for (blk = proc->bbcache->tab[BB_HASH(pc)]; blk; blk = blk->next)
+		if (blk->start == pc)
+			return blk;
+	return bb_build(proc, pc);
+}
+
+void bb_invalidate(struct bbcache *cache, rvaddr_t start, rvaddr_t end)
+{
+	struct bblock **pblk;
+	struct bblock *blk;
+
+	// Predictions may point to dropped blocks
+	memset(cache->jcache, 0, sizeof(cache->jcache));
+	memset(cache->ras, 0, sizeof(cache->ras));
+	cache->ras_top = 0;
+	cache->pred = NULL;
+
+	for (size_t i = 0; i < BBCACHE_SIZE; ++i) {
+		pblk = &cache->tab[i];
+		while ((blk = *pblk)) {
+			if (blk->start < end && start < blk->end) {
+				*pblk = blk->next;
+				free(blk);
+			} else {
+				// May be one of the dropped blocks
+				blk->ret = NULL;
+				pblk = &blk->next;
+			}
+		}
+	}
+}
+
+static struct bblock *bb_build(struct proc *proc, rvaddr_t pc)
+{
+	struct dinsn insns[BB_MAXLEN + 1];
+	struct bblock *blk;
+	rvaddr_t addr = pc;
+	uint32_t len = 0;
+	// Traces are recorded between blocks, see bb_exec_traced()
+	uint32_t maxlen = proc->trace ? 1 : BB_MAXLEN;
+	uint32_t nentries;
+	insn_t insn;
+	int ret;
+
+	while (len < maxlen) {
+		if ((ret = insn_fetch(proc, addr, &insn)) == -1)
+			break;
+		if (insn_predecode(insn, addr, &insns[len]) == -1)
+			break;
+		addr += (unsigned)ret;
+		if (insns[len++].flags & INSN_TERM)
+			break;
+	}
+	// errno was set by insn_fetch() or insn_predecode()
+	if (len == 0)
+		return NULL;
+
+	// The fallthrough entry is never fused, it isn't an instruction
+	for (uint32_t i = 0; i + 1 < len; ++i)
+		i += (uint32_t)insn_fuse(&insns[i]);
+
+	nentries = len;
+	if (!(insns[len - 1].flags & INSN_TERM)) {
+		memset(&insns[len], 0, sizeof(*insns));
+		insns[len].func = bb_fallthrough;
+		insns[len].pc = addr;
+		insns[len].flags = INSN_TERM;
+		++nentries;
+	}
+
+	if (!(blk = malloc(sizeof(*blk) + nentries * sizeof(*blk->insns)))) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	blk->start = pc;
+	blk->end = addr;
+	blk->len = len;
+	blk->execs = 0;
+	blk->flags = bb_flags(&insns[len - 1]);
+	blk->ret = NULL;
+	blk->jit = NULL;
+	memcpy(blk->insns, insns, nentries * sizeof(*insns));
+
+	blk->next = proc->bbcache->tab[BB_HASH(pc)];
+	proc->bbcache->tab[BB_HASH(pc)] = blk;
+	dbg_log("Predecoded block [0x%lx, 0x%lx[ with %u instructions", pc,
+		addr, len);
+	return blk;
+}
+
+/*
+ * How the jump ending a block uses the return address stack. Only jal and
+ * jalr that link in x1 or x5 push, and only jalr through one of them pops.
+ */
+static uint32_t bb_flags(const struct dinsn *di)
+{
+	uint32_t flags = 0;
+
+	if (IS_INSN(di->insn, JAL)) {
+		if (IS_LINK(di->rd))
+			flags |= BB_CALL;
+	} else if (IS_INSN(di->insn, JALR)) {
+		if (IS_LINK(di->rd))
+			flags |= BB_CALL;
+		if (IS_LINK(di->rs1) && di->rs1 != di->rd)
+			flags |= BB_RET;
+	}
+	return flags;
+}
+
+static void bb_fallthrough(struct proc *proc, const struct dinsn *di)
+{
+	proc->pc = di->pc;
+}
@@ -3,57 +3,66 @@
 #include <stdlib.h>
 #include "debug.h"
 
-void dbg_log(const char *restrict fmt, ...)
-{
-	va_list args;
+#define LOG_BUFSIZE (1 << 20)
 
-	fputs("[DEBUG]: ", stderr);
+enum log_level log_level = LOG_LVL_INFO;
+FILE *log_stream;
 
-	va_start(args, fmt);
-	vfprintf(stderr, fmt, args);
-	fputc('\n', stderr);
-	va_end(args);
-}
+static const char *const log_prefix[] = {
+	[LOG_LVL_DEBUG] = "[DEBUG]: ",
+	[LOG_LVL_INFO] = "[INFO]: ",
+	[LOG_LVL_WARN] = "[WARNING]: ",
+	[LOG_LVL_ERR] = "[ERROR]: ",
+};
 
-void info_log(const char *restrict fmt, ...)
+void rvlog(enum log_level level, const char *restrict fmt, ...)
 {
+	FILE *fp = log_stream ? log_stream : stderr;
 	va_list args;
 
-	fputs("[INFO]: ", stderr);
+	// Keeps the lines of guests running on other threads apart
+	flockfile(fp);
+	fputs(log_prefix[level], fp);
 
 	va_start(args, fmt);
-	vfprintf(stderr, fmt, args);
-	fputc('\n', stderr);
+	vfprintf(fp, fmt, args);
+	fputc('\n', fp);
 	va_end(args);
+	funlockfile(fp);
 }
 
-void warn_log(const char *restrict fmt, ...)
+void log_setlevel(enum log_level level)
 {
-	va_list args;
-
-	fputs("[WARNING]: ", stderr);
-
-	va_start(args, fmt);
-	vfprintf(stderr, fmt, args);
-	fputc('\n', stderr);
-	va_end(args);
+	log_level = level;
 }
 
-void err_log(const char *restrict fmt, ...)
+int log_open(const char *path)
 {
-	va_list args;
+	FILE *fp;
 
-	fputs("[WARNING]: ", stderr);
+	if (!(fp = fopen(path, "w")))
+		return -1;
+	// Can only fail on a bad mode, the default buffer is kept then
+	setvbuf(fp, NULL, _IOFBF, LOG_BUFSIZE);
 
-	va_start(args, fmt);
-	vfprintf(stderr, fmt, args);
-	fputc('\n', stderr);
-	va_end(args);
+	log_close();
+	log_stream = fp;
+	return 0;
+}
+
+void log_close(void)
+{
+	if (log_stream)
+		fclose(log_stream);
+	log_stream = NULL;
 }
 
 void rvrunpanic(const char *restrict file, const char *restrict func, int line,
 		const char *restrict reason)
 {
+	// The end of the log is the most useful part
+	if (log_stream)
+		fflush(log_stream);
 	fprintf(stderr, "[PANIC]: %s:%s():%d: %s\n", file, func, line, reason);
 	abort();
 }
@@ -1,48 +1,718 @@
 #include <errno.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include "riscv.h"
 #include "rv_i.h"
+#include "rv_m.h"
+#include "rv_a.h"
+#include "rv_b.h"
+#include "rv_c.h"
+#include "rv_f.h"
+#include "rv_v.h"
 #include "proc.h"
 #include "debug.h"
 #include "insn.h"
 
-int insn_fetch(struct proc *proc, insn_t *insn)
+// Instruction formats, tell insn_predecode() how to extract the immediate
+enum insn_fmt {
+	FMT_R,
+	FMT_I,
+	FMT_S,
+	FMT_B,
+	FMT_U,
+	FMT_J,
+	FMT_SH, // Shift by an immediate, `imm` is the shift amount
+	FMT_F, // Floating point with an f register as rd, no immediate
+	FMT_FL, // Floating-point load, FMT_I with an f register as rd
+	FMT_V, // Vector, `imm` is simm5 and rd, rs1 and rs2 may name v0
+	FMT_VM, // Vector load or store, with no immediate
+};
+
+/*
+ * Instructions known to the decoder. The decode tables used by insn_decode()
+ * are derived from the MASK_* and MATCH_* pairs of opcodes.h listed here, so
+ * supporting a new instruction only requires adding it to this array.
+ */
+struct insn_desc {
+	const char *name;
+	insn_t mask;
+	insn_t match;
+	insn_func_t func;
+	insn_func_t x0func; // Replaces `func` when rd is x0, if not NULL
+	enum insn_fmt fmt;
+	uint8_t flags;
+};
+
+#define ADD_INSN(name, fname, x0fname, fmt, flags)			\
+	{#name, MASK_##name, MATCH_##name, (fname), (x0fname), (fmt), (flags)}
+static const struct insn_desc insn_tab[] = {
+	ADD_INSN(LUI, insn_lui, insn_hint, FMT_U, 0),
+	ADD_INSN(AUIPC, insn_auipc, insn_hint, FMT_U, 0),
+	ADD_INSN(JAL, insn_jal, insn_j, FMT_J, INSN_TERM),
+	ADD_INSN(JALR, insn_jalr, insn_jr, FMT_I, INSN_TERM),
+	ADD_INSN(BEQ, insn_beq, NULL, FMT_B, INSN_TERM),
+	ADD_INSN(BNE, insn_bne, NULL, FMT_B, INSN_TERM),
+	ADD_INSN(BLT, insn_blt, NULL, FMT_B, INSN_TERM),
+	ADD_INSN(BGE, insn_bge, NULL, FMT_B, INSN_TERM),
+	ADD_INSN(BLTU, insn_bltu, NULL, FMT_B, INSN_TERM),
+	ADD_INSN(BGEU, insn_bgeu, NULL, FMT_B, INSN_TERM),
+	ADD_INSN(LB, insn_lb, NULL, FMT_I, INSN_LOAD),
+	ADD_INSN(LH, insn_lh, NULL, FMT_I, INSN_LOAD),
+	ADD_INSN(LW, insn_lw, NULL, FMT_I, INSN_LOAD),
+	ADD_INSN(LD, insn_ld, NULL, FMT_I, INSN_LOAD),
+	ADD_INSN(LBU, insn_lbu, NULL, FMT_I, INSN_LOAD),
+	ADD_INSN(LHU, insn_lhu, NULL, FMT_I, INSN_LOAD),
+	ADD_INSN(LWU, insn_lwu, NULL, FMT_I, INSN_LOAD),
+	ADD_INSN(SB, insn_sb, NULL, FMT_S, INSN_STORE),
+	ADD_INSN(SH, insn_sh, NULL, FMT_S, INSN_STORE),
+	ADD_INSN(SW, insn_sw, NULL, FMT_S, INSN_STORE),
+	ADD_INSN(SD, insn_sd, NULL, FMT_S, INSN_STORE),
+	ADD_INSN(ADDI, insn_addi, insn_hint, FMT_I, 0),
+	ADD_INSN(SLTI, insn_slti, insn_hint, FMT_I, 0),
+	ADD_INSN(SLTIU, insn_sltiu, insn_hint, FMT_I, 0),
+	ADD_INSN(XORI, insn_xori, insn_hint, FMT_I, 0),
+	ADD_INSN(ORI, insn_ori, insn_hint, FMT_I, 0),
+	ADD_INSN(ANDI, insn_andi, insn_hint, FMT_I, 0),
+	ADD_INSN(SLLI, insn_slli, insn_hint, FMT_SH, 0),
+	ADD_INSN(SRLI, insn_srli, insn_hint, FMT_SH, 0),
+	ADD_INSN(SRAI, insn_srai, insn_hint, FMT_SH, 0),
+	ADD_INSN(ADD, insn_add, insn_hint, FMT_R, 0),
+	ADD_INSN(SLT, insn_slt, insn_hint, FMT_R, 0),
+	ADD_INSN(SLTU, insn_sltu, insn_hint, FMT_R, 0),
+	ADD_INSN(AND, insn_and, insn_hint, FMT_R, 0),
+	ADD_INSN(OR, insn_or, insn_hint, FMT_R, 0),
+	ADD_INSN(XOR, insn_xor, insn_hint, FMT_R, 0),
+	ADD_INSN(SLL, insn_sll, insn_hint, FMT_R, 0),
+	ADD_INSN(SRL, insn_srl, insn_hint, FMT_R, 0),
+	ADD_INSN(SRA, insn_sra, insn_hint, FMT_R, 0),
+	ADD_INSN(SUB, insn_sub, insn_hint, FMT_R, 0),
+	ADD_INSN(ADDIW, insn_addiw, insn_hint, FMT_I, 0),
+	ADD_INSN(SLLIW, insn_slliw, insn_hint, FMT_SH, 0),
+	ADD_INSN(SRLIW, insn_srliw, insn_hint, FMT_SH, 0),
+	ADD_INSN(SRAIW, insn_sraiw, insn_hint, FMT_SH, 0),
+	ADD_INSN(ADDW, insn_addw, insn_hint, FMT_R, 0),
+	ADD_INSN(SUBW, insn_subw, insn_hint, FMT_R, 0),
+	ADD_INSN(SLLW, insn_sllw, insn_hint, FMT_R, 0),
+	ADD_INSN(SRLW, insn_srlw, insn_hint, FMT_R, 0),
+	ADD_INSN(SRAW, insn_sraw, insn_hint, FMT_R, 0),
+	ADD_INSN(MUL, insn_mul, insn_hint, FMT_R, 0),
+	ADD_INSN(MULH, insn_mulh, insn_hint, FMT_R, 0),
+	ADD_INSN(MULHSU, insn_mulhsu, insn_hint, FMT_R, 0),
+	ADD_INSN(MULHU, insn_mulhu, insn_hint, FMT_R, 0),
+	ADD_INSN(DIV, insn_div, insn_hint, FMT_R, 0),
+	ADD_INSN(DIVU, insn_divu, insn_hint, FMT_R, 0),
+	ADD_INSN(REM, insn_rem, insn_hint, FMT_R, 0),
+	ADD_INSN(REMU, insn_remu, insn_hint, FMT_R, 0),
+	ADD_INSN(MULW, insn_mulw, insn_hint, FMT_R, 0),
+	ADD_INSN(DIVW, insn_divw, insn_hint, FMT_R, 0),
+	ADD_INSN(DIVUW, insn_divuw, insn_hint, FMT_R, 0),
+	ADD_INSN(REMW, insn_remw, insn_hint, FMT_R, 0),
+	ADD_INSN(REMUW, insn_remuw, insn_hint, FMT_R, 0),
+	ADD_INSN(LR_W, insn_lr_w, NULL, FMT_R, INSN_LOAD),
+	ADD_INSN(SC_W, insn_sc_w, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOSWAP_W, insn_amoswap_w, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOADD_W, insn_amoadd_w, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOXOR_W, insn_amoxor_w, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOAND_W, insn_amoand_w, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOOR_W, insn_amoor_w, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOMIN_W, insn_amomin_w, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOMAX_W, insn_amomax_w, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOMINU_W, insn_amominu_w, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOMAXU_W, insn_amomaxu_w, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(LR_D, insn_lr_d, NULL, FMT_R, INSN_LOAD),
+	ADD_INSN(SC_D, insn_sc_d, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOSWAP_D, insn_amoswap_d, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOADD_D, insn_amoadd_d, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOXOR_D, insn_amoxor_d, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOAND_D, insn_amoand_d, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOOR_D, insn_amoor_d, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOMIN_D, insn_amomin_d, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOMAX_D, insn_amomax_d, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOMINU_D, insn_amominu_d, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(AMOMAXU_D, insn_amomaxu_d, NULL, FMT_R, INSN_STORE),
+	ADD_INSN(SH1ADD, insn_sh1add, insn_hint, FMT_R, 0),
+	ADD_INSN(SH2ADD, insn_sh2add, insn_hint, FMT_R, 0),
+	ADD_INSN(SH3ADD, insn_sh3add, insn_hint, FMT_R, 0),
+	ADD_INSN(ADD_UW, insn_add_uw, insn_hint, FMT_R, 0),
+	ADD_INSN(SH1ADD_UW, insn_sh1add_uw, insn_hint, FMT_R, 0),
+	ADD_INSN(SH2ADD_UW, insn_sh2add_uw, insn_hint, FMT_R, 0),
+	ADD_INSN(SH3ADD_UW, insn_sh3add_uw, insn_hint, FMT_R, 0),
+	ADD_INSN(SLLI_UW, insn_slli_uw, insn_hint, FMT_SH, 0),
+	ADD_INSN(ANDN, insn_andn, insn_hint, FMT_R, 0),
+	ADD_INSN(ORN, insn_orn, insn_hint, FMT_R, 0),
+	ADD_INSN(XNOR, insn_xnor, insn_hint, FMT_R, 0),
+	ADD_INSN(CLZ, insn_clz, insn_hint, FMT_R, 0),
+	ADD_INSN(CTZ, insn_ctz, insn_hint, FMT_R, 0),
+	ADD_INSN(CPOP, insn_cpop, insn_hint, FMT_R, 0),
+	ADD_INSN(CLZW, insn_clzw, insn_hint, FMT_R, 0),
+	ADD_INSN(CTZW, insn_ctzw, insn_hint, FMT_R, 0),
+	ADD_INSN(CPOPW, insn_cpopw, insn_hint, FMT_R, 0),
+	ADD_INSN(MAX, insn_max, insn_hint, FMT_R, 0),
+	ADD_INSN(MAXU, insn_maxu, insn_hint, FMT_R, 0),
+	ADD_INSN(MIN, insn_min, insn_hint, FMT_R, 0),
+	ADD_INSN(MINU, insn_minu, insn_hint, FMT_R, 0),
+	ADD_INSN(SEXT_B, insn_sext_b, insn_hint, FMT_R, 0),
+	ADD_INSN(SEXT_H, insn_sext_h, insn_hint, FMT_R, 0),
+	ADD_INSN(ZEXT_H, insn_zext_h, insn_hint, FMT_R, 0),
+	ADD_INSN(ROL, insn_rol, insn_hint, FMT_R, 0),
+	ADD_INSN(ROR, insn_ror, insn_hint, FMT_R, 0),
+	ADD_INSN(RORI, insn_rori, insn_hint, FMT_SH, 0),
+	ADD_INSN(ROLW, insn_rolw, insn_hint, FMT_R, 0),
+	ADD_INSN(RORW, insn_rorw, insn_hint, FMT_R, 0),
+	ADD_INSN(RORIW, insn_roriw, insn_hint, FMT_SH, 0),
+	ADD_INSN(ORC_B, insn_orc_b, insn_hint, FMT_R, 0),
+	ADD_INSN(REV8, insn_rev8, insn_hint, FMT_R, 0),
+	ADD_INSN(BCLR, insn_bclr, insn_hint, FMT_R, 0),
+	ADD_INSN(BCLRI, insn_bclri, insn_hint, FMT_SH, 0),
+	ADD_INSN(BEXT, insn_bext, insn_hint, FMT_R, 0),
+	ADD_INSN(BEXTI, insn_bexti, insn_hint, FMT_SH, 0),
+	ADD_INSN(BINV, insn_binv, insn_hint, FMT_R, 0),
+	ADD_INSN(BINVI, insn_binvi, insn_hint, FMT_SH, 0),
+	ADD_INSN(BSET, insn_bset, insn_hint, FMT_R, 0),
+	ADD_INSN(BSETI, insn_bseti, insn_hint, FMT_SH, 0),
+	ADD_INSN(FENCE, insn_fence, NULL, FMT_I, 0),
+	ADD_INSN(FENCE_I, insn_fence_i, NULL, FMT_I, INSN_TERM),
+	ADD_INSN(ECALL, insn_ecall, NULL, FMT_I, INSN_TERM),
+	ADD_INSN(EBREAK, insn_ebreak, NULL, FMT_I, INSN_TERM),
+	ADD_INSN(CSRRW, insn_csrrw, NULL, FMT_I, 0),
+	ADD_INSN(CSRRS, insn_csrrs, NULL, FMT_I, 0),
+	ADD_INSN(CSRRC, insn_csrrc, NULL, FMT_I, 0),
+	ADD_INSN(CSRRWI, insn_csrrwi, NULL, FMT_I, 0),
+	ADD_INSN(CSRRSI, insn_csrrsi, NULL, FMT_I, 0),
+	ADD_INSN(CSRRCI, insn_csrrci, NULL, FMT_I, 0),
+	ADD_INSN(FLW, insn_flw, NULL, FMT_FL, INSN_LOAD),
+	ADD_INSN(FLD, insn_fld, NULL, FMT_FL, INSN_LOAD),
+	ADD_INSN(FSW, insn_fsw, NULL, FMT_S, INSN_STORE),
+	ADD_INSN(FSD, insn_fsd, NULL, FMT_S, INSN_STORE),
+	ADD_INSN(FADD_S, insn_fadd_s, NULL, FMT_F, 0),
+	ADD_INSN(FSUB_S, insn_fsub_s, NULL, FMT_F, 0),
+	ADD_INSN(FMUL_S, insn_fmul_s, NULL, FMT_F, 0),
+	ADD_INSN(FDIV_S, insn_fdiv_s, NULL, FMT_F, 0),
+	ADD_INSN(FSQRT_S, insn_fsqrt_s, NULL, FMT_F, 0),
+	ADD_INSN(FMIN_S, insn_fmin_s, NULL, FMT_F, 0),
+	ADD_INSN(FMAX_S, insn_fmax_s, NULL, FMT_F, 0),
+	ADD_INSN(FMADD_S, insn_fmadd_s, NULL, FMT_F, 0),
+	ADD_INSN(FMSUB_S, insn_fmsub_s, NULL, FMT_F, 0),
+	ADD_INSN(FNMSUB_S, insn_fnmsub_s, NULL, FMT_F, 0),
+	ADD_INSN(FNMADD_S, insn_fnmadd_s, NULL, FMT_F, 0),
+	ADD_INSN(FSGNJ_S, insn_fsgnj_s, NULL, FMT_F, 0),
+	ADD_INSN(FSGNJN_S, insn_fsgnjn_s, NULL, FMT_F, 0),
+	ADD_INSN(FSGNJX_S, insn_fsgnjx_s, NULL, FMT_F, 0),
+	ADD_INSN(FEQ_S, insn_feq_s, NULL, FMT_R, 0),
+	ADD_INSN(FLT_S, insn_flt_s, NULL, FMT_R, 0),
+	ADD_INSN(FLE_S, insn_fle_s, NULL, FMT_R, 0),
+	ADD_INSN(FCLASS_S, insn_fclass_s, NULL, FMT_R, 0),
+	ADD_INSN(FCVT_W_S, insn_fcvt_w_s, NULL, FMT_R, 0),
+	ADD_INSN(FCVT_WU_S, insn_fcvt_wu_s, NULL, FMT_R, 0),
+	ADD_INSN(FCVT_L_S, insn_fcvt_l_s, NULL, FMT_R, 0),
+	ADD_INSN(FCVT_LU_S, insn_fcvt_lu_s, NULL, FMT_R, 0),
+	ADD_INSN(FCVT_S_W, insn_fcvt_s_w, NULL, FMT_F, 0),
+	ADD_INSN(FCVT_S_WU, insn_fcvt_s_wu, NULL, FMT_F, 0),
+	ADD_INSN(FCVT_S_L, insn_fcvt_s_l, NULL, FMT_F, 0),
+	ADD_INSN(FCVT_S_LU, insn_fcvt_s_lu, NULL, FMT_F, 0),
+	ADD_INSN(FADD_D, insn_fadd_d, NULL, FMT_F, 0),
+	ADD_INSN(FSUB_D, insn_fsub_d, NULL, FMT_F, 0),
+	ADD_INSN(FMUL_D, insn_fmul_d, NULL, FMT_F, 0),
+	ADD_INSN(FDIV_D, insn_fdiv_d, NULL, FMT_F, 0),
+	ADD_INSN(FSQRT_D, insn_fsqrt_d, NULL, FMT_F, 0),
+	ADD_INSN(FMIN_D, insn_fmin_d, NULL, FMT_F, 0),
+	ADD_INSN(FMAX_D, insn_fmax_d, NULL, FMT_F, 0),
+	ADD_INSN(FMADD_D, insn_fmadd_d, NULL, FMT_F, 0),
+	ADD_INSN(FMSUB_D, insn_fmsub_d, NULL, FMT_F, 0),
+	ADD_INSN(FNMSUB_D, insn_fnmsub_d, NULL, FMT_F, 0),
+	ADD_INSN(FNMADD_D, insn_fnmadd_d, NULL, FMT_F, 0),
+	ADD_INSN(FSGNJ_D, insn_fsgnj_d, NULL, FMT_F, 0),
+	ADD_INSN(FSGNJN_D, insn_fsgnjn_d, NULL, FMT_F, 0),
+	ADD_INSN(FSGNJX_D, insn_fsgnjx_d, NULL, FMT_F, 0),
+	ADD_INSN(FEQ_D, insn_feq_d, NULL, FMT_R, 0),
+	ADD_INSN(FLT_D, insn_flt_d, NULL, FMT_R, 0),
+	ADD_INSN(FLE_D, insn_fle_d, NULL, FMT_R, 0),
+	ADD_INSN(FCLASS_D, insn_fclass_d, NULL, FMT_R, 0),
+	ADD_INSN(FCVT_W_D, insn_fcvt_w_d, NULL, FMT_R, 0),
+	ADD_INSN(FCVT_WU_D, insn_fcvt_wu_d, NULL, FMT_R, 0),
+	ADD_INSN(FCVT_L_D, insn_fcvt_l_d, NULL, FMT_R, 0),
+	ADD_INSN(FCVT_LU_D, insn_fcvt_lu_d, NULL, FMT_R, 0),
+	ADD_INSN(FCVT_D_W, insn_fcvt_d_w, NULL, FMT_F, 0),
+	ADD_INSN(FCVT_D_WU, insn_fcvt_d_wu, NULL, FMT_F, 0),
+	ADD_INSN(FCVT_D_L, insn_fcvt_d_l, NULL, FMT_F, 0),
+	ADD_INSN(FCVT_D_LU, insn_fcvt_d_lu, NULL, FMT_F, 0),
+	ADD_INSN(FCVT_S_D, insn_fcvt_s_d, NULL, FMT_F, 0),
+	ADD_INSN(FCVT_D_S, insn_fcvt_d_s, NULL, FMT_F, 0),
+	ADD_INSN(FMV_X_W, insn_fmv_x_w, NULL, FMT_R, 0),
+	ADD_INSN(FMV_W_X, insn_fmv_w_x, NULL, FMT_F, 0),
+	ADD_INSN(FMV_X_D, insn_fmv_x_d, NULL, FMT_R, 0),
+	ADD_INSN(FMV_D_X, insn_fmv_d_x, NULL, FMT_F, 0),
+
+	ADD_INSN(VSETVLI, insn_vsetvli, NULL, FMT_I, 0),
+	ADD_INSN(VSETIVLI, insn_vsetivli, NULL, FMT_I, 0),
+	ADD_INSN(VSETVL, insn_vsetvl, NULL, FMT_R, 0),
+	ADD_INSN(VLE8_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLSE8_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLUXEI8_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLOXEI8_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VSE8_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSSE8_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSUXEI8_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSOXEI8_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VLE16_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLSE16_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLUXEI16_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLOXEI16_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VSE16_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSSE16_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSUXEI16_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSOXEI16_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VLE32_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLSE32_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLUXEI32_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLOXEI32_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VSE32_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSSE32_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSUXEI32_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSOXEI32_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VLE64_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLSE64_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLUXEI64_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VLOXEI64_V, insn_vle_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VSE64_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSSE64_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSUXEI64_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VSOXEI64_V, insn_vse_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VLM_V, insn_vlm_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VSM_V, insn_vsm_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VL1RE8_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL1RE16_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL1RE32_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL1RE64_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VS1R_V, insn_vsr_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VL2RE8_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL2RE16_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL2RE32_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL2RE64_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VS2R_V, insn_vsr_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VL4RE8_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL4RE16_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL4RE32_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL4RE64_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VS4R_V, insn_vsr_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VL8RE8_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL8RE16_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL8RE32_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VL8RE64_V, insn_vlr_v, NULL, FMT_VM, INSN_LOAD),
+	ADD_INSN(VS8R_V, insn_vsr_v, NULL, FMT_VM, INSN_STORE),
+	ADD_INSN(VADD_VV, insn_vadd_vv, NULL, FMT_V, 0),
+	ADD_INSN(VADD_VX, insn_vadd_vx, NULL, FMT_V, 0),
+	ADD_INSN(VADD_VI, insn_vadd_vi, NULL, FMT_V, 0),
+	ADD_INSN(VSUB_VV, insn_vsub_vv, NULL, FMT_V, 0),
+	ADD_INSN(VSUB_VX, insn_vsub_vx, NULL, FMT_V, 0),
+	ADD_INSN(VRSUB_VX, insn_vrsub_vx, NULL, FMT_V, 0),
+	ADD_INSN(VRSUB_VI, insn_vrsub_vi, NULL, FMT_V, 0),
+	ADD_INSN(VMINU_VV, insn_vminu_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMINU_VX, insn_vminu_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMIN_VV, insn_vmin_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMIN_VX, insn_vmin_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMAXU_VV, insn_vmaxu_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMAXU_VX, insn_vmaxu_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMAX_VV, insn_vmax_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMAX_VX, insn_vmax_vx, NULL, FMT_V, 0),
+	ADD_INSN(VAND_VV, insn_vand_vv, NULL, FMT_V, 0),
+	ADD_INSN(VAND_VX, insn_vand_vx, NULL, FMT_V, 0),
+	ADD_INSN(VAND_VI, insn_vand_vi, NULL, FMT_V, 0),
+	ADD_INSN(VOR_VV, insn_vor_vv, NULL, FMT_V, 0),
+	ADD_INSN(VOR_VX, insn_vor_vx, NULL, FMT_V, 0),
+	ADD_INSN(VOR_VI, insn_vor_vi, NULL, FMT_V, 0),
+	ADD_INSN(VXOR_VV, insn_vxor_vv, NULL, FMT_V, 0),
+	ADD_INSN(VXOR_VX, insn_vxor_vx, NULL, FMT_V, 0),
+	ADD_INSN(VXOR_VI, insn_vxor_vi, NULL, FMT_V, 0),
+	ADD_INSN(VRGATHER_VV, insn_vrgather_vv, NULL, FMT_V, 0),
+	ADD_INSN(VRGATHER_VX, insn_vrgather_vx, NULL, FMT_V, 0),
+	ADD_INSN(VRGATHER_VI, insn_vrgather_vi, NULL, FMT_V, 0),
+	ADD_INSN(VSLIDEUP_VX, insn_vslideup_vx, NULL, FMT_V, 0),
+	ADD_INSN(VSLIDEUP_VI, insn_vslideup_vi, NULL, FMT_V, 0),
+	ADD_INSN(VSLIDEDOWN_VX, insn_vslidedown_vx, NULL, FMT_V, 0),
+	ADD_INSN(VSLIDEDOWN_VI, insn_vslidedown_vi, NULL, FMT_V, 0),
+	ADD_INSN(VMERGE_VVM, insn_vmerge_vvm, NULL, FMT_V, 0),
+	ADD_INSN(VMERGE_VXM, insn_vmerge_vxm, NULL, FMT_V, 0),
+	ADD_INSN(VMERGE_VIM, insn_vmerge_vim, NULL, FMT_V, 0),
+	ADD_INSN(VMV_V_V, insn_vmv_v_v, NULL, FMT_V, 0),
+	ADD_INSN(VMV_V_X, insn_vmv_v_x, NULL, FMT_V, 0),
+	ADD_INSN(VMV_V_I, insn_vmv_v_i, NULL, FMT_V, 0),
+	ADD_INSN(VMSEQ_VV, insn_vmseq_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMSEQ_VX, insn_vmseq_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMSEQ_VI, insn_vmseq_vi, NULL, FMT_V, 0),
+	ADD_INSN(VMSNE_VV, insn_vmsne_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMSNE_VX, insn_vmsne_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMSNE_VI, insn_vmsne_vi, NULL, FMT_V, 0),
+	ADD_INSN(VMSLTU_VV, insn_vmsltu_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMSLTU_VX, insn_vmsltu_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMSLT_VV, insn_vmslt_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMSLT_VX, insn_vmslt_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMSLEU_VV, insn_vmsleu_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMSLEU_VX, insn_vmsleu_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMSLEU_VI, insn_vmsleu_vi, NULL, FMT_V, 0),
+	ADD_INSN(VMSLE_VV, insn_vmsle_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMSLE_VX, insn_vmsle_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMSLE_VI, insn_vmsle_vi, NULL, FMT_V, 0),
+	ADD_INSN(VMSGTU_VX, insn_vmsgtu_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMSGTU_VI, insn_vmsgtu_vi, NULL, FMT_V, 0),
+	ADD_INSN(VMSGT_VX, insn_vmsgt_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMSGT_VI, insn_vmsgt_vi, NULL, FMT_V, 0),
+	ADD_INSN(VSLL_VV, insn_vsll_vv, NULL, FMT_V, 0),
+	ADD_INSN(VSLL_VX, insn_vsll_vx, NULL, FMT_V, 0),
+	ADD_INSN(VSLL_VI, insn_vsll_vi, NULL, FMT_V, 0),
+	ADD_INSN(VSRL_VV, insn_vsrl_vv, NULL, FMT_V, 0),
+	ADD_INSN(VSRL_VX, insn_vsrl_vx, NULL, FMT_V, 0),
+	ADD_INSN(VSRL_VI, insn_vsrl_vi, NULL, FMT_V, 0),
+	ADD_INSN(VSRA_VV, insn_vsra_vv, NULL, FMT_V, 0),
+	ADD_INSN(VSRA_VX, insn_vsra_vx, NULL, FMT_V, 0),
+	ADD_INSN(VSRA_VI, insn_vsra_vi, NULL, FMT_V, 0),
+	ADD_INSN(VMV1R_V, insn_vmvr_v, NULL, FMT_V, 0),
+	ADD_INSN(VMV2R_V, insn_vmvr_v, NULL, FMT_V, 0),
+	ADD_INSN(VMV4R_V, insn_vmvr_v, NULL, FMT_V, 0),
+	ADD_INSN(VMV8R_V, insn_vmvr_v, NULL, FMT_V, 0),
+	ADD_INSN(VREDSUM_VS, insn_vred, NULL, FMT_V, 0),
+	ADD_INSN(VREDAND_VS, insn_vred, NULL, FMT_V, 0),
+	ADD_INSN(VREDOR_VS, insn_vred, NULL, FMT_V, 0),
+	ADD_INSN(VREDXOR_VS, insn_vred, NULL, FMT_V, 0),
+	ADD_INSN(VREDMINU_VS, insn_vred, NULL, FMT_V, 0),
+	ADD_INSN(VREDMIN_VS, insn_vred, NULL, FMT_V, 0),
+	ADD_INSN(VREDMAXU_VS, insn_vred, NULL, FMT_V, 0),
+	ADD_INSN(VREDMAX_VS, insn_vred, NULL, FMT_V, 0),
+	ADD_INSN(VSLIDE1UP_VX, insn_vslide1up_vx, NULL, FMT_V, 0),
+	ADD_INSN(VSLIDE1DOWN_VX, insn_vslide1down_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMV_X_S, insn_vmv_x_s, NULL, FMT_R, 0),
+	ADD_INSN(VMV_S_X, insn_vmv_s_x, NULL, FMT_V, 0),
+	ADD_INSN(VCPOP_M, insn_vcpop_m, NULL, FMT_R, 0),
+	ADD_INSN(VFIRST_M, insn_vfirst_m, NULL, FMT_R, 0),
+	ADD_INSN(VID_V, insn_vid_v, NULL, FMT_V, 0),
+	ADD_INSN(VMANDN_MM, insn_vmlogic, NULL, FMT_V, 0),
+	ADD_INSN(VMAND_MM, insn_vmlogic, NULL, FMT_V, 0),
+	ADD_INSN(VMOR_MM, insn_vmlogic, NULL, FMT_V, 0),
+	ADD_INSN(VMXOR_MM, insn_vmlogic, NULL, FMT_V, 0),
+	ADD_INSN(VMORN_MM, insn_vmlogic, NULL, FMT_V, 0),
+	ADD_INSN(VMNAND_MM, insn_vmlogic, NULL, FMT_V, 0),
+	ADD_INSN(VMNOR_MM, insn_vmlogic, NULL, FMT_V, 0),
+	ADD_INSN(VMXNOR_MM, insn_vmlogic, NULL, FMT_V, 0),
+	ADD_INSN(VDIVU_VV, insn_vdivu_vv, NULL, FMT_V, 0),
+	ADD_INSN(VDIVU_VX, insn_vdivu_vx, NULL, FMT_V, 0),
+	ADD_INSN(VDIV_VV, insn_vdiv_vv, NULL, FMT_V, 0),
+	ADD_INSN(VDIV_VX, insn_vdiv_vx, NULL, FMT_V, 0),
+	ADD_INSN(VREMU_VV, insn_vremu_vv, NULL, FMT_V, 0),
+	ADD_INSN(VREMU_VX, insn_vremu_vx, NULL, FMT_V, 0),
+	ADD_INSN(VREM_VV, insn_vrem_vv, NULL, FMT_V, 0),
+	ADD_INSN(VREM_VX, insn_vrem_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMULHU_VV, insn_vmulhu_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMULHU_VX, insn_vmulhu_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMUL_VV, insn_vmul_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMUL_VX, insn_vmul_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMULHSU_VV, insn_vmulhsu_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMULHSU_VX, insn_vmulhsu_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMULH_VV, insn_vmulh_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMULH_VX, insn_vmulh_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMADD_VV, insn_vmadd_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMADD_VX, insn_vmadd_vx, NULL, FMT_V, 0),
+	ADD_INSN(VNMSUB_VV, insn_vnmsub_vv, NULL, FMT_V, 0),
+	ADD_INSN(VNMSUB_VX, insn_vnmsub_vx, NULL, FMT_V, 0),
+	ADD_INSN(VMACC_VV, insn_vmacc_vv, NULL, FMT_V, 0),
+	ADD_INSN(VMACC_VX, insn_vmacc_vx, NULL, FMT_V, 0),
+	ADD_INSN(VNMSAC_VV, insn_vnmsac_vv, NULL, FMT_V, 0),
+	ADD_INSN(VNMSAC_VX, insn_vnmsac_vx, NULL, FMT_V, 0),
+};
+#undef ADD_INSN
+#define INSN_TAB_LEN (sizeof(insn_tab) / sizeof(*insn_tab))
+
+/*
+ * Pairs fused by insn_fuse(). The second instruction must read the rd of the
+ * first as rs1, and branches must compare it against x0.
+ */
+struct fuse_desc {
+	insn_t mask[2];
+	insn_t match[2];
+	insn_func_t func;
+};
+
+#define ADD_FUSE(first, second, fname)					\
+	{{MASK_##first, MASK_##second}, {MATCH_##first, MATCH_##second},	\
+	 (fname)}
+static const struct fuse_desc fuse_tab[] = {
+	ADD_FUSE(LUI, ADDI, insn_lui_addi),
+	ADD_FUSE(LUI, ADDIW, insn_lui_addiw),
+	ADD_FUSE(AUIPC, ADDI, insn_auipc_addi),
+	ADD_FUSE(AUIPC, JALR, insn_auipc_jalr),
+	ADD_FUSE(AUIPC, LD, insn_auipc_ld),
+	ADD_FUSE(SLT, BEQ, insn_slt_bz),
+	ADD_FUSE(SLT, BNE, insn_slt_bz),
+	ADD_FUSE(SLTU, BEQ, insn_sltu_bz),
+	ADD_FUSE(SLTU, BNE, insn_sltu_bz),
+	ADD_FUSE(SLTI, BEQ, insn_slti_bz),
+	ADD_FUSE(SLTI, BNE, insn_slti_bz),
+	ADD_FUSE(SLTIU, BEQ, insn_sltiu_bz),
+	ADD_FUSE(SLTIU, BNE, insn_sltiu_bz),
+};
+#undef ADD_FUSE
+#define FUSE_TAB_LEN (sizeof(fuse_tab) / sizeof(*fuse_tab))
+
+/*
+ * Decode tree, indexed by opcode, then funct3, then funct7. Every path has the
+ * same depth so decoding is branch free until the leaf: a level that does not
+ * need to look at its field has a single child and a zero `idxmask`. Leaves
+ * hold the first candidate inline and chain the rare others through `next`
+ * (e.g. ecall and ebreak only differ in imm12), an empty leaf never matches.
+ */
+struct dnode {
+	struct dnode *child;
+	struct dnode *next;
+	const struct insn_desc *desc;
+	insn_t idxmask;
+	insn_t mask;
+	insn_t match;
+};
+
+static const struct {
+	unsigned shift;
+	insn_t mask;
+} dfields[] = {
+	{0, 0x7f},	// opcode
+	{12, 0x7},	// funct3
+	{25, 0x7f},	// funct7
+};
+#define DFIELDS_LEN (sizeof(dfields) / sizeof(*dfields))
+
+static struct dnode optab[0x80];
+
+static const struct insn_desc *insn_lookup(insn_t insn);
+static ireg_t insn_imm(insn_t insn, enum insn_fmt fmt);
+static void dnode_build(struct dnode *node, unsigned depth,
+			const struct insn_desc **cand, size_t ncand)
+	__attribute__((nonnull, cold));
+static void insn_decode_init(void) __attribute__((constructor, cold));
+static int insn_fetch16(struct proc *proc, rvaddr_t addr, uint16_t *half)
+	__attribute__((nonnull));
+
+int insn_fetch(struct proc *proc, rvaddr_t addr, insn_t *insn)
 {
+	uint16_t lo, hi;
+
+	if (insn_fetch16(proc, addr, &lo) == -1)
+		return -1;
+	if (RVC_IS_COMPRESSED(lo)) {
+		*insn = lo;
+		return 2;
+	}
+	// The upper half may be on the next page, or in the next segment
+	if (insn_fetch16(proc, addr + 2, &hi) == -1)
+		return -1;
+	*insn = (insn_t)lo | (insn_t)hi << 16;
+	return 4;
+}
+
+// Fetches the 16-bit parcel at `addr`, instructions are made of one or two
+static int insn_fetch16(struct proc *proc, rvaddr_t addr, uint16_t *half)
+{
+	const struct tlb_entry *e = &proc->mem.tlb.exec[TLB_IDX(addr)];
 	struct memseg *seg;
 
-	seg = is_memseg(proc->mem, proc->pc, proc->pc + sizeof(*insn) + 1);
-	if (!seg) {
-		errno = EINVAL;
+	if (e->tag == TLB_TAG(addr, sizeof(*half))) {
+		memcpy_le(half, (const void *)(e->addend + addr), 16);
+		return 0;
+	}
+
+	mem_lock(&proc->mem);
+	seg = is_memseg(&proc->mem, addr, addr + sizeof(*half));
+	if (!seg || !(seg->flags & MEM_READ) || !(seg->flags & MEM_EXEC)) {
+		mem_unlock(&proc->mem);
+		errno = seg ? EPERM : EINVAL;
 		return -1;
-	} else if (!(seg->flags & MEM_READ) || !(seg->flags & MEM_EXEC)) {
-		errno = EPERM;
+	}
+
+	*half = (uint16_t)
+		(((unsigned)seg->mem[addr - seg->start])		|
+		((unsigned)seg->mem[addr - seg->start + 1] << 8));
+	tlb_fill(proc->mem.tlb.exec, seg, addr);
+	mem_unlock(&proc->mem);
+	return 0;
+}
+
+insn_func_t insn_decode(insn_t insn)
+{
+	const struct insn_desc *desc;
+
+	if (!(desc = insn_lookup(insn)))
+		return NULL;
+	return desc->func;
+}
+
+int insn_predecode(insn_t insn, rvaddr_t pc, struct dinsn *di)
+{
+	const struct insn_desc *desc;
+	uint8_t len = 4;
+
+	// Expanded once here, handlers only ever see 32-bit instructions
+	if (RVC_IS_COMPRESSED(insn)) {
+		insn = rvc_expand((uint16_t)insn);
+		len = 2;
+	}
+	if (!(desc = insn_lookup(insn)))
 		return -1;
+
+	di->func = desc->func;
+	di->imm = insn_imm(insn, desc->fmt);
+	di->pc = pc;
+	di->insn = insn;
+	di->rd = (uint8_t)((insn >> 7) & 0x1f);
+	di->rs1 = (uint8_t)((insn >> 15) & 0x1f);
+	di->rs2 = (uint8_t)((insn >> 20) & 0x1f);
+	di->len = len;
+	di->flags = (uint8_t)(desc->flags | (len == 2 ? INSN_RVC : 0));
+	// Nothing to redirect, rd is a vector or f register or isn't there
+	if (desc->fmt == FMT_S || desc->fmt == FMT_B || desc->fmt == FMT_V ||
+	    desc->fmt == FMT_VM || desc->fmt == FMT_F || desc->fmt == FMT_FL)
+		return 0;
+	if (di->rd != 0) {
+		di->flags |= INSN_WRD;
+	} else {
+		di->rd = REG_SINK;
+		if (desc->x0func)
+			di->func = desc->x0func;
 	}
+	return 0;
+}
 
-	*insn = (insn_t)
-		(((insn_t)seg->mem[proc->pc - seg->start]) 		|
-		((insn_t)seg->mem[proc->pc - seg->start + 1] << 8) 	|
-		((insn_t)seg->mem[proc->pc - seg->start + 2] << 16) 	|
-		((insn_t)seg->mem[proc->pc - seg->start + 3] << 24));
-	return 4;
+int insn_fuse(struct dinsn *di)
+{
+	// Also rules out writes to x0, see REG_SINK
+	if (di[1].rs1 != di[0].rd)
+		return 0;
+	// Branches have an rs2, which must be x0
+	if (IS_INSN(di[1].insn, BEQ) || IS_INSN(di[1].insn, BNE))
+		if (di[1].rs2 != 0)
+			return 0;
+
+	for (size_t i = 0; i < FUSE_TAB_LEN; ++i) {
+		if ((di[0].insn & fuse_tab[i].mask[0]) != fuse_tab[i].match[0] ||
+		    (di[1].insn & fuse_tab[i].mask[1]) != fuse_tab[i].match[1])
+			continue;
+		di[0].func = fuse_tab[i].func;
+		di[0].flags |= INSN_FUSED;
+		return 1;
+	}
+	return 0;
+}
+
+const char *insn_name(insn_t insn)
+{
+	const struct insn_desc *desc;
+
+	if (!(desc = insn_lookup(insn)))
+		return NULL;
+	return desc->name;
 }
 
-#define ADD_INSN(name, fname) if (IS_INSN(insn, name)) return (fname)
-int (*insn_decode(insn_t insn))(struct proc *, insn_t)
+static const struct insn_desc *insn_lookup(insn_t insn)
 {
+	const struct dnode *node;
 
-	ADD_INSN(ADD, insn_add);
-	ADD_INSN(SLT, insn_slt);
-	ADD_INSN(SLTU, insn_sltu);
-	ADD_INSN(AND, insn_and);
-	ADD_INSN(OR, insn_or);
-	ADD_INSN(XOR, insn_xor);
-	ADD_INSN(SLL, insn_sll);
-	ADD_INSN(SRL, insn_srl);
-	ADD_INSN(SRA, insn_sra);
-	ADD_INSN(SUB, insn_sub);
+	node = &optab[insn & dfields[0].mask];
+	node = &node->child[(insn >> dfields[1].shift) & node->idxmask];
+	node = &node->child[(insn >> dfields[2].shift) & node->idxmask];
+	do {
+		if ((insn & node->mask) == node->match)
+			return node->desc;
+	} while ((node = node->next));
 
 	errno = ENOSYS;
 	return NULL;
 }
-#undef ADD_INSN
+
+static ireg_t insn_imm(insn_t insn, enum insn_fmt fmt)
+{
+	int32_t sinsn = (int32_t)insn;
+
+	switch (fmt) {
+	case FMT_I:
+	case FMT_FL:
+		return sinsn >> 20;
+	case FMT_S:
+		return ((sinsn >> 25) * 32) | (ireg_t)((insn >> 7) & 0x1f);
+	case FMT_B:
+		return ((sinsn >> 31) * 4096)		|
+			(ireg_t)((insn & 0x80) << 4)	|
+			(ireg_t)((insn >> 20) & 0x7e0)	|
+			(ireg_t)((insn >> 7) & 0x1e);
+	case FMT_U:
+		return (int32_t)(insn & 0xfffff000);
+	case FMT_J:
+		return ((sinsn >> 31) * 0x100000)	|
+			(ireg_t)(insn & 0xff000)	|
+			(ireg_t)((insn >> 9) & 0x800)	|
+			(ireg_t)((insn >> 20) & 0x7fe);
+	case FMT_SH:
+		return (insn >> 20) & 0x3f;
+	case FMT_V:
+		return (int32_t)(insn << 12) >> 27;
+	case FMT_R:
+	case FMT_F:
+	case FMT_VM:
+	default:
+		return 0;
+	}
+}
+
+static void dnode_build(struct dnode *node, unsigned depth,
+			const struct insn_desc **cand, size_t ncand)
+{
+	const struct insn_desc *sub[INSN_TAB_LEN];
+	size_t nsub;
+	insn_t fmask;
+	insn_t val;
+
+	if (depth + 1 == DFIELDS_LEN) {
+		node->mask = 0;
+		node->match = 1;
+		for (size_t i = 0; i < ncand; ++i) {
+			if (i > 0) {
+				if (!(node->next = calloc(1, sizeof(*node))))
+					panic("Cannot allocate decode table");
+				node = node->next;
+			}
+			node->mask = cand[i]->mask;
+			node->match = cand[i]->match;
+			node->desc = cand[i];
+		}
+		return;
+	}
+
+	fmask = dfields[depth + 1].mask << dfields[depth + 1].shift;
+	node->idxmask = 0;
+	for (size_t i = 0; i < ncand; ++i)
+		if (cand[i]->mask & fmask)
+			node->idxmask = dfields[depth + 1].mask;
+
+	if (!(node->child = calloc(node->idxmask + 1, sizeof(*node->child))))
+		panic("Cannot allocate decode table");
+
+	for (insn_t v = 0; v <= node->idxmask; ++v) {
+		val = v << dfields[depth + 1].shift;
+		nsub = 0;
+		for (size_t i = 0; i < ncand; ++i)
+			if ((val & cand[i]->mask & fmask) ==
+			    (cand[i]->match & fmask))
+				sub[nsub++] = cand[i];
+		dnode_build(&node->child[v], depth + 1, sub, nsub);
+	}
+}
+
+static void insn_decode_init(void)
+{
+	const struct insn_desc *cand[INSN_TAB_LEN];
+	size_t ncand;
+
+	for (insn_t op = 0; op <= dfields[0].mask; ++op) {
+		ncand = 0;
+		for (size_t i = 0; i < INSN_TAB_LEN; ++i)
+			if ((op & insn_tab[i].mask) ==
+			    (insn_tab[i].match & dfields[0].mask))
+				cand[ncand++] = &insn_tab[i];
+		dnode_build(&optab[op], 0, cand, ncand);
+	}
+}
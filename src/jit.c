@@ -0,0 +1,906 @@
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "riscv.h"
+#include "proc.h"
+#include "memory.h"
+#include "debug.h"
+#include "insn.h"
+#include "bbcache.h"
+#include "jit.h"
+
+_Static_assert(JIT_JOURNAL_LEN >= BB_MAXLEN, "Journal can't hold a block");
+
+#if defined(__x86_64__)
+
+enum x86_reg {
+	RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+// Condition codes, as in jcc, setcc and cmovcc
+enum x86_cc {
+	CC_B=0x2,
+	CC_AE=0x3,
+	CC_E=0x4,
+	CC_NE=0x5,
+	CC_BE=0x6,
+	CC_A=0x7,
+	CC_L=0xc,
+	CC_GE=0xd,
+};
+
+/*
+ * Guest registers used the most by a block are cached in these. RDI holds
+ * the process, RSI the budget, R15 flat memory, and RAX, RCX, RDX and R11 are
+ * scratch.
+ */
+static const uint8_t cache_regs[] = {
+	RBX, RBP, R12, R13, R14, R8, R9, R10,
+};
+#define CACHE_REGS_LEN (sizeof(cache_regs) / sizeof(*cache_regs))
+
+// Callee-saved registers that translations use
+static const uint8_t saved_regs[] = {RBX, RBP, R12, R13, R14, R15};
+#define SAVED_REGS_LEN (sizeof(saved_regs) / sizeof(*saved_regs))
+
+#define REG_OFF(r) ((uint32_t)(offsetof(struct proc, regs) + \
+		   (r) * sizeof(reg_t)))
+#define PC_OFF ((uint32_t)offsetof(struct proc, pc))
+#define INSTRET_OFF ((uint32_t)offsetof(struct proc, instret))
+#define MEM_OFF(field) ((uint32_t)(offsetof(struct proc, mem) + \
+			offsetof(struct memory, field)))
+
+// Fixed instruction encoding
+struct x86_code {
+	uint8_t len;
+	uint8_t bytes[5];
+};
+
+// How an instruction is translated, `arg` is described by each kind
+enum jit_kind {
+	JK_ALU, // x86 opcode of `op r/m64, r64`
+	JK_ALUW, // Same, on 32 bits
+	JK_ALUI, // x86 /digit of `op r/m64, imm32`
+	JK_ADDIW,
+	JK_SHIFT, // x86 /digit of `shift r/m64, cl`, or of a rotate
+	JK_SHIFTW,
+	JK_SHIFTI,
+	JK_SHIFTIW,
+	JK_SLT, // Condition code
+	JK_SLTI,
+	JK_MUL,
+	JK_MULW,
+	JK_SHADD, // Shift of rs1, the scale of lea
+	JK_SHADDUW, // Same, rs1 is zero-extended
+	JK_LUI,
+	JK_AUIPC,
+	JK_JAL,
+	JK_JALR,
+	JK_BRANCH, // Condition code
+	JK_LOAD, // Access size, in bytes
+	JK_LOADU,
+	JK_STORE,
+	JK_FENCE,
+};
+
+struct jit_op {
+	insn_t mask;
+	insn_t match;
+	uint8_t kind;
+	uint8_t arg;
+};
+
+#define JIT_OP(name, kind, arg) {MASK_##name, MATCH_##name, (kind), (arg)}
+static const struct jit_op jit_ops[] = {
+	JIT_OP(LUI, JK_LUI, 0),
+	JIT_OP(AUIPC, JK_AUIPC, 0),
+	JIT_OP(JAL, JK_JAL, 0),
+	JIT_OP(JALR, JK_JALR, 0),
+	JIT_OP(BEQ, JK_BRANCH, CC_E),
+	JIT_OP(BNE, JK_BRANCH, CC_NE),
+	JIT_OP(BLT, JK_BRANCH, CC_L),
+	JIT_OP(BGE, JK_BRANCH, CC_GE),
+	JIT_OP(BLTU, JK_BRANCH, CC_B),
+	JIT_OP(BGEU, JK_BRANCH, CC_AE),
+	JIT_OP(LB, JK_LOAD, 1),
+	JIT_OP(LH, JK_LOAD, 2),
+	JIT_OP(LW, JK_LOAD, 4),
+	JIT_OP(LD, JK_LOAD, 8),
+	JIT_OP(LBU, JK_LOADU, 1),
+	JIT_OP(LHU, JK_LOADU, 2),
+	JIT_OP(LWU, JK_LOADU, 4),
+	JIT_OP(SB, JK_STORE, 1),
+	JIT_OP(SH, JK_STORE, 2),
+	JIT_OP(SW, JK_STORE, 4),
+	JIT_OP(SD, JK_STORE, 8),
+	JIT_OP(ADDI, JK_ALUI, 0),
+	JIT_OP(SLTI, JK_SLTI, CC_L),
+	JIT_OP(SLTIU, JK_SLTI, CC_B),
+	JIT_OP(XORI, JK_ALUI, 6),
+	JIT_OP(ORI, JK_ALUI, 1),
+	JIT_OP(ANDI, JK_ALUI, 4),
+	JIT_OP(SLLI, JK_SHIFTI, 4),
+	JIT_OP(SRLI, JK_SHIFTI, 5),
+	JIT_OP(SRAI, JK_SHIFTI, 7),
+	JIT_OP(ADD, JK_ALU, 0x01),
+	JIT_OP(SUB, JK_ALU, 0x29),
+	JIT_OP(AND, JK_ALU, 0x21),
+	JIT_OP(OR, JK_ALU, 0x09),
+	JIT_OP(XOR, JK_ALU, 0x31),
+	JIT_OP(SLT, JK_SLT, CC_L),
+	JIT_OP(SLTU, JK_SLT, CC_B),
+	JIT_OP(SLL, JK_SHIFT, 4),
+	JIT_OP(SRL, JK_SHIFT, 5),
+	JIT_OP(SRA, JK_SHIFT, 7),
+	JIT_OP(ADDIW, JK_ADDIW, 0),
+	JIT_OP(SLLIW, JK_SHIFTIW, 4),
+	JIT_OP(SRLIW, JK_SHIFTIW, 5),
+	JIT_OP(SRAIW, JK_SHIFTIW, 7),
+	JIT_OP(ADDW, JK_ALUW, 0x01),
+	JIT_OP(SUBW, JK_ALUW, 0x29),
+	JIT_OP(SLLW, JK_SHIFTW, 4),
+	JIT_OP(SRLW, JK_SHIFTW, 5),
+	JIT_OP(SRAW, JK_SHIFTW, 7),
+	JIT_OP(MUL, JK_MUL, 0),
+	JIT_OP(MULW, JK_MULW, 0),
+	JIT_OP(SH1ADD, JK_SHADD, 1),
+	JIT_OP(SH2ADD, JK_SHADD, 2),
+	JIT_OP(SH3ADD, JK_SHADD, 3),
+	JIT_OP(ADD_UW, JK_SHADDUW, 0),
+	JIT_OP(SH1ADD_UW, JK_SHADDUW, 1),
+	JIT_OP(SH2ADD_UW, JK_SHADDUW, 2),
+	JIT_OP(SH3ADD_UW, JK_SHADDUW, 3),
+	JIT_OP(ROL, JK_SHIFT, 0),
+	JIT_OP(ROR, JK_SHIFT, 1),
+	JIT_OP(RORI, JK_SHIFTI, 1),
+	JIT_OP(ROLW, JK_SHIFTW, 0),
+	JIT_OP(RORW, JK_SHIFTW, 1),
+	JIT_OP(RORIW, JK_SHIFTIW, 1),
+	JIT_OP(FENCE, JK_FENCE, 0),
+};
+#undef JIT_OP
+#define JIT_OPS_LEN (sizeof(jit_ops) / sizeof(*jit_ops))
+
+/*
+ * State of a translation. Code is emitted at `p`, which keeps advancing past
+ * `end` without writing once the cache is full.
+ */
+struct jctx {
+	struct jit *jit;
+	unsigned char *p;
+	unsigned char *end;
+	int8_t host[REG_SINK + 1]; // Host register caching each, or -1
+	uint32_t dirty; // Cached guest registers not written back
+	bool flat;
+	rvaddr_t start; // Of the block
+	uint32_t len; // Instructions translated
+	unsigned char *loop; // Where iterations start, NULL if blocks can't loop
+	uint32_t nstores;
+	uint32_t nexits;
+	struct {
+		unsigned char *rel; // rel32 of the jcc to patch
+		uint32_t retired;
+	} exits[BB_MAXLEN];
+};
+
+static const struct jit_op *jit_lookup(insn_t insn);
+static void jit_flush(struct proc *proc) __attribute__((nonnull, cold));
+static int jit_translate(struct jit *jit, const struct proc *proc,
+			 struct bblock *blk) __attribute__((nonnull));
+static bool jit_insn(struct jctx *c, const struct dinsn *di, uint32_t idx)
+	__attribute__((nonnull));
+static void jit_ldst(struct jctx *c, const struct dinsn *di,
+		     const struct jit_op *op, uint32_t idx)
+	__attribute__((nonnull));
+static void jit_cache(struct jctx *c, const struct bblock *blk, uint32_t n)
+	__attribute__((nonnull));
+static void jit_verify(struct jit *jit, const struct proc *proc,
+		       const struct bblock *blk, const reg_t *regs,
+		       rvaddr_t pc, const uint8_t *sizes, uint32_t nstores)
+	__attribute__((nonnull));
+
+// Code emission
+static void emit8(struct jctx *c, uint8_t byte) __attribute__((nonnull));
+static void emit32(struct jctx *c, uint32_t val) __attribute__((nonnull));
+static void emit_bytes(struct jctx *c, const uint8_t *bytes, size_t len)
+	__attribute__((nonnull));
+static void x_rex(struct jctx *c, int w, int reg, int base)
+	__attribute__((nonnull));
+static void x_rr(struct jctx *c, uint8_t op, int w, int rm, int reg)
+	__attribute__((nonnull));
+static void x_rdi(struct jctx *c, uint8_t op, int reg, uint32_t disp)
+	__attribute__((nonnull));
+static void x_imm(struct jctx *c, uint8_t ext, int w, int rm, int32_t imm)
+	__attribute__((nonnull));
+static void x_movimm(struct jctx *c, int reg, uint64_t imm)
+	__attribute__((nonnull));
+static void x_shift(struct jctx *c, uint8_t ext, int w, int rm, int imm)
+	__attribute__((nonnull));
+static void x_movsxd(struct jctx *c, int reg) __attribute__((nonnull));
+static unsigned char *x_jcc(struct jctx *c, uint8_t cc)
+	__attribute__((nonnull));
+static unsigned char *x_jmp(struct jctx *c) __attribute__((nonnull));
+static void x_patch(struct jctx *c, unsigned char *rel,
+		    const unsigned char *target) __attribute__((nonnull));
+static void get_reg(struct jctx *c, int dst, uint8_t reg)
+	__attribute__((nonnull));
+static void put_reg(struct jctx *c, uint8_t reg, int src)
+	__attribute__((nonnull));
+static void spill(struct jctx *c) __attribute__((nonnull));
+static void set_pc(struct jctx *c, rvaddr_t pc) __attribute__((nonnull));
+static void x_loop(struct jctx *c) __attribute__((nonnull));
+
+struct jit *jit_alloc(size_t size, bool verify)
+{
+	struct jit *jit;
+
+	if (!(jit = calloc(1, sizeof(*jit))))
+		return NULL;
+	jit->size = size ? size : JIT_CACHE_DEFAULT;
+	jit->code = mmap(NULL, jit->size, PROT_READ | PROT_WRITE | PROT_EXEC,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (jit->code == MAP_FAILED) {
+		free(jit);
+		return NULL;
+	}
+	jit->verify = verify;
+	return jit;
+}
+
+void jit_free(struct jit *jit)
+{
+	munmap(jit->code, jit->size);
+	free(jit);
+}
+
+void jit_compile(struct proc *proc, struct bblock *blk)
+{
+	if (jit_translate(proc->jit, proc, blk) == 0 || errno != ENOSPC)
+		return;
+	jit_flush(proc);
+	jit_translate(proc->jit, proc, blk);
+}
+
+/*
+ * To verify a block, the translation runs first and journals its stores. They
+ * are rolled back, and the interpreter runs the block from the same state.
+ */
+uint32_t jit_run(struct proc *proc, struct bblock *blk, uint64_t budget)
+{
+	struct jit *jit = proc->jit;
+	uint8_t sizes[BB_MAXLEN];
+	reg_t regs[32];
+	reg_t jregs[32];
+	rvaddr_t pc = proc->pc;
+	rvaddr_t jpc;
+	uint32_t nstores = 0;
+	uint32_t n;
+
+	if (!jit->verify)
+		return blk->jit(proc, budget);
+
+	memcpy(regs, proc->regs, sizeof(regs));
+	n = blk->jit(proc, budget);
+	memcpy(jregs, proc->regs, sizeof(jregs));
+	jpc = proc->pc;
+
+	for (uint32_t i = 0; i < n; ++i)
+		if (blk->insns[i].flags & INSN_STORE)
+			sizes[nstores++] = (uint8_t)(1 << ((blk->insns[i].insn
+						   >> 12) & 0x3));
+	for (uint32_t i = nstores; i-- > 0;)
+		memcpy(proc->mem.flat + jit->journal[i][0], &jit->journal[i][1],
+		       sizes[i]);
+	memcpy(proc->regs, regs, sizeof(regs));
+	proc->pc = pc;
+
+	bb_exec(proc, blk);
+	// Translations that stopped early can't be compared
+	if (n == blk->len)
+		jit_verify(jit, proc, blk, jregs, jpc, sizes, nstores);
+	return blk->len;
+}
+
+// Drops every translation
+static void jit_flush(struct proc *proc)
+{
+	struct bblock *blk;
+
+	for (size_t i = 0; i < BBCACHE_SIZE; ++i)
+		for (blk = proc->bbcache->tab[i]; blk; blk = blk->next) {
+			blk->jit = NULL;
+			blk->execs = 0;
+		}
+	proc->jit->used = 0;
+	++proc->jit->flushes;
+	dbg_log("JIT: Flushed the code cache");
+}
+
+static const struct jit_op *jit_lookup(insn_t insn)
+{
+	for (size_t i = 0; i < JIT_OPS_LEN; ++i)
+		if ((insn & jit_ops[i].mask) == jit_ops[i].match)
+			return &jit_ops[i];
+	return NULL;
+}
+
+/*
+ * Translates the longest prefix of `blk` that only has supported
+ * instructions. Returns 0 on success or -1 with errno set to ENOSPC if the
+ * code cache is full, or ENOSYS if the first instruction can't be translated.
+ */
+static int jit_translate(struct jit *jit, const struct proc *proc,
+			 struct bblock *blk)
+{
+	struct jctx c = {
+		.jit = jit,
+		.p = jit->code + jit->used,
+		.end = jit->code + jit->size,
+		.flat = proc->mem.flat != NULL,
+	};
+	unsigned char *start = c.p;
+	unsigned char *epilogue;
+	const struct dinsn *last;
+	uint32_t n;
+
+	for (n = 0; n < blk->len; ++n) {
+		const struct jit_op *op = jit_lookup(blk->insns[n].insn);
+
+		if (!op || (!c.flat && (op->kind == JK_LOAD ||
+		    op->kind == JK_LOADU || op->kind == JK_STORE)))
+			break;
+	}
+	if (n == 0) {
+		errno = ENOSYS;
+		return -1;
+	}
+
+	for (size_t i = 0; i < SAVED_REGS_LEN; ++i) {
+		x_rex(&c, 0, 0, saved_regs[i]);
+		emit8(&c, (uint8_t)(0x50 + (saved_regs[i] & 7)));
+	}
+	if (c.flat)
+		x_rdi(&c, 0x8b, R15, MEM_OFF(flat));
+	jit_cache(&c, blk, n);
+	c.start = blk->start;
+	c.len = n;
+	if (!jit->verify)
+		c.loop = c.p;
+
+	for (uint32_t i = 0; i < n; ++i)
+		if (!jit_insn(&c, &blk->insns[i], i))
+			break;
+
+	// Falls through, or stops before an instruction left to the interpreter
+	last = &blk->insns[n - 1];
+	if (!(last->flags & INSN_TERM)) {
+		spill(&c);
+		set_pc(&c, n < blk->len ? blk->insns[n].pc : blk->end);
+	}
+	x_movimm(&c, RAX, n);
+
+	epilogue = c.p;
+	for (size_t i = SAVED_REGS_LEN; i-- > 0;) {
+		x_rex(&c, 0, 0, saved_regs[i]);
+		emit8(&c, (uint8_t)(0x58 + (saved_regs[i] & 7)));
+	}
+	emit8(&c, 0xc3);
+
+	// Side exits of loads and stores, registers and pc are already set
+	for (uint32_t i = 0; i < c.nexits; ++i) {
+		x_patch(&c, c.exits[i].rel, c.p);
+		x_movimm(&c, RAX, c.exits[i].retired);
+		x_patch(&c, x_jmp(&c), epilogue);
+	}
+
+	if (c.p > c.end) {
+		errno = ENOSPC;
+		return -1;
+	}
+	jit->used = (size_t)(c.p - jit->code);
+	// Keeps translations aligned for the host's fetch
+	jit->used = (jit->used + 15) & ~(size_t)15;
+	if (jit->used > jit->size)
+		jit->used = jit->size;
+	blk->jit = (jit_func_t)(uintptr_t)start;
+	++jit->compiled;
+	dbg_log("JIT: Translated %u instructions of [0x%lx, 0x%lx[ to %zu bytes",
+		n, blk->start, blk->end, (size_t)(c.p - start));
+	return 0;
+}
+
+// Picks the guest registers to cache and loads them
+static void jit_cache(struct jctx *c, const struct bblock *blk, uint32_t n)
+{
+	uint32_t uses[REG_SINK + 1] = {0};
+	uint8_t best;
+
+	for (uint32_t i = 0; i < n; ++i) {
+		++uses[blk->insns[i].rs1];
+		++uses[blk->insns[i].rs2];
+		++uses[blk->insns[i].rd];
+	}
+	uses[0] = 0;
+	memset(c->host, -1, sizeof(c->host));
+
+	for (size_t i = 0; i < CACHE_REGS_LEN; ++i) {
+		best = 0;
+		for (uint8_t r = 1; r < 32; ++r)
+			if (c->host[r] == -1 && uses[r] > uses[best])
+				best = r;
+		// Single uses gain nothing from a load in the prologue
+		if (uses[best] < 2)
+			break;
+		c->host[best] = (int8_t)cache_regs[i];
+		x_rdi(c, 0x8b, cache_regs[i], REG_OFF(best));
+	}
+}
+
+// Translates one instruction, returns false if it ends the block
+static bool jit_insn(struct jctx *c, const struct dinsn *di, uint32_t idx)
+{
+	const struct jit_op *op = jit_lookup(di->insn);
+	int32_t imm = (int32_t)di->imm;
+	unsigned char *skip;
+	unsigned char *done;
+
+	switch (op->kind) {
+	case JK_ALU:
+	case JK_ALUW:
+		get_reg(c, RAX, di->rs1);
+		get_reg(c, RDX, di->rs2);
+		x_rr(c, op->arg, op->kind == JK_ALU, RAX, RDX);
+		if (op->kind == JK_ALUW)
+			x_movsxd(c, RAX);
+		put_reg(c, di->rd, RAX);
+		break;
+	case JK_ALUI:
+	case JK_ADDIW:
+		get_reg(c, RAX, di->rs1);
+		x_imm(c, op->arg, op->kind == JK_ALUI, RAX, imm);
+		if (op->kind == JK_ADDIW)
+			x_movsxd(c, RAX);
+		put_reg(c, di->rd, RAX);
+		break;
+	case JK_SHIFT:
+	case JK_SHIFTW:
+		get_reg(c, RAX, di->rs1);
+		get_reg(c, RCX, di->rs2);
+		x_shift(c, op->arg, op->kind == JK_SHIFT, RAX, -1);
+		if (op->kind == JK_SHIFTW)
+			x_movsxd(c, RAX);
+		put_reg(c, di->rd, RAX);
+		break;
+	case JK_SHIFTI:
+	case JK_SHIFTIW:
+		get_reg(c, RAX, di->rs1);
+		x_shift(c, op->arg, op->kind == JK_SHIFTI, RAX, imm);
+		if (op->kind == JK_SHIFTIW)
+			x_movsxd(c, RAX);
+		put_reg(c, di->rd, RAX);
+		break;
+	case JK_MUL:
+	case JK_MULW:
+		get_reg(c, RAX, di->rs1);
+		get_reg(c, RDX, di->rs2);
+		// imul rax, rdx
+		x_rex(c, op->kind == JK_MUL, RAX, RDX);
+		emit_bytes(c, (const uint8_t[]){0x0f, 0xaf, 0xc2}, 3);
+		if (op->kind == JK_MULW)
+			x_movsxd(c, RAX);
+		put_reg(c, di->rd, RAX);
+		break;
+	case JK_SHADD:
+	case JK_SHADDUW:
+		get_reg(c, RAX, di->rs1);
+		get_reg(c, RDX, di->rs2);
+		// mov eax, eax
+		if (op->kind == JK_SHADDUW)
+			x_rr(c, 0x89, 0, RAX, RAX);
+		// lea rax, [rdx + rax * (1 << arg)]
+		emit_bytes(c, (const uint8_t[]){0x48, 0x8d, 0x04,
+			   (uint8_t)(op->arg << 6 | RDX)}, 4);
+		put_reg(c, di->rd, RAX);
+		break;
+	case JK_SLT:
+	case JK_SLTI:
+		get_reg(c, RAX, di->rs1);
+		if (op->kind == JK_SLT) {
+			get_reg(c, RDX, di->rs2);
+			x_rr(c, 0x39, 1, RAX, RDX);
+		} else {
+			x_imm(c, 7, 1, RAX, imm);
+		}
+		// setcc al, movzx eax, al
+		emit_bytes(c, (const uint8_t[]){0x0f, (uint8_t)(0x90 + op->arg),
+			   0xc0, 0x0f, 0xb6, 0xc0}, 6);
+		put_reg(c, di->rd, RAX);
+		break;
+	case JK_LUI:
+		x_movimm(c, RAX, (uint64_t)di->imm);
+		put_reg(c, di->rd, RAX);
+		break;
+	case JK_AUIPC:
+		x_movimm(c, RAX, di->pc + (reg_t)di->imm);
+		put_reg(c, di->rd, RAX);
+		break;
+	case JK_LOAD:
+	case JK_LOADU:
+	case JK_STORE:
+		jit_ldst(c, di, op, idx);
+		break;
+	case JK_JAL:
+		x_movimm(c, RAX, di->pc + di->len);
+		put_reg(c, di->rd, RAX);
+		spill(c);
+		if (c->loop && di->pc + (reg_t)di->imm == c->start)
+			x_loop(c);
+		set_pc(c, di->pc + (reg_t)di->imm);
+		return false;
+	case JK_JALR:
+		get_reg(c, RAX, di->rs1);
+		x_imm(c, 0, 1, RAX, imm);
+		x_imm(c, 4, 1, RAX, -2);
+		x_movimm(c, RDX, di->pc + di->len);
+		put_reg(c, di->rd, RDX);
+		spill(c);
+		x_rdi(c, 0x89, RAX, PC_OFF);
+		return false;
+	case JK_BRANCH:
+		get_reg(c, RAX, di->rs1);
+		get_reg(c, RDX, di->rs2);
+		spill(c);
+		x_rr(c, 0x39, 1, RAX, RDX);
+		if (c->loop && di->pc + (reg_t)di->imm == c->start) {
+			// Inverted condition, falls through to loop
+			skip = x_jcc(c, (uint8_t)(op->arg ^ 1));
+			x_loop(c);
+			set_pc(c, c->start);
+			done = x_jmp(c);
+			x_patch(c, skip, c->p);
+			set_pc(c, di->pc + di->len);
+			x_patch(c, done, c->p);
+			return false;
+		}
+		// Moves don't touch the flags
+		x_movimm(c, RCX, di->pc + di->len);
+		x_movimm(c, RDX, di->pc + (reg_t)di->imm);
+		x_rex(c, 1, RCX, RDX);
+		emit_bytes(c, (const uint8_t[]){0x0f, (uint8_t)(0x40 + op->arg),
+			   0xca}, 3);
+		x_rdi(c, 0x89, RCX, PC_OFF);
+		return false;
+	case JK_FENCE:
+		// mfence, the other orders are free as in insn_fence()
+		if (FENCE_STORE_LOAD(di->insn))
+			emit_bytes(c, (const uint8_t[]){0x0f, 0xae, 0xf0}, 3);
+		break;
+	}
+	return !(di->flags & INSN_TERM);
+}
+
+/*
+ * Loads and stores access flat memory directly, after writing back the
+ * registers and the pc so that host faults find the state ldst_addr() leaves.
+ * Addresses past `flat_limit`, and stores that may hit writable code, exit to
+ * the interpreter instead.
+ */
+static void jit_ldst(struct jctx *c, const struct dinsn *di,
+		     const struct jit_op *op, uint32_t idx)
+{
+	// movsx/movzx/mov rax, [r15 + rax], by signedness and size
+	static const struct x86_code loads[2][9] = {
+		{[1] = {5, {0x49, 0x0f, 0xbe, 0x04, 0x07}},
+		 [2] = {5, {0x49, 0x0f, 0xbf, 0x04, 0x07}},
+		 [4] = {4, {0x49, 0x63, 0x04, 0x07}},
+		 [8] = {4, {0x49, 0x8b, 0x04, 0x07}}},
+		{[1] = {5, {0x41, 0x0f, 0xb6, 0x04, 0x07}},
+		 [2] = {5, {0x41, 0x0f, 0xb7, 0x04, 0x07}},
+		 [4] = {4, {0x41, 0x8b, 0x04, 0x07}}},
+	};
+	// movzx/mov r11, [r15 + rax], by size
+	static const struct x86_code olds[9] = {
+		[1] = {5, {0x45, 0x0f, 0xb6, 0x1c, 0x07}},
+		[2] = {5, {0x45, 0x0f, 0xb7, 0x1c, 0x07}},
+		[4] = {4, {0x45, 0x8b, 0x1c, 0x07}},
+		[8] = {4, {0x4d, 0x8b, 0x1c, 0x07}},
+	};
+	// mov [r15 + rax], rdx, by size
+	static const struct x86_code stores[9] = {
+		[1] = {4, {0x41, 0x88, 0x14, 0x07}},
+		[2] = {5, {0x66, 0x41, 0x89, 0x14, 0x07}},
+		[4] = {4, {0x41, 0x89, 0x14, 0x07}},
+		[8] = {4, {0x49, 0x89, 0x14, 0x07}},
+	};
+	const struct x86_code *code;
+	unsigned char *skip;
+
+	get_reg(c, RAX, di->rs1);
+	if (di->imm)
+		x_imm(c, 0, 1, RAX, (int32_t)di->imm);
+	spill(c);
+	set_pc(c, di->pc);
+
+	x_rdi(c, 0x3b, RAX, MEM_OFF(flat_limit));
+	c->exits[c->nexits].rel = x_jcc(c, CC_A);
+	c->exits[c->nexits++].retired = idx;
+
+	if (op->kind != JK_STORE) {
+		code = &loads[op->kind == JK_LOADU][op->arg];
+		emit_bytes(c, code->bytes, code->len);
+		put_reg(c, di->rd, RAX);
+		return;
+	}
+
+	// Exits if [rax, rax + size[ overlaps [wx_start, wx_end[
+	x_rdi(c, 0x3b, RAX, MEM_OFF(wx_end));
+	skip = x_jcc(c, CC_AE);
+	emit_bytes(c, (const uint8_t[]){0x48, 0x8d, 0x50, op->arg}, 4);
+	x_rdi(c, 0x3b, RDX, MEM_OFF(wx_start));
+	c->exits[c->nexits].rel = x_jcc(c, CC_A);
+	c->exits[c->nexits++].retired = idx;
+	x_patch(c, skip, c->p);
+
+	get_reg(c, RDX, di->rs2);
+	if (c->jit->verify) {
+		// journal[i] = {rax, old value, rdx}
+		x_movimm(c, RCX, (uint64_t)(uintptr_t)
+			 c->jit->journal[c->nstores]);
+		emit_bytes(c, (const uint8_t[]){0x48, 0x89, 0x01,
+			   0x48, 0x89, 0x51, 0x10}, 7);
+		code = &olds[op->arg];
+		emit_bytes(c, code->bytes, code->len);
+		emit_bytes(c, (const uint8_t[]){0x4c, 0x89, 0x59, 0x08}, 4);
+	}
+	++c->nstores;
+	code = &stores[op->arg];
+	emit_bytes(c, code->bytes, code->len);
+}
+
+/*
+ * Panics if the interpreter left `proc` in a different state than the
+ * translation, which left `regs`, `pc`, and its journaled stores.
+ */
+static void jit_verify(struct jit *jit, const struct proc *proc,
+		       const struct bblock *blk, const reg_t *regs,
+		       rvaddr_t pc, const uint8_t *sizes, uint32_t nstores)
+{
+	bool ok = proc->pc == pc;
+	uint64_t val;
+	uint32_t j;
+
+	if (!ok)
+		err_log("JIT: pc is 0x%lx instead of 0x%lx", pc, proc->pc);
+	for (int r = 1; r < 32; ++r) {
+		if (regs[r] == proc->regs[r])
+			continue;
+		err_log("JIT: x%d is 0x%lx instead of 0x%lx", r, regs[r],
+			proc->regs[r]);
+		ok = false;
+	}
+	// Only the last store to an address is still visible
+	for (uint32_t i = 0; i < nstores; ++i) {
+		for (j = i + 1; j < nstores && jit->journal[j][0] !=
+		     jit->journal[i][0]; ++j)
+			;
+		if (j < nstores)
+			continue;
+		val = 0;
+		memcpy(&val, proc->mem.flat + jit->journal[i][0], sizes[i]);
+		if (memcmp(&val, &jit->journal[i][2], sizes[i]) == 0)
+			continue;
+		err_log("JIT: Stored 0x%lx at 0x%lx instead of 0x%lx",
+			jit->journal[i][2], jit->journal[i][0], val);
+		ok = false;
+	}
+
+	if (!ok) {
+		err_log("JIT: In block [0x%lx, 0x%lx[", blk->start, blk->end);
+		panic("Translation doesn't match the interpreter");
+	}
+	++jit->verified;
+}
+
+static void emit8(struct jctx *c, uint8_t byte)
+{
+	if (c->p < c->end)
+		*c->p = byte;
+	++c->p;
+}
+
+static void emit32(struct jctx *c, uint32_t val)
+{
+	for (int i = 0; i < 4; ++i)
+		emit8(c, (uint8_t)(val >> (8 * i)));
+}
+
+static void emit_bytes(struct jctx *c, const uint8_t *bytes, size_t len)
+{
+	for (size_t i = 0; i < len; ++i)
+		emit8(c, bytes[i]);
+}
+
+// REX prefix, only emitted if needed
+static void x_rex(struct jctx *c, int w, int reg, int base)
+{
+	uint8_t rex = (uint8_t)(0x40 | (w << 3) | ((reg >> 3) << 2) |
+				(base >> 3));
+
+	if (rex != 0x40)
+		emit8(c, rex);
+}
+
+// `op rm, reg` between registers
+static void x_rr(struct jctx *c, uint8_t op, int w, int rm, int reg)
+{
+	x_rex(c, w, reg, rm);
+	emit8(c, op);
+	emit8(c, (uint8_t)(0xc0 | ((reg & 7) << 3) | (rm & 7)));
+}
+
+// `op reg, [rdi + disp]`, or the other way around, on 64 bits
+static void x_rdi(struct jctx *c, uint8_t op, int reg, uint32_t disp)
+{
+	x_rex(c, 1, reg, RDI);
+	emit8(c, op);
+	emit8(c, (uint8_t)(0x80 | ((reg & 7) << 3) | RDI));
+	emit32(c, disp);
+}
+
+// `op rm, imm32`, `ext` is the /digit of opcode 0x81
+static void x_imm(struct jctx *c, uint8_t ext, int w, int rm, int32_t imm)
+{
+	x_rex(c, w, 0, rm);
+	emit8(c, 0x81);
+	emit8(c, (uint8_t)(0xc0 | (ext << 3) | (rm & 7)));
+	emit32(c, (uint32_t)imm);
+}
+
+static void x_movimm(struct jctx *c, int reg, uint64_t imm)
+{
+	if ((uint64_t)(int64_t)(int32_t)imm == imm) {
+		x_rex(c, 1, 0, reg);
+		emit8(c, 0xc7);
+		emit8(c, (uint8_t)(0xc0 | (reg & 7)));
+		emit32(c, (uint32_t)imm);
+		return;
+	}
+	x_rex(c, 1, 0, reg);
+	emit8(c, (uint8_t)(0xb8 + (reg & 7)));
+	emit32(c, (uint32_t)imm);
+	emit32(c, (uint32_t)(imm >> 32));
+}
+
+// Shifts `rm` by `imm`, or by cl if `imm` is negative
+static void x_shift(struct jctx *c, uint8_t ext, int w, int rm, int imm)
+{
+	x_rex(c, w, 0, rm);
+	emit8(c, imm < 0 ? 0xd3 : 0xc1);
+	emit8(c, (uint8_t)(0xc0 | (ext << 3) | (rm & 7)));
+	if (imm >= 0)
+		emit8(c, (uint8_t)imm);
+}
+
+// Sign-extends the low 32 bits of `reg`
+static void x_movsxd(struct jctx *c, int reg)
+{
+	x_rr(c, 0x63, 1, reg, reg);
+}
+
+// jcc rel32, returns where to patch the displacement
+static unsigned char *x_jcc(struct jctx *c, uint8_t cc)
+{
+	emit8(c, 0x0f);
+	emit8(c, (uint8_t)(0x80 + cc));
+	emit32(c, 0);
+	return c->p - 4;
+}
+
+// jmp rel32, returns where to patch the displacement
+static unsigned char *x_jmp(struct jctx *c)
+{
+	emit8(c, 0xe9);
+	emit32(c, 0);
+	return c->p - 4;
+}
+
+static void x_patch(struct jctx *c, unsigned char *rel,
+		    const unsigned char *target)
+{
+	int32_t disp = (int32_t)(target - (rel + 4));
+
+	if (rel + 4 <= c->end)
+		memcpy(rel, &disp, sizeof(disp));
+}
+
+static void get_reg(struct jctx *c, int dst, uint8_t reg)
+{
+	if (reg == 0)
+		x_rr(c, 0x31, 0, dst, dst);
+	else if (c->host[reg] >= 0)
+		x_rr(c, 0x89, 1, dst, c->host[reg]);
+	else
+		x_rdi(c, 0x8b, dst, REG_OFF(reg));
+}
+
+static void put_reg(struct jctx *c, uint8_t reg, int src)
+{
+	if (reg == REG_SINK)
+		return;
+	if (c->host[reg] >= 0) {
+		x_rr(c, 0x89, 1, c->host[reg], src);
+		c->dirty |= (uint32_t)1 << reg;
+	} else {
+		x_rdi(c, 0x89, src, REG_OFF(reg));
+	}
+}
+
+// Writes the modified cached registers back to the process
+static void spill(struct jctx *c)
+{
+	for (uint8_t r = 1; r < 32; ++r)
+		if (c->dirty & ((uint32_t)1 << r))
+			x_rdi(c, 0x89, c->host[r], REG_OFF(r));
+	c->dirty = 0;
+}
+
+static void set_pc(struct jctx *c, rvaddr_t pc)
+{
+	x_movimm(c, RDX, pc);
+	x_rdi(c, 0x89, RDX, PC_OFF);
+}
+
+/*
+ * Goes back to the start of the block if the budget allows another iteration
+ * after this one, which retired `c->len` instructions. Falls through
+ * otherwise.
+ */
+static void x_loop(struct jctx *c)
+{
+	unsigned char *last;
+
+	x_imm(c, 7, 1, RSI, (int32_t)c->len);
+	last = x_jcc(c, CC_BE);
+	x_imm(c, 5, 1, RSI, (int32_t)c->len);
+	// add qword [rdi + instret], len
+	x_rex(c, 1, 0, RDI);
+	emit8(c, 0x81);
+	emit8(c, (uint8_t)(0x80 | RDI));
+	emit32(c, INSTRET_OFF);
+	emit32(c, c->len);
+	x_patch(c, x_jmp(c), c->loop);
+	x_patch(c, last, c->p);
+}
+
+#else
+
+struct jit *jit_alloc(size_t size, bool verify)
+{
+	(void)size;
+	(void)verify;
+	errno = ENOSYS;
+	return NULL;
+}
+
+void jit_free(struct jit *jit)
+{
+	(void)jit;
+}
+
+void jit_compile(struct proc *proc, struct bblock *blk)
+{
+	(void)proc;
+	(void)blk;
+}
+
+uint32_t jit_run(struct proc *proc, struct bblock *blk, uint64_t budget)
+{
+	(void)budget;
+	bb_exec(proc, blk);
+	return blk->len;
+}
+
+#endif
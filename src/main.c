@@ -1,28 +1,308 @@
-#include <assert.h>
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "riscv.h"
 #include "debug.h"
 #include "memory.h"
 #include "proc.h"
-#include "insn.h"
+#include "bbcache.h"
+#include "jit.h"
+#include "batch.h"
+#include "snapshot.h"
+#include "thread.h"
 
-int main(void)
+static void usage(const char *argv0) __attribute__((nonnull, cold));
+static int run_batch(char *paths[], size_t npaths, size_t instances,
+		     const struct batchopts *opts) __attribute__((nonnull));
+static int run_checkpointed(struct proc *proc, const char *path,
+			    uint64_t every) __attribute__((nonnull));
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [-vq] [-l log file] [-t trace file] "
+		"[-j on|off|verify] [-m flat|checked] [-s stack size] "
+		"[-r seed] [-n instances] [-w workers] [-b slice] "
+		"[-L max live] [-c checkpoint [-C every]] [-R checkpoint] "
+		"[file...]\n", argv0);
+}
+
+/*
+ * Runs a process to the end, and checkpoints it every `every` instructions:
+ * fully to `path` first, then incrementally to `path`.1, `path`.2, ...
+ */
+static int run_checkpointed(struct proc *proc, const char *path,
+			    uint64_t every)
+{
+	char name[PATH_MAX];
+	unsigned n = 0;
+	int ret;
+
+	while ((ret = proc_run(proc, every)) == 0 && !proc->exited) {
+		if (n == 0)
+			snprintf(name, sizeof(name), "%s", path);
+		else
+			snprintf(name, sizeof(name), "%s.%u", path, n);
+		if (proc_checkpoint(proc, name, n > 0) == -1) {
+			err_log("%s: Cannot checkpoint: %s", name,
+				strerror(errno));
+			return -1;
+		}
+		info_log("Checkpoint %s at %lu instructions", name,
+			 proc->instret);
+		++n;
+	}
+	return ret;
+}
+
+/*
+ * Runs `instances` guests of every file on the batch scheduler, returns 0 if
+ * they all exited with status 0.
+ */
+static int run_batch(char *paths[], size_t npaths, size_t instances,
+		     const struct batchopts *opts)
 {
+	size_t n = npaths * instances;
+	struct image **images;
+	struct guest *guests;
+	struct batchstats stats;
+	int ret = 1;
+
+	if (!(images = calloc(npaths, sizeof(*images))) ||
+	    !(guests = calloc(n, sizeof(*guests)))) {
+		err_log("%s", strerror(errno));
+		free(images);
+		return 1;
+	}
+	// Every instance of a file is spawned from the same image
+	for (size_t i = 0; i < npaths; ++i)
+		if (!(images[i] = image_open(paths[i]))) {
+			err_log("%s: %s", paths[i], strerror(errno));
+			goto out;
+		}
+	for (size_t i = 0; i < n; ++i) {
+		guests[i].path = paths[i % npaths];
+		guests[i].image = images[i % npaths];
+	}
+
+	if (batch_run(guests, n, opts, &stats) == -1) {
+		err_log("Can't run the batch: %s", strerror(errno));
+		goto out;
+	}
+	ret = 0;
+
+	for (size_t i = 0; i < n; ++i) {
+		const struct guest *g = &guests[i];
+
+		switch (g->state) {
+		case GUEST_EXITED:
+			if (g->exit_code != 0) {
+				dbg_log("Guest %zu (%s) exited with status %d",
+					i, g->path, g->exit_code);
+				ret = 1;
+			}
+			break;
+		case GUEST_TRAPPED:
+			warn_log("Guest %zu (%s) stopped at pc 0x%lx: %s, "
+				 "tval 0x%lx", i, g->path, g->pc,
+				 trap_name(g->trap.cause), g->trap.tval);
+			ret = 1;
+			break;
+		default:
+			warn_log("Guest %zu (%s) failed: %s", i, g->path,
+				 strerror(g->err));
+			ret = 1;
+			break;
+		}
+	}
+
+	info_log("%zu guests on %u workers: %zu exited, %zu trapped, "
+		 "%zu failed", n, stats.workers, stats.exited, stats.trapped,
+		 stats.failed);
+	info_log("Retired %lu instructions in %.3fs, %.2f MIPS",
+		 stats.instret, stats.secs,
+		 (double)stats.instret / stats.secs / 1e6);
+	info_log("%lu time slices, %lu steals", stats.slices, stats.steals);
+	for (size_t i = 0; i < npaths; ++i)
+		info_log("%s: %zu KiB image shared by %zu guests", paths[i],
+			 images[i]->size / 1024, instances);
+	info_log("Load: mean %.1fus", stats.load_mean * 1e6);
+	info_log("Latency: mean %.3fms, p50 %.3fms, p99 %.3fms, max %.3fms",
+		 stats.lat_mean * 1e3, stats.lat_p50 * 1e3,
+		 stats.lat_p99 * 1e3, stats.lat_max * 1e3);
+
+out:
+	for (size_t i = 0; i < npaths; ++i)
+		if (images[i])
+			image_close(images[i]);
+	free(images);
+	free(guests);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct procopts opts = {.flatmem = true, .jit = true};
+	struct batchopts bopts = {0};
+	const char *path = "test.elf";
+	const char *ckpt = NULL;
+	const char *restore = NULL;
+	uint64_t every = UINT64_MAX;
+	uint64_t instret;
+	size_t instances = 1;
 	struct proc *proc;
-	insn_func_t insn_func;
-	insn_t insn;
+	struct timespec start, end;
+	double secs;
 	int ret;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "vql:t:j:m:s:r:n:w:b:L:c:C:R:")) != -1) {
+		switch (opt) {
+		case 'v':
+			log_setlevel(LOG_LVL_DEBUG);
+			break;
+		case 'q':
+			log_setlevel(LOG_LVL_ERR);
+			break;
+		case 'l':
+			if (log_open(optarg) == -1) {
+				err_log("%s: %s", optarg, strerror(errno));
+				return 1;
+			}
+			break;
+		case 't':
+			opts.trace = optarg;
+			break;
+		case 'j':
+			if (strcmp(optarg, "on") == 0) {
+				opts.jit = true;
+			} else if (strcmp(optarg, "off") == 0) {
+				opts.jit = false;
+			} else if (strcmp(optarg, "verify") == 0) {
+				opts.jit = opts.jit_verify = true;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'm':
+			if (strcmp(optarg, "flat") == 0) {
+				opts.flatmem = true;
+			} else if (strcmp(optarg, "checked") == 0) {
+				opts.flatmem = false;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 's':
+			opts.stack_max = strtoull(optarg, NULL, 0);
+			break;
+		case 'r':
+			opts.seed = strtoull(optarg, NULL, 0);
+			break;
+		case 'n':
+			instances = strtoull(optarg, NULL, 0);
+			break;
+		case 'w':
+			bopts.workers = (unsigned)strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			bopts.slice = strtoull(optarg, NULL, 0);
+			break;
+		case 'L':
+			bopts.max_live = (unsigned)strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			ckpt = optarg;
+			break;
+		case 'C':
+			every = strtoull(optarg, NULL, 0);
+			break;
+		case 'R':
+			restore = optarg;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (instances == 0 || every == 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (instances > 1 || argc - optind > 1) {
+		if (opts.trace || ckpt || restore) {
+			err_log("Batches can't be traced or checkpointed");
+			return 1;
+		}
+		bopts.procopts = opts;
+		if (optind == argc)
+			ret = run_batch((char *[]){(char *)path}, 1, instances,
+					&bopts);
+		else
+			ret = run_batch(&argv[optind], (size_t)(argc - optind),
+					instances, &bopts);
+		log_close();
+		return ret;
+	}
+	if (optind < argc)
+		path = argv[optind];
+	// Checkpoints only hold one thread
+	opts.threads = !ckpt;
 
-	if (!(proc = loadproc("test.elf")))
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (!(proc = restore ? proc_restore(restore, &opts) :
+	    loadproc(path, &opts))) {
+		log_close();
 		return 1;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (restore)
+		info_log("Restored %s at %lu instructions in %.1fus", restore,
+			 proc->instret, ((double)(end.tv_sec - start.tv_sec) *
+			 1e9 + (double)(end.tv_nsec - start.tv_nsec)) / 1e3);
+
+	instret = proc->instret;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ret = ckpt ? run_checkpointed(proc, ckpt, every) :
+	      proc_run(proc, UINT64_MAX);
+	thread_stop(proc);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	instret = proc->instret - instret;
+
+	if (proc->exited)
+		info_log("Exited with status %d", proc->exit_code);
+	else if (ret == -1 && proc->trap.pending)
+		err_log("Stopped at pc 0x%lx: %s, tval 0x%lx", proc->pc,
+			trap_name(proc->trap.cause), proc->trap.tval);
+	else if (ret == -1)
+		err_log("Stopped at pc 0x%lx: %s", proc->pc, strerror(errno));
 
-	ret = insn_fetch(proc, &insn);
-	assert(ret == 4);
-	dbg_log("insn 0x%.8x at addr 0x%lx", insn, proc->pc);
-	assert(insn_func = insn_decode(insn));
+	secs = (double)(end.tv_sec - start.tv_sec) +
+	       (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	info_log("Retired %lu instructions in %.3fs, %.2f MIPS",
+		 instret, secs, (double)instret / secs / 1e6);
+	// Translations don't count the pairs they fuse
+	if (proc->instret && !proc->jit)
+		info_log("%lu instructions (%.2f%%) ran fused", proc->fused,
+			 100.0 * (double)proc->fused / (double)proc->instret);
 
-	assert(insn_func(proc, insn) == 0);
-	proc->pc += (unsigned )ret;
+	dbg_log("Jump cache: %lu hits, %lu misses, return stack: %lu hits, "
+		"%lu misses", proc->bbcache->stats.jc_hits,
+		proc->bbcache->stats.jc_misses, proc->bbcache->stats.ras_hits,
+		proc->bbcache->stats.ras_misses);
+	if (proc->jit)
+		dbg_log("JIT: %lu blocks translated, %lu verified, %lu flushes",
+			proc->jit->compiled, proc->jit->verified,
+			proc->jit->flushes);
 
+	ret = proc->exited ? proc->exit_code & 0xff : ret == -1;
 	freeproc(proc);
-	return 0;
+	log_close();
+	return ret;
 }
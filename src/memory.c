@@ -1,10 +1,26 @@
 #include <errno.h>
 #include <assert.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "riscv.h"
+#include "debug.h"
 #include "memory.h"
 
+#define PGDOWN(addr) ((addr) & ~PGOFFSET)
+#define PGUP(addr) (((addr) + PGOFFSET) & ~PGOFFSET)
+
+// Where host faults in flat memory go, see memfault_arm()
+static _Thread_local sigjmp_buf *fault_env;
+static _Thread_local const struct memory *fault_mem;
+static _Thread_local rvaddr_t fault_addr;
+static _Thread_local int fault_err; // 0 to find it from the segments
+static pthread_once_t fault_handler_once = PTHREAD_ONCE_INIT;
+
 static inline void memload8(struct memseg *seg, rvaddr_t addr, uint8_t *in)
 	__attribute__((nonnull));
 static inline void memload16(struct memseg *seg, rvaddr_t addr, uint16_t *in)
@@ -21,39 +37,149 @@ static inline void memstore32(struct memseg *seg, rvaddr_t addr, uint32_t in)
 	__attribute__((nonnull));
 static inline void memstore64(struct memseg *seg, rvaddr_t addr, uint64_t in)
 	__attribute__((nonnull));
+static void wx_grow(struct memory *mem, const struct memseg *seg)
+	__attribute__((nonnull));
+static bool page_shared(const struct memory *mem, const struct memseg *seg,
+			rvaddr_t page) __attribute__((nonnull));
+static int zeropages(void *addr, size_t len, int prot);
+static int growmap(unsigned char **map, size_t oldlen, size_t newlen)
+	__attribute__((nonnull));
+static int flat_prot(const struct memory *mem, rvaddr_t start, rvaddr_t end)
+	__attribute__((nonnull));
+static int flat_protect(const struct memory *mem, rvaddr_t start,
+			rvaddr_t end) __attribute__((nonnull));
+static void memfault_handler(int sig, siginfo_t *info, void *ucontext);
+static void memfault_install(void) __attribute__((cold));
+
+void initmem(struct memory *mem, bool flat)
+{
+	void *map;
+
+	mem->segments = NULL;
+	mem->xdirty_start = mem->xdirty_end = 0;
+	mem->flat = NULL;
+	mem->flat_limit = 0;
+	mem->wx_start = mem->wx_end = 0;
+	mem->lock = NULL;
+	tlb_flush(&mem->tlb);
+
+	if (!flat)
+		return;
+	map = mmap(NULL, FLAT_SIZE, PROT_NONE,
+		   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (map == MAP_FAILED) {
+		warn_log("Cannot reserve flat memory, using checked segments: "
+			 "%s", strerror(errno));
+		return;
+	}
+	pthread_once(&fault_handler_once, memfault_install);
+
+	mem->flat = map;
+	// Leaves room for the widest access
+	mem->flat_limit = FLAT_SIZE - sizeof(uint64_t);
+}
 
 struct memseg *addseg(struct memory *mem, rvaddr_t start, rvaddr_t end,
 		      uint8_t flags)
+{
+	if (overlap_memseg(mem, start, end))
+		return NULL;
+	return addseg_unchecked(mem, start, end, flags);
+}
+
+struct memseg *addseg_unchecked(struct memory *mem, rvaddr_t start,
+				rvaddr_t end, uint8_t flags)
 {
 	struct memseg *seg;
-	struct memseg *before;
+	void *map;
 
-	if (MEMFLAG_INVALID(flags))
+	if (MEMFLAG_INVALID(flags) || start >= end)
 		return NULL;
-	if (is_memseg(*mem, start, end))
+	if (mem->flat && end > FLAT_SIZE)
 		return NULL;
 	if (!(seg = malloc(sizeof(*seg))))
 		return NULL;
-	if (!(seg->mem = malloc(end - start - 1))) {
-		free(seg);
-		return NULL;
+
+	if (mem->flat) {
+		seg->mem = mem->flat + start;
+		if (mprotect(mem->flat + PGDOWN(start), PGUP(end) -
+		    PGDOWN(start), PROT_READ | PROT_WRITE) == -1) {
+			free(seg);
+			return NULL;
+		}
+	} else {
+		// Mirrors the guest page offset, so that files can be mapped
+		map = mmap(NULL, PGUP(end) - PGDOWN(start),
+			   PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (map == MAP_FAILED) {
+			free(seg);
+			return NULL;
+		}
+		seg->mem = (unsigned char *)map + (start & PGOFFSET);
 	}
 
 	seg->start = start;
 	seg->end = end;
 	seg->flags = flags;
-	seg->next = NULL;
+	seg->snap = false;
+	seg->mapped = false;
+	wx_grow(mem, seg);
+	// Pages shared with the new segment may be cached as partial
+	tlb_flush(&mem->tlb);
+
+	// Segments don't overlap, so their order doesn't matter
+	seg->next = mem->segments;
+	mem->segments = seg;
+	return seg;
+}
+
+int resizeseg(struct memory *mem, struct memseg *seg, rvaddr_t end)
+{
+	rvaddr_t base = PGDOWN(seg->start);
+	rvaddr_t lo = end < seg->end ? end : seg->end;
+	rvaddr_t hi = end < seg->end ? seg->end : end;
+	unsigned char *map;
+
+	if (end <= seg->start || (mem->flat && end > FLAT_SIZE)) {
+		errno = EINVAL;
+		return -1;
+	}
 
-	if (!mem->segments) {
-		mem->segments = seg;
-		return seg;
+	if (mem->flat) {
+		if (PGUP(end) > PGUP(seg->end) &&
+		    mprotect(mem->flat + PGUP(seg->end), PGUP(end) -
+			     PGUP(seg->end), PROT_READ | PROT_WRITE) == -1)
+			return -1;
+		if (PGUP(end) < PGUP(seg->end) && seg->mapped)
+			zeropages(mem->flat + PGUP(end), PGUP(seg->end) -
+				  PGUP(end), PROT_NONE);
+		else if (PGUP(end) < PGUP(seg->end))
+			madvise(mem->flat + PGUP(end), PGUP(seg->end) -
+				PGUP(end), MADV_DONTNEED);
+	} else {
+		map = seg->mem - (seg->start & PGOFFSET);
+		if (PGUP(end) < PGUP(seg->end))
+			munmap(map + PGUP(end) - base, PGUP(seg->end) -
+			       PGUP(end));
+		else if (PGUP(end) > PGUP(seg->end) && growmap(&map,
+			 PGUP(seg->end) - base, PGUP(end) - base) == -1)
+			return -1;
+		seg->mem = map + (seg->start & PGOFFSET);
 	}
 
-	before = mem->segments;
-	while (before->next)
-		before = before->next;
-	before->next = seg;
-	return seg;
+	// Bytes that changed hands in the page of the lower end read as zero
+	memset(seg->mem + (lo - seg->start), 0, (hi < PGUP(lo) ? hi :
+	       PGUP(lo)) - lo);
+	if ((seg->flags & MEM_EXEC) && end < seg->end)
+		mark_xdirty(mem, end, seg->end);
+	seg->end = end;
+	seg->snap = false;
+	wx_grow(mem, seg);
+	tlb_flush(&mem->tlb);
+	if (mem->flat)
+		return flat_protect(mem, base, PGUP(hi));
+	return 0;
 }
 
 void freeseg(struct memory *mem, struct memseg *seg)
@@ -61,8 +187,6 @@ void freeseg(struct memory *mem, struct memseg *seg)
 	struct memseg *before;
 
 	if (seg == mem->segments) {
-		if (!seg->next)
-			goto free_seg;
 		mem->segments = seg->next;
 		goto free_seg;
 	}
@@ -75,10 +199,108 @@ void freeseg(struct memory *mem, struct memseg *seg)
 
 	before->next = seg->next;
 free_seg:
-	free(seg->mem);
+	tlb_flush(&mem->tlb);
+	if (seg->flags & MEM_EXEC)
+		mark_xdirty(mem, seg->start, seg->end);
+	if (mem->flat) {
+		// Pages shared with other segments keep their contents
+		if (PGUP(seg->start) < PGDOWN(seg->end) && seg->mapped)
+			zeropages(mem->flat + PGUP(seg->start),
+				  PGDOWN(seg->end) - PGUP(seg->start),
+				  PROT_NONE);
+		else if (PGUP(seg->start) < PGDOWN(seg->end))
+			madvise(mem->flat + PGUP(seg->start),
+				PGDOWN(seg->end) - PGUP(seg->start),
+				MADV_DONTNEED);
+		flat_protect(mem, PGDOWN(seg->start), PGUP(seg->end));
+	} else {
+		munmap(seg->mem - (seg->start & PGOFFSET), PGUP(seg->end) -
+		       PGDOWN(seg->start));
+	}
 	free(seg);
 }
 
+int mapseg(struct memory *mem, struct memseg *seg, int fd, off_t offset,
+	   size_t filesz)
+{
+	const struct memseg *other;
+	rvaddr_t pgstart = PGDOWN(seg->start);
+	rvaddr_t pgend = PGUP(seg->start + filesz);
+	unsigned char *tail;
+	size_t len;
+	struct stat st;
+
+	if (filesz == 0)
+		return 0;
+	if (((rvaddr_t)offset & PGOFFSET) != (seg->start & PGOFFSET) ||
+	    filesz > seg->end - seg->start || fstat(fd, &st) == -1 ||
+	    offset < 0 || (uint64_t)offset + filesz > (uint64_t)st.st_size) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	// Would replace the contents of another segment's pages
+	if (mem->flat)
+		for (other = mem->segments; other; other = other->next)
+			if (other != seg && pgstart < other->end &&
+			    other->start < pgend) {
+				errno = EBUSY;
+				return -1;
+			}
+
+	if (mmap(seg->mem - (seg->start & PGOFFSET), pgend - pgstart,
+		 PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+		 offset - (off_t)(seg->start & PGOFFSET)) == MAP_FAILED)
+		return -1;
+	seg->mapped = true;
+
+	/*
+	 * The rest of the last page is past the file image, e.g. .bss. Only
+	 * written if it isn't zero already, as in images, so that the page
+	 * stays shared with the file.
+	 */
+	tail = seg->mem + filesz;
+	len = pgend - seg->start - filesz;
+	if (len && (tail[0] != 0 || memcmp(tail, tail + 1, len - 1) != 0))
+		memset(tail, 0, len);
+	return 0;
+}
+
+int mappages(struct memory *mem, struct memseg *seg, rvaddr_t addr,
+	     size_t len, int fd, off_t offset)
+{
+	unsigned char *base = seg->mem - (seg->start & PGOFFSET);
+	rvaddr_t pgstart = PGDOWN(seg->start);
+	rvaddr_t lo = addr;
+	rvaddr_t hi = addr + len;
+
+	if (((addr | len | (rvaddr_t)offset) & PGOFFSET) || addr < pgstart ||
+	    hi > PGUP(seg->end)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (lo < hi && page_shared(mem, seg, lo))
+		lo += PGSIZE;
+	if (lo < hi && page_shared(mem, seg, hi - PGSIZE))
+		hi -= PGSIZE;
+
+	if (lo >= hi)
+		return 0;
+	if (mmap(base + (lo - pgstart), hi - lo, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_FIXED, fd, offset + (off_t)(lo - addr)) ==
+	    MAP_FAILED)
+		return -1;
+	seg->mapped = true;
+	return 0;
+}
+
+int protectseg(struct memory *mem, struct memseg *seg)
+{
+	if (!mem->flat)
+		return 0;
+	return flat_protect(mem, PGDOWN(seg->start), PGUP(seg->end));
+}
+
 void freemem(struct memory *mem)
 {
 	struct memseg *seg;
@@ -90,84 +312,354 @@ void freemem(struct memory *mem)
 		freeseg(mem, seg);
 		seg = next;
 	}
+
+	if (mem->flat) {
+		munmap(mem->flat, FLAT_SIZE);
+		mem->flat = NULL;
+		mem->flat_limit = 0;
+	}
 }
 
-struct memseg *is_memseg(struct memory mem, rvaddr_t start, rvaddr_t end)
+struct memseg *is_memseg(const struct memory *mem, rvaddr_t start,
+			 rvaddr_t end)
 {
 	struct memseg *seg;
 
 	if (start > end)
 		return NULL;
 
-	for (seg = mem.segments; seg; seg = seg->next)
+	for (seg = mem->segments; seg; seg = seg->next)
 		if (start >= seg->start && end <= seg->end)
 			return seg;
 	return NULL;
 }
 
-int memloadN(struct memory mem, rvaddr_t addr, uint8_t size, void *out)
+struct memseg *overlap_memseg(const struct memory *mem, rvaddr_t start,
+			      rvaddr_t end)
 {
 	struct memseg *seg;
 
-	assert(size == 8 || size == 16 || size == 32 || size == 64);
+	for (seg = mem->segments; seg; seg = seg->next)
+		if (start < seg->end && seg->start < end)
+			return seg;
+	return NULL;
+}
 
-	seg = is_memseg(mem, addr, addr + (size / 8) + 1);
-	if (!seg) {
-		errno = EINVAL;
-		return -1;
-	} else if (!(seg->flags & MEM_READ)) {
-		errno = EPERM;
+int memiov(struct memory *mem, rvaddr_t addr, size_t len, uint8_t access,
+	   struct iovec *iov, int iovcnt)
+{
+	const struct memseg *seg;
+	int n = 0;
+	size_t part;
+
+	mem_lock(mem);
+	for (; len > 0 && n < iovcnt; ++n) {
+		if (!(seg = is_memseg(mem, addr, addr + 1)) ||
+		    !(seg->flags & access))
+			break;
+		part = seg->end - addr < len ? seg->end - addr : len;
+		iov[n].iov_base = seg->mem + (addr - seg->start);
+		iov[n].iov_len = part;
+		if ((access & MEM_WRITE) && (seg->flags & MEM_EXEC))
+			mark_xdirty(mem, addr, addr + part);
+		addr += part;
+		len -= part;
+	}
+	mem_unlock(mem);
+
+	if (n == 0 && len > 0) {
+		errno = EFAULT;
 		return -1;
 	}
+	return n;
+}
+
+void tlb_flush(struct tlb *tlb)
+{
+	for (size_t i = 0; i < TLB_SIZE; ++i)
+		tlb->read[i].tag = tlb->write[i].tag = tlb->exec[i].tag =
+			TLB_INVALID;
+}
+
+uint64_t memloadN_tlbmiss(struct memory *mem, rvaddr_t addr, uint8_t size)
+{
+	struct memseg *seg;
+	uint8_t v8;
+	uint16_t v16;
+	uint32_t v32;
+	uint64_t val = 0;
+
+	assert(size == 8 || size == 16 || size == 32 || size == 64);
+
+	mem_lock(mem);
+	seg = is_memseg(mem, addr, addr + size / 8);
+	if (!seg || !(seg->flags & MEM_READ)) {
+		mem_unlock(mem);
+		memfault_raise(addr, seg ? EPERM : EINVAL);
+	}
 
 	switch (size) {
 	case 8:
-		memload8(seg, addr, (uint8_t *)out);
+		memload8(seg, addr, &v8);
+		val = v8;
 		break;
 	case 16:
-		memload16(seg, addr, (uint16_t *)out);
+		memload16(seg, addr, &v16);
+		val = v16;
 		break;
 	case 32:
-		memload32(seg, addr, (uint32_t *)out);
+		memload32(seg, addr, &v32);
+		val = v32;
 		break;
 	case 64:
-		memload64(seg, addr, (uint64_t *)out);
+		memload64(seg, addr, &val);
 		break;
 	}
 
-	return 0;
+	tlb_fill(mem->tlb.read, seg, addr);
+	mem_unlock(mem);
+	return val;
 }
 
-int memstoreN(struct memory mem, rvaddr_t addr, uint8_t size, const void *in)
+void memstoreN_tlbmiss(struct memory *mem, rvaddr_t addr, uint8_t size,
+		       uint64_t val)
 {
 	struct memseg *seg;
 
 	assert(size == 8 || size == 16 || size == 32 || size == 64);
 
-	seg = is_memseg(mem, addr, addr + (size / 8) + 1);
-	if (!seg) {
-		errno = EINVAL;
-		return -1;
-	} else if (!(seg->flags & MEM_WRITE)) {
-		errno = EPERM;
-		return -1;
+	mem_lock(mem);
+	seg = is_memseg(mem, addr, addr + size / 8);
+	if (!seg || !(seg->flags & MEM_WRITE)) {
+		mem_unlock(mem);
+		memfault_raise(addr, seg ? EPERM : EINVAL);
 	}
 
 	switch (size) {
 	case 8:
-		memstore8(seg, addr, *((const uint8_t *)in));
+		memstore8(seg, addr, (uint8_t)val);
 		break;
 	case 16:
-		memstore16(seg, addr, *((const uint16_t *)in));
+		memstore16(seg, addr, (uint16_t)val);
 		break;
 	case 32:
-		memstore32(seg, addr, *((const uint32_t *)in));
+		memstore32(seg, addr, (uint32_t)val);
 		break;
 	case 64:
-		memstore64(seg, addr, *((const uint64_t *)in));
+		memstore64(seg, addr, val);
 		break;
 	}
 
+	if (seg->flags & MEM_EXEC)
+		mark_xdirty(mem, addr, addr + size / 8);
+	else
+		tlb_fill(mem->tlb.write, seg, addr);
+	mem_unlock(mem);
+}
+
+void *memxlate_tlbmiss(struct memory *mem, rvaddr_t addr, uint8_t size)
+{
+	struct memseg *seg;
+
+	mem_lock(mem);
+	seg = is_memseg(mem, addr, addr + size / 8);
+	if (!seg || (seg->flags & (MEM_READ | MEM_WRITE)) !=
+	    (MEM_READ | MEM_WRITE)) {
+		mem_unlock(mem);
+		memfault_raise(addr, seg ? EPERM : EINVAL);
+	}
+
+	if (seg->flags & MEM_EXEC)
+		mark_xdirty(mem, addr, addr + size / 8);
+	else
+		tlb_fill(mem->tlb.write, seg, addr);
+	mem_unlock(mem);
+	return seg->mem + (addr - seg->start);
+}
+
+void tlb_fill(struct tlb_entry *tab, const struct memseg *seg,
+		     rvaddr_t addr)
+{
+	rvaddr_t page = addr & ~PGOFFSET;
+
+	if (page < seg->start || page + PGSIZE > seg->end || page + PGSIZE == 0)
+		return;
+	tab[TLB_IDX(addr)].tag = page;
+	tab[TLB_IDX(addr)].addend = (uintptr_t)seg->mem - seg->start;
+}
+
+void memfault_arm(const struct memory *mem, sigjmp_buf *env)
+{
+	fault_mem = mem;
+	fault_env = env;
+}
+
+void memfault_raise(rvaddr_t addr, int err)
+{
+	fault_addr = addr;
+	fault_err = err;
+	siglongjmp(*fault_env, 1);
+}
+
+rvaddr_t memfault_addr(void)
+{
+	return fault_addr;
+}
+
+int memfault_errno(const struct memory *mem)
+{
+	int err;
+
+	if (fault_err)
+		return fault_err;
+	mem_lock(mem);
+	err = is_memseg(mem, fault_addr, fault_addr + 1) ? EPERM : EINVAL;
+	mem_unlock(mem);
+	return err;
+}
+
+static void memfault_handler(int sig, siginfo_t *info, void *ucontext)
+{
+	uintptr_t addr = (uintptr_t)info->si_addr;
+#ifdef __x86_64__
+	const ucontext_t *uc = ucontext;
+#endif
+
+	(void)ucontext;
+	if (fault_env && fault_mem->flat &&
+	    addr - (uintptr_t)fault_mem->flat < FLAT_SIZE) {
+		fault_addr = addr - (uintptr_t)fault_mem->flat;
+		fault_err = 0;
+#ifdef __x86_64__
+		/*
+		 * Handlers start with the default MXCSR, the guest keeps its
+		 * rounding mode and accrued flags, see rv_f.h
+		 */
+		if (uc->uc_mcontext.fpregs)
+			__builtin_ia32_ldmxcsr(uc->uc_mcontext.fpregs->mxcsr);
+#endif
+		siglongjmp(*fault_env, 1);
+	}
+
+	// Not a guest access, crash as we would have without the handler
+	signal(sig, SIG_DFL);
+}
+
+static void memfault_install(void)
+{
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_sigaction = memfault_handler;
+	sa.sa_flags = SA_SIGINFO;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGSEGV, &sa, NULL) == -1)
+		panic("Cannot install the flat memory fault handler");
+}
+
+// Grows [wx_start, wx_end[ to cover `seg` if it is writable code
+static void wx_grow(struct memory *mem, const struct memseg *seg)
+{
+	if (!(seg->flags & MEM_WRITE) || !(seg->flags & MEM_EXEC))
+		return;
+	if (mem->wx_start >= mem->wx_end || seg->start < mem->wx_start)
+		mem->wx_start = seg->start;
+	if (seg->end > mem->wx_end)
+		mem->wx_end = seg->end;
+}
+
+// Whether another segment maps some of `page`, only with flat memory
+static bool page_shared(const struct memory *mem, const struct memseg *seg,
+			rvaddr_t page)
+{
+	const struct memseg *other;
+
+	if (!mem->flat)
+		return false;
+	for (other = mem->segments; other; other = other->next)
+		if (other != seg && page < other->end &&
+		    other->start < page + PGSIZE)
+			return true;
+	return false;
+}
+
+/*
+ * Replaces host pages with fresh zero ones, unlike MADV_DONTNEED which would
+ * bring back the contents of a private file mapping
+ */
+static int zeropages(void *addr, size_t len, int prot)
+{
+	if (mmap(addr, len, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE |
+		 MAP_FIXED, -1, 0) == MAP_FAILED)
+		return -1;
+	return 0;
+}
+
+/*
+ * Grows the host mapping of a checked segment, `oldlen` bytes at `*map`, to
+ * `newlen` bytes. mapseg() and mappages() split it in several mappings, which
+ * mremap() can't resize at once, so the new pages are mapped right after the
+ * old ones if they are free, or else everything moves to a new mapping.
+ */
+static int growmap(unsigned char **map, size_t oldlen, size_t newlen)
+{
+	unsigned char *tail = *map + oldlen;
+	void *p;
+
+	p = mmap(tail, newlen - oldlen, PROT_READ | PROT_WRITE, MAP_PRIVATE |
+		 MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+	if (p == tail)
+		return 0;
+	// Kernels before 4.17 take the address as a hint
+	if (p != MAP_FAILED)
+		munmap(p, newlen - oldlen);
+
+	p = mmap(NULL, newlen, PROT_READ | PROT_WRITE, MAP_PRIVATE |
+		 MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED)
+		return -1;
+	memcpy(p, *map, oldlen);
+	munmap(*map, oldlen);
+	*map = p;
+	return 0;
+}
+
+// Host permissions of flat memory pages, that [start, end[ covers
+static int flat_prot(const struct memory *mem, rvaddr_t start, rvaddr_t end)
+{
+	const struct memseg *seg;
+	int prot = PROT_NONE;
+
+	for (seg = mem->segments; seg; seg = seg->next) {
+		if (!(start < seg->end && seg->start < end))
+			continue;
+		if (seg->flags & (MEM_READ | MEM_EXEC))
+			prot |= PROT_READ;
+		if (seg->flags & MEM_WRITE)
+			prot |= PROT_WRITE;
+	}
+	return prot;
+}
+
+/*
+ * Sets the host permissions of the pages in [start, end[, page aligned. The
+ * first and last ones may be shared between segments, they get the union of
+ * their permissions.
+ */
+static int flat_protect(const struct memory *mem, rvaddr_t start,
+			rvaddr_t end)
+{
+	if (end - start > 2 * PGSIZE &&
+	    mprotect(mem->flat + start + PGSIZE, end - start - 2 * PGSIZE,
+		     flat_prot(mem, start + PGSIZE, end - PGSIZE)) == -1)
+		return -1;
+	if (mprotect(mem->flat + start, PGSIZE,
+		     flat_prot(mem, start, start + PGSIZE)) == -1)
+		return -1;
+	if (end - start > PGSIZE &&
+	    mprotect(mem->flat + end - PGSIZE, PGSIZE,
+		     flat_prot(mem, end - PGSIZE, end)) == -1)
+		return -1;
 	return 0;
 }
 
@@ -1,10 +1,13 @@
-#include <time.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 // For stack initialization, copy emulator's soft limit
 #include <sys/types.h>
@@ -13,6 +16,13 @@
 #include <elf.h>
 #include "proc.h"
 #include "debug.h"
+#include "bbcache.h"
+#include "trace.h"
+#include "jit.h"
+#include "syscall.h"
+#include "thread.h"
+#include "rv_f.h"
+#include "rv_v.h"
 
 enum LOAD_ERR {
 	ELF_NOT_EXEC=1,
@@ -29,20 +39,37 @@ enum LOAD_ERR {
 	ELF_SEGMENT_CANTREAD,
 	PROC_CANNOT_QUERYSTACKSZ,
 	PROC_CANNOT_ALLOCSTACK,
+	PROC_CANNOT_ALLOCBBCACHE,
+	PROC_CANNOT_OPENTRACE,
+	IMAGE_CANNOT_CREATE,
 };
 
 static const char elfmag[] = {ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3};
 
-static int elfparse(FILE *file, struct proc *proc)
+/*
+ * The stack is placed below STACK_TOP, with at least STACK_GUARD unmapped
+ * bytes under it so that overflows fault instead of running into another
+ * segment. Placement gives up after STACK_TRIES collisions.
+ */
+#define STACK_TOP ((rvaddr_t)1 << 31)
+#define STACK_GUARD PGSIZE
+#define STACK_TRIES 64
+#define STACK_DEFAULT (2 * 1024 * 1024) // Without a RLIMIT_STACK limit
+
+static int elfcheck(const Elf64_Ehdr *elfh) __attribute__((nonnull, cold));
+static int elfparse(FILE *file, struct proc *proc, bool elfread)
 	__attribute__((nonnull, cold));
-static int loadseg(FILE *fp, Elf64_Phdr elfph, struct proc *proc)
+static int imageseg(FILE *fp, Elf64_Phdr elfph, struct image *img)
 	__attribute__((nonnull, cold));
-static int loadstack(struct proc *proc)
+static int loadseg(FILE *fp, Elf64_Phdr elfph, struct proc *proc,
+		   bool elfread) __attribute__((nonnull, cold));
+static int loadstack(struct proc *proc, const struct procopts *opts)
 	__attribute__((nonnull, cold));
+static uint64_t splitmix64(uint64_t *state) __attribute__((nonnull));
 static void loader_err(const char *path, enum LOAD_ERR e)
 	__attribute__((nonnull, cold));
 
-struct proc *loadproc(const char *path)
+struct proc *loadproc(const char *path, const struct procopts *opts)
 {
 	FILE *fp = NULL;
 	struct proc *proc = NULL;
@@ -52,15 +79,21 @@ struct proc *loadproc(const char *path)
 		goto err_out;
 	if (!(proc = calloc(1, sizeof(*proc))))
 		goto err_out;
-	if ((err = elfparse(fp, proc)) != 0) {
+	initmem(&proc->mem, opts->flatmem);
+	if ((err = elfparse(fp, proc, opts->elfread)) != 0) {
 		loader_err(path, err);
 		goto err_out;
 	}
 
-	if ((err = loadstack(proc)) != 0) {
+	if ((err = loadstack(proc, opts)) != 0) {
 		loader_err(path, err);
 		goto err_out;
 	}
+	sys_init(proc);
+	fp_init(proc, 0);
+	vec_init(proc);
+	if (proc_setup(proc, path, opts) == -1)
+		goto err_out;
 
 	fclose(fp);
 	return proc;
@@ -69,43 +102,174 @@ err_out:
 	if (fp)
 		fclose(fp);
 	if (proc)
-		free(proc);
+		proc_discard(proc);
 	return NULL;
 }
 
-void freeproc(struct proc *proc)
+struct image *image_open(const char *path)
 {
-	freemem(&proc->mem);
-	free(proc);
+	FILE *fp = NULL;
+	struct image *img = NULL;
+	Elf64_Ehdr elfh;
+	Elf64_Phdr elfph;
+	enum LOAD_ERR err = 0;
+
+	if (!(fp = fopen(path, "rb")))
+		return NULL;
+	if (fread(&elfh, sizeof(elfh), 1, fp) != 1 ||
+	    (err = elfcheck(&elfh)) != 0)
+		goto err_out;
+	if (!(img = calloc(1, sizeof(*img) + elfh.e_phnum *
+	    sizeof(img->segs[0]))))
+		goto err_out;
+	img->fd = -1;
+	if (!(img->path = strdup(path)))
+		goto err_out;
+	img->entry = elfh.e_entry;
+
+	if ((img->fd = memfd_create("rvrun image", MFD_CLOEXEC |
+	    MFD_ALLOW_SEALING)) == -1) {
+		err = IMAGE_CANNOT_CREATE;
+		goto err_out;
+	}
+	for (uint16_t i = 0; i < elfh.e_phnum; ++i) {
+		if (fseek(fp, (long int)(elfh.e_phoff +
+		    (Elf64_Off)(i * elfh.e_phentsize)), SEEK_SET) != 0 ||
+		    fread(&elfph, sizeof(elfph), 1, fp) != 1) {
+			err = ELF_SEGMENT_CANTOFFSET;
+			goto err_out;
+		}
+		if ((err = imageseg(fp, elfph, img)) != 0)
+			goto err_out;
+	}
+
+	// Nothing can change the image anymore, not even through /proc
+	if (ftruncate(img->fd, (off_t)img->size) == -1 ||
+	    fcntl(img->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW |
+		  F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+		err = IMAGE_CANNOT_CREATE;
+		goto err_out;
+	}
+	fclose(fp);
+	return img;
+
+err_out:
+	if (err)
+		loader_err(path, err);
+	fclose(fp);
+	if (img) {
+		if (img->fd != -1)
+			close(img->fd);
+		free(img->path);
+		free(img);
+	}
+	errno = err == IMAGE_CANNOT_CREATE ? errno : ENOEXEC;
+	return NULL;
 }
 
-static int elfparse(FILE *file, struct proc *proc)
+void image_close(struct image *img)
 {
-	Elf64_Ehdr elfh;
-	Elf64_Phdr elfph;
+	if (img->fd != -1)
+		close(img->fd);
+	free(img->path);
+	free(img);
+}
+
+struct proc *proc_spawn(const struct image *img, const struct procopts *opts)
+{
+	const struct imageseg *is;
+	struct memseg *seg;
+	struct proc *proc;
 	enum LOAD_ERR err;
 
-	if (fread(&elfh, sizeof(elfh), 1, file) != 1)
-		return -1;
+	if (!(proc = calloc(1, sizeof(*proc))))
+		return NULL;
+	initmem(&proc->mem, opts->flatmem);
+
+	for (size_t i = 0; i < img->nsegs; ++i) {
+		is = &img->segs[i];
+		if (!(seg = addseg(&proc->mem, is->start, is->end,
+		    is->flags))) {
+			loader_err(img->path, ELF_SEGMENT_ALLOCFAIL);
+			goto err_out;
+		}
+		// Pages shared by two segments can't be mapped, copy them
+		if (mapseg(&proc->mem, seg, img->fd, is->offset,
+		    is->filesz) == -1 && pread(img->fd, seg->mem, is->filesz,
+		    is->offset) != (ssize_t)is->filesz) {
+			loader_err(img->path, ELF_SEGMENT_CANTREAD);
+			goto err_out;
+		}
+		if (protectseg(&proc->mem, seg) == -1) {
+			loader_err(img->path, ELF_SEGMENT_ALLOCFAIL);
+			goto err_out;
+		}
+	}
+	proc->pc = img->entry;
+	proc->brk_start = img->brk_start;
+
+	if ((err = loadstack(proc, opts)) != 0) {
+		loader_err(img->path, err);
+		goto err_out;
+	}
+	sys_init(proc);
+	fp_init(proc, 0);
+	vec_init(proc);
+	if (proc_setup(proc, img->path, opts) == 0)
+		return proc;
 
-	// Checking if ELF file is correct
-	if (memcmp(elfh.e_ident, elfmag, sizeof(elfmag)) != 0)
+err_out:
+	proc_discard(proc);
+	return NULL;
+}
+
+void freeproc(struct proc *proc)
+{
+	if (proc->thread)
+		thread_free(proc);
+	if (proc->trace && trace_close(proc->trace) == -1)
+		warn_log("Trace is incomplete: %s", strerror(errno));
+	if (proc->jit)
+		jit_free(proc->jit);
+	bbcache_free(proc->bbcache);
+	freemem(&proc->mem);
+	free(proc->snap_path);
+	free(proc);
+}
+
+// Checks that the ELF file is a RISC-V executable we can run
+static int elfcheck(const Elf64_Ehdr *elfh)
+{
+	if (memcmp(elfh->e_ident, elfmag, sizeof(elfmag)) != 0)
 		return ELF_NOT_MAGIC;
-	else if (elfh.e_ident[EI_CLASS] != ELFCLASS64)
+	else if (elfh->e_ident[EI_CLASS] != ELFCLASS64)
 		return ELF_NOT_64BIT;
-	else if (elfh.e_ident[EI_DATA] != ELFDATA2LSB)
+	else if (elfh->e_ident[EI_DATA] != ELFDATA2LSB)
 		return ELF_NOT_LITTLE;
-	else if (elfh.e_ident[EI_VERSION] == EV_NONE)
+	else if (elfh->e_ident[EI_VERSION] == EV_NONE)
 		return ELF_NOT_VERSION;
-	else if (elfh.e_ident[EI_OSABI] != ELFOSABI_SYSV)
+	else if (elfh->e_ident[EI_OSABI] != ELFOSABI_SYSV)
 		return ELF_NOT_SYSV;
-	else if (elfh.e_type != ET_EXEC)
+	else if (elfh->e_type != ET_EXEC)
 		return ELF_NOT_EXEC;
 	// EM_RISCV is not in elf(5), but is in RISC-V ABI spec page 23
-	else if (elfh.e_machine != EM_RISCV)
+	else if (elfh->e_machine != EM_RISCV)
 		return ELF_NOT_RISCV;
-	else if (elfh.e_version == EV_NONE)
+	else if (elfh->e_version == EV_NONE)
 		return ELF_NOT_FVERSION;
+	return 0;
+}
+
+static int elfparse(FILE *file, struct proc *proc, bool elfread)
+{
+	Elf64_Ehdr elfh;
+	Elf64_Phdr elfph;
+	enum LOAD_ERR err;
+
+	if (fread(&elfh, sizeof(elfh), 1, file) != 1)
+		return -1;
+	if ((err = elfcheck(&elfh)) != 0)
+		return err;
 
 	for (uint16_t i = 0; i < elfh.e_phnum; ++i) {
 		if (fseek(file, (long int)(elfh.e_phoff +
@@ -113,7 +277,7 @@ static int elfparse(FILE *file, struct proc *proc)
 			return ELF_SEGMENT_CANTOFFSET;
 		if (fread(&elfph, sizeof(elfph), 1, file) != 1)
 			return ELF_SEGMENT_CANTOFFSET;
-		if ((err = loadseg(file, elfph, proc)) != 0)
+		if ((err = loadseg(file, elfph, proc, elfread)) != 0)
 			return err;
 	}
 
@@ -121,7 +285,8 @@ static int elfparse(FILE *file, struct proc *proc)
 	return 0;
 }
 
-static int loadseg(FILE *fp, Elf64_Phdr elfph, struct proc *proc)
+static int loadseg(FILE *fp, Elf64_Phdr elfph, struct proc *proc,
+		   bool elfread)
 {
 	struct memseg *seg;
 	uint8_t flags = 0;
@@ -134,14 +299,22 @@ static int loadseg(FILE *fp, Elf64_Phdr elfph, struct proc *proc)
 	flags |= (elfph.p_flags & PF_W) ? MEM_WRITE : 0;
 	flags |= (elfph.p_flags & PF_X) ? MEM_EXEC : 0;
 	if (!(seg = addseg(&proc->mem, elfph.p_vaddr, elfph.p_vaddr +
-	    elfph.p_memsz + 1, flags)))
+	    elfph.p_memsz, flags)))
 		return ELF_SEGMENT_ALLOCFAIL;
+	// The program break starts after the highest segment
+	if (((seg->end + PGOFFSET) & ~PGOFFSET) > proc->brk_start)
+		proc->brk_start = (seg->end + PGOFFSET) & ~PGOFFSET;
 
 	if (elfph.p_filesz > elfph.p_memsz) {
 		freemem(&proc->mem);
 		return ELF_SEGMENT_MEMTOOSMALL;
 	}
 
+	// Zero-copy, the .bss tail stays untouched zero pages
+	if (!elfread && mapseg(&proc->mem, seg, fileno(fp),
+	    (off_t)elfph.p_offset, elfph.p_filesz) == 0)
+		goto protect;
+
 	if (fseek(fp, (long int)elfph.p_offset, SEEK_SET) == -1) {
 		freemem(&proc->mem);
 		return ELF_SEGMENT_CANTOFFSET;
@@ -151,40 +324,139 @@ static int loadseg(FILE *fp, Elf64_Phdr elfph, struct proc *proc)
 		freemem(&proc->mem);
 		return ELF_SEGMENT_CANTREAD;
 	}
+
+protect:
+	if (protectseg(&proc->mem, seg) == -1) {
+		freemem(&proc->mem);
+		return ELF_SEGMENT_ALLOCFAIL;
+	}
 	return 0;
 }
 
-static int loadstack(struct proc *proc)
+/*
+ * Copies a PT_LOAD segment at the end of the image's memfd, at the same
+ * offset in its page as in the guest so that it can be mapped
+ */
+static int imageseg(FILE *fp, Elf64_Phdr elfph, struct image *img)
 {
-	struct rlimit slimit;
-	rvaddr_t start;
+	struct imageseg *is = &img->segs[img->nsegs];
+	unsigned char buf[BUFSIZ];
+	size_t left;
+	size_t len;
+	off_t off;
 
-	assert(sizeof(slimit.rlim_cur) <= sizeof(start));
-	assert(sizeof(random()) <= sizeof(start));
+	if (elfph.p_type != PT_LOAD)
+		return 0;
+	if (elfph.p_filesz > elfph.p_memsz)
+		return ELF_SEGMENT_MEMTOOSMALL;
 
-	if (getrlimit(RLIMIT_STACK, &slimit) == -1) {
-		perror("loadstack(): getrlimit()");
-		return PROC_CANNOT_QUERYSTACKSZ;
+	is->start = elfph.p_vaddr;
+	is->end = elfph.p_vaddr + elfph.p_memsz;
+	is->flags |= (elfph.p_flags & PF_R) ? MEM_READ : 0;
+	is->flags |= (elfph.p_flags & PF_W) ? MEM_WRITE : 0;
+	is->flags |= (elfph.p_flags & PF_X) ? MEM_EXEC : 0;
+	is->offset = (off_t)(img->size + (elfph.p_vaddr & PGOFFSET));
+	is->filesz = elfph.p_filesz;
+	if (((is->end + PGOFFSET) & ~PGOFFSET) > img->brk_start)
+		img->brk_start = (is->end + PGOFFSET) & ~PGOFFSET;
+
+	if (fseek(fp, (long int)elfph.p_offset, SEEK_SET) == -1)
+		return ELF_SEGMENT_CANTOFFSET;
+	for (left = is->filesz, off = is->offset; left; left -= len,
+	     off += (off_t)len) {
+		len = left < sizeof(buf) ? left : sizeof(buf);
+		if (fread(buf, 1, len, fp) != len)
+			return ELF_SEGMENT_CANTREAD;
+		if (pwrite(img->fd, buf, len, off) != (ssize_t)len)
+			return IMAGE_CANNOT_CREATE;
 	}
 
-	if (slimit.rlim_cur == RLIM_INFINITY)
-		slimit.rlim_cur = 2 * (1024 * 1024); // 2Mb stack
+	img->size = ((size_t)is->offset + is->filesz + PGOFFSET) & ~PGOFFSET;
+	++img->nsegs;
+	return 0;
+}
 
-	srandom((unsigned)time(NULL));
-	do {
-		start = (rvaddr_t)random();
-		if (start + slimit.rlim_cur < start)
-			continue;
-	} while (is_memseg(proc->mem, start, start + slimit.rlim_cur + 1));
+int proc_setup(struct proc *proc, const char *path,
+	       const struct procopts *opts)
+{
+	if (!(proc->bbcache = bbcache_alloc())) {
+		loader_err(path, PROC_CANNOT_ALLOCBBCACHE);
+		return -1;
+	}
 
-	if (!addseg(&proc->mem, start, start + slimit.rlim_cur + 1,
-	   MEM_READ | MEM_WRITE))
-		return PROC_CANNOT_ALLOCSTACK;
+	if (opts->trace && !(proc->trace = trace_open(opts->trace,
+	    proc->pc))) {
+		err_log("%s: %s", opts->trace, strerror(errno));
+		loader_err(path, PROC_CANNOT_OPENTRACE);
+		return -1;
+	}
 
-	proc->regs[REG_SP] = start + slimit.rlim_cur;
+	proc->clone = opts->threads;
+	// Traces are recorded by the interpreter
+	if (opts->jit && !opts->trace && !(proc->jit = jit_alloc(opts->jit_cache,
+	    opts->jit_verify)))
+		warn_log("Cannot start the JIT, only interpreting: %s",
+			 strerror(errno));
 	return 0;
 }
 
+void proc_discard(struct proc *proc)
+{
+	if (proc->bbcache)
+		bbcache_free(proc->bbcache);
+	freemem(&proc->mem);
+	free(proc->snap_path);
+	free(proc);
+}
+
+/*
+ * The stack segment spans the whole limit, but like every segment its host
+ * pages are only allocated as the guest touches them.
+ */
+static int loadstack(struct proc *proc, const struct procopts *opts)
+{
+	struct rlimit slimit;
+	uint64_t size = opts->stack_max;
+	uint64_t state = opts->seed;
+	rvaddr_t start;
+
+	if (size == 0) {
+		if (getrlimit(RLIMIT_STACK, &slimit) == -1) {
+			perror("loadstack(): getrlimit()");
+			return PROC_CANNOT_QUERYSTACKSZ;
+		}
+		size = slimit.rlim_cur == RLIM_INFINITY ? STACK_DEFAULT :
+		       slimit.rlim_cur;
+	}
+	size = (size + PGOFFSET) & ~PGOFFSET;
+	if (size == 0 || size > STACK_TOP - STACK_GUARD)
+		return PROC_CANNOT_ALLOCSTACK;
+
+	for (int i = 0; i < STACK_TRIES; ++i) {
+		start = STACK_GUARD + (splitmix64(&state) % (STACK_TOP -
+			STACK_GUARD - size + 1) & ~PGOFFSET);
+		if (overlap_memseg(&proc->mem, start - STACK_GUARD,
+		    start + size))
+			continue;
+		if (!addseg(&proc->mem, start, start + size,
+		    MEM_READ | MEM_WRITE))
+			return PROC_CANNOT_ALLOCSTACK;
+		proc->regs[REG_SP] = start + size;
+		return 0;
+	}
+	return PROC_CANNOT_ALLOCSTACK;
+}
+
+// Small seedable PRNG, see https://prng.di.unimi.it/splitmix64.c
+static uint64_t splitmix64(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9e3779b97f4a7c15);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
 static void loader_err(const char *path, enum LOAD_ERR e)
 {
 	char *msg = "";
@@ -232,6 +504,15 @@ static void loader_err(const char *path, enum LOAD_ERR e)
 	case PROC_CANNOT_ALLOCSTACK:
 		msg = "Cannot alocate stack for the process";
 		break;
+	case PROC_CANNOT_ALLOCBBCACHE:
+		msg = "Cannot allocate the basic block cache";
+		break;
+	case PROC_CANNOT_OPENTRACE:
+		msg = "Cannot open the trace file";
+		break;
+	case IMAGE_CANNOT_CREATE:
+		msg = "Cannot create the image";
+		break;
 	default:
 		msg = "Unknown error";
 		break;
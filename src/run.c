@@ -0,0 +1,241 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include "riscv.h"
+#include "proc.h"
+#include "memory.h"
+#include "insn.h"
+#include "bbcache.h"
+#include "trace.h"
+#include "jit.h"
+#include "thread.h"
+#include "rv_f.h"
+
+// Values proc_run()'s sigsetjmp() returns with
+#define TRAP_MEM 1 // A memory fault, see memfault_arm()
+#define TRAP_SET 2 // proc_trap(), `proc->trap` is already set
+#define TRAP_EXIT 3 // proc_exit()
+
+static int run_blocks(struct proc *proc, uint64_t budget,
+		      struct bblock *volatile *cur) __attribute__((nonnull));
+static void bb_exec_traced(struct proc *proc, const struct bblock *blk)
+	__attribute__((nonnull));
+static uint32_t bb_retired(const struct bblock *blk, rvaddr_t pc)
+	__attribute__((nonnull, cold));
+static void mem_trap(struct proc *proc, const struct bblock *blk)
+	__attribute__((nonnull, cold));
+static int fetch_trap(struct proc *proc) __attribute__((nonnull, cold));
+static int trap_errno(enum trap_cause cause) __attribute__((cold));
+
+int proc_run(struct proc *proc, uint64_t budget)
+{
+	struct bblock *volatile blk = NULL;
+	sigjmp_buf env;
+	int ret;
+
+	if (proc->exited)
+		return 0;
+
+	fp_enter(proc);
+	// Traps come back here, with the pc on the trapping instruction
+	if ((ret = sigsetjmp(env, 1))) {
+		memfault_arm(NULL, NULL);
+		proc->trap_env = NULL;
+		fp_leave(proc);
+		// The pc is past the block, so all of it retired
+		if (ret == TRAP_EXIT) {
+			proc->instret += bb_retired(blk, proc->pc);
+			bb_sync(proc);
+			return 0;
+		}
+		if (ret == TRAP_MEM)
+			mem_trap(proc, blk);
+		proc->instret += bb_retired(blk, proc->pc);
+		bb_sync(proc);
+		errno = trap_errno(proc->trap.cause);
+		return -1;
+	}
+
+	memfault_arm(&proc->mem, &env);
+	proc->trap_env = &env;
+	ret = run_blocks(proc, budget, &blk);
+	memfault_arm(NULL, NULL);
+	proc->trap_env = NULL;
+	fp_leave(proc);
+	return ret;
+}
+
+void proc_trap(struct proc *proc, enum trap_cause cause, rvaddr_t tval)
+{
+	proc->trap.pending = true;
+	proc->trap.cause = cause;
+	proc->trap.tval = tval;
+	siglongjmp(*proc->trap_env, TRAP_SET);
+}
+
+void proc_exit(struct proc *proc, int code)
+{
+	proc->exited = true;
+	proc->exit_code = code;
+	siglongjmp(*proc->trap_env, TRAP_EXIT);
+}
+
+const char *trap_name(enum trap_cause cause)
+{
+	switch (cause) {
+	case CAUSE_FETCH_MISALIGNED:
+		return "Instruction address misaligned";
+	case CAUSE_FETCH_ACCESS:
+		return "Instruction access fault";
+	case CAUSE_ILLEGAL_INSN:
+		return "Illegal instruction";
+	case CAUSE_BREAKPOINT:
+		return "Breakpoint";
+	case CAUSE_LOAD_MISALIGNED:
+		return "Load address misaligned";
+	case CAUSE_LOAD_ACCESS:
+		return "Load access fault";
+	case CAUSE_STORE_MISALIGNED:
+		return "Store address misaligned";
+	case CAUSE_STORE_ACCESS:
+		return "Store access fault";
+	case CAUSE_USER_ECALL:
+		return "Environment call";
+	case CAUSE_FETCH_PAGE:
+		return "Instruction page fault";
+	case CAUSE_LOAD_PAGE:
+		return "Load page fault";
+	case CAUSE_STORE_PAGE:
+		return "Store page fault";
+	default:
+		return "Unknown trap";
+	}
+}
+
+// The body of proc_run(), keeps the running block in `*cur`
+static int run_blocks(struct proc *proc, uint64_t budget,
+		      struct bblock *volatile *cur)
+{
+	const uint64_t first = proc->instret;
+	struct bblock *blk;
+	uint64_t left;
+	uint32_t n;
+	int ret;
+
+	while (proc->instret - first < budget) {
+		if (proc->thread && thread_poll(proc, &ret))
+			return ret;
+		if (!(*cur = blk = bb_next(proc)))
+			return fetch_trap(proc);
+
+		if (blk->jit) {
+			// Translations can stop early, or loop on their block
+			left = budget - (proc->instret - first);
+			if (proc->thread && left > THREAD_SLICE)
+				left = THREAD_SLICE;
+			n = jit_run(proc, blk, left);
+			proc->instret += n;
+		} else {
+			if (proc->trace)
+				bb_exec_traced(proc, blk);
+			else
+				bb_exec(proc, blk);
+			n = blk->len;
+			proc->instret += n;
+			if (proc->jit && ++blk->execs == JIT_THRESHOLD)
+				jit_compile(proc, blk);
+		}
+		// Unless the translation stopped before the last instruction
+		if (n == blk->len)
+			bb_link(proc, blk);
+		// May free `blk`
+		bb_sync(proc);
+	}
+	return 0;
+}
+
+/*
+ * Executes and records a block of a traced process, which only has one
+ * instruction, see bb_build().
+ */
+static void bb_exec_traced(struct proc *proc, const struct bblock *blk)
+{
+	const struct dinsn *di = blk->insns;
+	// rs1 may be overwritten, e.g. by ld a0, 0(a0)
+	rvaddr_t addr = getreg(proc, di->rs1) + (reg_t)di->imm;
+
+	bb_exec(proc, blk);
+	trace_record(proc->trace, di, getreg(proc, di->rd), addr);
+}
+
+// Number of instructions of `blk` retired before the one at `pc` faulted
+static uint32_t bb_retired(const struct bblock *blk, rvaddr_t pc)
+{
+	uint32_t i;
+
+	for (i = 0; i < blk->len && blk->insns[i].pc != pc; ++i)
+		;
+	return i;
+}
+
+// Turns the memory fault of the instruction at `proc->pc` into its trap
+static void mem_trap(struct proc *proc, const struct bblock *blk)
+{
+	uint32_t i = bb_retired(blk, proc->pc);
+	bool store = i < blk->len && (blk->insns[i].flags & INSN_STORE);
+
+	proc->trap.pending = true;
+	proc->trap.tval = memfault_addr();
+	if (memfault_errno(&proc->mem) == EPERM)
+		proc->trap.cause = store ? CAUSE_STORE_ACCESS :
+				   CAUSE_LOAD_ACCESS;
+	else
+		proc->trap.cause = store ? CAUSE_STORE_PAGE : CAUSE_LOAD_PAGE;
+}
+
+/*
+ * Turns a failed bb_lookup() into the trap of the instruction at `proc->pc`,
+ * if it was one. Returns -1, leaving errno as is.
+ */
+static int fetch_trap(struct proc *proc)
+{
+	insn_t insn = 0;
+
+	switch (errno) {
+	case EINVAL:
+		proc->trap.cause = CAUSE_FETCH_PAGE;
+		proc->trap.tval = proc->pc;
+		break;
+	case EPERM:
+		proc->trap.cause = CAUSE_FETCH_ACCESS;
+		proc->trap.tval = proc->pc;
+		break;
+	case ENOSYS:
+		// It was fetched before it couldn't be decoded
+		insn_fetch(proc, proc->pc, &insn);
+		proc->trap.cause = CAUSE_ILLEGAL_INSN;
+		proc->trap.tval = insn;
+		break;
+	default:
+		return -1;
+	}
+	proc->trap.pending = true;
+	return -1;
+}
+
+// The errno proc_run() reports a trap with
+static int trap_errno(enum trap_cause cause)
+{
+	switch (cause) {
+	case CAUSE_FETCH_PAGE:
+	case CAUSE_LOAD_PAGE:
+	case CAUSE_STORE_PAGE:
+		return EINVAL;
+	case CAUSE_FETCH_ACCESS:
+	case CAUSE_LOAD_ACCESS:
+	case CAUSE_STORE_ACCESS:
+		return EPERM;
+	default:
+		return ENOSYS;
+	}
+}
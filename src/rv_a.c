@@ -0,0 +1,138 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "riscv.h"
+#include "proc.h"
+#include "memory.h"
+#include "debug.h"
+#include "insn.h"
+#include "rv_a.h"
+
+// The host atomics operate on guest words as they are, little-endian
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The A extension needs a little-endian host"
+#endif
+
+static inline rvaddr_t amo_check(struct proc *proc, const struct dinsn *di,
+				 unsigned size, enum trap_cause cause)
+	__attribute__((nonnull));
+
+/*
+ * Handlers replacing the `type` word at rs1 with `op` (an __atomic_fetch_*
+ * builtin) of it and rs2, and setting rd to the old value, sign-extended
+ */
+#define AMO_OP(name, type, op)						\
+void insn_##name(struct proc *proc, const struct dinsn *di)		\
+{									\
+	type *p = memxlate(&proc->mem, amo_check(proc, di, sizeof(type),\
+			   CAUSE_STORE_MISALIGNED), sizeof(type) * 8);	\
+	const type b = (type)getreg(proc, di->rs2);			\
+									\
+	mvreg(proc, di->rd, (reg_t)(ireg_t)op(p, b, __ATOMIC_SEQ_CST));	\
+	dbg_log(#name ": Setting x%d = 0x%lx", di->rd,			\
+		getreg(proc, di->rd));					\
+	insn_next(proc, di);						\
+}
+
+/*
+ * Same for min and max, as a compare-and-swap loop which writes back the old
+ * value `a` if `keep` holds and rs2, `b`, otherwise. The word is written
+ * either way, so that read-only memory faults.
+ */
+#define AMO_CMP(name, type, keep)					\
+void insn_##name(struct proc *proc, const struct dinsn *di)		\
+{									\
+	type *p = memxlate(&proc->mem, amo_check(proc, di, sizeof(type),\
+			   CAUSE_STORE_MISALIGNED), sizeof(type) * 8);	\
+	const type b = (type)getreg(proc, di->rs2);			\
+	type a = __atomic_load_n(p, __ATOMIC_RELAXED);			\
+									\
+	while (!__atomic_compare_exchange_n(p, &a, (keep) ? a : b, true,	\
+	       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))			\
+		;							\
+	mvreg(proc, di->rd, (reg_t)(ireg_t)a);				\
+	dbg_log(#name ": Setting x%d = 0x%lx", di->rd,			\
+		getreg(proc, di->rd));					\
+	insn_next(proc, di);						\
+}
+
+// LR, which reserves the `utype` word at rs1, and SC
+#define LR(name, type, utype)						\
+void insn_##name(struct proc *proc, const struct dinsn *di)		\
+{									\
+	const rvaddr_t addr = amo_check(proc, di, sizeof(type),		\
+					CAUSE_LOAD_MISALIGNED);		\
+	utype val;							\
+									\
+	memload(&proc->mem, addr, &val);				\
+	proc->resv = true;						\
+	proc->resv_addr = addr;						\
+	proc->resv_val = val;						\
+	mvreg(proc, di->rd, (reg_t)(ireg_t)(type)val);			\
+	dbg_log(#name ": Setting x%d = 0x%lx", di->rd,			\
+		getreg(proc, di->rd));					\
+	insn_next(proc, di);						\
+}
+
+#define SC(name, type)							\
+void insn_##name(struct proc *proc, const struct dinsn *di)		\
+{									\
+	const rvaddr_t addr = amo_check(proc, di, sizeof(type),		\
+					CAUSE_STORE_MISALIGNED);	\
+	type *p = memxlate(&proc->mem, addr, sizeof(type) * 8);	\
+	type old = (type)proc->resv_val;				\
+	bool ok = proc->resv && proc->resv_addr == addr &&		\
+		  __atomic_compare_exchange_n(p, &old,			\
+		  (type)getreg(proc, di->rs2), false, __ATOMIC_SEQ_CST,	\
+		  __ATOMIC_SEQ_CST);					\
+									\
+	proc->resv = false;						\
+	mvreg(proc, di->rd, !ok);					\
+	dbg_log(#name ": %s at 0x%lx", ok ? "Stored" : "Failed", addr);	\
+	insn_next(proc, di);						\
+}
+
+LR(lr_w, int32_t, uint32_t)
+SC(sc_w, int32_t)
+AMO_OP(amoswap_w, int32_t, __atomic_exchange_n)
+AMO_OP(amoadd_w, int32_t, __atomic_fetch_add)
+AMO_OP(amoxor_w, int32_t, __atomic_fetch_xor)
+AMO_OP(amoand_w, int32_t, __atomic_fetch_and)
+AMO_OP(amoor_w, int32_t, __atomic_fetch_or)
+AMO_CMP(amomin_w, int32_t, a <= b)
+AMO_CMP(amomax_w, int32_t, a >= b)
+AMO_CMP(amominu_w, int32_t, (uint32_t)a <= (uint32_t)b)
+AMO_CMP(amomaxu_w, int32_t, (uint32_t)a >= (uint32_t)b)
+
+LR(lr_d, int64_t, uint64_t)
+SC(sc_d, int64_t)
+AMO_OP(amoswap_d, int64_t, __atomic_exchange_n)
+AMO_OP(amoadd_d, int64_t, __atomic_fetch_add)
+AMO_OP(amoxor_d, int64_t, __atomic_fetch_xor)
+AMO_OP(amoand_d, int64_t, __atomic_fetch_and)
+AMO_OP(amoor_d, int64_t, __atomic_fetch_or)
+AMO_CMP(amomin_d, int64_t, a <= b)
+AMO_CMP(amomax_d, int64_t, a >= b)
+AMO_CMP(amominu_d, int64_t, (uint64_t)a <= (uint64_t)b)
+AMO_CMP(amomaxu_d, int64_t, (uint64_t)a >= (uint64_t)b)
+
+/*
+ * Returns rs1, the address of an atomic access of `size` bytes, after
+ * pointing the pc at the instruction as ldst_addr() in rv_i.c does. Misaligned
+ * addresses trap with `cause` instead of being emulated, they couldn't be
+ * atomic.
+ */
+static inline rvaddr_t amo_check(struct proc *proc, const struct dinsn *di,
+				 unsigned size, enum trap_cause cause)
+{
+	const rvaddr_t addr = getreg(proc, di->rs1);
+
+	proc->pc = di->pc;
+	if (addr & (size - 1))
+		insn_trap(proc, di, cause, addr);
+	return addr;
+}
+
+#undef AMO_OP
+#undef AMO_CMP
+#undef LR
+#undef SC
@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include "riscv.h"
+#include "proc.h"
+#include "debug.h"
+#include "insn.h"
+#include "rv_b.h"
+
+/*
+ * Baseline x86-64 has none of lzcnt, tzcnt and popcnt, the counting handlers
+ * are also built for x86-64-v3 hosts, which have all of them, and the dynamic
+ * linker picks once
+ */
+#ifdef __x86_64__
+#define CLONES __attribute__((target_clones("arch=x86-64-v3", "default")))
+#else
+#define CLONES
+#endif
+
+// Bytes of a register with their high bit clear
+#define LOW7 UINT64_C(0x7f7f7f7f7f7f7f7f)
+
+/*
+ * Handlers setting rd to `expr`, which reads rs1 as `a`, and rs2 as `b` or
+ * the shift amount as `sh`
+ */
+#define B_OP(name, attr, expr)						\
+attr void insn_##name(struct proc *proc, const struct dinsn *di)	\
+{									\
+	const reg_t a = getreg(proc, di->rs1);				\
+	const reg_t b = getreg(proc, di->rs2);				\
+									\
+	mvreg(proc, di->rd, (expr));					\
+	dbg_log(#name ": Setting x%d = 0x%lx", di->rd,			\
+		getreg(proc, di->rd));					\
+	insn_next(proc, di);						\
+}
+
+#define B_UNOP(name, attr, expr)					\
+attr void insn_##name(struct proc *proc, const struct dinsn *di)	\
+{									\
+	const reg_t a = getreg(proc, di->rs1);				\
+									\
+	mvreg(proc, di->rd, (expr));					\
+	dbg_log(#name ": Setting x%d = 0x%lx", di->rd,			\
+		getreg(proc, di->rd));					\
+	insn_next(proc, di);						\
+}
+
+#define B_IMMOP(name, expr)						\
+void insn_##name(struct proc *proc, const struct dinsn *di)		\
+{									\
+	const reg_t a = getreg(proc, di->rs1);				\
+	const unsigned sh = (unsigned)di->imm;				\
+									\
+	mvreg(proc, di->rd, (expr));					\
+	dbg_log(#name ": Setting x%d = 0x%lx", di->rd,			\
+		getreg(proc, di->rd));					\
+	insn_next(proc, di);						\
+}
+
+// Sign-extends the low 32 bits of `val`, as *W instructions do
+#define SEXT32(val) ((reg_t)(ireg_t)(int32_t)(uint32_t)(val))
+
+// Rotates, which compilers turn into the host's
+#define ROR64(x, n) ((x) >> ((n) & 63) | (x) << (-(n) & 63))
+#define ROR32(x, n) ((x) >> ((n) & 31) | (x) << (-(n) & 31))
+
+// Zba
+B_OP(sh1add, , (a << 1) + b)
+B_OP(sh2add, , (a << 2) + b)
+B_OP(sh3add, , (a << 3) + b)
+B_OP(add_uw, , (reg_t)(uint32_t)a + b)
+B_OP(sh1add_uw, , ((reg_t)(uint32_t)a << 1) + b)
+B_OP(sh2add_uw, , ((reg_t)(uint32_t)a << 2) + b)
+B_OP(sh3add_uw, , ((reg_t)(uint32_t)a << 3) + b)
+B_IMMOP(slli_uw, (reg_t)(uint32_t)a << sh)
+
+// Zbb
+B_OP(andn, , a & ~b)
+B_OP(orn, , a | ~b)
+B_OP(xnor, , ~(a ^ b))
+B_UNOP(clz, CLONES, a ? (reg_t)__builtin_clzll(a) : 64)
+B_UNOP(ctz, CLONES, a ? (reg_t)__builtin_ctzll(a) : 64)
+B_UNOP(cpop, CLONES, (reg_t)__builtin_popcountll(a))
+B_UNOP(clzw, CLONES,
+       (uint32_t)a ? (reg_t)__builtin_clz((uint32_t)a) : 32)
+B_UNOP(ctzw, CLONES,
+       (uint32_t)a ? (reg_t)__builtin_ctz((uint32_t)a) : 32)
+B_UNOP(cpopw, CLONES, (reg_t)__builtin_popcount((uint32_t)a))
+B_OP(max, , (ireg_t)a > (ireg_t)b ? a : b)
+B_OP(maxu, , a > b ? a : b)
+B_OP(min, , (ireg_t)a < (ireg_t)b ? a : b)
+B_OP(minu, , a < b ? a : b)
+B_UNOP(sext_b, , (reg_t)(ireg_t)(int8_t)a)
+B_UNOP(sext_h, , (reg_t)(ireg_t)(int16_t)a)
+B_UNOP(zext_h, , (uint16_t)a)
+B_OP(rol, , ROR64(a, -b))
+B_OP(ror, , ROR64(a, b))
+B_IMMOP(rori, ROR64(a, sh))
+B_OP(rolw, , SEXT32(ROR32((uint32_t)a, -(uint32_t)b)))
+B_OP(rorw, , SEXT32(ROR32((uint32_t)a, (uint32_t)b)))
+B_IMMOP(roriw, SEXT32(ROR32((uint32_t)a, sh)))
+// Sets the high bit of non-zero bytes, then spreads it to the whole byte
+B_UNOP(orc_b, , (((((a & LOW7) + LOW7) | a) & ~LOW7) >> 7) * 0xff)
+B_UNOP(rev8, , __builtin_bswap64(a))
+
+// Zbs
+B_OP(bclr, , a & ~((reg_t)1 << (b & 63)))
+B_IMMOP(bclri, a & ~((reg_t)1 << sh))
+B_OP(bext, , (a >> (b & 63)) & 1)
+B_IMMOP(bexti, (a >> sh) & 1)
+B_OP(binv, , a ^ (reg_t)1 << (b & 63))
+B_IMMOP(binvi, a ^ (reg_t)1 << sh)
+B_OP(bset, , a | (reg_t)1 << (b & 63))
+B_IMMOP(bseti, a | (reg_t)1 << sh)
+
+#undef CLONES
+#undef LOW7
+#undef B_OP
+#undef B_UNOP
+#undef B_IMMOP
+#undef SEXT32
+#undef ROR64
+#undef ROR32
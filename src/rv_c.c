@@ -0,0 +1,226 @@
+#include <stdint.h>
+#include "riscv.h"
+#include "insn.h"
+#include "rv_c.h"
+
+static inline int32_t sext(uint32_t val, unsigned bits);
+static inline insn_t enc_r(insn_t match, unsigned rd, unsigned rs1,
+			   unsigned rs2);
+static inline insn_t enc_i(insn_t match, unsigned rd, unsigned rs1,
+			   int32_t imm);
+static inline insn_t enc_s(insn_t match, unsigned rs1, unsigned rs2,
+			   int32_t imm);
+static inline insn_t enc_b(insn_t match, unsigned rs1, unsigned rs2,
+			   int32_t imm);
+static inline insn_t enc_u(insn_t match, unsigned rd, int32_t imm);
+static inline insn_t enc_j(insn_t match, unsigned rd, int32_t imm);
+
+/*
+ * Bits `hi` to `lo` of the compressed instruction `c`, moved to bit `to`, the
+ * immediates are scattered around the instruction
+ */
+#define CBITS(hi, lo, to)						\
+	(((c >> (lo)) & ((1u << ((hi) - (lo) + 1)) - 1)) << (to))
+
+// Register fields, the primed ones (3 bits wide) name x8 to x15
+#define C_RD (c >> 7 & 0x1f)
+#define C_RS2 (c >> 2 & 0x1f)
+#define C_RS1P (8 + (c >> 7 & 0x7))
+#define C_RS2P (8 + (c >> 2 & 0x7))
+
+// Quadrant (low 2 bits) and funct3 of a compressed instruction
+#define C_OP(quadrant, funct3) ((quadrant) | (funct3) << 2)
+
+insn_t rvc_expand(uint16_t cinsn)
+{
+	const uint32_t c = cinsn;
+	// 6-bit immediate of the CI format
+	const int32_t imm6 = sext(CBITS(12, 12, 5) | CBITS(6, 2, 0), 6);
+	const unsigned shamt = CBITS(12, 12, 5) | CBITS(6, 2, 0);
+	uint32_t uimm;
+	int32_t imm;
+
+	switch (C_OP(c & 0x3, c >> 13)) {
+	case C_OP(0, 0): // c.addi4spn, all zeroes is the illegal instruction
+		uimm = CBITS(12, 11, 4) | CBITS(10, 7, 6) | CBITS(6, 6, 2) |
+		       CBITS(5, 5, 3);
+		if (uimm == 0)
+			return 0;
+		return enc_i(MATCH_ADDI, C_RS2P, 2, (int32_t)uimm);
+	case C_OP(0, 1): // c.fld
+		uimm = CBITS(12, 10, 3) | CBITS(6, 5, 6);
+		return enc_i(MATCH_FLD, C_RS2P, C_RS1P, (int32_t)uimm);
+	case C_OP(0, 2): // c.lw
+		uimm = CBITS(12, 10, 3) | CBITS(6, 6, 2) | CBITS(5, 5, 6);
+		return enc_i(MATCH_LW, C_RS2P, C_RS1P, (int32_t)uimm);
+	case C_OP(0, 3): // c.ld
+		uimm = CBITS(12, 10, 3) | CBITS(6, 5, 6);
+		return enc_i(MATCH_LD, C_RS2P, C_RS1P, (int32_t)uimm);
+	case C_OP(0, 5): // c.fsd
+		uimm = CBITS(12, 10, 3) | CBITS(6, 5, 6);
+		return enc_s(MATCH_FSD, C_RS1P, C_RS2P, (int32_t)uimm);
+	case C_OP(0, 6): // c.sw
+		uimm = CBITS(12, 10, 3) | CBITS(6, 6, 2) | CBITS(5, 5, 6);
+		return enc_s(MATCH_SW, C_RS1P, C_RS2P, (int32_t)uimm);
+	case C_OP(0, 7): // c.sd
+		uimm = CBITS(12, 10, 3) | CBITS(6, 5, 6);
+		return enc_s(MATCH_SD, C_RS1P, C_RS2P, (int32_t)uimm);
+
+	case C_OP(1, 0): // c.addi, c.nop
+		return enc_i(MATCH_ADDI, C_RD, C_RD, imm6);
+	case C_OP(1, 1): // c.addiw
+		if (C_RD == 0)
+			return 0;
+		return enc_i(MATCH_ADDIW, C_RD, C_RD, imm6);
+	case C_OP(1, 2): // c.li
+		return enc_i(MATCH_ADDI, C_RD, 0, imm6);
+	case C_OP(1, 3):
+		if (C_RD == 2) { // c.addi16sp
+			imm = sext(CBITS(12, 12, 9) | CBITS(6, 6, 4) |
+				   CBITS(5, 5, 6) | CBITS(4, 3, 7) |
+				   CBITS(2, 2, 5), 10);
+			if (imm == 0)
+				return 0;
+			return enc_i(MATCH_ADDI, 2, 2, imm);
+		}
+		// c.lui
+		imm = sext(CBITS(12, 12, 17) | CBITS(6, 2, 12), 18);
+		if (imm == 0)
+			return 0;
+		return enc_u(MATCH_LUI, C_RD, imm);
+	case C_OP(1, 4):
+		switch (c >> 10 & 0x3) {
+		case 0: // c.srli
+			return enc_i(MATCH_SRLI, C_RS1P, C_RS1P, (int32_t)shamt);
+		case 1: // c.srai
+			return enc_i(MATCH_SRAI, C_RS1P, C_RS1P, (int32_t)shamt);
+		case 2: // c.andi
+			return enc_i(MATCH_ANDI, C_RS1P, C_RS1P, imm6);
+		}
+		switch ((c >> 12 & 0x1) << 2 | (c >> 5 & 0x3)) {
+		case 0: // c.sub
+			return enc_r(MATCH_SUB, C_RS1P, C_RS1P, C_RS2P);
+		case 1: // c.xor
+			return enc_r(MATCH_XOR, C_RS1P, C_RS1P, C_RS2P);
+		case 2: // c.or
+			return enc_r(MATCH_OR, C_RS1P, C_RS1P, C_RS2P);
+		case 3: // c.and
+			return enc_r(MATCH_AND, C_RS1P, C_RS1P, C_RS2P);
+		case 4: // c.subw
+			return enc_r(MATCH_SUBW, C_RS1P, C_RS1P, C_RS2P);
+		case 5: // c.addw
+			return enc_r(MATCH_ADDW, C_RS1P, C_RS1P, C_RS2P);
+		}
+		return 0;
+	case C_OP(1, 5): // c.j
+		imm = sext(CBITS(12, 12, 11) | CBITS(11, 11, 4) |
+			   CBITS(10, 9, 8) | CBITS(8, 8, 10) | CBITS(7, 7, 6) |
+			   CBITS(6, 6, 7) | CBITS(5, 3, 1) | CBITS(2, 2, 5), 12);
+		return enc_j(MATCH_JAL, 0, imm);
+	case C_OP(1, 6): // c.beqz
+	case C_OP(1, 7): // c.bnez
+		imm = sext(CBITS(12, 12, 8) | CBITS(11, 10, 3) |
+			   CBITS(6, 5, 6) | CBITS(4, 3, 1) | CBITS(2, 2, 5), 9);
+		return enc_b(c >> 13 == 6 ? MATCH_BEQ : MATCH_BNE, C_RS1P, 0,
+			     imm);
+
+	case C_OP(2, 0): // c.slli
+		return enc_i(MATCH_SLLI, C_RD, C_RD, (int32_t)shamt);
+	case C_OP(2, 1): // c.fldsp
+		uimm = CBITS(12, 12, 5) | CBITS(6, 5, 3) | CBITS(4, 2, 6);
+		return enc_i(MATCH_FLD, C_RD, 2, (int32_t)uimm);
+	case C_OP(2, 2): // c.lwsp
+		if (C_RD == 0)
+			return 0;
+		uimm = CBITS(12, 12, 5) | CBITS(6, 4, 2) | CBITS(3, 2, 6);
+		return enc_i(MATCH_LW, C_RD, 2, (int32_t)uimm);
+	case C_OP(2, 3): // c.ldsp
+		if (C_RD == 0)
+			return 0;
+		uimm = CBITS(12, 12, 5) | CBITS(6, 5, 3) | CBITS(4, 2, 6);
+		return enc_i(MATCH_LD, C_RD, 2, (int32_t)uimm);
+	case C_OP(2, 4):
+		if (!(c >> 12 & 0x1)) {
+			if (C_RS2 != 0) // c.mv
+				return enc_r(MATCH_ADD, C_RD, 0, C_RS2);
+			if (C_RD == 0)
+				return 0;
+			// c.jr
+			return enc_i(MATCH_JALR, 0, C_RD, 0);
+		}
+		if (C_RS2 != 0) // c.add
+			return enc_r(MATCH_ADD, C_RD, C_RD, C_RS2);
+		if (C_RD == 0) // c.ebreak
+			return MATCH_EBREAK;
+		// c.jalr
+		return enc_i(MATCH_JALR, 1, C_RD, 0);
+	case C_OP(2, 5): // c.fsdsp
+		uimm = CBITS(12, 10, 3) | CBITS(9, 7, 6);
+		return enc_s(MATCH_FSD, 2, C_RS2, (int32_t)uimm);
+	case C_OP(2, 6): // c.swsp
+		uimm = CBITS(12, 9, 2) | CBITS(8, 7, 6);
+		return enc_s(MATCH_SW, 2, C_RS2, (int32_t)uimm);
+	case C_OP(2, 7): // c.sdsp
+		uimm = CBITS(12, 10, 3) | CBITS(9, 7, 6);
+		return enc_s(MATCH_SD, 2, C_RS2, (int32_t)uimm);
+	}
+	// Reserved, or not compressed at all
+	return 0;
+}
+
+// Sign-extends the low `bits` bits of `val`
+static inline int32_t sext(uint32_t val, unsigned bits)
+{
+	return (int32_t)(val << (32 - bits)) >> (32 - bits);
+}
+
+static inline insn_t enc_r(insn_t match, unsigned rd, unsigned rs1,
+			   unsigned rs2)
+{
+	return match | rs2 << 20 | rs1 << 15 | rd << 7;
+}
+
+static inline insn_t enc_i(insn_t match, unsigned rd, unsigned rs1,
+			   int32_t imm)
+{
+	return match | (insn_t)imm << 20 | rs1 << 15 | rd << 7;
+}
+
+static inline insn_t enc_s(insn_t match, unsigned rs1, unsigned rs2,
+			   int32_t imm)
+{
+	const insn_t u = (insn_t)imm;
+
+	return match | (u >> 5 & 0x7f) << 25 | rs2 << 20 | rs1 << 15 |
+	       (u & 0x1f) << 7;
+}
+
+static inline insn_t enc_b(insn_t match, unsigned rs1, unsigned rs2,
+			   int32_t imm)
+{
+	const insn_t u = (insn_t)imm;
+
+	return match | (u >> 12 & 0x1) << 31 | (u >> 5 & 0x3f) << 25 |
+	       rs2 << 20 | rs1 << 15 | (u >> 1 & 0xf) << 8 |
+	       (u >> 11 & 0x1) << 7;
+}
+
+static inline insn_t enc_u(insn_t match, unsigned rd, int32_t imm)
+{
+	return match | ((insn_t)imm & 0xfffff000) | rd << 7;
+}
+
+static inline insn_t enc_j(insn_t match, unsigned rd, int32_t imm)
+{
+	const insn_t u = (insn_t)imm;
+
+	return match | (u >> 20 & 0x1) << 31 | (u >> 1 & 0x3ff) << 21 |
+	       (u >> 11 & 0x1) << 20 | (u >> 12 & 0xff) << 12 | rd << 7;
+}
+
+#undef CBITS
+#undef C_RD
+#undef C_RS2
+#undef C_RS1P
+#undef C_RS2P
+#undef C_OP
@@ -0,0 +1,648 @@
+#include <fenv.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "riscv.h"
+#include "proc.h"
+#include "memory.h"
+#include "debug.h"
+#include "insn.h"
+#include "rv_f.h"
+
+// Rounding modes, of the rm field and frm
+enum fp_rm {
+	RM_RNE=0,
+	RM_RTZ=1,
+	RM_RDN=2,
+	RM_RUP=3,
+	RM_RMM=4,
+	RM_DYN=7, // frm, only valid in rm
+};
+
+// Exception flags, of fflags
+enum fp_flag {
+	FF_NX=0x01,
+	FF_UF=0x02,
+	FF_OF=0x04,
+	FF_DZ=0x08,
+	FF_NV=0x10,
+};
+
+// Integer types of conversions, the rs2 field of fcvt
+enum fp_int {
+	FI_W=0,
+	FI_WU=1,
+	FI_L=2,
+	FI_LU=3,
+};
+
+// What fclass gives for signaling NaNs
+#define FCLASS_SNAN (1 << 8)
+
+// Upper half of NaN-boxed floats, and the canonical NaN of floats
+#define NANBOX UINT64_C(0xffffffff00000000)
+#define NAN_S UINT32_C(0x7fc00000)
+
+// Fields of the instructions that insn_predecode() doesn't extract
+#define RS3(di) ((uint8_t)((di)->insn >> 27))
+#define RM(di) (((di)->insn >> 12) & 0x7)
+
+/*
+ * Keeps `x` from being computed past the next function call, as the compiler
+ * doesn't know that fesetround() changes how it is
+ */
+#define FP_BARRIER(x) __asm__ volatile("" : "+g"(x))
+
+/*
+ * Sets `res` to `expr` evaluated in the rounding mode of the instruction
+ * `di`. The host is already in that of frm, which instructions nearly always
+ * use, others switch it to theirs around `expr`. Operands must be read in
+ * `expr` so that they aren't before the switch.
+ */
+#define FP_EVAL(proc, di, res, expr) do {				\
+	const int mode_ = fp_modes[fp_rm(proc, di)];			\
+									\
+	if (__builtin_expect(mode_ == (proc)->f.mode, 1)) {		\
+		(res) = (expr);						\
+	} else {							\
+		fesetround(mode_);					\
+		(res) = (expr);						\
+		FP_BARRIER(res);					\
+		fesetround((proc)->f.mode);				\
+	}								\
+} while (0)
+
+// Host rounding modes of enum fp_rm, which has no RMM
+static const int fp_modes[RM_RMM + 1] = {
+	[RM_RNE] = FE_TONEAREST,
+	[RM_RTZ] = FE_TOWARDZERO,
+	[RM_RDN] = FE_DOWNWARD,
+	[RM_RUP] = FE_UPWARD,
+	[RM_RMM] = FE_TONEAREST,
+};
+
+// Ranges of enum fp_int, and what out of range values convert to
+static const struct {
+	double lo; // The smallest integer in range
+	double end; // Past the largest
+	reg_t min;
+	reg_t max; // Also for NaNs
+} fp_ints[] = {
+	[FI_W] = {-0x1p31, 0x1p31, (reg_t)INT32_MIN, INT32_MAX},
+	[FI_WU] = {0, 0x1p32, 0, UINT64_MAX},
+	[FI_L] = {-0x1p63, 0x1p63, (reg_t)INT64_MIN, INT64_MAX},
+	[FI_LU] = {0, 0x1p64, 0, UINT64_MAX},
+};
+
+static inline unsigned fp_rm(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+static inline rvaddr_t fp_addr(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+static inline uint32_t fbits_s(const struct proc *proc, uint8_t r)
+	__attribute__((nonnull));
+static inline uint64_t fbits_d(const struct proc *proc, uint8_t r)
+	__attribute__((nonnull));
+static inline void setbits_s(struct proc *proc, uint8_t r, uint32_t bits)
+	__attribute__((nonnull));
+static inline void setbits_d(struct proc *proc, uint8_t r, uint64_t bits)
+	__attribute__((nonnull));
+static inline float getf_s(const struct proc *proc, uint8_t r)
+	__attribute__((nonnull));
+static inline double getf_d(const struct proc *proc, uint8_t r)
+	__attribute__((nonnull));
+static inline void setf_s(struct proc *proc, uint8_t r, float val)
+	__attribute__((nonnull));
+static inline void setf_d(struct proc *proc, uint8_t r, double val)
+	__attribute__((nonnull));
+static inline float canon_s(float val);
+static inline double canon_d(double val);
+static uint8_t fp_host_flags(void);
+static reg_t fp_toint(struct proc *proc, double x, unsigned rm,
+		      enum fp_int type) __attribute__((nonnull));
+static reg_t fp_class(uint64_t bits, unsigned expbits, unsigned manbits);
+static double fp_trunc(double x);
+static inline bool fp_fma_invalid(double a, double b);
+
+/*
+ * The rounding mode of the instruction `di`, its rm field or frm, traps if
+ * it is reserved
+ */
+static inline unsigned fp_rm(struct proc *proc, const struct dinsn *di)
+{
+	unsigned rm = RM(di);
+
+	if (rm == RM_DYN)
+		rm = proc->f.frm;
+	if (__builtin_expect(rm > RM_RMM, 0))
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	return rm;
+}
+
+// The effective address of loads and stores, as ldst_addr() in rv_i.c
+static inline rvaddr_t fp_addr(struct proc *proc, const struct dinsn *di)
+{
+	proc->pc = di->pc;
+	return getreg(proc, di->rs1) + (reg_t)di->imm;
+}
+
+// Register fN as a float, the canonical NaN if it isn't NaN-boxed
+static inline uint32_t fbits_s(const struct proc *proc, uint8_t r)
+{
+	uint64_t bits = proc->f.regs[r];
+	uint32_t res = (bits & NANBOX) == NANBOX ? (uint32_t)bits : NAN_S;
+
+	// Or the compiler folds operations on the constant, e.g. to compare it
+	// without raising invalid
+	__asm__("" : "+r"(res));
+	return res;
+}
+
+static inline uint64_t fbits_d(const struct proc *proc, uint8_t r)
+{
+	return proc->f.regs[r];
+}
+
+static inline void setbits_s(struct proc *proc, uint8_t r, uint32_t bits)
+{
+	proc->f.regs[r] = NANBOX | bits;
+}
+
+static inline void setbits_d(struct proc *proc, uint8_t r, uint64_t bits)
+{
+	proc->f.regs[r] = bits;
+}
+
+static inline float getf_s(const struct proc *proc, uint8_t r)
+{
+	uint32_t bits = fbits_s(proc, r);
+	float val;
+
+	memcpy(&val, &bits, sizeof(val));
+	return val;
+}
+
+static inline double getf_d(const struct proc *proc, uint8_t r)
+{
+	double val;
+
+	memcpy(&val, &proc->f.regs[r], sizeof(val));
+	return val;
+}
+
+static inline void setf_s(struct proc *proc, uint8_t r, float val)
+{
+	uint32_t bits;
+
+	memcpy(&bits, &val, sizeof(bits));
+	setbits_s(proc, r, bits);
+}
+
+static inline void setf_d(struct proc *proc, uint8_t r, double val)
+{
+	memcpy(&proc->f.regs[r], &val, sizeof(val));
+}
+
+/*
+ * The canonical NaN if `val` is a NaN, the host's have a sign and keep the
+ * payload of operands
+ */
+static inline float canon_s(float val)
+{
+	return isnan(val) ? NAN : val;
+}
+
+static inline double canon_d(double val)
+{
+	return isnan(val) ? (double)NAN : val;
+}
+
+// Exception flags the host accrued, as in fflags
+static uint8_t fp_host_flags(void)
+{
+	int ex = fetestexcept(FE_ALL_EXCEPT);
+
+	return (uint8_t)((ex & FE_INEXACT ? FF_NX : 0)	|
+			 (ex & FE_UNDERFLOW ? FF_UF : 0)	|
+			 (ex & FE_OVERFLOW ? FF_OF : 0)	|
+			 (ex & FE_DIVBYZERO ? FF_DZ : 0)	|
+			 (ex & FE_INVALID ? FF_NV : 0));
+}
+
+/*
+ * Converts `x` to an integer of type `type` rounded by `rm`, as
+ * fcvt.{w,wu,l,lu}.* do: NaNs and values out of range raise invalid and give
+ * the bound nearest to them, or the largest integer for NaNs, others that
+ * weren't integers raise inexact. 32 bits results are sign-extended. Floats
+ * convert exactly to doubles, so they come through here too.
+ */
+static reg_t fp_toint(struct proc *proc, double x, unsigned rm,
+		      enum fp_int type)
+{
+	double r;
+
+	if (isnan(x)) {
+		proc->f.fflags |= FF_NV;
+		return fp_ints[type].max;
+	}
+
+	switch (rm) {
+	case RM_RNE:
+		r = roundeven(x);
+		break;
+	case RM_RTZ:
+		r = fp_trunc(x);
+		break;
+	case RM_RDN:
+		r = fp_trunc(x);
+		r -= r > x;
+		break;
+	case RM_RUP:
+		r = fp_trunc(x);
+		r += r < x;
+		break;
+	default:
+		r = round(x);
+		break;
+	}
+
+	if (r < fp_ints[type].lo) {
+		proc->f.fflags |= FF_NV;
+		return fp_ints[type].min;
+	} else if (r >= fp_ints[type].end) {
+		proc->f.fflags |= FF_NV;
+		return fp_ints[type].max;
+	}
+	if (r != x)
+		proc->f.fflags |= FF_NX;
+
+	switch (type) {
+	case FI_WU:
+		return (reg_t)(int64_t)(int32_t)(uint32_t)r;
+	case FI_LU:
+		return (reg_t)r;
+	default:
+		return (reg_t)(int64_t)r;
+	}
+}
+
+/*
+ * trunc() without raising inexact, which the host's does without SSE4.1 and
+ * would for values out of range. Adjusted by one it gives floor() and ceil()
+ * as exactly, fractional values are below 2^52.
+ */
+static double fp_trunc(double x)
+{
+	uint64_t bits;
+	int exp;
+
+	memcpy(&bits, &x, sizeof(bits));
+	exp = (int)((bits >> 52) & 0x7ff) - 1023;
+	if (exp < 0)
+		bits &= UINT64_C(1) << 63;
+	else if (exp < 52)
+		bits &= ~((UINT64_C(1) << (52 - exp)) - 1);
+	memcpy(&x, &bits, sizeof(x));
+	return x;
+}
+
+/*
+ * If multiplying `a` and `b` is invalid, which fused multiply-adds must raise
+ * even when the addend is a quiet NaN and the host's don't
+ */
+static inline bool fp_fma_invalid(double a, double b)
+{
+	return (isinf(a) && b == 0) || (isinf(b) && a == 0);
+}
+
+/*
+ * The fclass mask of a float or double, from its bits, without raising
+ * invalid for signaling NaNs as comparisons would
+ */
+static reg_t fp_class(uint64_t bits, unsigned expbits, unsigned manbits)
+{
+	const uint64_t expmax = (UINT64_C(1) << expbits) - 1;
+	const uint64_t exp = (bits >> manbits) & expmax;
+	const uint64_t man = bits & ((UINT64_C(1) << manbits) - 1);
+	const bool neg = (bits >> (expbits + manbits)) & 1;
+
+	if (exp == expmax) {
+		if (man == 0)
+			return neg ? 1 << 0 : 1 << 7;
+		// The quiet bit is the top one of the significand
+		return man >> (manbits - 1) ? 1 << 9 : FCLASS_SNAN;
+	}
+	if (exp == 0)
+		return man == 0 ? (neg ? 1 << 3 : 1 << 4) :
+				  (neg ? 1 << 2 : 1 << 5);
+	return neg ? 1 << 1 : 1 << 6;
+}
+
+void fp_init(struct proc *proc, reg_t fcsr)
+{
+	memset(&proc->f, 0, sizeof(proc->f));
+	proc->f.frm = (fcsr >> FCSR_FRM_SHIFT) & FCSR_FRM;
+	proc->f.fflags = fcsr & FCSR_FFLAGS;
+	proc->f.mode = proc->f.frm <= RM_RMM ? fp_modes[proc->f.frm] :
+		       FE_TONEAREST;
+}
+
+void fp_enter(struct proc *proc)
+{
+	feclearexcept(FE_ALL_EXCEPT);
+	if (proc->f.mode != FE_TONEAREST)
+		fesetround(proc->f.mode);
+}
+
+void fp_leave(struct proc *proc)
+{
+	proc->f.fflags |= fp_host_flags();
+	feclearexcept(FE_ALL_EXCEPT);
+	if (proc->f.mode != FE_TONEAREST)
+		fesetround(FE_TONEAREST);
+}
+
+reg_t fp_fcsr(struct proc *proc)
+{
+	proc->f.fflags |= fp_host_flags();
+	return (reg_t)proc->f.frm << FCSR_FRM_SHIFT | proc->f.fflags;
+}
+
+void fp_set_fcsr(struct proc *proc, reg_t fcsr)
+{
+	const uint8_t frm = (fcsr >> FCSR_FRM_SHIFT) & FCSR_FRM;
+	// frm may hold reserved modes, instructions that use them trap
+	const int mode = frm <= RM_RMM ? fp_modes[frm] : FE_TONEAREST;
+
+	feclearexcept(FE_ALL_EXCEPT);
+	proc->f.fflags = fcsr & FCSR_FFLAGS;
+	proc->f.frm = frm;
+	if (mode != proc->f.mode) {
+		fesetround(mode);
+		proc->f.mode = mode;
+	}
+}
+
+void insn_flw(struct proc *proc, const struct dinsn *di)
+{
+	uint32_t val;
+
+	memload(&proc->mem, fp_addr(proc, di), &val);
+	setbits_s(proc, di->rd, val);
+	dbg_log("flw: Setting f%d = 0x%lx", di->rd, proc->f.regs[di->rd]);
+	insn_next(proc, di);
+}
+
+void insn_fld(struct proc *proc, const struct dinsn *di)
+{
+	uint64_t val;
+
+	memload(&proc->mem, fp_addr(proc, di), &val);
+	setbits_d(proc, di->rd, val);
+	dbg_log("fld: Setting f%d = 0x%lx", di->rd, proc->f.regs[di->rd]);
+	insn_next(proc, di);
+}
+
+// Stores the low half as is, NaN-boxed or not
+void insn_fsw(struct proc *proc, const struct dinsn *di)
+{
+	uint32_t val = (uint32_t)proc->f.regs[di->rs2];
+
+	memstore(&proc->mem, fp_addr(proc, di), &val);
+	dbg_log("fsw: Storing f%d at 0x%lx", di->rs2, fp_addr(proc, di));
+	insn_next(proc, di);
+}
+
+void insn_fsd(struct proc *proc, const struct dinsn *di)
+{
+	uint64_t val = proc->f.regs[di->rs2];
+
+	memstore(&proc->mem, fp_addr(proc, di), &val);
+	dbg_log("fsd: Storing f%d at 0x%lx", di->rs2, fp_addr(proc, di));
+	insn_next(proc, di);
+}
+
+/*
+ * The handlers of both precisions, `P` is s or d, `T` float or double and
+ * `U` the unsigned integer of the same size
+ */
+#define FP_LOG(name, P, di)						\
+	dbg_log(#name "." #P ": Setting f%d = 0x%lx", (di)->rd,		\
+		proc->f.regs[(di)->rd])
+
+#define FP_ARITH(name, P, T, op)					\
+void insn_##name##_##P(struct proc *proc, const struct dinsn *di)	\
+{									\
+	T res;								\
+									\
+	FP_EVAL(proc, di, res, getf_##P(proc, di->rs1) op		\
+			       getf_##P(proc, di->rs2));		\
+	setf_##P(proc, di->rd, canon_##P(res));				\
+	FP_LOG(name, P, di);						\
+	insn_next(proc, di);						\
+}
+
+#define FP_SQRT(P, T, fn)						\
+void insn_fsqrt_##P(struct proc *proc, const struct dinsn *di)		\
+{									\
+	T res;								\
+									\
+	FP_EVAL(proc, di, res, fn(getf_##P(proc, di->rs1)));		\
+	setf_##P(proc, di->rd, canon_##P(res));				\
+	FP_LOG(fsqrt, P, di);						\
+	insn_next(proc, di);						\
+}
+
+// Negating operands is exact, unlike negating the result in every mode
+#define FP_FMA(name, P, T, fn, sa, sc)					\
+void insn_##name##_##P(struct proc *proc, const struct dinsn *di)	\
+{									\
+	T res;								\
+									\
+	FP_EVAL(proc, di, res, fn(sa getf_##P(proc, di->rs1),		\
+				  getf_##P(proc, di->rs2),		\
+				  sc getf_##P(proc, RS3(di))));		\
+	if (__builtin_expect(isnan(res), 0) &&				\
+	    fp_fma_invalid(getf_##P(proc, di->rs1),			\
+			   getf_##P(proc, di->rs2)))			\
+		proc->f.fflags |= FF_NV;				\
+	setf_##P(proc, di->rd, canon_##P(res));				\
+	FP_LOG(name, P, di);						\
+	insn_next(proc, di);						\
+}
+
+/*
+ * Minimum and maximum numbers of IEEE 754-2019, a single NaN operand is
+ * ignored and -0 is below +0. `neg` tells which of two zeros to pick.
+ */
+#define FP_MINMAX(name, P, T, op, neg, expbits, manbits)		\
+void insn_##name##_##P(struct proc *proc, const struct dinsn *di)	\
+{									\
+	T a = getf_##P(proc, di->rs1);					\
+	T b = getf_##P(proc, di->rs2);					\
+	T res;								\
+									\
+	if (fp_class(fbits_##P(proc, di->rs1), expbits, manbits) ==	\
+	    FCLASS_SNAN ||						\
+	    fp_class(fbits_##P(proc, di->rs2), expbits, manbits) ==	\
+	    FCLASS_SNAN)						\
+		proc->f.fflags |= FF_NV;				\
+	if (isnan(a))							\
+		res = canon_##P(b);					\
+	else if (isnan(b))						\
+		res = a;						\
+	else if (a == b)						\
+		res = !signbit(a) == !(neg) ? a : b;			\
+	else								\
+		res = a op b ? a : b;					\
+	setf_##P(proc, di->rd, res);					\
+	FP_LOG(name, P, di);						\
+	insn_next(proc, di);						\
+}
+
+#define FP_SGNJ(name, P, U, expr)					\
+void insn_##name##_##P(struct proc *proc, const struct dinsn *di)	\
+{									\
+	const U sign = (U)1 << (sizeof(U) * 8 - 1);			\
+	U a = fbits_##P(proc, di->rs1);					\
+	U b = fbits_##P(proc, di->rs2);					\
+									\
+	setbits_##P(proc, di->rd, (U)((a & ~sign) | (expr)));		\
+	FP_LOG(name, P, di);						\
+	insn_next(proc, di);						\
+}
+
+/*
+ * feq is a quiet comparison and flt and fle signaling ones, as == and < or
+ * <= are on the host
+ */
+#define FP_CMP(name, P, op)						\
+void insn_##name##_##P(struct proc *proc, const struct dinsn *di)	\
+{									\
+	mvreg(proc, di->rd, (reg_t)(getf_##P(proc, di->rs1) op		\
+				    getf_##P(proc, di->rs2)));		\
+	dbg_log(#name "." #P ": Setting x%d = %lu", di->rd,		\
+		getreg(proc, di->rd));					\
+	insn_next(proc, di);						\
+}
+
+#define FP_CLASS(P, expbits, manbits)					\
+void insn_fclass_##P(struct proc *proc, const struct dinsn *di)		\
+{									\
+	mvreg(proc, di->rd, fp_class(fbits_##P(proc, di->rs1), expbits,	\
+				     manbits));				\
+	dbg_log("fclass." #P ": Setting x%d = 0x%lx", di->rd,		\
+		getreg(proc, di->rd));					\
+	insn_next(proc, di);						\
+}
+
+#define FP_TOINT(it, P, type)						\
+void insn_fcvt_##it##_##P(struct proc *proc, const struct dinsn *di)	\
+{									\
+	mvreg(proc, di->rd, fp_toint(proc, getf_##P(proc, di->rs1),	\
+				     fp_rm(proc, di), type));		\
+	dbg_log("fcvt." #it "." #P ": Setting x%d = 0x%lx", di->rd,	\
+		getreg(proc, di->rd));					\
+	insn_next(proc, di);						\
+}
+
+#define FP_FROMINT(it, P, T, IT)					\
+void insn_fcvt_##P##_##it(struct proc *proc, const struct dinsn *di)	\
+{									\
+	T res;								\
+									\
+	FP_EVAL(proc, di, res, (T)(IT)getreg(proc, di->rs1));		\
+	setf_##P(proc, di->rd, res);					\
+	FP_LOG(fcvt.P, it, di);						\
+	insn_next(proc, di);						\
+}
+
+#define FP_HANDLERS(P, T, U, fsqrt, fma, expbits, manbits)		\
+	FP_ARITH(fadd, P, T, +)						\
+	FP_ARITH(fsub, P, T, -)						\
+	FP_ARITH(fmul, P, T, *)						\
+	FP_ARITH(fdiv, P, T, /)						\
+	FP_SQRT(P, T, fsqrt)						\
+	FP_FMA(fmadd, P, T, fma, +, +)					\
+	FP_FMA(fmsub, P, T, fma, +, -)					\
+	FP_FMA(fnmsub, P, T, fma, -, +)					\
+	FP_FMA(fnmadd, P, T, fma, -, -)					\
+	FP_MINMAX(fmin, P, T, <, 1, expbits, manbits)			\
+	FP_MINMAX(fmax, P, T, >, 0, expbits, manbits)			\
+	FP_SGNJ(fsgnj, P, U, b & sign)					\
+	FP_SGNJ(fsgnjn, P, U, ~b & sign)				\
+	FP_SGNJ(fsgnjx, P, U, (a ^ b) & sign)				\
+	FP_CMP(feq, P, ==)						\
+	FP_CMP(flt, P, <)						\
+	FP_CMP(fle, P, <=)						\
+	FP_CLASS(P, expbits, manbits)					\
+	FP_TOINT(w, P, FI_W)						\
+	FP_TOINT(wu, P, FI_WU)						\
+	FP_TOINT(l, P, FI_L)						\
+	FP_TOINT(lu, P, FI_LU)						\
+	FP_FROMINT(w, P, T, int32_t)					\
+	FP_FROMINT(wu, P, T, uint32_t)					\
+	FP_FROMINT(l, P, T, int64_t)					\
+	FP_FROMINT(lu, P, T, uint64_t)
+
+FP_HANDLERS(s, float, uint32_t, sqrtf, fmaf, 8, 23)
+FP_HANDLERS(d, double, uint64_t, sqrt, fma, 11, 52)
+
+void insn_fcvt_s_d(struct proc *proc, const struct dinsn *di)
+{
+	float res;
+
+	FP_EVAL(proc, di, res, (float)getf_d(proc, di->rs1));
+	setf_s(proc, di->rd, canon_s(res));
+	FP_LOG(fcvt.s, d, di);
+	insn_next(proc, di);
+}
+
+// Exact, but rm must still be valid
+void insn_fcvt_d_s(struct proc *proc, const struct dinsn *di)
+{
+	fp_rm(proc, di);
+	setf_d(proc, di->rd, canon_d(getf_s(proc, di->rs1)));
+	FP_LOG(fcvt.d, s, di);
+	insn_next(proc, di);
+}
+
+// Moves between register files copy bits, even NaN payloads
+void insn_fmv_x_w(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd,
+	      (reg_t)(int64_t)(int32_t)(uint32_t)proc->f.regs[di->rs1]);
+	dbg_log("fmv.x.w: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_fmv_w_x(struct proc *proc, const struct dinsn *di)
+{
+	setbits_s(proc, di->rd, (uint32_t)getreg(proc, di->rs1));
+	FP_LOG(fmv.w, x, di);
+	insn_next(proc, di);
+}
+
+void insn_fmv_x_d(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, proc->f.regs[di->rs1]);
+	dbg_log("fmv.x.d: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_fmv_d_x(struct proc *proc, const struct dinsn *di)
+{
+	setbits_d(proc, di->rd, getreg(proc, di->rs1));
+	FP_LOG(fmv.d, x, di);
+	insn_next(proc, di);
+}
+#undef FP_LOG
+#undef FP_ARITH
+#undef FP_SQRT
+#undef FP_FMA
+#undef FP_MINMAX
+#undef FP_SGNJ
+#undef FP_CMP
+#undef FP_CLASS
+#undef FP_TOINT
+#undef FP_FROMINT
+#undef FP_HANDLERS
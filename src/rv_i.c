@@ -2,151 +2,745 @@
 #include <stdint.h>
 #include "riscv.h"
 #include "proc.h"
+#include "memory.h"
 #include "debug.h"
+#include "insn.h"
 #include "rv_i.h"
+#include "rv_f.h"
+#include "syscall.h"
 
-static void R_getfields(insn_t insn, enum ABI_REG *rd, enum ABI_REG *rs1,
-			enum ABI_REG *rs2)
-	__attribute__((nonnull));
+// Sign-extends the low 32 bits of `val` to XLEN, as *W instructions do
+static inline reg_t sext32(reg_t val)
+{
+	return (reg_t)(ireg_t)(int32_t)(uint32_t)val;
+}
+
+// Jumps to pc + imm if `cond` holds, otherwise goes to the next instruction
+static inline void branch(struct proc *proc, const struct dinsn *di, int cond)
+{
+	proc->pc = cond ? di->pc + (reg_t)di->imm : di->pc + di->len;
+}
+
+/*
+ * The effective address of loads and stores. Also points the pc at the
+ * instruction, as memory faults unwind without knowing which one faulted.
+ */
+static inline rvaddr_t ldst_addr(struct proc *proc, const struct dinsn *di)
+{
+	proc->pc = di->pc;
+	return getreg(proc, di->rs1) + (reg_t)di->imm;
+}
+
+void insn_lui(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)di->imm);
+	dbg_log("lui: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_auipc(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, di->pc + (reg_t)di->imm);
+	dbg_log("auipc: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_jal(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, di->pc + di->len);
+	proc->pc = di->pc + (reg_t)di->imm;
+	dbg_log("jal: Jumping to 0x%lx, x%d = 0x%lx", proc->pc, di->rd,
+		getreg(proc, di->rd));
+}
+
+void insn_jalr(struct proc *proc, const struct dinsn *di)
+{
+	rvaddr_t target;
+
+	target = (getreg(proc, di->rs1) + (reg_t)di->imm) & ~(rvaddr_t)1;
+	mvreg(proc, di->rd, di->pc + di->len);
+	proc->pc = target;
+	dbg_log("jalr: Jumping to 0x%lx, x%d = 0x%lx", proc->pc, di->rd,
+		getreg(proc, di->rd));
+}
+
+void insn_j(struct proc *proc, const struct dinsn *di)
+{
+	proc->pc = di->pc + (reg_t)di->imm;
+	dbg_log("j: Jumping to 0x%lx", proc->pc);
+}
+
+void insn_jr(struct proc *proc, const struct dinsn *di)
+{
+	proc->pc = (getreg(proc, di->rs1) + (reg_t)di->imm) & ~(rvaddr_t)1;
+	dbg_log("jr: Jumping to 0x%lx", proc->pc);
+}
+
+void insn_beq(struct proc *proc, const struct dinsn *di)
+{
+	branch(proc, di, getreg(proc, di->rs1) == getreg(proc, di->rs2));
+	dbg_log("beq: x%d == x%d? Going to 0x%lx", di->rs1, di->rs2, proc->pc);
+}
+
+void insn_bne(struct proc *proc, const struct dinsn *di)
+{
+	branch(proc, di, getreg(proc, di->rs1) != getreg(proc, di->rs2));
+	dbg_log("bne: x%d != x%d? Going to 0x%lx", di->rs1, di->rs2, proc->pc);
+}
+
+void insn_blt(struct proc *proc, const struct dinsn *di)
+{
+	branch(proc, di, (ireg_t)getreg(proc, di->rs1) <
+			 (ireg_t)getreg(proc, di->rs2));
+	dbg_log("blt: x%d < x%d? Going to 0x%lx", di->rs1, di->rs2, proc->pc);
+}
+
+void insn_bge(struct proc *proc, const struct dinsn *di)
+{
+	branch(proc, di, (ireg_t)getreg(proc, di->rs1) >=
+			 (ireg_t)getreg(proc, di->rs2));
+	dbg_log("bge: x%d >= x%d? Going to 0x%lx", di->rs1, di->rs2, proc->pc);
+}
+
+void insn_bltu(struct proc *proc, const struct dinsn *di)
+{
+	branch(proc, di, (ureg_t)getreg(proc, di->rs1) <
+			 (ureg_t)getreg(proc, di->rs2));
+	dbg_log("bltu: x%d < x%d? Going to 0x%lx", di->rs1, di->rs2,
+		proc->pc);
+}
+
+void insn_bgeu(struct proc *proc, const struct dinsn *di)
+{
+	branch(proc, di, (ureg_t)getreg(proc, di->rs1) >=
+			 (ureg_t)getreg(proc, di->rs2));
+	dbg_log("bgeu: x%d >= x%d? Going to 0x%lx", di->rs1, di->rs2,
+		proc->pc);
+}
+
+void insn_lb(struct proc *proc, const struct dinsn *di)
+{
+	uint8_t val;
+
+	memload(&proc->mem, ldst_addr(proc, di), &val);
+	mvreg(proc, di->rd, (reg_t)(ireg_t)(int8_t)val);
+	dbg_log("lb: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_lh(struct proc *proc, const struct dinsn *di)
+{
+	uint16_t val;
+
+	memload(&proc->mem, ldst_addr(proc, di), &val);
+	mvreg(proc, di->rd, (reg_t)(ireg_t)(int16_t)val);
+	dbg_log("lh: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
 
+void insn_lw(struct proc *proc, const struct dinsn *di)
+{
+	uint32_t val;
+
+	memload(&proc->mem, ldst_addr(proc, di), &val);
+	mvreg(proc, di->rd, sext32(val));
+	dbg_log("lw: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_ld(struct proc *proc, const struct dinsn *di)
+{
+	uint64_t val;
+
+	memload(&proc->mem, ldst_addr(proc, di), &val);
+	mvreg(proc, di->rd, val);
+	dbg_log("ld: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
 
-static void R_getfields(insn_t insn, enum ABI_REG *rd, enum ABI_REG *rs1,
-			enum ABI_REG *rs2)
+void insn_lbu(struct proc *proc, const struct dinsn *di)
 {
-	*rd = (enum ABI_REG)((insn & 0xf80) >> 7);
-	*rs1 = (enum ABI_REG)((insn & 0xf8000) >> 15);
-	*rs2 = (enum ABI_REG)((insn & 0xf00000) >> 20);
+	uint8_t val;
+
+	memload(&proc->mem, ldst_addr(proc, di), &val);
+	mvreg(proc, di->rd, val);
+	dbg_log("lbu: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
 }
 
-int insn_add(struct proc *proc, insn_t insn)
+void insn_lhu(struct proc *proc, const struct dinsn *di)
 {
-	enum ABI_REG rs1;
-	enum ABI_REG rs2;
-	enum ABI_REG rd;
+	uint16_t val;
 
-	R_getfields(insn, &rd, &rs1, &rs2);
-	mvreg(proc, rd, getreg(proc, rs1) + getreg(proc, rs2));
-	dbg_log("add: setting x%d to x%d + x%d = %ld", rd, rs1, rs2,
-		getreg(proc, rd));
-	return 0;
+	memload(&proc->mem, ldst_addr(proc, di), &val);
+	mvreg(proc, di->rd, val);
+	dbg_log("lhu: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
 }
 
-int insn_slt(struct proc *proc, insn_t insn)
+void insn_lwu(struct proc *proc, const struct dinsn *di)
 {
-	enum ABI_REG rd;
-	enum ABI_REG rs1;
-	enum ABI_REG rs2;
+	uint32_t val;
 
-	R_getfields(insn, &rd, &rs1, &rs2);
-	mvreg(proc, rd, (ireg_t)getreg(proc, rs1) < (ireg_t)getreg(proc, rs2));
-	dbg_log("stl: Setting x%d to %ld: x%d < x%d?", rd, getreg(proc, rd),
-		rs1, rs2);
-	return 0;
+	memload(&proc->mem, ldst_addr(proc, di), &val);
+	mvreg(proc, di->rd, val);
+	dbg_log("lwu: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
 }
 
-int insn_sltu(struct proc *proc, insn_t insn)
+void insn_sb(struct proc *proc, const struct dinsn *di)
 {
-	enum ABI_REG rd;
-	enum ABI_REG rs1;
-	enum ABI_REG rs2;
+	uint8_t val;
 
-	R_getfields(insn, &rd, &rs1, &rs2);
-	mvreg(proc, rd, (ureg_t)getreg(proc, rs1) < (ureg_t)getreg(proc, rs2));
-	dbg_log("stlu: Setting x%d to %ld: x%d < x%d?", rd, getreg(proc, rd),
-		rs1, rs2);
-	return 0;
+	val = (uint8_t)getreg(proc, di->rs2);
+	memstore(&proc->mem, ldst_addr(proc, di), &val);
+	dbg_log("sb: Storing x%d at 0x%lx", di->rs2, ldst_addr(proc, di));
+	insn_next(proc, di);
 }
 
-int insn_and(struct proc *proc, insn_t insn)
+void insn_sh(struct proc *proc, const struct dinsn *di)
 {
-	enum ABI_REG rd;
-	enum ABI_REG rs1;
-	enum ABI_REG rs2;
+	uint16_t val;
 
-	R_getfields(insn, &rd, &rs1, &rs2);
-	mvreg(proc, rd, getreg(proc, rs1) & getreg(proc, rs2));
-	dbg_log("and: Setting x%d = x%d & x%d = 0x%lx", rd, rs1, rs2,
-		getreg(proc, rd));
-	return 0;
+	val = (uint16_t)getreg(proc, di->rs2);
+	memstore(&proc->mem, ldst_addr(proc, di), &val);
+	dbg_log("sh: Storing x%d at 0x%lx", di->rs2, ldst_addr(proc, di));
+	insn_next(proc, di);
 }
 
-int insn_or(struct proc *proc, insn_t insn)
+void insn_sw(struct proc *proc, const struct dinsn *di)
 {
-	enum ABI_REG rd;
-	enum ABI_REG rs1;
-	enum ABI_REG rs2;
+	uint32_t val;
 
-	R_getfields(insn, &rd, &rs1, &rs2);
-	mvreg(proc, rd, getreg(proc, rs1) | getreg(proc, rs2));
-	dbg_log("and: Setting x%d = x%d | x%d = 0x%lx", rd, rs1, rs2,
-		getreg(proc, rd));
-	return 0;
+	val = (uint32_t)getreg(proc, di->rs2);
+	memstore(&proc->mem, ldst_addr(proc, di), &val);
+	dbg_log("sw: Storing x%d at 0x%lx", di->rs2, ldst_addr(proc, di));
+	insn_next(proc, di);
 }
 
-int insn_xor(struct proc *proc, insn_t insn)
+void insn_sd(struct proc *proc, const struct dinsn *di)
 {
-	enum ABI_REG rd;
-	enum ABI_REG rs1;
-	enum ABI_REG rs2;
+	uint64_t val;
 
-	R_getfields(insn, &rd, &rs1, &rs2);
-	mvreg(proc, rd, getreg(proc, rs1) ^ getreg(proc, rs2));
-	dbg_log("xor: Setting x%d = x%d ^ x%d = 0x%lx", rd, rs1, rs2,
-		getreg(proc, rd));
-	return 0;
+	val = getreg(proc, di->rs2);
+	memstore(&proc->mem, ldst_addr(proc, di), &val);
+	dbg_log("sd: Storing x%d at 0x%lx", di->rs2, ldst_addr(proc, di));
+	insn_next(proc, di);
 }
 
-int insn_sll(struct proc *proc, insn_t insn)
+void insn_addi(struct proc *proc, const struct dinsn *di)
 {
-	enum ABI_REG rd;
-	enum ABI_REG rs1;
-	enum ABI_REG rs2;
+	mvreg(proc, di->rd, getreg(proc, di->rs1) + (reg_t)di->imm);
+	dbg_log("addi: Setting x%d = x%d + %ld = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
 
-	R_getfields(insn, &rd, &rs1, &rs2);
-	mvreg(proc, rd, (reg_t)((ureg_t)getreg(proc, rs1) <<
-				(ureg_t)(getreg(proc, rs2) & 0x3f)));
-	dbg_log("sll: Setting x%d = x%d << x%d = 0x%lx", rd, rs1, rs2,
-		getreg(proc, rd));
-	return 0;
+void insn_slti(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (ireg_t)getreg(proc, di->rs1) < di->imm);
+	dbg_log("slti: Setting x%d to %ld: x%d < %ld?", di->rd,
+		getreg(proc, di->rd), di->rs1, di->imm);
+	insn_next(proc, di);
 }
 
-int insn_srl(struct proc *proc, insn_t insn)
+void insn_sltiu(struct proc *proc, const struct dinsn *di)
 {
-	enum ABI_REG rd;
-	enum ABI_REG rs1;
-	enum ABI_REG rs2;
+	mvreg(proc, di->rd, (ureg_t)getreg(proc, di->rs1) < (ureg_t)di->imm);
+	dbg_log("sltiu: Setting x%d to %ld: x%d < %lu?", di->rd,
+		getreg(proc, di->rd), di->rs1, (ureg_t)di->imm);
+	insn_next(proc, di);
+}
 
-	R_getfields(insn, &rd, &rs1, &rs2);
-	mvreg(proc, rd, (reg_t)((ureg_t)getreg(proc, rs1) >>
-				(ureg_t)(getreg(proc, rs2) & 0x3f)));
-	dbg_log("srl: Setting x%d = x%d >> x%d = 0x%lx", rd, rs1, rs2,
-		getreg(proc, rd));
-	return 0;
+void insn_xori(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, getreg(proc, di->rs1) ^ (reg_t)di->imm);
+	dbg_log("xori: Setting x%d = x%d ^ 0x%lx = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
 }
 
-int insn_sra(struct proc *proc, insn_t insn)
+void insn_ori(struct proc *proc, const struct dinsn *di)
 {
-	enum ABI_REG rd;
-	enum ABI_REG rs1;
-	enum ABI_REG rs2;
+	mvreg(proc, di->rd, getreg(proc, di->rs1) | (reg_t)di->imm);
+	dbg_log("ori: Setting x%d = x%d | 0x%lx = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
 
-	R_getfields(insn, &rd, &rs1, &rs2);
-	mvreg(proc, rd, (reg_t)((ireg_t)getreg(proc, rs1) >>
-				(ireg_t)(getreg(proc, rs2) & 0x3f)));
-	dbg_log("sra: Setting x%d = x%d >> x%d = 0x%lx", rd, rs1, rs2,
-		getreg(proc, rd));
-	return 0;
+void insn_andi(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, getreg(proc, di->rs1) & (reg_t)di->imm);
+	dbg_log("andi: Setting x%d = x%d & 0x%lx = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
 }
 
-int insn_sub(struct proc *proc, insn_t insn)
+void insn_slli(struct proc *proc, const struct dinsn *di)
 {
-	enum ABI_REG rd;
-	enum ABI_REG rs1;
-	enum ABI_REG rs2;
+	mvreg(proc, di->rd, getreg(proc, di->rs1) << di->imm);
+	dbg_log("slli: Setting x%d = x%d << %ld = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_srli(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, getreg(proc, di->rs1) >> di->imm);
+	dbg_log("srli: Setting x%d = x%d >> %ld = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_srai(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)((ireg_t)getreg(proc, di->rs1) >> di->imm));
+	dbg_log("srai: Setting x%d = x%d >> %ld = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_add(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, getreg(proc, di->rs1) + getreg(proc, di->rs2));
+	dbg_log("add: setting x%d to x%d + x%d = %ld", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_slt(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (ireg_t)getreg(proc, di->rs1) <
+			    (ireg_t)getreg(proc, di->rs2));
+	dbg_log("stl: Setting x%d to %ld: x%d < x%d?", di->rd,
+		getreg(proc, di->rd), di->rs1, di->rs2);
+	insn_next(proc, di);
+}
 
-	R_getfields(insn, &rd, &rs1, &rs2);
-	mvreg(proc, rd, getreg(proc, rs1) - getreg(proc, rs2));
-	dbg_log("sub: Setting x%d = x%d - x%d = %ld", rd, rs1, rs2,
-		getreg(proc, rd));
-	return 0;
+void insn_sltu(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (ureg_t)getreg(proc, di->rs1) <
+			    (ureg_t)getreg(proc, di->rs2));
+	dbg_log("stlu: Setting x%d to %ld: x%d < x%d?", di->rd,
+		getreg(proc, di->rd), di->rs1, di->rs2);
+	insn_next(proc, di);
+}
+
+void insn_and(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, getreg(proc, di->rs1) & getreg(proc, di->rs2));
+	dbg_log("and: Setting x%d = x%d & x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_or(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, getreg(proc, di->rs1) | getreg(proc, di->rs2));
+	dbg_log("and: Setting x%d = x%d | x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_xor(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, getreg(proc, di->rs1) ^ getreg(proc, di->rs2));
+	dbg_log("xor: Setting x%d = x%d ^ x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_sll(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)((ureg_t)getreg(proc, di->rs1) <<
+				(ureg_t)(getreg(proc, di->rs2) & 0x3f)));
+	dbg_log("sll: Setting x%d = x%d << x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_srl(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)((ureg_t)getreg(proc, di->rs1) >>
+				(ureg_t)(getreg(proc, di->rs2) & 0x3f)));
+	dbg_log("srl: Setting x%d = x%d >> x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_sra(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)((ireg_t)getreg(proc, di->rs1) >>
+				(ireg_t)(getreg(proc, di->rs2) & 0x3f)));
+	dbg_log("sra: Setting x%d = x%d >> x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_sub(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, getreg(proc, di->rs1) - getreg(proc, di->rs2));
+	dbg_log("sub: Setting x%d = x%d - x%d = %ld", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_addiw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, sext32(getreg(proc, di->rs1) + (reg_t)di->imm));
+	dbg_log("addiw: Setting x%d = x%d + %ld = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_slliw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, sext32(getreg(proc, di->rs1) << di->imm));
+	dbg_log("slliw: Setting x%d = x%d << %ld = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_srliw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, sext32((uint32_t)getreg(proc, di->rs1) >> di->imm));
+	dbg_log("srliw: Setting x%d = x%d >> %ld = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_sraiw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)(ireg_t)((int32_t)getreg(proc, di->rs1) >>
+					    di->imm));
+	dbg_log("sraiw: Setting x%d = x%d >> %ld = 0x%lx", di->rd, di->rs1,
+		di->imm, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_addw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, sext32(getreg(proc, di->rs1) +
+				   getreg(proc, di->rs2)));
+	dbg_log("addw: Setting x%d = x%d + x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_subw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, sext32(getreg(proc, di->rs1) -
+				   getreg(proc, di->rs2)));
+	dbg_log("subw: Setting x%d = x%d - x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_sllw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, sext32(getreg(proc, di->rs1) <<
+				   (getreg(proc, di->rs2) & 0x1f)));
+	dbg_log("sllw: Setting x%d = x%d << x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_srlw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, sext32((uint32_t)getreg(proc, di->rs1) >>
+				   (getreg(proc, di->rs2) & 0x1f)));
+	dbg_log("srlw: Setting x%d = x%d >> x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_sraw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)(ireg_t)((int32_t)getreg(proc, di->rs1) >>
+					    (getreg(proc, di->rs2) & 0x1f)));
+	dbg_log("sraw: Setting x%d = x%d >> x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_hint(struct proc *proc, const struct dinsn *di)
+{
+	// Computational instructions writing x0 are nops, or hints we ignore
+	insn_next(proc, di);
+}
+
+void insn_ecall(struct proc *proc, const struct dinsn *di)
+{
+	dbg_log("ecall: System call %lu at 0x%lx", getreg(proc, REG_A7),
+		di->pc);
+	proc->pc = di->pc;
+	sys_ecall(proc);
+	proc->pc = di->pc + di->len;
+}
+
+void insn_ebreak(struct proc *proc, const struct dinsn *di)
+{
+	dbg_log("ebreak: Trapping at 0x%lx", di->pc);
+	insn_trap(proc, di, CAUSE_BREAKPOINT, di->pc);
+}
+
+/*
+ * Orders the accesses of threads, see thread.h. Only ordering earlier stores
+ * before later loads takes a full barrier, x86-64 hosts keep the other orders
+ * without one.
+ */
+void insn_fence(struct proc *proc, const struct dinsn *di)
+{
+	if (FENCE_STORE_LOAD(di->insn))
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	else
+		__atomic_thread_fence(__ATOMIC_ACQ_REL);
+	insn_next(proc, di);
+}
+
+void insn_fence_i(struct proc *proc, const struct dinsn *di)
+{
+	// Every predecoded block is dropped once the current one ends
+	proc->mem.xdirty_start = 0;
+	proc->mem.xdirty_end = UINT64_MAX;
+	proc->pc = di->pc + di->len;
+	dbg_log("fence.i: Invalidating every predecoded block");
+}
+
+/*
+ * The CSRs user mode can access, others trap. The counters only advance
+ * between basic blocks, and there is one cycle per instruction.
+ */
+static reg_t csr_read(struct proc *proc, const struct dinsn *di, uint32_t csr)
+{
+	switch (csr) {
+	case CSR_FFLAGS:
+		return fp_fcsr(proc) & FCSR_FFLAGS;
+	case CSR_FRM:
+		return proc->f.frm;
+	case CSR_FCSR:
+		return fp_fcsr(proc);
+	case CSR_VSTART:
+		return proc->v.vstart;
+	case CSR_VXSAT:
+		return proc->v.vxsat;
+	case CSR_VXRM:
+		return proc->v.vxrm;
+	case CSR_VCSR:
+		return (reg_t)(proc->v.vxrm << 1 | proc->v.vxsat);
+	case CSR_CYCLE:
+	case CSR_INSTRET:
+		return proc->instret;
+	case CSR_VL:
+		return proc->v.vl;
+	case CSR_VTYPE:
+		return proc->v.vtype;
+	case CSR_VLENB:
+		return VLENB;
+	default:
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	}
+}
+
+// CSRs 0xc00 to 0xfff are read-only
+static void csr_write(struct proc *proc, const struct dinsn *di, uint32_t csr,
+		      reg_t val)
+{
+	switch (csr) {
+	case CSR_FFLAGS:
+		fp_set_fcsr(proc, (reg_t)proc->f.frm << FCSR_FRM_SHIFT |
+			    (val & FCSR_FFLAGS));
+		break;
+	case CSR_FRM:
+		// Keeps the flags the host accrued
+		fp_set_fcsr(proc, (val & FCSR_FRM) << FCSR_FRM_SHIFT |
+			    (fp_fcsr(proc) & FCSR_FFLAGS));
+		break;
+	case CSR_FCSR:
+		fp_set_fcsr(proc, val);
+		break;
+	case CSR_VSTART:
+		proc->v.vstart = val & (VLEN - 1);
+		break;
+	case CSR_VXSAT:
+		proc->v.vxsat = val & 0x1;
+		break;
+	case CSR_VXRM:
+		proc->v.vxrm = val & 0x3;
+		break;
+	case CSR_VCSR:
+		proc->v.vxrm = (val >> 1) & 0x3;
+		proc->v.vxsat = val & 0x1;
+		break;
+	default:
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	}
+	dbg_log("csr: Setting CSR 0x%x = 0x%lx", csr, val);
+}
+
+// The CSR number, which insn_predecode() sign-extends as an immediate
+#define CSR(di) ((di)->insn >> 20)
+
+void insn_csrrw(struct proc *proc, const struct dinsn *di)
+{
+	reg_t val = getreg(proc, di->rs1);
+	// Reads have no side effect, so rd = x0 can read too
+	reg_t old = csr_read(proc, di, CSR(di));
+
+	csr_write(proc, di, CSR(di), val);
+	mvreg(proc, di->rd, old);
+	insn_next(proc, di);
+}
+
+void insn_csrrs(struct proc *proc, const struct dinsn *di)
+{
+	reg_t val = getreg(proc, di->rs1);
+	reg_t old = csr_read(proc, di, CSR(di));
+
+	if (di->rs1 != 0)
+		csr_write(proc, di, CSR(di), old | val);
+	mvreg(proc, di->rd, old);
+	insn_next(proc, di);
+}
+
+void insn_csrrc(struct proc *proc, const struct dinsn *di)
+{
+	reg_t val = getreg(proc, di->rs1);
+	reg_t old = csr_read(proc, di, CSR(di));
+
+	if (di->rs1 != 0)
+		csr_write(proc, di, CSR(di), old & ~val);
+	mvreg(proc, di->rd, old);
+	insn_next(proc, di);
+}
+
+// The immediate forms take a 5 bits immediate in place of rs1
+void insn_csrrwi(struct proc *proc, const struct dinsn *di)
+{
+	reg_t old = csr_read(proc, di, CSR(di));
+
+	csr_write(proc, di, CSR(di), di->rs1);
+	mvreg(proc, di->rd, old);
+	insn_next(proc, di);
+}
+
+void insn_csrrsi(struct proc *proc, const struct dinsn *di)
+{
+	reg_t old = csr_read(proc, di, CSR(di));
+
+	if (di->rs1 != 0)
+		csr_write(proc, di, CSR(di), old | di->rs1);
+	mvreg(proc, di->rd, old);
+	insn_next(proc, di);
+}
+
+void insn_csrrci(struct proc *proc, const struct dinsn *di)
+{
+	reg_t old = csr_read(proc, di, CSR(di));
+
+	if (di->rs1 != 0)
+		csr_write(proc, di, CSR(di), old & ~(reg_t)di->rs1);
+	mvreg(proc, di->rd, old);
+	insn_next(proc, di);
+}
+#undef CSR
+
+/*
+ * Fused pairs, see insn_fuse(). `di` is the first instruction of the pair and
+ * `di + 1` the second, whose rs1 is the rd of the first. Both are retired.
+ */
+static inline void fused_next(struct proc *proc, const struct dinsn *di)
+{
+	proc->fused += 2;
+	insn_next(proc, di + 1);
+}
+
+// Branches on whether the rd of a compare is 0, as beqz and bnez do
+static inline void fused_branch(struct proc *proc, const struct dinsn *di,
+				reg_t val)
+{
+	mvreg(proc, di->rd, val);
+	branch(proc, di + 1, (val != 0) == IS_INSN(di[1].insn, BNE));
+	proc->fused += 2;
+	dbg_log("%s: x%d = %lu, going to 0x%lx", IS_INSN(di[1].insn, BNE) ?
+		"set+bnez" : "set+beqz", di->rd, val, proc->pc);
+}
+
+void insn_lui_addi(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)di->imm);
+	mvreg(proc, di[1].rd, (reg_t)(di->imm + di[1].imm));
+	dbg_log("lui+addi: Setting x%d = 0x%lx", di[1].rd,
+		getreg(proc, di[1].rd));
+	fused_next(proc, di);
+}
+
+void insn_lui_addiw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)di->imm);
+	mvreg(proc, di[1].rd, sext32((reg_t)(di->imm + di[1].imm)));
+	dbg_log("lui+addiw: Setting x%d = 0x%lx", di[1].rd,
+		getreg(proc, di[1].rd));
+	fused_next(proc, di);
+}
+
+void insn_auipc_addi(struct proc *proc, const struct dinsn *di)
+{
+	reg_t val = di->pc + (reg_t)di->imm;
+
+	mvreg(proc, di->rd, val);
+	mvreg(proc, di[1].rd, val + (reg_t)di[1].imm);
+	dbg_log("auipc+addi: Setting x%d = 0x%lx", di[1].rd,
+		getreg(proc, di[1].rd));
+	fused_next(proc, di);
+}
+
+void insn_auipc_jalr(struct proc *proc, const struct dinsn *di)
+{
+	reg_t val = di->pc + (reg_t)di->imm;
+
+	mvreg(proc, di->rd, val);
+	mvreg(proc, di[1].rd, di[1].pc + di[1].len);
+	proc->pc = (val + (reg_t)di[1].imm) & ~(rvaddr_t)1;
+	proc->fused += 2;
+	dbg_log("auipc+jalr: Jumping to 0x%lx, x%d = 0x%lx", proc->pc,
+		di[1].rd, getreg(proc, di[1].rd));
+}
+
+void insn_auipc_ld(struct proc *proc, const struct dinsn *di)
+{
+	reg_t addr = di->pc + (reg_t)di->imm;
+	uint64_t val;
+
+	mvreg(proc, di->rd, addr);
+	// See ldst_addr()
+	proc->pc = di[1].pc;
+	memload(&proc->mem, addr + (reg_t)di[1].imm, &val);
+	mvreg(proc, di[1].rd, val);
+	dbg_log("auipc+ld: Setting x%d = 0x%lx", di[1].rd,
+		getreg(proc, di[1].rd));
+	fused_next(proc, di);
+}
+
+void insn_slt_bz(struct proc *proc, const struct dinsn *di)
+{
+	fused_branch(proc, di, (ireg_t)getreg(proc, di->rs1) <
+				      (ireg_t)getreg(proc, di->rs2));
+}
+
+void insn_sltu_bz(struct proc *proc, const struct dinsn *di)
+{
+	fused_branch(proc, di, getreg(proc, di->rs1) <
+				      getreg(proc, di->rs2));
+}
+
+void insn_slti_bz(struct proc *proc, const struct dinsn *di)
+{
+	fused_branch(proc, di, (ireg_t)getreg(proc, di->rs1) < di->imm);
+}
+
+void insn_sltiu_bz(struct proc *proc, const struct dinsn *di)
+{
+	fused_branch(proc, di, getreg(proc, di->rs1) <
+				      (reg_t)di->imm);
 }
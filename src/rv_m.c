@@ -0,0 +1,174 @@
+#include <stdint.h>
+#include "riscv.h"
+#include "proc.h"
+#include "debug.h"
+#include "insn.h"
+#include "rv_m.h"
+
+__extension__ typedef __int128 i128;
+__extension__ typedef unsigned __int128 u128;
+
+/*
+ * Division helpers of width `W`, of the signed type `S` and unsigned `U`.
+ * For signed divisions, a zero divisor becomes 1, and so does -1 when
+ * dividing the smallest value `min`. That makes the host division safe and
+ * already gives the results of overflows: `min`, and a zero remainder. Zero
+ * divisors then force the quotient to all ones and the remainder to `a`.
+ */
+#define DIVREM(W, S, U, min)						\
+static inline S divs##W(S a, S b)					\
+{									\
+	const S zero = b == 0;						\
+	const S ovf = (a == (min)) & (b == -1);				\
+									\
+	return (S)((S)(a / (S)(b + zero + 2 * ovf)) | (S)-zero);	\
+}									\
+									\
+static inline S rems##W(S a, S b)					\
+{									\
+	const S zero = b == 0;						\
+	const S ovf = (a == (min)) & (b == -1);				\
+									\
+	return (S)((S)(a % (S)(b + zero + 2 * ovf)) | (S)(a & -zero));	\
+}									\
+									\
+static inline U divu##W(U a, U b)					\
+{									\
+	const U zero = b == 0;						\
+									\
+	return (U)(a / (U)(b + zero)) | (U)-zero;			\
+}									\
+									\
+static inline U remu##W(U a, U b)					\
+{									\
+	const U zero = b == 0;						\
+									\
+	return (U)(a % (U)(b + zero)) | (U)(a & (U)-zero);		\
+}
+
+DIVREM(64, int64_t, uint64_t, INT64_MIN)
+DIVREM(32, int32_t, uint32_t, INT32_MIN)
+#undef DIVREM
+
+void insn_mul(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, getreg(proc, di->rs1) * getreg(proc, di->rs2));
+	dbg_log("mul: Setting x%d = x%d * x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_mulh(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)((i128)(ireg_t)getreg(proc, di->rs1) *
+				   (ireg_t)getreg(proc, di->rs2) >> 64));
+	dbg_log("mulh: Setting x%d = x%d * x%d >> 64 = 0x%lx", di->rd,
+		di->rs1, di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_mulhsu(struct proc *proc, const struct dinsn *di)
+{
+	// Fits in 128 bits signed, the product is below 2^127 in magnitude
+	mvreg(proc, di->rd, (reg_t)((i128)(ireg_t)getreg(proc, di->rs1) *
+				   (i128)getreg(proc, di->rs2) >> 64));
+	dbg_log("mulhsu: Setting x%d = x%d * x%d >> 64 = 0x%lx", di->rd,
+		di->rs1, di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_mulhu(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)((u128)getreg(proc, di->rs1) *
+				   getreg(proc, di->rs2) >> 64));
+	dbg_log("mulhu: Setting x%d = x%d * x%d >> 64 = 0x%lx", di->rd,
+		di->rs1, di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_div(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)divs64((ireg_t)getreg(proc, di->rs1),
+					  (ireg_t)getreg(proc, di->rs2)));
+	dbg_log("div: Setting x%d = x%d / x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_divu(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, divu64(getreg(proc, di->rs1),
+				  getreg(proc, di->rs2)));
+	dbg_log("divu: Setting x%d = x%d / x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_rem(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)rems64((ireg_t)getreg(proc, di->rs1),
+					  (ireg_t)getreg(proc, di->rs2)));
+	dbg_log("rem: Setting x%d = x%d %% x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_remu(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, remu64(getreg(proc, di->rs1),
+				  getreg(proc, di->rs2)));
+	dbg_log("remu: Setting x%d = x%d %% x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_mulw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)(ireg_t)(int32_t)
+	      ((uint32_t)getreg(proc, di->rs1) *
+	       (uint32_t)getreg(proc, di->rs2)));
+	dbg_log("mulw: Setting x%d = x%d * x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+// The *W divisions work on 32 bits values, sign-extended like their results
+void insn_divw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)(ireg_t)(int32_t)
+	      divs32((int32_t)getreg(proc, di->rs1),
+		     (int32_t)getreg(proc, di->rs2)));
+	dbg_log("divw: Setting x%d = x%d / x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_divuw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)(ireg_t)(int32_t)
+	      divu32((uint32_t)getreg(proc, di->rs1),
+		     (uint32_t)getreg(proc, di->rs2)));
+	dbg_log("divuw: Setting x%d = x%d / x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_remw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)(ireg_t)(int32_t)
+	      rems32((int32_t)getreg(proc, di->rs1),
+		     (int32_t)getreg(proc, di->rs2)));
+	dbg_log("remw: Setting x%d = x%d %% x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_remuw(struct proc *proc, const struct dinsn *di)
+{
+	mvreg(proc, di->rd, (reg_t)(ireg_t)(int32_t)
+	      remu32((uint32_t)getreg(proc, di->rs1),
+		     (uint32_t)getreg(proc, di->rs2)));
+	dbg_log("remuw: Setting x%d = x%d %% x%d = 0x%lx", di->rd, di->rs1,
+		di->rs2, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
@@ -0,0 +1,1202 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/uio.h>
+#include "riscv.h"
+#include "proc.h"
+#include "memory.h"
+#include "debug.h"
+#include "insn.h"
+#include "rv_v.h"
+#include "vkern.h"
+
+// Fields of vtype, see vsetvl()
+#define VTYPE_VLMUL 0x7
+#define VTYPE_VSEW_SHIFT 3
+#define VTYPE_VSEW 0x7
+#define VTYPE_VTA 0x40
+#define VTYPE_VMA 0x80
+
+// Fields of the instructions that insn_predecode() doesn't extract
+#define VM(di) (((di)->insn >> 25) & 1) // Unmasked
+#define FUNCT6(di) ((di)->insn >> 26)
+#define NF(di) ((di)->insn >> 29) // Fields of segment accesses, minus one
+#define WIDTH(di) (((di)->insn >> 12) & 0x7)
+
+// Bytes of the largest register group
+#define VGROUP_MAX (8 * VLENB)
+
+/*
+ * Whether the host stores elements like the guest, so that unit-stride
+ * accesses can copy whole register groups.
+ */
+#define VMEM_COPY (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+
+// How a memory instruction walks its elements, the mop field
+enum vmop {
+	VMOP_UNIT=0,
+	VMOP_INDEXED=1,
+	VMOP_STRIDED=2,
+	VMOP_ORDERED=3,
+};
+
+static inline uint8_t *vreg(struct proc *proc, uint8_t r)
+	__attribute__((nonnull, returns_nonnull));
+static inline int vlmul(reg_t vtype);
+static inline unsigned vsew(reg_t vtype);
+static inline reg_t vlmax(unsigned sew, int lmul);
+static inline unsigned vgroup_regs(int lmul);
+static inline unsigned vsew_check(struct proc *proc, const struct dinsn *di)
+	__attribute__((nonnull));
+static inline void vgroup_check(struct proc *proc, const struct dinsn *di,
+				uint8_t r, unsigned nregs)
+	__attribute__((nonnull));
+static inline bool vactive(const struct proc *proc, const struct dinsn *di,
+			   size_t i) __attribute__((nonnull));
+static inline uint64_t vget(const uint8_t *v, unsigned sew, size_t i)
+	__attribute__((nonnull));
+static inline void vset(uint8_t *v, unsigned sew, size_t i, uint64_t val)
+	__attribute__((nonnull));
+static inline uint64_t vtrunc(uint64_t val, unsigned sew);
+static inline int64_t vsext(uint64_t val, unsigned sew);
+static inline bool mask_get(const uint8_t *m, size_t i)
+	__attribute__((nonnull));
+static inline void mask_set(uint8_t *m, size_t i, bool bit)
+	__attribute__((nonnull));
+static void vsetvl(struct proc *proc, const struct dinsn *di, reg_t vtype,
+		   reg_t avl) __attribute__((nonnull));
+static void vop(struct proc *proc, const struct dinsn *di, const char *name,
+		enum vk_op op, bool vv, uint64_t x) __attribute__((nonnull));
+static void vmasked(struct proc *proc, const struct dinsn *di, uint8_t *vd,
+		    const uint8_t *res, unsigned sew) __attribute__((nonnull));
+static void vmerge(struct proc *proc, const struct dinsn *di,
+		   const char *name, bool vv, uint64_t x)
+	__attribute__((nonnull));
+static void vmuladd(struct proc *proc, const struct dinsn *di,
+		    const char *name, bool vv, uint64_t x)
+	__attribute__((nonnull));
+static uint64_t valu(unsigned funct6, unsigned sew, uint64_t a, uint64_t b);
+static void velem(struct proc *proc, const struct dinsn *di, const char *name,
+		  bool vv, uint64_t x) __attribute__((nonnull));
+static void vcmp(struct proc *proc, const struct dinsn *di, const char *name,
+		 bool vv, uint64_t x) __attribute__((nonnull));
+static void vred(struct proc *proc, const struct dinsn *di, const char *name)
+	__attribute__((nonnull));
+static void vmask(struct proc *proc, const struct dinsn *di, const char *name)
+	__attribute__((nonnull));
+static void vslide(struct proc *proc, const struct dinsn *di, const char *name,
+		   uint64_t offset, bool down) __attribute__((nonnull));
+static void vgather(struct proc *proc, const struct dinsn *di,
+		    const char *name, bool vv, uint64_t x)
+	__attribute__((nonnull));
+static void vmem(struct proc *proc, const struct dinsn *di, bool store)
+	__attribute__((nonnull));
+static bool vmem_copy(struct memory *mem, rvaddr_t addr, uint8_t *v,
+		      size_t len, bool store) __attribute__((nonnull));
+static void vmem_whole(struct proc *proc, const struct dinsn *di,
+		       unsigned nregs, bool store) __attribute__((nonnull));
+
+static inline uint8_t *vreg(struct proc *proc, uint8_t r)
+{
+	return proc->v.regs[r];
+}
+
+// log2 of LMUL, from -3 to 3, -4 is reserved
+static inline int vlmul(reg_t vtype)
+{
+	return ((int)(vtype & VTYPE_VLMUL) ^ 4) - 4;
+}
+
+// log2 of the element size in bytes, SEW / 8
+static inline unsigned vsew(reg_t vtype)
+{
+	return (unsigned)(vtype >> VTYPE_VSEW_SHIFT) & VTYPE_VSEW;
+}
+
+static inline reg_t vlmax(unsigned sew, int lmul)
+{
+	reg_t elems = VLENB >> sew;
+
+	return lmul >= 0 ? elems << lmul : elems >> -lmul;
+}
+
+// Registers in a group, fractional groups still take one
+static inline unsigned vgroup_regs(int lmul)
+{
+	return lmul > 0 ? 1u << lmul : 1;
+}
+
+/*
+ * Returns the current SEW, as vsew() does, after checking that the
+ * instruction `di` can run: vtype must be valid, and vstart zero as this
+ * implementation never interrupts an instruction, so it may trap on any other
+ * value.
+ */
+static inline unsigned vsew_check(struct proc *proc, const struct dinsn *di)
+{
+	if ((proc->v.vtype & VTYPE_VILL) || proc->v.vstart != 0)
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	return vsew(proc->v.vtype);
+}
+
+// Register groups of `nregs` registers must start at a multiple of it
+static inline void vgroup_check(struct proc *proc, const struct dinsn *di,
+				uint8_t r, unsigned nregs)
+{
+	if (r & (nregs - 1))
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+}
+
+// Whether element `i` is active, for masked instructions
+static inline bool vactive(const struct proc *proc, const struct dinsn *di,
+			   size_t i)
+{
+	return VM(di) || mask_get(proc->v.regs[0], i);
+}
+
+// Element `i`, zero-extended
+static inline uint64_t vget(const uint8_t *v, unsigned sew, size_t i)
+{
+	uint16_t e16;
+	uint32_t e32;
+	uint64_t e64;
+
+	switch (sew) {
+	case 0:
+		return v[i];
+	case 1:
+		memcpy(&e16, v + 2 * i, sizeof(e16));
+		return e16;
+	case 2:
+		memcpy(&e32, v + 4 * i, sizeof(e32));
+		return e32;
+	default:
+		memcpy(&e64, v + 8 * i, sizeof(e64));
+		return e64;
+	}
+}
+
+static inline void vset(uint8_t *v, unsigned sew, size_t i, uint64_t val)
+{
+	uint16_t e16 = (uint16_t)val;
+	uint32_t e32 = (uint32_t)val;
+
+	switch (sew) {
+	case 0:
+		v[i] = (uint8_t)val;
+		break;
+	case 1:
+		memcpy(v + 2 * i, &e16, sizeof(e16));
+		break;
+	case 2:
+		memcpy(v + 4 * i, &e32, sizeof(e32));
+		break;
+	default:
+		memcpy(v + 8 * i, &val, sizeof(val));
+		break;
+	}
+}
+
+static inline uint64_t vtrunc(uint64_t val, unsigned sew)
+{
+	return val & (~(uint64_t)0 >> (64 - (8u << sew)));
+}
+
+static inline int64_t vsext(uint64_t val, unsigned sew)
+{
+	unsigned shift = 64 - (8u << sew);
+
+	return (int64_t)(val << shift) >> shift;
+}
+
+// Bit `i` of a mask register
+static inline bool mask_get(const uint8_t *m, size_t i)
+{
+	return (m[i / 8] >> (i % 8)) & 1;
+}
+
+static inline void mask_set(uint8_t *m, size_t i, bool bit)
+{
+	m[i / 8] = (uint8_t)((m[i / 8] & ~(1u << (i % 8))) |
+			     ((unsigned)bit << (i % 8)));
+}
+
+/*
+ * Sets vtype and vl for an application vector length of `avl`. Unsupported
+ * types set vill and a vl of 0 instead of trapping, as the specification
+ * requires. vl is the largest allowed, min(avl, VLMAX).
+ */
+static void vsetvl(struct proc *proc, const struct dinsn *di, reg_t vtype,
+		   reg_t avl)
+{
+	unsigned sew = vsew(vtype);
+	int lmul = vlmul(vtype);
+	reg_t max;
+
+	if ((vtype & ~(reg_t)(VTYPE_VLMUL | VTYPE_VSEW << VTYPE_VSEW_SHIFT |
+	    VTYPE_VTA | VTYPE_VMA)) || sew > 3 || lmul == -4 ||
+	    (int)sew > 3 + lmul) {
+		proc->v.vtype = VTYPE_VILL;
+		proc->v.vl = 0;
+	} else {
+		max = vlmax(sew, lmul);
+		proc->v.vtype = vtype;
+		proc->v.vl = avl < max ? avl : max;
+	}
+	proc->v.vstart = 0;
+	mvreg(proc, di->rd, proc->v.vl);
+	dbg_log("vsetvl: vtype = 0x%lx, vl = %lu", proc->v.vtype, proc->v.vl);
+}
+
+/*
+ * Runs the kernel of `op` on vs2 and vs1 if `vv` is set, or vs2 and `x`,
+ * element-wise. Masked off elements are left as they are, as are those past
+ * vl: both policies are undisturbed, which agnostic ones permit.
+ */
+static void vop(struct proc *proc, const struct dinsn *di, const char *name,
+		enum vk_op op, bool vv, uint64_t x)
+{
+	unsigned sew = vsew_check(proc, di);
+	unsigned nregs = vgroup_regs(vlmul(proc->v.vtype));
+	uint8_t res[VGROUP_MAX];
+	uint8_t *vd = vreg(proc, di->rd);
+	uint8_t *out = VM(di) ? vd : res;
+
+	vgroup_check(proc, di, di->rd, nregs);
+	vgroup_check(proc, di, di->rs2, nregs);
+	if (vv) {
+		vgroup_check(proc, di, di->rs1, nregs);
+		vkern->vv[op][sew](out, vreg(proc, di->rs2),
+				   vreg(proc, di->rs1), proc->v.vl);
+	} else {
+		vkern->vx[op][sew](out, vreg(proc, di->rs2), x, proc->v.vl);
+	}
+	if (!VM(di))
+		vmasked(proc, di, vd, res, sew);
+	dbg_log("%s: Setting v%d, vl = %lu, SEW = %u", name, di->rd,
+		proc->v.vl, 8u << sew);
+}
+
+/*
+ * Copies the active elements of `res` to vd, for masked instructions. The
+ * mask is v0, which can't be the destination.
+ */
+static void vmasked(struct proc *proc, const struct dinsn *di, uint8_t *vd,
+		    const uint8_t *res, unsigned sew)
+{
+	if (di->rd == 0)
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	for (size_t i = 0; i < proc->v.vl; ++i)
+		if (mask_get(proc->v.regs[0], i))
+			memcpy(vd + (i << sew), res + (i << sew),
+			       (size_t)1 << sew);
+}
+
+/*
+ * vmerge, vs1 or `x` where v0 is set and vs2 elsewhere. The sources are read
+ * before vd is written, which may be one of them.
+ */
+static void vmerge(struct proc *proc, const struct dinsn *di,
+		   const char *name, bool vv, uint64_t x)
+{
+	unsigned sew = vsew_check(proc, di);
+	unsigned nregs = vgroup_regs(vlmul(proc->v.vtype));
+	uint8_t res[VGROUP_MAX];
+	uint8_t *vd = vreg(proc, di->rd);
+	uint8_t *vs2 = vreg(proc, di->rs2);
+
+	vgroup_check(proc, di, di->rd, nregs);
+	vgroup_check(proc, di, di->rs2, nregs);
+	if (vv) {
+		vgroup_check(proc, di, di->rs1, nregs);
+		vkern->vv[VK_MV][sew](res, vs2, vreg(proc, di->rs1),
+				      proc->v.vl);
+	} else {
+		vkern->vx[VK_MV][sew](res, vs2, x, proc->v.vl);
+	}
+	for (size_t i = 0; i < proc->v.vl; ++i)
+		if (!mask_get(proc->v.regs[0], i))
+			memcpy(res + (i << sew), vs2 + (i << sew),
+			       (size_t)1 << sew);
+	memcpy(vd, res, (size_t)proc->v.vl << sew);
+	dbg_log("%s: Setting v%d, vl = %lu, SEW = %u", name, di->rd,
+		proc->v.vl, 8u << sew);
+}
+
+/*
+ * vmacc, vnmsac, vmadd and vnmsub, from the multiply and add kernels. The
+ * product is vs1 (or `x`) times vs2 for the first two, which add it to vd,
+ * and times vd for the others, which add it to vs2.
+ */
+static void vmuladd(struct proc *proc, const struct dinsn *di,
+		    const char *name, bool vv, uint64_t x)
+{
+	unsigned sew = vsew_check(proc, di);
+	unsigned nregs = vgroup_regs(vlmul(proc->v.vtype));
+	uint8_t prod[VGROUP_MAX];
+	uint8_t res[VGROUP_MAX];
+	uint8_t *vd = vreg(proc, di->rd);
+	uint8_t *vs2 = vreg(proc, di->rs2);
+	uint8_t *out = VM(di) ? vd : res;
+	bool acc = FUNCT6(di) >= 0x2d; // vmacc and vnmsac
+	bool sub = FUNCT6(di) & 0x2;
+	uint8_t *mul = acc ? vs2 : vd;
+	uint8_t *add = acc ? vd : vs2;
+
+	vgroup_check(proc, di, di->rd, nregs);
+	vgroup_check(proc, di, di->rs2, nregs);
+	if (vv) {
+		vgroup_check(proc, di, di->rs1, nregs);
+		vkern->vv[VK_MUL][sew](prod, mul, vreg(proc, di->rs1),
+				       proc->v.vl);
+	} else {
+		vkern->vx[VK_MUL][sew](prod, mul, x, proc->v.vl);
+	}
+	vkern->vv[sub ? VK_SUB : VK_ADD][sew](out, add, prod, proc->v.vl);
+	if (!VM(di))
+		vmasked(proc, di, vd, res, sew);
+	dbg_log("%s: Setting v%d, vl = %lu, SEW = %u", name, di->rd,
+		proc->v.vl, 8u << sew);
+}
+
+/*
+ * The operations without a kernel, on one element, by the funct6 of their
+ * OPMVV and OPMVX encodings. Division by zero and overflow don't trap, they
+ * give the same results as the scalar M instructions.
+ */
+static uint64_t valu(unsigned funct6, unsigned sew, uint64_t a, uint64_t b)
+{
+	unsigned bits = 8u << sew;
+	int64_t sa = vsext(a, sew);
+	int64_t sb = vsext(b, sew);
+	int64_t smin = vsext((uint64_t)1 << (bits - 1), sew);
+	__extension__ typedef unsigned __int128 u128;
+	__extension__ typedef __int128 i128;
+
+	switch (funct6) {
+	case 0x20: // vdivu
+		return b == 0 ? ~(uint64_t)0 : a / b;
+	case 0x21: // vdiv
+		if (b == 0)
+			return ~(uint64_t)0;
+		if (sa == smin && sb == -1)
+			return a;
+		return (uint64_t)(sa / sb);
+	case 0x22: // vremu
+		return b == 0 ? a : a % b;
+	case 0x23: // vrem
+		if (b == 0)
+			return a;
+		if (sa == smin && sb == -1)
+			return 0;
+		return (uint64_t)(sa % sb);
+	case 0x24: // vmulhu
+		return (uint64_t)(((u128)a * b) >> bits);
+	case 0x26: // vmulhsu
+		return (uint64_t)(((i128)sa * (i128)b) >> bits);
+	case 0x27: // vmulh
+	default:
+		return (uint64_t)(((i128)sa * sb) >> bits);
+	}
+}
+
+// Runs valu() element-wise, like vop()
+static void velem(struct proc *proc, const struct dinsn *di, const char *name,
+		  bool vv, uint64_t x)
+{
+	unsigned sew = vsew_check(proc, di);
+	unsigned nregs = vgroup_regs(vlmul(proc->v.vtype));
+	uint8_t *vd = vreg(proc, di->rd);
+	uint8_t *vs2 = vreg(proc, di->rs2);
+	uint8_t *vs1 = vreg(proc, di->rs1);
+	uint64_t b = vtrunc(x, sew);
+
+	vgroup_check(proc, di, di->rd, nregs);
+	vgroup_check(proc, di, di->rs2, nregs);
+	if (vv)
+		vgroup_check(proc, di, di->rs1, nregs);
+	if (!VM(di) && di->rd == 0)
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	for (size_t i = 0; i < proc->v.vl; ++i) {
+		if (!vactive(proc, di, i))
+			continue;
+		if (vv)
+			b = vget(vs1, sew, i);
+		vset(vd, sew, i, valu(FUNCT6(di), sew, vget(vs2, sew, i), b));
+	}
+	dbg_log("%s: Setting v%d, vl = %lu, SEW = %u", name, di->rd,
+		proc->v.vl, 8u << sew);
+}
+
+/*
+ * Integer comparisons, vs2 against vs1 or `x`, by funct6. They write a mask
+ * register, which is built apart as vd may be one of the sources.
+ */
+static void vcmp(struct proc *proc, const struct dinsn *di, const char *name,
+		 bool vv, uint64_t x)
+{
+	unsigned sew = vsew_check(proc, di);
+	unsigned nregs = vgroup_regs(vlmul(proc->v.vtype));
+	uint8_t *vs2 = vreg(proc, di->rs2);
+	uint8_t *vs1 = vreg(proc, di->rs1);
+	uint8_t m[VLENB];
+	uint64_t a;
+	uint64_t b = vtrunc(x, sew);
+	bool res;
+
+	vgroup_check(proc, di, di->rs2, nregs);
+	if (vv)
+		vgroup_check(proc, di, di->rs1, nregs);
+	memcpy(m, vreg(proc, di->rd), sizeof(m));
+	for (size_t i = 0; i < proc->v.vl; ++i) {
+		if (!vactive(proc, di, i))
+			continue;
+		a = vget(vs2, sew, i);
+		if (vv)
+			b = vget(vs1, sew, i);
+		switch (FUNCT6(di)) {
+		case 0x18: // vmseq
+			res = a == b;
+			break;
+		case 0x19: // vmsne
+			res = a != b;
+			break;
+		case 0x1a: // vmsltu
+			res = a < b;
+			break;
+		case 0x1b: // vmslt
+			res = vsext(a, sew) < vsext(b, sew);
+			break;
+		case 0x1c: // vmsleu
+			res = a <= b;
+			break;
+		case 0x1d: // vmsle
+			res = vsext(a, sew) <= vsext(b, sew);
+			break;
+		case 0x1e: // vmsgtu
+			res = a > b;
+			break;
+		case 0x1f: // vmsgt
+		default:
+			res = vsext(a, sew) > vsext(b, sew);
+			break;
+		}
+		mask_set(m, i, res);
+	}
+	memcpy(vreg(proc, di->rd), m, sizeof(m));
+	dbg_log("%s: Setting mask v%d, vl = %lu, SEW = %u", name, di->rd,
+		proc->v.vl, 8u << sew);
+}
+
+/*
+ * Reductions, by funct6, of vs1[0] and the active elements of vs2 into
+ * vd[0]. Nothing is written when vl is 0.
+ */
+static void vred(struct proc *proc, const struct dinsn *di, const char *name)
+{
+	unsigned sew = vsew_check(proc, di);
+	uint8_t *vs2 = vreg(proc, di->rs2);
+	uint64_t acc = vget(vreg(proc, di->rs1), sew, 0);
+	uint64_t e;
+
+	vgroup_check(proc, di, di->rs2, vgroup_regs(vlmul(proc->v.vtype)));
+	if (proc->v.vl == 0)
+		return;
+	for (size_t i = 0; i < proc->v.vl; ++i) {
+		if (!vactive(proc, di, i))
+			continue;
+		e = vget(vs2, sew, i);
+		switch (FUNCT6(di)) {
+		case 0x0: // vredsum
+			acc += e;
+			break;
+		case 0x1: // vredand
+			acc &= e;
+			break;
+		case 0x2: // vredor
+			acc |= e;
+			break;
+		case 0x3: // vredxor
+			acc ^= e;
+			break;
+		case 0x4: // vredminu
+			acc = e < acc ? e : acc;
+			break;
+		case 0x5: // vredmin
+			acc = vsext(e, sew) < vsext(acc, sew) ? e : acc;
+			break;
+		case 0x6: // vredmaxu
+			acc = e > acc ? e : acc;
+			break;
+		case 0x7: // vredmax
+		default:
+			acc = vsext(e, sew) > vsext(acc, sew) ? e : acc;
+			break;
+		}
+	}
+	vset(vreg(proc, di->rd), sew, 0, acc);
+	dbg_log("%s: Setting v%d[0] = 0x%lx", name, di->rd,
+		vtrunc(acc, sew));
+}
+
+/*
+ * Logical operations on mask registers, by funct6, a byte at a time. The
+ * bits past vl are kept.
+ */
+static void vmask(struct proc *proc, const struct dinsn *di, const char *name)
+{
+	const uint8_t *a = vreg(proc, di->rs2);
+	const uint8_t *b = vreg(proc, di->rs1);
+	uint8_t *vd = vreg(proc, di->rd);
+	size_t vl = proc->v.vl;
+	uint8_t res[VLENB];
+	uint8_t tail;
+
+	vsew_check(proc, di);
+	for (size_t i = 0; i < (vl + 7) / 8; ++i) {
+		switch (FUNCT6(di)) {
+		case 0x18: // vmandn
+			res[i] = a[i] & (uint8_t)~b[i];
+			break;
+		case 0x19: // vmand
+			res[i] = a[i] & b[i];
+			break;
+		case 0x1a: // vmor
+			res[i] = a[i] | b[i];
+			break;
+		case 0x1b: // vmxor
+			res[i] = a[i] ^ b[i];
+			break;
+		case 0x1c: // vmorn
+			res[i] = a[i] | (uint8_t)~b[i];
+			break;
+		case 0x1d: // vmnand
+			res[i] = (uint8_t)~(a[i] & b[i]);
+			break;
+		case 0x1e: // vmnor
+			res[i] = (uint8_t)~(a[i] | b[i]);
+			break;
+		case 0x1f: // vmxnor
+		default:
+			res[i] = (uint8_t)~(a[i] ^ b[i]);
+			break;
+		}
+	}
+	if (vl % 8) {
+		tail = (uint8_t)(0xff << (vl % 8));
+		res[vl / 8] = (uint8_t)((res[vl / 8] & ~tail) |
+					(vd[vl / 8] & tail));
+	}
+	memcpy(vd, res, (vl + 7) / 8);
+	dbg_log("%s: Setting mask v%d, vl = %lu", name, di->rd, vl);
+}
+
+/*
+ * vslideup and vslidedown by `offset` elements. Elements slid down from past
+ * VLMAX are zero, those below `offset` aren't written by slides up.
+ */
+static void vslide(struct proc *proc, const struct dinsn *di, const char *name,
+		   uint64_t offset, bool down)
+{
+	unsigned sew = vsew_check(proc, di);
+	int lmul = vlmul(proc->v.vtype);
+	reg_t max = vlmax(sew, lmul);
+	uint8_t *vd = vreg(proc, di->rd);
+	uint8_t *vs2 = vreg(proc, di->rs2);
+	uint8_t src[VGROUP_MAX];
+
+	vgroup_check(proc, di, di->rd, vgroup_regs(lmul));
+	vgroup_check(proc, di, di->rs2, vgroup_regs(lmul));
+	// Slides down may overlap their source
+	memcpy(src, vs2, (size_t)max << sew);
+	if (!VM(di) && di->rd == 0)
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	for (size_t i = down ? 0 : offset; i < proc->v.vl; ++i) {
+		if (!vactive(proc, di, i))
+			continue;
+		if (!down)
+			vset(vd, sew, i, vget(src, sew, i - offset));
+		else if (offset < max && i + offset < max)
+			vset(vd, sew, i, vget(src, sew, i + offset));
+		else
+			vset(vd, sew, i, 0);
+	}
+	dbg_log("%s: Setting v%d, by %lu, vl = %lu", name, di->rd, offset,
+		proc->v.vl);
+}
+
+// vrgather, by the indices in vs1 or `x`, which are 0 past VLMAX
+static void vgather(struct proc *proc, const struct dinsn *di,
+		    const char *name, bool vv, uint64_t x)
+{
+	unsigned sew = vsew_check(proc, di);
+	int lmul = vlmul(proc->v.vtype);
+	reg_t max = vlmax(sew, lmul);
+	uint8_t *vd = vreg(proc, di->rd);
+	uint8_t *vs2 = vreg(proc, di->rs2);
+	uint8_t *vs1 = vreg(proc, di->rs1);
+	uint8_t res[VGROUP_MAX];
+	uint64_t idx = x;
+
+	vgroup_check(proc, di, di->rd, vgroup_regs(lmul));
+	vgroup_check(proc, di, di->rs2, vgroup_regs(lmul));
+	if (vv)
+		vgroup_check(proc, di, di->rs1, vgroup_regs(lmul));
+	if (!VM(di) && di->rd == 0)
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	memcpy(res, vd, (size_t)proc->v.vl << sew);
+	for (size_t i = 0; i < proc->v.vl; ++i) {
+		if (!vactive(proc, di, i))
+			continue;
+		if (vv)
+			idx = vget(vs1, sew, i);
+		vset(res, sew, i, idx < max ? vget(vs2, sew, idx) : 0);
+	}
+	memcpy(vd, res, (size_t)proc->v.vl << sew);
+	dbg_log("%s: Setting v%d, vl = %lu", name, di->rd, proc->v.vl);
+}
+
+/*
+ * Unit-stride, strided and indexed loads and stores, including segment ones.
+ * Field `f` of element `i` goes to register group vd + f * EMUL, and faults
+ * unwind like scalar accesses, see ldst_addr(), leaving the elements before
+ * the faulting one accessed.
+ */
+static void vmem(struct proc *proc, const struct dinsn *di, bool store)
+{
+	unsigned sew = vsew_check(proc, di);
+	int lmul = vlmul(proc->v.vtype);
+	unsigned width = WIDTH(di) ? WIDTH(di) - 4 : 0; // log2 of EEW / 8
+	enum vmop mop = (enum vmop)((di->insn >> 26) & 0x3);
+	bool indexed = mop == VMOP_INDEXED || mop == VMOP_ORDERED;
+	// Group size of what has `width`, the data, or the indices if indexed
+	int wemul = (int)width - (int)sew + lmul;
+	// Element width and group size of the data
+	unsigned eew = indexed ? sew : width;
+	int emul = indexed ? lmul : wemul;
+	unsigned nregs = vgroup_regs(emul);
+	unsigned nf = NF(di) + 1;
+	rvaddr_t base = getreg(proc, di->rs1);
+	reg_t stride = mop == VMOP_STRIDED ? getreg(proc, di->rs2) :
+		       (reg_t)nf << eew;
+	uint8_t *vs2 = vreg(proc, di->rs2);
+	size_t vl = proc->v.vl;
+	rvaddr_t addr;
+	uint8_t *v;
+
+	proc->pc = di->pc;
+	// Masked loads can't overwrite their mask, stores only read v0
+	if (emul < -3 || emul > 3 || nf * nregs > 8 ||
+	    di->rd + nf * nregs > 32 || (!VM(di) && !store && di->rd == 0) ||
+	    wemul < -3 || wemul > 3)
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	vgroup_check(proc, di, di->rd, nregs);
+	if (indexed)
+		vgroup_check(proc, di, di->rs2, vgroup_regs(wemul));
+
+	if (mop == VMOP_UNIT && nf == 1 && VM(di) &&
+	    vmem_copy(&proc->mem, base, vreg(proc, di->rd), vl << eew, store))
+		goto out;
+
+	for (size_t i = 0; i < vl; ++i) {
+		if (!vactive(proc, di, i))
+			continue;
+		addr = base + (indexed ? vget(vs2, width, i) : i * stride);
+		for (unsigned f = 0; f < nf; ++f) {
+			v = vreg(proc, (uint8_t)(di->rd + f * nregs)) +
+			    (i << eew);
+			if (store)
+				memstoreN(&proc->mem, addr + (f << eew),
+					  (uint8_t)(8 << eew), v);
+			else
+				memloadN(&proc->mem, addr + (f << eew),
+					 (uint8_t)(8 << eew), v);
+		}
+	}
+out:
+	dbg_log("v%s: %s v%d, vl = %lu, EEW = %u, at 0x%lx",
+		store ? "s" : "l", store ? "Stored" : "Loaded", di->rd, vl,
+		8u << eew, base);
+}
+
+/*
+ * Copies `len` contiguous bytes between guest memory at `addr` and vector
+ * registers in one go, if they are all accessible (e.g. never across the end
+ * of a segment). Returns false if it didn't, element accesses then fault on
+ * the right one.
+ */
+static bool vmem_copy(struct memory *mem, rvaddr_t addr, uint8_t *v,
+		      size_t len, bool store)
+{
+	struct iovec iov[2];
+	int n;
+
+	if (!VMEM_COPY || len == 0)
+		return len == 0;
+	// Flat memory faults on its own, but stores to code are tracked
+	if (addr < mem->flat_limit && mem->flat_limit - addr >= len &&
+	    (!store || addr >= mem->wx_end || addr + len <= mem->wx_start)) {
+		if (store)
+			memcpy(mem->flat + addr, v, len);
+		else
+			memcpy(v, mem->flat + addr, len);
+		return true;
+	}
+
+	n = memiov(mem, addr, len, store ? MEM_WRITE : MEM_READ, iov, 2);
+	if (n <= 0 || iov[0].iov_len + (n > 1 ? iov[1].iov_len : 0) != len)
+		return false;
+	for (int i = 0; i < n; v += iov[i].iov_len, ++i) {
+		if (store)
+			memcpy(iov[i].iov_base, v, iov[i].iov_len);
+		else
+			memcpy(v, iov[i].iov_base, iov[i].iov_len);
+	}
+	return true;
+}
+
+/*
+ * Whole register loads and stores of `nregs` registers, which ignore vtype
+ * and vl.
+ */
+static void vmem_whole(struct proc *proc, const struct dinsn *di,
+		       unsigned nregs, bool store)
+{
+	rvaddr_t base = getreg(proc, di->rs1);
+	size_t len = nregs * VLENB;
+	uint8_t *v = vreg(proc, di->rd);
+
+	proc->pc = di->pc;
+	if (proc->v.vstart != 0)
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	vgroup_check(proc, di, di->rd, nregs);
+	if (!vmem_copy(&proc->mem, base, v, len, store))
+		for (size_t i = 0; i < len / 8; ++i) {
+			if (store)
+				memstoreN(&proc->mem, base + 8 * i, 64,
+					  v + 8 * i);
+			else
+				memloadN(&proc->mem, base + 8 * i, 64,
+					 v + 8 * i);
+		}
+	dbg_log("v%sr: %s v%d-v%d at 0x%lx", store ? "s" : "l",
+		store ? "Stored" : "Loaded", di->rd, di->rd + nregs - 1, base);
+}
+
+void vec_init(struct proc *proc)
+{
+	memset(&proc->v, 0, sizeof(proc->v));
+	proc->v.vtype = VTYPE_VILL;
+}
+
+void insn_vsetvli(struct proc *proc, const struct dinsn *di)
+{
+	reg_t avl;
+
+	// rs1 = x0 asks for VLMAX, or to keep vl if rd = x0 too
+	if (di->rs1 != 0)
+		avl = getreg(proc, di->rs1);
+	else
+		avl = di->rd != REG_SINK ? ~(reg_t)0 : proc->v.vl;
+	vsetvl(proc, di, (di->insn >> 20) & 0x7ff, avl);
+	insn_next(proc, di);
+}
+
+void insn_vsetivli(struct proc *proc, const struct dinsn *di)
+{
+	vsetvl(proc, di, (di->insn >> 20) & 0x3ff, di->rs1);
+	insn_next(proc, di);
+}
+
+void insn_vsetvl(struct proc *proc, const struct dinsn *di)
+{
+	reg_t avl;
+
+	if (di->rs1 != 0)
+		avl = getreg(proc, di->rs1);
+	else
+		avl = di->rd != REG_SINK ? ~(reg_t)0 : proc->v.vl;
+	vsetvl(proc, di, getreg(proc, di->rs2), avl);
+	insn_next(proc, di);
+}
+
+void insn_vle_v(struct proc *proc, const struct dinsn *di)
+{
+	vmem(proc, di, false);
+	insn_next(proc, di);
+}
+
+void insn_vse_v(struct proc *proc, const struct dinsn *di)
+{
+	vmem(proc, di, true);
+	insn_next(proc, di);
+}
+
+// Mask loads and stores are byte loads of ceil(vl / 8) bytes
+void insn_vlm_v(struct proc *proc, const struct dinsn *di)
+{
+	rvaddr_t base = getreg(proc, di->rs1);
+	size_t len = (proc->v.vl + 7) / 8;
+	uint8_t *v = vreg(proc, di->rd);
+
+	proc->pc = di->pc;
+	vsew_check(proc, di);
+	if (!vmem_copy(&proc->mem, base, v, len, false))
+		for (size_t i = 0; i < len; ++i)
+			memload(&proc->mem, base + i, &v[i]);
+	dbg_log("vlm: Loaded mask v%d, vl = %lu", di->rd, proc->v.vl);
+	insn_next(proc, di);
+}
+
+void insn_vsm_v(struct proc *proc, const struct dinsn *di)
+{
+	rvaddr_t base = getreg(proc, di->rs1);
+	size_t len = (proc->v.vl + 7) / 8;
+	uint8_t *v = vreg(proc, di->rd);
+
+	proc->pc = di->pc;
+	vsew_check(proc, di);
+	if (!vmem_copy(&proc->mem, base, v, len, true))
+		for (size_t i = 0; i < len; ++i)
+			memstore(&proc->mem, base + i, &v[i]);
+	dbg_log("vsm: Stored mask v%d, vl = %lu", di->rd, proc->v.vl);
+	insn_next(proc, di);
+}
+
+void insn_vlr_v(struct proc *proc, const struct dinsn *di)
+{
+	vmem_whole(proc, di, NF(di) + 1, false);
+	insn_next(proc, di);
+}
+
+void insn_vsr_v(struct proc *proc, const struct dinsn *di)
+{
+	vmem_whole(proc, di, NF(di) + 1, true);
+	insn_next(proc, di);
+}
+
+// Handlers of the instructions that run a kernel, for each operand form
+#define VOP_VV(name, op)						\
+void insn_##name##_vv(struct proc *proc, const struct dinsn *di)	\
+{									\
+	vop(proc, di, #name ".vv", (op), true, 0);			\
+	insn_next(proc, di);						\
+}
+#define VOP_VX(name, op)						\
+void insn_##name##_vx(struct proc *proc, const struct dinsn *di)	\
+{									\
+	vop(proc, di, #name ".vx", (op), false, getreg(proc, di->rs1));	\
+	insn_next(proc, di);						\
+}
+// Shifts take their immediate unsigned
+#define VOP_VI(name, op)						\
+void insn_##name##_vi(struct proc *proc, const struct dinsn *di)	\
+{									\
+	vop(proc, di, #name ".vi", (op), false, (op) == VK_SLL ||	\
+	    (op) == VK_SRL || (op) == VK_SRA ? (reg_t)di->imm & 0x1f :	\
+	    (reg_t)di->imm);						\
+	insn_next(proc, di);						\
+}
+
+VOP_VV(vadd, VK_ADD)
+VOP_VX(vadd, VK_ADD)
+VOP_VI(vadd, VK_ADD)
+VOP_VV(vsub, VK_SUB)
+VOP_VX(vsub, VK_SUB)
+VOP_VX(vrsub, VK_RSUB)
+VOP_VI(vrsub, VK_RSUB)
+VOP_VV(vminu, VK_MINU)
+VOP_VX(vminu, VK_MINU)
+VOP_VV(vmin, VK_MIN)
+VOP_VX(vmin, VK_MIN)
+VOP_VV(vmaxu, VK_MAXU)
+VOP_VX(vmaxu, VK_MAXU)
+VOP_VV(vmax, VK_MAX)
+VOP_VX(vmax, VK_MAX)
+VOP_VV(vand, VK_AND)
+VOP_VX(vand, VK_AND)
+VOP_VI(vand, VK_AND)
+VOP_VV(vor, VK_OR)
+VOP_VX(vor, VK_OR)
+VOP_VI(vor, VK_OR)
+VOP_VV(vxor, VK_XOR)
+VOP_VX(vxor, VK_XOR)
+VOP_VI(vxor, VK_XOR)
+VOP_VV(vsll, VK_SLL)
+VOP_VX(vsll, VK_SLL)
+VOP_VI(vsll, VK_SLL)
+VOP_VV(vsrl, VK_SRL)
+VOP_VX(vsrl, VK_SRL)
+VOP_VI(vsrl, VK_SRL)
+VOP_VV(vsra, VK_SRA)
+VOP_VX(vsra, VK_SRA)
+VOP_VI(vsra, VK_SRA)
+VOP_VV(vmul, VK_MUL)
+VOP_VX(vmul, VK_MUL)
+#undef VOP_VV
+#undef VOP_VX
+#undef VOP_VI
+
+// vmv.v.* are unmasked, so vop() writes vd directly
+void insn_vmv_v_v(struct proc *proc, const struct dinsn *di)
+{
+	vop(proc, di, "vmv.v.v", VK_MV, true, 0);
+	insn_next(proc, di);
+}
+
+void insn_vmv_v_x(struct proc *proc, const struct dinsn *di)
+{
+	vop(proc, di, "vmv.v.x", VK_MV, false, getreg(proc, di->rs1));
+	insn_next(proc, di);
+}
+
+void insn_vmv_v_i(struct proc *proc, const struct dinsn *di)
+{
+	vop(proc, di, "vmv.v.i", VK_MV, false, (reg_t)di->imm);
+	insn_next(proc, di);
+}
+
+void insn_vmerge_vvm(struct proc *proc, const struct dinsn *di)
+{
+	vmerge(proc, di, "vmerge.vvm", true, 0);
+	insn_next(proc, di);
+}
+
+void insn_vmerge_vxm(struct proc *proc, const struct dinsn *di)
+{
+	vmerge(proc, di, "vmerge.vxm", false, getreg(proc, di->rs1));
+	insn_next(proc, di);
+}
+
+void insn_vmerge_vim(struct proc *proc, const struct dinsn *di)
+{
+	vmerge(proc, di, "vmerge.vim", false, (reg_t)di->imm);
+	insn_next(proc, di);
+}
+
+// Handlers of the instructions that take an OPMVV and an OPMVX form
+#define VOP_M(name, func)						\
+void insn_##name##_vv(struct proc *proc, const struct dinsn *di)	\
+{									\
+	func(proc, di, #name ".vv", true, 0);				\
+	insn_next(proc, di);						\
+}									\
+void insn_##name##_vx(struct proc *proc, const struct dinsn *di)	\
+{									\
+	func(proc, di, #name ".vx", false, getreg(proc, di->rs1));	\
+	insn_next(proc, di);						\
+}
+
+VOP_M(vmulh, velem)
+VOP_M(vmulhu, velem)
+VOP_M(vmulhsu, velem)
+VOP_M(vdivu, velem)
+VOP_M(vdiv, velem)
+VOP_M(vremu, velem)
+VOP_M(vrem, velem)
+VOP_M(vmacc, vmuladd)
+VOP_M(vnmsac, vmuladd)
+VOP_M(vmadd, vmuladd)
+VOP_M(vnmsub, vmuladd)
+VOP_M(vmsltu, vcmp)
+VOP_M(vmslt, vcmp)
+VOP_M(vrgather, vgather)
+#undef VOP_M
+
+/*
+ * Comparisons that also have an immediate form, it is sign-extended even for
+ * unsigned ones
+ */
+#define VCMP(name)							\
+void insn_##name##_vv(struct proc *proc, const struct dinsn *di)	\
+{									\
+	vcmp(proc, di, #name ".vv", true, 0);				\
+	insn_next(proc, di);						\
+}									\
+void insn_##name##_vx(struct proc *proc, const struct dinsn *di)	\
+{									\
+	vcmp(proc, di, #name ".vx", false, getreg(proc, di->rs1));	\
+	insn_next(proc, di);						\
+}									\
+void insn_##name##_vi(struct proc *proc, const struct dinsn *di)	\
+{									\
+	vcmp(proc, di, #name ".vi", false, (reg_t)di->imm);		\
+	insn_next(proc, di);						\
+}
+
+VCMP(vmseq)
+VCMP(vmsne)
+VCMP(vmsleu)
+VCMP(vmsle)
+#undef VCMP
+
+void insn_vmsgtu_vx(struct proc *proc, const struct dinsn *di)
+{
+	vcmp(proc, di, "vmsgtu.vx", false, getreg(proc, di->rs1));
+	insn_next(proc, di);
+}
+
+void insn_vmsgtu_vi(struct proc *proc, const struct dinsn *di)
+{
+	vcmp(proc, di, "vmsgtu.vi", false, (reg_t)di->imm);
+	insn_next(proc, di);
+}
+
+void insn_vmsgt_vx(struct proc *proc, const struct dinsn *di)
+{
+	vcmp(proc, di, "vmsgt.vx", false, getreg(proc, di->rs1));
+	insn_next(proc, di);
+}
+
+void insn_vmsgt_vi(struct proc *proc, const struct dinsn *di)
+{
+	vcmp(proc, di, "vmsgt.vi", false, (reg_t)di->imm);
+	insn_next(proc, di);
+}
+
+void insn_vrgather_vi(struct proc *proc, const struct dinsn *di)
+{
+	vgather(proc, di, "vrgather.vi", false, (reg_t)di->imm & 0x1f);
+	insn_next(proc, di);
+}
+
+void insn_vred(struct proc *proc, const struct dinsn *di)
+{
+	vred(proc, di, "vred");
+	insn_next(proc, di);
+}
+
+void insn_vmlogic(struct proc *proc, const struct dinsn *di)
+{
+	vmask(proc, di, "vm*.mm");
+	insn_next(proc, di);
+}
+
+void insn_vslideup_vx(struct proc *proc, const struct dinsn *di)
+{
+	vslide(proc, di, "vslideup.vx", getreg(proc, di->rs1), false);
+	insn_next(proc, di);
+}
+
+void insn_vslideup_vi(struct proc *proc, const struct dinsn *di)
+{
+	vslide(proc, di, "vslideup.vi", (reg_t)di->imm & 0x1f, false);
+	insn_next(proc, di);
+}
+
+void insn_vslidedown_vx(struct proc *proc, const struct dinsn *di)
+{
+	vslide(proc, di, "vslidedown.vx", getreg(proc, di->rs1), true);
+	insn_next(proc, di);
+}
+
+void insn_vslidedown_vi(struct proc *proc, const struct dinsn *di)
+{
+	vslide(proc, di, "vslidedown.vi", (reg_t)di->imm & 0x1f, true);
+	insn_next(proc, di);
+}
+
+// vslide1up and vslide1down slide by one and put x[rs1] in the hole
+void insn_vslide1up_vx(struct proc *proc, const struct dinsn *di)
+{
+	unsigned sew;
+	reg_t x = getreg(proc, di->rs1);
+
+	vslide(proc, di, "vslide1up.vx", 1, false);
+	sew = vsew(proc->v.vtype);
+	if (proc->v.vl > 0 && vactive(proc, di, 0))
+		vset(vreg(proc, di->rd), sew, 0, x);
+	insn_next(proc, di);
+}
+
+void insn_vslide1down_vx(struct proc *proc, const struct dinsn *di)
+{
+	unsigned sew;
+	reg_t x = getreg(proc, di->rs1);
+	size_t last = proc->v.vl - 1;
+
+	vslide(proc, di, "vslide1down.vx", 1, true);
+	sew = vsew(proc->v.vtype);
+	if (proc->v.vl > 0 && vactive(proc, di, last))
+		vset(vreg(proc, di->rd), sew, last, x);
+	insn_next(proc, di);
+}
+
+void insn_vmv_x_s(struct proc *proc, const struct dinsn *di)
+{
+	unsigned sew = vsew_check(proc, di);
+
+	mvreg(proc, di->rd, (reg_t)vsext(vget(vreg(proc, di->rs2), sew, 0),
+					 sew));
+	dbg_log("vmv.x.s: Setting x%d = 0x%lx", di->rd, getreg(proc, di->rd));
+	insn_next(proc, di);
+}
+
+void insn_vmv_s_x(struct proc *proc, const struct dinsn *di)
+{
+	unsigned sew = vsew_check(proc, di);
+
+	if (proc->v.vl > 0)
+		vset(vreg(proc, di->rd), sew, 0, getreg(proc, di->rs1));
+	dbg_log("vmv.s.x: Setting v%d[0]", di->rd);
+	insn_next(proc, di);
+}
+
+void insn_vcpop_m(struct proc *proc, const struct dinsn *di)
+{
+	const uint8_t *vs2 = vreg(proc, di->rs2);
+	reg_t n = 0;
+
+	vsew_check(proc, di);
+	for (size_t i = 0; i < proc->v.vl; ++i)
+		n += vactive(proc, di, i) && mask_get(vs2, i);
+	mvreg(proc, di->rd, n);
+	dbg_log("vcpop.m: Setting x%d = %lu", di->rd, n);
+	insn_next(proc, di);
+}
+
+void insn_vfirst_m(struct proc *proc, const struct dinsn *di)
+{
+	const uint8_t *vs2 = vreg(proc, di->rs2);
+	reg_t first = ~(reg_t)0;
+
+	vsew_check(proc, di);
+	for (size_t i = 0; i < proc->v.vl; ++i)
+		if (vactive(proc, di, i) && mask_get(vs2, i)) {
+			first = i;
+			break;
+		}
+	mvreg(proc, di->rd, first);
+	dbg_log("vfirst.m: Setting x%d = %ld", di->rd, (ireg_t)first);
+	insn_next(proc, di);
+}
+
+void insn_vid_v(struct proc *proc, const struct dinsn *di)
+{
+	unsigned sew = vsew_check(proc, di);
+
+	vgroup_check(proc, di, di->rd, vgroup_regs(vlmul(proc->v.vtype)));
+	if (!VM(di) && di->rd == 0)
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	for (size_t i = 0; i < proc->v.vl; ++i)
+		if (vactive(proc, di, i))
+			vset(vreg(proc, di->rd), sew, i, i);
+	dbg_log("vid.v: Setting v%d, vl = %lu", di->rd, proc->v.vl);
+	insn_next(proc, di);
+}
+
+// vmv<nr>r.v copy whole registers, like vl<nr>r.v, whatever vtype and vl are
+void insn_vmvr_v(struct proc *proc, const struct dinsn *di)
+{
+	unsigned nregs = ((di->insn >> 15) & 0x7) + 1;
+
+	if (proc->v.vstart != 0)
+		insn_trap(proc, di, CAUSE_ILLEGAL_INSN, di->insn);
+	vgroup_check(proc, di, di->rd, nregs);
+	vgroup_check(proc, di, di->rs2, nregs);
+	memmove(vreg(proc, di->rd), vreg(proc, di->rs2), nregs * VLENB);
+	dbg_log("vmv%ur.v: Setting v%d-v%d", nregs, di->rd,
+		di->rd + nregs - 1);
+	insn_next(proc, di);
+}
@@ -0,0 +1,536 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "riscv.h"
+#include "debug.h"
+#include "memory.h"
+#include "proc.h"
+#include "snapshot.h"
+#include "rv_f.h"
+
+#define PGDOWN(addr) ((addr) & ~PGOFFSET)
+#define PGUP(addr) (((addr) + PGOFFSET) & ~PGOFFSET)
+
+// Host address of page `page` of `seg`, counted from PGDOWN(seg->start)
+#define SEG_PAGE(seg, page) ((seg)->mem - ((seg)->start & PGOFFSET) + \
+			     ((size_t)(page) << PGSHIFT))
+#define SEG_NPAGES(seg) ((PGUP((seg)->end) - PGDOWN((seg)->start)) >> PGSHIFT)
+
+// /proc/self/pagemap entries, see Documentation/admin-guide/mm/pagemap.rst
+#define PM_PRESENT ((uint64_t)1 << 63)
+#define PM_SWAP ((uint64_t)1 << 62)
+#define PM_FILE ((uint64_t)1 << 61)
+#define PM_BATCH 512 // Entries read at once
+
+// A segment being checkpointed and the pages to write
+struct snapseg {
+	struct memseg *seg;
+	bool full;
+	struct snap_run *runs;
+	size_t nruns;
+	size_t cap;
+};
+
+// A checkpoint being restored
+struct snapfile {
+	int fd;
+	struct snap_hdr *hdr;
+	struct snap_seg *segs;
+};
+
+static int snap_runs(struct snapseg *ss, int pm) __attribute__((nonnull));
+static int snap_addrun(struct snapseg *ss, size_t page)
+	__attribute__((nonnull));
+static int snap_open(struct snapfile *sf, const char *path)
+	__attribute__((nonnull));
+static const struct snap_seg *snap_find(const struct snapfile *sf,
+					const struct memseg *seg)
+	__attribute__((nonnull));
+static int snap_load(struct memory *mem, struct memseg *seg,
+		     const struct snapfile *files, size_t nfiles,
+		     const struct snap_seg *top) __attribute__((nonnull));
+static int snap_map(struct memory *mem, struct memseg *seg, int fd,
+		    const struct snap_seg *ss, uint64_t page, uint64_t npages)
+	__attribute__((nonnull));
+static int pwrite_all(int fd, const void *buf, size_t len, off_t off)
+	__attribute__((nonnull));
+static bool page_zero(const unsigned char *page) __attribute__((nonnull));
+
+int proc_checkpoint(struct proc *proc, const char *path, bool incremental)
+{
+	struct snap_hdr *hdr = NULL;
+	struct snapseg *ss = NULL;
+	struct snap_seg *tab = NULL;
+	struct memseg *seg;
+	size_t nsegs = 0;
+	size_t nruns = 0;
+	size_t i;
+	off_t runs;
+	off_t off;
+	char *abspath = NULL;
+	char *tmp = NULL;
+	int fd = -1;
+	int pm = -1;
+	int err;
+
+	if (proc->exited) {
+		errno = EINVAL;
+		return -1;
+	}
+	// The other threads aren't saved
+	if (proc->thread) {
+		errno = ENOTSUP;
+		return -1;
+	}
+	incremental = incremental && proc->snap_path &&
+		      proc->snap_depth < SNAP_DEPTH_MAX &&
+		      strlen(proc->snap_path) < SNAP_PATH_MAX;
+	// A checkpoint replacing its parent can't name it
+	if (incremental && (abspath = realpath(path, NULL))) {
+		incremental = strcmp(abspath, proc->snap_path) != 0;
+		free(abspath);
+		abspath = NULL;
+	}
+	for (seg = proc->mem.segments; seg; seg = seg->next)
+		++nsegs;
+	if (!(hdr = calloc(1, PGSIZE)) || !(ss = calloc(nsegs, sizeof(*ss))) ||
+	    !(tab = calloc(nsegs, sizeof(*tab))))
+		goto err_out;
+	if (incremental && (pm = open("/proc/self/pagemap", O_RDONLY |
+	    O_CLOEXEC)) == -1)
+		goto err_out;
+
+	for (seg = proc->mem.segments, i = 0; seg; seg = seg->next, ++i) {
+		ss[i].seg = seg;
+		ss[i].full = !incremental || !seg->snap;
+		if (snap_runs(&ss[i], pm) == -1)
+			goto err_out;
+		nruns += ss[i].nruns;
+	}
+
+	runs = (off_t)(PGSIZE + nsegs * sizeof(*tab));
+	off = (off_t)PGUP((rvaddr_t)runs + nruns * sizeof(struct snap_run));
+	for (i = 0; i < nsegs; ++i) {
+		seg = ss[i].seg;
+		tab[i].start = seg->start;
+		tab[i].end = seg->end;
+		tab[i].flags = seg->flags | (ss[i].full ? SNAP_FULL : 0);
+		tab[i].offset = (uint64_t)off;
+		tab[i].runs = (uint64_t)runs;
+		tab[i].nruns = ss[i].nruns;
+		runs += (off_t)(ss[i].nruns * sizeof(struct snap_run));
+		off += (off_t)(SEG_NPAGES(seg) << PGSHIFT);
+	}
+
+	memcpy(hdr->magic, SNAP_MAGIC, sizeof(SNAP_MAGIC));
+	hdr->version = SNAP_VERSION;
+	if (incremental) {
+		hdr->depth = proc->snap_depth + 1;
+		strcpy(hdr->parent, proc->snap_path);
+	}
+	for (i = 0; i < 32; ++i)
+		hdr->regs[i] = proc->regs[i];
+	hdr->pc = proc->pc;
+	hdr->instret = proc->instret;
+	hdr->brk_start = proc->brk_start;
+	hdr->brk = proc->brk;
+	hdr->brk_max = proc->brk_max;
+	hdr->heap = proc->heap ? proc->heap->start : 0;
+	hdr->mmap_next = proc->mmap_next;
+	hdr->nsegs = nsegs;
+	// Not running, so the host has no flags of its own
+	hdr->fcsr = (uint64_t)proc->f.frm << FCSR_FRM_SHIFT | proc->f.fflags;
+	memcpy(hdr->fregs, proc->f.regs, sizeof(hdr->fregs));
+	hdr->vl = proc->v.vl;
+	hdr->vtype = proc->v.vtype;
+	hdr->vcsr = (uint64_t)(proc->v.vxrm << 1 | proc->v.vxsat);
+	memcpy(hdr->vregs, proc->v.regs, sizeof(hdr->vregs));
+
+	/*
+	 * The process may have pages mapped from the file at `path`, which
+	 * must keep them, so the checkpoint replaces it rather than truncating
+	 * it.
+	 */
+	if (!(tmp = malloc(strlen(path) + sizeof(".XXXXXX"))))
+		goto err_out;
+	sprintf(tmp, "%s.XXXXXX", path);
+	if ((fd = mkostemp(tmp, O_CLOEXEC)) == -1) {
+		free(tmp);
+		tmp = NULL;
+		goto err_out;
+	}
+	if (fchmod(fd, 0644) == -1 || ftruncate(fd, off) == -1)
+		goto err_out;
+	for (i = 0; i < nsegs; ++i) {
+		for (size_t r = 0; r < ss[i].nruns; ++r)
+			if (pwrite_all(fd, SEG_PAGE(ss[i].seg,
+			    ss[i].runs[r].page), ss[i].runs[r].npages << PGSHIFT,
+			    (off_t)(tab[i].offset + (ss[i].runs[r].page <<
+			    PGSHIFT))) == -1)
+				goto err_out;
+		if (pwrite_all(fd, ss[i].runs, ss[i].nruns *
+		    sizeof(struct snap_run), (off_t)tab[i].runs) == -1)
+			goto err_out;
+	}
+	if (pwrite_all(fd, tab, nsegs * sizeof(*tab), PGSIZE) == -1 ||
+	    pwrite_all(fd, hdr, PGSIZE, 0) == -1 || rename(tmp, path) == -1)
+		goto err_out;
+	free(tmp);
+	tmp = NULL;
+	// Incremental checkpoints name their parent in their header
+	if (!(abspath = realpath(path, NULL)))
+		goto err_out;
+	if (strlen(abspath) >= SNAP_PATH_MAX) {
+		errno = ENAMETOOLONG;
+		goto err_out;
+	}
+
+	/*
+	 * The file now has every page, mapping them from it makes the pages
+	 * the guest writes from now on the only anonymous ones. Pages that
+	 * stay unmapped are written again by the next checkpoint.
+	 */
+	for (i = 0; i < nsegs; ++i) {
+		seg = ss[i].seg;
+		if (ss[i].full)
+			mappages(&proc->mem, seg, PGDOWN(seg->start),
+				 SEG_NPAGES(seg) << PGSHIFT, fd,
+				 (off_t)tab[i].offset);
+		else
+			for (size_t r = 0; r < ss[i].nruns; ++r)
+				mappages(&proc->mem, seg, PGDOWN(seg->start) +
+					 (ss[i].runs[r].page << PGSHIFT),
+					 ss[i].runs[r].npages << PGSHIFT, fd,
+					 (off_t)(tab[i].offset +
+					 (ss[i].runs[r].page << PGSHIFT)));
+		if (protectseg(&proc->mem, seg) == -1)
+			warn_log("Cannot protect segment [0x%lx, 0x%lx[: %s",
+				 seg->start, seg->end, strerror(errno));
+		seg->snap = true;
+	}
+
+	free(proc->snap_path);
+	proc->snap_path = abspath;
+	proc->snap_depth = (uint32_t)hdr->depth;
+	dbg_log("Checkpoint %s: %zu segments, %zu runs, depth %lu", path,
+		nsegs, nruns, hdr->depth);
+	abspath = NULL;
+	err = 0;
+	goto out;
+
+err_out:
+	err = errno;
+out:
+	if (fd != -1)
+		close(fd);
+	if (tmp) {
+		unlink(tmp);
+		free(tmp);
+	}
+	if (pm != -1)
+		close(pm);
+	for (i = 0; ss && i < nsegs; ++i)
+		free(ss[i].runs);
+	free(abspath);
+	free(ss);
+	free(tab);
+	free(hdr);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+
+struct proc *proc_restore(const char *path, const struct procopts *opts)
+{
+	struct snapfile files[SNAP_DEPTH_MAX + 1] = {0};
+	const struct snap_hdr *hdr;
+	struct memseg **segs = NULL;
+	struct proc *proc = NULL;
+	const char *p = path;
+	size_t nfiles = 0;
+	size_t i;
+	int err = 0;
+
+	// The checkpoint, then its parents up to a full one
+	do {
+		if (snap_open(&files[nfiles++], p) == -1)
+			goto err_out;
+		if (nfiles > 1 && files[nfiles - 1].hdr->depth + 1 !=
+		    files[nfiles - 2].hdr->depth) {
+			err_log("%s: Not the parent of %s", p,
+				files[nfiles - 2].hdr->parent);
+			errno = EINVAL;
+			goto err_out;
+		}
+		p = files[nfiles - 1].hdr->parent;
+	} while (files[nfiles - 1].hdr->depth > 0);
+	hdr = files[0].hdr;
+
+	if (!(proc = calloc(1, sizeof(*proc))) ||
+	    !(segs = calloc(hdr->nsegs, sizeof(*segs))))
+		goto err_out;
+	initmem(&proc->mem, opts->flatmem);
+	for (i = 0; i < hdr->nsegs; ++i)
+		if (!(segs[i] = addseg(&proc->mem, files[0].segs[i].start,
+		    files[0].segs[i].end, (uint8_t)(files[0].segs[i].flags &
+		    (MEM_READ | MEM_WRITE | MEM_EXEC))))) {
+			errno = EINVAL;
+			goto err_out;
+		}
+	// Segments stay writable by the host until they are all loaded
+	for (i = 0; i < hdr->nsegs; ++i)
+		if (snap_load(&proc->mem, segs[i], files, nfiles,
+		    &files[0].segs[i]) == -1)
+			goto err_out;
+	for (i = 0; i < hdr->nsegs; ++i) {
+		if (protectseg(&proc->mem, segs[i]) == -1)
+			goto err_out;
+		segs[i]->snap = true;
+		if (hdr->heap && segs[i]->start == hdr->heap)
+			proc->heap = segs[i];
+	}
+
+	for (i = 0; i < 32; ++i)
+		proc->regs[i] = hdr->regs[i];
+	proc->pc = hdr->pc;
+	proc->instret = hdr->instret;
+	proc->brk_start = hdr->brk_start;
+	proc->brk = hdr->brk;
+	proc->brk_max = hdr->brk_max;
+	proc->mmap_next = hdr->mmap_next;
+	fp_init(proc, hdr->fcsr);
+	memcpy(proc->f.regs, hdr->fregs, sizeof(proc->f.regs));
+	proc->v.vl = hdr->vl;
+	proc->v.vtype = hdr->vtype;
+	proc->v.vxrm = (hdr->vcsr >> 1) & 0x3;
+	proc->v.vxsat = hdr->vcsr & 0x1;
+	memcpy(proc->v.regs, hdr->vregs, sizeof(proc->v.regs));
+	if (!(proc->snap_path = realpath(path, NULL)))
+		goto err_out;
+	proc->snap_depth = (uint32_t)hdr->depth;
+
+	if (proc_setup(proc, path, opts) == 0)
+		goto out;
+	errno = EINVAL;
+
+err_out:
+	err = errno;
+	err_log("%s: Cannot restore the checkpoint: %s", path, strerror(err));
+	if (proc)
+		proc_discard(proc);
+	proc = NULL;
+out:
+	for (i = 0; i < nfiles; ++i) {
+		if (files[i].fd != -1)
+			close(files[i].fd);
+		free(files[i].hdr);
+		free(files[i].segs);
+	}
+	free(segs);
+	if (err)
+		errno = err;
+	return proc;
+}
+
+/*
+ * Finds the pages of a segment to write: the ones that aren't zero if it is
+ * full, or else those that aren't backed by a file, which the guest wrote
+ * since the last checkpoint.
+ */
+static int snap_runs(struct snapseg *ss, int pm)
+{
+	const struct memseg *seg = ss->seg;
+	size_t npages = SEG_NPAGES(seg);
+	uint64_t pmap[PM_BATCH];
+	ssize_t ret;
+	off_t pmoff = (off_t)((uintptr_t)SEG_PAGE(seg, 0) >> PGSHIFT) *
+		      (off_t)sizeof(pmap[0]);
+	size_t n;
+	bool dirty;
+
+	for (size_t page = 0; page < npages; page += n) {
+		n = npages - page < PM_BATCH ? npages - page : PM_BATCH;
+		if (!ss->full && (ret = pread(pm, pmap, n * sizeof(pmap[0]),
+		    pmoff + (off_t)(page * sizeof(pmap[0])))) !=
+		    (ssize_t)(n * sizeof(pmap[0]))) {
+			if (ret >= 0)
+				errno = EIO;
+			return -1;
+		}
+		for (size_t k = 0; k < n; ++k) {
+			if (ss->full)
+				dirty = !page_zero(SEG_PAGE(seg, page + k));
+			else
+				dirty = (pmap[k] & PM_SWAP) ||
+					(pmap[k] & (PM_PRESENT | PM_FILE)) ==
+					PM_PRESENT;
+			if (dirty && snap_addrun(ss, page + k) == -1)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+static int snap_addrun(struct snapseg *ss, size_t page)
+{
+	struct snap_run *runs;
+	struct snap_run *last = ss->nruns ? &ss->runs[ss->nruns - 1] : NULL;
+
+	if (last && last->page + last->npages == page) {
+		++last->npages;
+		return 0;
+	}
+	if (ss->nruns == ss->cap) {
+		ss->cap = ss->cap ? 2 * ss->cap : 16;
+		if (!(runs = realloc(ss->runs, ss->cap * sizeof(*runs))))
+			return -1;
+		ss->runs = runs;
+	}
+	ss->runs[ss->nruns++] = (struct snap_run){.page = page, .npages = 1};
+	return 0;
+}
+
+// Reads the header and segment table of a checkpoint
+static int snap_open(struct snapfile *sf, const char *path)
+{
+	size_t len;
+
+	if ((sf->fd = open(path, O_RDONLY | O_CLOEXEC)) == -1) {
+		err_log("%s: %s", path, strerror(errno));
+		return -1;
+	}
+	if (!(sf->hdr = malloc(PGSIZE)))
+		return -1;
+	if (pread(sf->fd, sf->hdr, PGSIZE, 0) != (ssize_t)PGSIZE ||
+	    memcmp(sf->hdr->magic, SNAP_MAGIC, sizeof(SNAP_MAGIC)) != 0 ||
+	    sf->hdr->version != SNAP_VERSION ||
+	    sf->hdr->depth > SNAP_DEPTH_MAX ||
+	    !memchr(sf->hdr->parent, '\0', sizeof(sf->hdr->parent)) ||
+	    sf->hdr->nsegs > (SIZE_MAX - PGSIZE) / sizeof(*sf->segs)) {
+		err_log("%s: Not a checkpoint", path);
+		errno = EINVAL;
+		return -1;
+	}
+	len = sf->hdr->nsegs * sizeof(*sf->segs);
+	if (!(sf->segs = malloc(len ? len : 1)))
+		return -1;
+	if (pread(sf->fd, sf->segs, len, PGSIZE) != (ssize_t)len) {
+		err_log("%s: Truncated checkpoint", path);
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+// Returns the segment of a checkpoint that has the same range as `seg`
+static const struct snap_seg *snap_find(const struct snapfile *sf,
+					const struct memseg *seg)
+{
+	for (size_t i = 0; i < sf->hdr->nsegs; ++i)
+		if (sf->segs[i].start == seg->start &&
+		    sf->segs[i].end == seg->end)
+			return &sf->segs[i];
+	return NULL;
+}
+
+/*
+ * Maps the pages of a segment from the first checkpoint up the chain that has
+ * all of them, then the runs of the ones after it on top
+ */
+static int snap_load(struct memory *mem, struct memseg *seg,
+		     const struct snapfile *files, size_t nfiles,
+		     const struct snap_seg *top)
+{
+	const struct snap_seg *chain[SNAP_DEPTH_MAX + 1];
+	struct snap_run *runs;
+	size_t k = 0;
+	size_t len;
+
+	chain[0] = top;
+	while (!(chain[k]->flags & SNAP_FULL)) {
+		if (k + 1 >= nfiles || !(chain[k + 1] = snap_find(&files[k + 1],
+		    seg))) {
+			errno = EINVAL;
+			return -1;
+		}
+		++k;
+	}
+	if (snap_map(mem, seg, files[k].fd, chain[k], 0, SEG_NPAGES(seg)) == -1)
+		return -1;
+
+	while (k-- > 0) {
+		len = chain[k]->nruns * sizeof(*runs);
+		if (!(runs = malloc(len ? len : 1)))
+			return -1;
+		if (pread(files[k].fd, runs, len, (off_t)chain[k]->runs) !=
+		    (ssize_t)len) {
+			free(runs);
+			errno = EINVAL;
+			return -1;
+		}
+		for (size_t r = 0; r < chain[k]->nruns; ++r) {
+			if (runs[r].page + runs[r].npages > SEG_NPAGES(seg))
+				errno = EINVAL;
+			else if (snap_map(mem, seg, files[k].fd, chain[k],
+				 runs[r].page, runs[r].npages) == 0)
+				continue;
+			free(runs);
+			return -1;
+		}
+		free(runs);
+	}
+	return 0;
+}
+
+/*
+ * Maps pages of a segment from its checkpoint. mappages() leaves those
+ * shared with other segments alone, which can only be the first and last, so
+ * they are copied first.
+ */
+static int snap_map(struct memory *mem, struct memseg *seg, int fd,
+		    const struct snap_seg *ss, uint64_t page, uint64_t npages)
+{
+	off_t off = (off_t)(ss->offset + (page << PGSHIFT));
+
+	if (npages == 0)
+		return 0;
+	if (page == 0 && pread(fd, SEG_PAGE(seg, 0), PGSIZE, off) !=
+	    (ssize_t)PGSIZE)
+		return -1;
+	if (page + npages == SEG_NPAGES(seg) && pread(fd, SEG_PAGE(seg,
+	    page + npages - 1), PGSIZE, off + (off_t)((npages - 1) <<
+	    PGSHIFT)) != (ssize_t)PGSIZE)
+		return -1;
+	return mappages(mem, seg, PGDOWN(seg->start) + (page << PGSHIFT),
+			npages << PGSHIFT, fd, off);
+}
+
+static int pwrite_all(int fd, const void *buf, size_t len, off_t off)
+{
+	ssize_t ret;
+
+	while (len) {
+		if ((ret = pwrite(fd, buf, len, off)) == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf = (const unsigned char *)buf + ret;
+		len -= (size_t)ret;
+		off += ret;
+	}
+	return 0;
+}
+
+static bool page_zero(const unsigned char *page)
+{
+	return page[0] == 0 && memcmp(page, page + 1, PGSIZE - 1) == 0;
+}
@@ -0,0 +1,561 @@
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "riscv.h"
+#include "proc.h"
+#include "memory.h"
+#include "debug.h"
+#include "syscall.h"
+#include "thread.h"
+
+// Guest values of the flags of openat() and mmap(), from the generic ABI
+#define RV_O_ACCMODE 03
+#define RV_MAP_SHARED 0x01
+#define RV_MAP_FIXED 0x10
+#define RV_MAP_ANONYMOUS 0x20
+#define RV_PROT_READ 0x1
+#define RV_PROT_WRITE 0x2
+#define RV_PROT_EXEC 0x4
+#define RV_FUTEX_WAIT 0
+#define RV_FUTEX_WAKE 1
+#define RV_FUTEX_WAIT_BITSET 9
+#define RV_FUTEX_WAKE_BITSET 10
+#define RV_FUTEX_PRIVATE 128
+#define RV_FUTEX_CLOCK_REALTIME 256
+#define RV_FUTEX_BITSET_ANY 0xffffffff
+
+// Size of the guest struct stat, and of the iovec array readv() can take
+#define RV_STAT_SIZE 128
+#define RV_IOV_MAX 1024
+
+static const struct {
+	int rv;
+	int host;
+} open_flags[] = {
+	{0100, O_CREAT},
+	{0200, O_EXCL},
+	{0400, O_NOCTTY},
+	{01000, O_TRUNC},
+	{02000, O_APPEND},
+	{04000, O_NONBLOCK},
+	{010000, O_DSYNC},
+	{0200000, O_DIRECTORY},
+	{0400000, O_NOFOLLOW},
+	{02000000, O_CLOEXEC},
+};
+#define OPEN_FLAGS_LEN (sizeof(open_flags) / sizeof(*open_flags))
+
+static int64_t sys_rw(struct proc *proc, int fd, rvaddr_t addr, size_t len,
+		      bool write) __attribute__((nonnull));
+static int64_t sys_rwv(struct proc *proc, int fd, rvaddr_t addr, int iovcnt,
+		       bool write) __attribute__((nonnull));
+static int64_t sys_openat(struct proc *proc, int dirfd, rvaddr_t addr,
+			  int flags, mode_t mode) __attribute__((nonnull));
+static int64_t sys_fstat(struct proc *proc, int fd, rvaddr_t addr)
+	__attribute__((nonnull));
+static int64_t sys_clock_gettime(struct proc *proc, clockid_t clk,
+				 rvaddr_t addr) __attribute__((nonnull));
+static int64_t sys_brk(struct proc *proc, rvaddr_t addr)
+	__attribute__((nonnull));
+static int64_t sys_mmap(struct proc *proc, rvaddr_t addr, size_t len,
+			int prot, int flags, int fd, off_t off)
+	__attribute__((nonnull));
+static int64_t sys_munmap(struct proc *proc, rvaddr_t addr, size_t len)
+	__attribute__((nonnull));
+static int64_t sys_futex(struct proc *proc, rvaddr_t addr, int op,
+			 uint32_t val, rvaddr_t timeout, uint32_t val3)
+	__attribute__((nonnull));
+static int copyin(struct proc *proc, void *dst, rvaddr_t src, size_t len)
+	__attribute__((nonnull));
+static int copyout(struct proc *proc, rvaddr_t dst, const void *src,
+		   size_t len) __attribute__((nonnull));
+static size_t iov_len(const struct iovec *iov, int iovcnt);
+static void put_le(unsigned char *buf, size_t off, uint64_t val, uint8_t size)
+	__attribute__((nonnull));
+
+void sys_init(struct proc *proc)
+{
+	const struct memseg *seg;
+	rvaddr_t top = 0;
+
+	proc->brk = proc->brk_start;
+	proc->brk_max = SYS_MMAP_BASE;
+	for (seg = proc->mem.segments; seg; seg = seg->next) {
+		if (seg->end > top)
+			top = seg->end;
+		if (seg->start >= proc->brk_start && seg->start < proc->brk_max)
+			proc->brk_max = seg->start;
+	}
+	proc->mmap_next = (top + PGOFFSET) & ~PGOFFSET;
+	if (proc->mmap_next < SYS_MMAP_BASE)
+		proc->mmap_next = SYS_MMAP_BASE;
+	if (proc->brk_max > proc->mmap_next)
+		proc->brk_max = proc->mmap_next;
+}
+
+void sys_ecall(struct proc *proc)
+{
+	reg_t nr = getreg(proc, REG_A7);
+	reg_t a0 = getreg(proc, REG_A0);
+	reg_t a1 = getreg(proc, REG_A1);
+	reg_t a2 = getreg(proc, REG_A2);
+	int64_t ret;
+
+	switch (nr) {
+	case SYS_READ:
+	case SYS_WRITE:
+		ret = sys_rw(proc, (int)a0, a1, a2, nr == SYS_WRITE);
+		break;
+	case SYS_READV:
+	case SYS_WRITEV:
+		ret = sys_rwv(proc, (int)a0, a1, (int)a2, nr == SYS_WRITEV);
+		break;
+	case SYS_OPENAT:
+		ret = sys_openat(proc, (int)a0, a1, (int)a2,
+				 (mode_t)getreg(proc, REG_A3));
+		break;
+	case SYS_CLOSE:
+		ret = close((int)a0);
+		break;
+	case SYS_LSEEK:
+		ret = lseek((int)a0, (off_t)a1, (int)a2);
+		break;
+	case SYS_FSTAT:
+		ret = sys_fstat(proc, (int)a0, a1);
+		break;
+	case SYS_EXIT:
+	case SYS_EXIT_GROUP:
+		dbg_log("exit: Status %d", (int)a0);
+		if (!proc->thread)
+			proc_exit(proc, (int)a0);
+		// Only returns if another thread ended the process meanwhile
+		thread_exit(proc, (int)a0, nr == SYS_EXIT_GROUP);
+		return;
+	case SYS_SET_TID_ADDRESS:
+		proc->clear_tid = a0;
+		ret = thread_tid(proc);
+		break;
+	case SYS_FUTEX:
+		ret = sys_futex(proc, a0, (int)a1, (uint32_t)a2,
+				getreg(proc, REG_A3),
+				(uint32_t)getreg(proc, REG_A5));
+		break;
+	case SYS_CLOCK_GETTIME:
+		ret = sys_clock_gettime(proc, (clockid_t)a0, a1);
+		break;
+	case SYS_SCHED_YIELD:
+		ret = sched_yield();
+		break;
+	case SYS_GETPID:
+		ret = getpid();
+		break;
+	case SYS_GETTID:
+		ret = thread_tid(proc);
+		break;
+	// Other threads see the segments change together, see thread.h
+	case SYS_BRK:
+		thread_mmap_lock(proc);
+		ret = sys_brk(proc, a0);
+		thread_mmap_unlock(proc);
+		break;
+	case SYS_MMAP:
+		thread_mmap_lock(proc);
+		ret = sys_mmap(proc, a0, a1, (int)a2, (int)getreg(proc, REG_A3),
+			       (int)getreg(proc, REG_A4),
+			       (off_t)getreg(proc, REG_A5));
+		thread_mmap_unlock(proc);
+		break;
+	case SYS_MUNMAP:
+		thread_mmap_lock(proc);
+		ret = sys_munmap(proc, a0, a1);
+		thread_mmap_unlock(proc);
+		break;
+	case SYS_CLONE:
+		// As libcs pass them: flags, stack, ptid, tls, ctid
+		ret = thread_clone(proc, a0, a1, a2, getreg(proc, REG_A3),
+				   getreg(proc, REG_A4));
+		break;
+	default:
+		warn_log("Unsupported system call %lu at 0x%lx", nr, proc->pc);
+		errno = ENOSYS;
+		ret = -1;
+		break;
+	}
+
+	if (ret == -1)
+		ret = -errno;
+	mvreg(proc, REG_A0, (reg_t)ret);
+	dbg_log("syscall: %lu returned %ld", nr, ret);
+}
+
+// read() and write(), straight between the file and guest memory
+static int64_t sys_rw(struct proc *proc, int fd, rvaddr_t addr, size_t len,
+		      bool write)
+{
+	struct iovec iov[SYS_IOV_MAX];
+	int n;
+
+	if ((n = memiov(&proc->mem, addr, len, write ? MEM_READ : MEM_WRITE,
+	    iov, SYS_IOV_MAX)) == -1)
+		return -1;
+	return write ? writev(fd, iov, n) : readv(fd, iov, n);
+}
+
+/*
+ * readv() and writev(), every guest iovec is translated in place. The first
+ * one that isn't entirely accessible is the last one passed on, as a short
+ * transfer.
+ */
+static int64_t sys_rwv(struct proc *proc, int fd, rvaddr_t addr, int iovcnt,
+		       bool write)
+{
+	struct iovec iov[SYS_IOV_MAX];
+	unsigned char giov[16];
+	uint64_t base, len;
+	int n = 0;
+	int ret;
+
+	if (iovcnt < 0 || iovcnt > RV_IOV_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (int i = 0; i < iovcnt && n < SYS_IOV_MAX; ++i) {
+		if (copyin(proc, giov, addr + 16 * (rvaddr_t)i, 16) == -1)
+			return -1;
+		memcpy_le(&base, giov, 64);
+		memcpy_le(&len, giov + 8, 64);
+		if ((ret = memiov(&proc->mem, base, len, write ? MEM_READ :
+		    MEM_WRITE, iov + n, SYS_IOV_MAX - n)) == -1) {
+			if (n == 0)
+				return -1;
+			break;
+		}
+		n += ret;
+		if (iov_len(iov + n - ret, ret) < len)
+			break;
+	}
+	return write ? writev(fd, iov, n) : readv(fd, iov, n);
+}
+
+static int64_t sys_openat(struct proc *proc, int dirfd, rvaddr_t addr,
+			  int flags, mode_t mode)
+{
+	char path[PATH_MAX];
+	struct iovec iov[SYS_IOV_MAX];
+	size_t len = 0;
+	int hflags = flags & RV_O_ACCMODE;
+	int n;
+
+	// The path is the only buffer that must be copied, to be terminated
+	if ((n = memiov(&proc->mem, addr, sizeof(path), MEM_READ, iov,
+	    SYS_IOV_MAX)) == -1)
+		return -1;
+	for (int i = 0; i < n; ++i) {
+		memcpy(path + len, iov[i].iov_base, iov[i].iov_len);
+		len += iov[i].iov_len;
+	}
+	if (!memchr(path, '\0', len)) {
+		errno = len == sizeof(path) ? ENAMETOOLONG : EFAULT;
+		return -1;
+	}
+
+	for (size_t i = 0; i < OPEN_FLAGS_LEN; ++i)
+		if (flags & open_flags[i].rv)
+			hflags |= open_flags[i].host;
+	return openat(dirfd, path, hflags, mode);
+}
+
+// Writes the host's struct stat of `fd` as the guest's
+static int64_t sys_fstat(struct proc *proc, int fd, rvaddr_t addr)
+{
+	unsigned char buf[RV_STAT_SIZE] = {0};
+	struct stat st;
+
+	if (fstat(fd, &st) == -1)
+		return -1;
+	put_le(buf, 0, st.st_dev, 64);
+	put_le(buf, 8, st.st_ino, 64);
+	put_le(buf, 16, st.st_mode, 32);
+	put_le(buf, 20, st.st_nlink, 32);
+	put_le(buf, 24, st.st_uid, 32);
+	put_le(buf, 28, st.st_gid, 32);
+	put_le(buf, 32, st.st_rdev, 64);
+	put_le(buf, 48, (uint64_t)st.st_size, 64);
+	put_le(buf, 56, (uint64_t)st.st_blksize, 32);
+	put_le(buf, 64, (uint64_t)st.st_blocks, 64);
+	put_le(buf, 72, (uint64_t)st.st_atim.tv_sec, 64);
+	put_le(buf, 80, (uint64_t)st.st_atim.tv_nsec, 64);
+	put_le(buf, 88, (uint64_t)st.st_mtim.tv_sec, 64);
+	put_le(buf, 96, (uint64_t)st.st_mtim.tv_nsec, 64);
+	put_le(buf, 104, (uint64_t)st.st_ctim.tv_sec, 64);
+	put_le(buf, 112, (uint64_t)st.st_ctim.tv_nsec, 64);
+	return copyout(proc, addr, buf, sizeof(buf));
+}
+
+static int64_t sys_clock_gettime(struct proc *proc, clockid_t clk,
+				 rvaddr_t addr)
+{
+	unsigned char buf[16];
+	struct timespec ts;
+
+	if (clock_gettime(clk, &ts) == -1)
+		return -1;
+	put_le(buf, 0, (uint64_t)ts.tv_sec, 64);
+	put_le(buf, 8, (uint64_t)ts.tv_nsec, 64);
+	return copyout(proc, addr, buf, sizeof(buf));
+}
+
+/*
+ * Moves the program break within [brk_start, brk_max[, which no other
+ * segment overlaps, by resizing the heap segment. Returns the new break, or
+ * the old one if it can't move.
+ */
+static int64_t sys_brk(struct proc *proc, rvaddr_t addr)
+{
+	rvaddr_t end = (addr + PGOFFSET) & ~PGOFFSET;
+
+	if (addr < proc->brk_start || end > proc->brk_max)
+		return (int64_t)proc->brk;
+
+	if (end == proc->brk_start) {
+		if (proc->heap)
+			freeseg(&proc->mem, proc->heap);
+		proc->heap = NULL;
+	} else if (!proc->heap) {
+		if (!(proc->heap = addseg_unchecked(&proc->mem,
+		    proc->brk_start, end, MEM_READ | MEM_WRITE)))
+			return (int64_t)proc->brk;
+	} else if (end != proc->heap->end &&
+		   resizeseg(&proc->mem, proc->heap, end) == -1) {
+		return (int64_t)proc->brk;
+	}
+	proc->brk = addr;
+	return (int64_t)proc->brk;
+}
+
+/*
+ * Private file mappings go through mapseg(), so their pages are only read as
+ * they are touched. Shared writable mappings of files aren't supported, and
+ * PROT_NONE only reserves the range.
+ */
+static int64_t sys_mmap(struct proc *proc, rvaddr_t addr, size_t len,
+			int prot, int flags, int fd, off_t off)
+{
+	rvaddr_t size = ((rvaddr_t)len + PGOFFSET) & ~PGOFFSET;
+	uint8_t mflags = 0;
+	struct memseg *seg;
+	struct stat st;
+	size_t filesz = 0;
+
+	if (len == 0 || size < len || ((rvaddr_t)off & PGOFFSET) ||
+	    ((flags & RV_MAP_FIXED) && (addr & PGOFFSET)) ||
+	    (!(flags & RV_MAP_ANONYMOUS) && (flags & RV_MAP_SHARED) &&
+	     (prot & RV_PROT_WRITE))) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!(flags & RV_MAP_ANONYMOUS)) {
+		if (fstat(fd, &st) == -1)
+			return -1;
+		if (off < st.st_size)
+			filesz = (uint64_t)(st.st_size - off) < len ?
+				 (size_t)(st.st_size - off) : len;
+	}
+
+	mflags |= (prot & RV_PROT_READ) ? MEM_READ : 0;
+	mflags |= (prot & RV_PROT_WRITE) ? MEM_WRITE : 0;
+	mflags |= (prot & RV_PROT_EXEC) ? MEM_EXEC : 0;
+
+	if (!(flags & RV_MAP_FIXED)) {
+		if (size > FLAT_SIZE - proc->mmap_next) {
+			errno = ENOMEM;
+			return -1;
+		}
+		addr = proc->mmap_next;
+		proc->mmap_next += size;
+		if (mflags == 0)
+			return (int64_t)addr;
+		seg = addseg_unchecked(&proc->mem, addr, addr + size, mflags);
+	} else {
+		if (mflags == 0 && !overlap_memseg(&proc->mem, addr,
+		    addr + size))
+			return (int64_t)addr;
+		seg = addseg(&proc->mem, addr, addr + size, mflags);
+	}
+	if (!seg) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	if (filesz && mapseg(&proc->mem, seg, fd, off, filesz) == -1 &&
+	    pread(fd, seg->mem, filesz, off) != (ssize_t)filesz)
+		goto err_free;
+	if (protectseg(&proc->mem, seg) == -1)
+		goto err_free;
+	return (int64_t)addr;
+
+err_free:
+	freeseg(&proc->mem, seg);
+	errno = ENOMEM;
+	return -1;
+}
+
+// Only drops whole segments, and never the heap, see sys_brk()
+static int64_t sys_munmap(struct proc *proc, rvaddr_t addr, size_t len)
+{
+	rvaddr_t end = addr + (((rvaddr_t)len + PGOFFSET) & ~PGOFFSET);
+	struct memseg *seg;
+	struct memseg *next;
+
+	if ((addr & PGOFFSET) || len == 0 || end < addr) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (seg = proc->mem.segments; seg; seg = next) {
+		next = seg->next;
+		if (seg != proc->heap && seg->start >= addr && seg->end <= end)
+			freeseg(&proc->mem, seg);
+	}
+	return 0;
+}
+
+/*
+ * The futex operations libcs need, on the host futex of the guest word. Every
+ * futex is private, no other process can map guest memory. Relative timeouts
+ * are made absolute, see thread_futex_wait().
+ */
+static int64_t sys_futex(struct proc *proc, rvaddr_t addr, int op,
+			 uint32_t val, rvaddr_t timeout, uint32_t val3)
+{
+	const bool realtime = op & RV_FUTEX_CLOCK_REALTIME;
+	unsigned char buf[16];
+	struct timespec ts;
+	struct timespec now;
+	struct iovec iov;
+	uint64_t sec, nsec;
+
+	if (addr & 0x3) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (memiov(&proc->mem, addr, sizeof(uint32_t), MEM_READ, &iov,
+	    1) == -1 || iov.iov_len != sizeof(uint32_t)) {
+		errno = EFAULT;
+		return -1;
+	}
+
+	switch (op & ~(RV_FUTEX_PRIVATE | RV_FUTEX_CLOCK_REALTIME)) {
+	case RV_FUTEX_WAKE:
+		val3 = RV_FUTEX_BITSET_ANY;
+		// fall through
+	case RV_FUTEX_WAKE_BITSET:
+		return syscall(SYS_futex, iov.iov_base, FUTEX_WAKE_BITSET |
+			       FUTEX_PRIVATE_FLAG, val, NULL, NULL, val3);
+	case RV_FUTEX_WAIT:
+	case RV_FUTEX_WAIT_BITSET:
+		break;
+	default:
+		warn_log("Unsupported futex operation %d at 0x%lx", op,
+			 proc->pc);
+		errno = ENOSYS;
+		return -1;
+	}
+
+	if (timeout) {
+		if (copyin(proc, buf, timeout, sizeof(buf)) == -1)
+			return -1;
+		memcpy_le(&sec, buf, 64);
+		memcpy_le(&nsec, buf + 8, 64);
+		if (sec > INT64_MAX || nsec >= 1000000000) {
+			errno = EINVAL;
+			return -1;
+		}
+		ts.tv_sec = (time_t)sec;
+		ts.tv_nsec = (long)nsec;
+	}
+	// FUTEX_WAIT times out after a duration, on the monotonic clock
+	if ((op & ~(RV_FUTEX_PRIVATE | RV_FUTEX_CLOCK_REALTIME)) ==
+	    RV_FUTEX_WAIT) {
+		val3 = RV_FUTEX_BITSET_ANY;
+		if (timeout) {
+			clock_gettime(realtime ? CLOCK_REALTIME :
+				      CLOCK_MONOTONIC, &now);
+			ts.tv_sec += now.tv_sec + (ts.tv_nsec + now.tv_nsec) /
+				     1000000000;
+			ts.tv_nsec = (ts.tv_nsec + now.tv_nsec) % 1000000000;
+		}
+	}
+	return thread_futex_wait(proc, iov.iov_base, val, timeout ? &ts :
+				 NULL, realtime, val3);
+}
+
+// Copies guest memory, returns 0 or -1 with errno set to EFAULT
+static int copyin(struct proc *proc, void *dst, rvaddr_t src, size_t len)
+{
+	struct iovec iov[SYS_IOV_MAX];
+	int n;
+
+	if ((n = memiov(&proc->mem, src, len, MEM_READ, iov,
+	    SYS_IOV_MAX)) == -1)
+		return -1;
+	if (iov_len(iov, n) < len) {
+		errno = EFAULT;
+		return -1;
+	}
+	for (int i = 0; i < n; ++i) {
+		memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+		dst = (unsigned char *)dst + iov[i].iov_len;
+	}
+	return 0;
+}
+
+static int copyout(struct proc *proc, rvaddr_t dst, const void *src,
+		   size_t len)
+{
+	struct iovec iov[SYS_IOV_MAX];
+	int n;
+
+	if ((n = memiov(&proc->mem, dst, len, MEM_WRITE, iov,
+	    SYS_IOV_MAX)) == -1)
+		return -1;
+	if (iov_len(iov, n) < len) {
+		errno = EFAULT;
+		return -1;
+	}
+	for (int i = 0; i < n; ++i) {
+		memcpy(iov[i].iov_base, src, iov[i].iov_len);
+		src = (const unsigned char *)src + iov[i].iov_len;
+	}
+	return 0;
+}
+
+static size_t iov_len(const struct iovec *iov, int iovcnt)
+{
+	size_t len = 0;
+
+	for (int i = 0; i < iovcnt; ++i)
+		len += iov[i].iov_len;
+	return len;
+}
+
+// Stores a `size` bits field of a guest structure
+static void put_le(unsigned char *buf, size_t off, uint64_t val, uint8_t size)
+{
+	uint32_t val32 = (uint32_t)val;
+
+	if (size == 32)
+		memcpy_le(buf + off, &val32, 32);
+	else
+		memcpy_le(buf + off, &val, 64);
+}
@@ -0,0 +1,485 @@
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "riscv.h"
+#include "proc.h"
+#include "memory.h"
+#include "debug.h"
+#include "bbcache.h"
+#include "jit.h"
+#include "thread.h"
+
+// Guest values of the flags of clone(), from the generic ABI
+#define RV_CLONE_VM 0x00000100
+#define RV_CLONE_FS 0x00000200
+#define RV_CLONE_FILES 0x00000400
+#define RV_CLONE_SIGHAND 0x00000800
+#define RV_CLONE_THREAD 0x00010000
+#define RV_CLONE_SYSVSEM 0x00040000
+#define RV_CLONE_SETTLS 0x00080000
+#define RV_CLONE_PARENT_SETTID 0x00100000
+#define RV_CLONE_CHILD_CLEARTID 0x00200000
+#define RV_CLONE_DETACHED 0x00400000
+#define RV_CLONE_CHILD_SETTID 0x01000000
+
+// What clone() must be passed to start a thread, as libcs do, and may be
+#define CLONE_THREAD_FLAGS (RV_CLONE_VM | RV_CLONE_FS | RV_CLONE_FILES | \
+			    RV_CLONE_SIGHAND | RV_CLONE_THREAD)
+#define CLONE_OPT_FLAGS (RV_CLONE_SYSVSEM | RV_CLONE_SETTLS |		\
+			 RV_CLONE_PARENT_SETTID | RV_CLONE_CHILD_CLEARTID |	\
+			 RV_CLONE_DETACHED | RV_CLONE_CHILD_SETTID)
+
+/*
+ * Interrupts the system calls of host threads, so that they notice the
+ * process ending. Its default action is to do nothing.
+ */
+#define KICK_SIGNAL SIGURG
+/*
+ * Kicks can come just before a thread blocks, so futex waits wake up and
+ * look at the group this often, and so does thread_stop() to kick again
+ */
+#define KICK_NS 50000000
+
+static pthread_once_t kick_once = PTHREAD_ONCE_INIT;
+
+static int thread_init(struct proc *proc) __attribute__((nonnull, cold));
+static void *thread_main(void *arg) __attribute__((nonnull));
+static void thread_end(struct thgroup *g, const struct thread *self,
+		       int code) __attribute__((nonnull));
+static void thread_kick(struct thgroup *g, const struct thread *self)
+	__attribute__((nonnull));
+static uint32_t *tid_addr(struct proc *proc, rvaddr_t addr)
+	__attribute__((nonnull));
+static void timespec_add(struct timespec *ts, long ns)
+	__attribute__((nonnull));
+static void kick_handler(int sig);
+static void kick_install(void) __attribute__((cold));
+
+int64_t thread_clone(struct proc *proc, uint64_t flags, rvaddr_t stack,
+		     rvaddr_t ptid, rvaddr_t tls, rvaddr_t ctid)
+{
+	struct thgroup *g;
+	struct thread *t = NULL;
+	struct proc *child = NULL;
+	struct bbcache *bbcache = NULL;
+	struct jit *jit = NULL;
+	pthread_attr_t attr;
+	uint32_t *tid;
+	int err;
+
+	if ((flags & CLONE_THREAD_FLAGS) != CLONE_THREAD_FLAGS ||
+	    !proc->clone || !proc->mem.flat || proc->trace) {
+		warn_log("clone: Only threads of untraced processes in flat "
+			 "memory are supported");
+		errno = ENOSYS;
+		return -1;
+	}
+	if (flags & ~(uint64_t)(CLONE_THREAD_FLAGS | CLONE_OPT_FLAGS)) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (!proc->thread && thread_init(proc) == -1)
+		return -1;
+	g = proc->thread->group;
+
+	if (!(t = calloc(1, sizeof(*t))) || !(child = malloc(sizeof(*child)))
+	    || !(bbcache = bbcache_alloc())) {
+		err = EAGAIN;
+		goto err_free;
+	}
+	if (proc->jit && !(jit = jit_alloc(proc->jit->size, false)))
+		warn_log("Cannot start the JIT of a thread, only interpreting: "
+			 "%s", strerror(errno));
+	t->group = g;
+	t->proc = child;
+	t->tid = __atomic_fetch_add(&g->next_tid, 1, __ATOMIC_RELAXED);
+	// Set before the thread runs, which may read them
+	if ((flags & RV_CLONE_PARENT_SETTID) && (tid = tid_addr(proc, ptid)))
+		__atomic_store_n(tid, (uint32_t)t->tid, __ATOMIC_SEQ_CST);
+	if ((flags & RV_CLONE_CHILD_SETTID) && (tid = tid_addr(proc, ctid)))
+		__atomic_store_n(tid, (uint32_t)t->tid, __ATOMIC_SEQ_CST);
+
+	// The segments and the break only change under the lock
+	pthread_mutex_lock(&g->lock);
+	*child = *proc;
+	child->mem.xdirty_start = child->mem.xdirty_end = 0;
+	child->mem.wx_start = g->wx_start;
+	child->mem.wx_end = g->wx_end;
+	tlb_flush(&child->mem.tlb);
+	child->bbcache = bbcache;
+	child->jit = jit;
+	child->instret = child->fused = 0;
+	memset(&child->trap, 0, sizeof(child->trap));
+	child->trap_env = NULL;
+	child->snap_path = NULL;
+	child->snap_depth = 0;
+	child->thread = t;
+	child->clear_tid = (flags & RV_CLONE_CHILD_CLEARTID) ? ctid : 0;
+	child->resv = false;
+	child->regs[REG_A0] = 0;
+	if (stack)
+		child->regs[REG_SP] = stack;
+	if (flags & RV_CLONE_SETTLS)
+		child->regs[REG_TP] = tls;
+	// Past the ecall
+	child->pc = proc->pc + 4;
+	t->gen = g->gen;
+
+	t->next = g->threads;
+	g->threads = t;
+	++g->live;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	err = pthread_create(&t->host, &attr, thread_main, t);
+	pthread_attr_destroy(&attr);
+	if (err) {
+		g->threads = t->next;
+		--g->live;
+		pthread_mutex_unlock(&g->lock);
+		err = EAGAIN;
+		goto err_free;
+	}
+	pthread_mutex_unlock(&g->lock);
+	dbg_log("clone: Started thread %d at 0x%lx", t->tid, child->pc);
+	return t->tid;
+
+err_free:
+	if (jit)
+		jit_free(jit);
+	if (bbcache)
+		bbcache_free(bbcache);
+	free(child);
+	free(t);
+	errno = err;
+	return -1;
+}
+
+void thread_exit(struct proc *proc, int code, bool all)
+{
+	struct thread *t = proc->thread;
+	struct thgroup *g = t->group;
+	uint32_t *tid;
+	bool exiting;
+
+	if (all) {
+		pthread_mutex_lock(&g->lock);
+		thread_end(g, t, code);
+		pthread_mutex_unlock(&g->lock);
+		proc_exit(proc, code);
+	}
+
+	// Wakes the threads joining this one
+	if (proc->clear_tid && (tid = tid_addr(proc, proc->clear_tid))) {
+		__atomic_store_n(tid, 0, __ATOMIC_SEQ_CST);
+		syscall(SYS_futex, tid, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1,
+			NULL, NULL, 0);
+	}
+	if (t != g->leader)
+		proc_exit(proc, code);
+
+	pthread_mutex_lock(&g->lock);
+	while (g->live > 0 && !g->exiting)
+		pthread_cond_wait(&g->cond, &g->lock);
+	exiting = g->exiting;
+	pthread_mutex_unlock(&g->lock);
+	if (!exiting)
+		proc_exit(proc, code);
+}
+
+pid_t thread_tid(const struct proc *proc)
+{
+	return proc->thread ? proc->thread->tid : getpid();
+}
+
+int thread_futex_wait(struct proc *proc, uint32_t *uaddr, uint32_t val,
+		      const struct timespec *timeout, bool realtime,
+		      uint32_t mask)
+{
+	const int op = FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG |
+		       (realtime ? FUTEX_CLOCK_REALTIME : 0);
+	struct timespec slice;
+	bool last;
+
+	if (!proc->thread)
+		return (int)syscall(SYS_futex, uaddr, op, val, timeout, NULL,
+				    mask);
+
+	for (;;) {
+		if (__atomic_load_n(&proc->thread->group->exiting,
+				    __ATOMIC_ACQUIRE)) {
+			errno = EINTR;
+			return -1;
+		}
+		clock_gettime(realtime ? CLOCK_REALTIME : CLOCK_MONOTONIC,
+			      &slice);
+		timespec_add(&slice, KICK_NS);
+		last = timeout && (timeout->tv_sec < slice.tv_sec ||
+		       (timeout->tv_sec == slice.tv_sec &&
+			timeout->tv_nsec <= slice.tv_nsec));
+		if (syscall(SYS_futex, uaddr, op, val, last ? timeout : &slice,
+			    NULL, mask) == 0)
+			return 0;
+		if (errno != ETIMEDOUT || last)
+			return -1;
+	}
+}
+
+void thread_mmap_lock(struct proc *proc)
+{
+	struct thgroup *g;
+
+	if (!proc->thread)
+		return;
+	g = proc->thread->group;
+	pthread_mutex_lock(&g->lock);
+	// Grown from the latest, see wx_grow()
+	proc->mem.wx_start = g->wx_start;
+	proc->mem.wx_end = g->wx_end;
+}
+
+void thread_mmap_unlock(struct proc *proc)
+{
+	const struct memory *mem = &proc->mem;
+	struct thread *self = proc->thread;
+	struct thgroup *g;
+	struct thread *t;
+
+	if (!self)
+		return;
+	g = self->group;
+	for (t = g->threads; t; t = t->next) {
+		if (t == self)
+			continue;
+		t->proc->mem.segments = mem->segments;
+		t->proc->brk = proc->brk;
+		t->proc->heap = proc->heap;
+		t->proc->mmap_next = proc->mmap_next;
+		if (mem->xdirty_start >= mem->xdirty_end)
+			continue;
+		if (t->xdirty_start >= t->xdirty_end ||
+		    mem->xdirty_start < t->xdirty_start)
+			t->xdirty_start = mem->xdirty_start;
+		if (mem->xdirty_end > t->xdirty_end)
+			t->xdirty_end = mem->xdirty_end;
+	}
+	g->wx_start = mem->wx_start;
+	g->wx_end = mem->wx_end;
+	__atomic_store_n(&g->gen, g->gen + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&g->lock);
+}
+
+bool thread_sync(struct proc *proc, int *ret)
+{
+	struct thread *t = proc->thread;
+	struct thgroup *g = t->group;
+	bool failed = false;
+	bool stop;
+
+	pthread_mutex_lock(&g->lock);
+	t->gen = g->gen;
+	proc->mem.wx_start = g->wx_start;
+	proc->mem.wx_end = g->wx_end;
+	if (t->xdirty_start < t->xdirty_end) {
+		mark_xdirty(&proc->mem, t->xdirty_start, t->xdirty_end);
+		t->xdirty_start = t->xdirty_end = 0;
+	}
+	// May map pages that were unmapped
+	tlb_flush(&proc->mem.tlb);
+
+	stop = g->exiting;
+	if (stop && t == g->leader && g->failed) {
+		proc->trap = g->trap;
+		proc->pc = g->pc;
+		failed = true;
+		*ret = -1;
+	} else if (stop) {
+		proc->exited = true;
+		proc->exit_code = g->exit_code;
+		*ret = 0;
+	}
+	pthread_mutex_unlock(&g->lock);
+
+	bb_sync(proc);
+	if (failed)
+		errno = g->err;
+	return stop;
+}
+
+void thread_stop(struct proc *proc)
+{
+	struct thread *t = proc->thread;
+	struct thgroup *g;
+	struct timespec ts;
+
+	if (!t)
+		return;
+	g = t->group;
+	pthread_mutex_lock(&g->lock);
+	thread_end(g, t, proc->exit_code);
+	while (g->live > 0) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		timespec_add(&ts, KICK_NS);
+		if (pthread_cond_timedwait(&g->cond, &g->lock, &ts) ==
+		    ETIMEDOUT)
+			thread_kick(g, t);
+	}
+	proc->instret += g->instret;
+	g->instret = 0;
+	pthread_mutex_unlock(&g->lock);
+}
+
+void thread_free(struct proc *proc)
+{
+	struct thgroup *g = proc->thread->group;
+
+	thread_stop(proc);
+	pthread_cond_destroy(&g->cond);
+	pthread_mutex_destroy(&g->lock);
+	free(g);
+	free(proc->thread);
+	proc->thread = NULL;
+	proc->mem.lock = NULL;
+}
+
+// Makes `proc` the leader of a new group, before its first clone()
+static int thread_init(struct proc *proc)
+{
+	struct thgroup *g;
+	struct thread *t;
+
+	if (!(g = calloc(1, sizeof(*g))) || !(t = calloc(1, sizeof(*t)))) {
+		free(g);
+		errno = EAGAIN;
+		return -1;
+	}
+	pthread_mutex_init(&g->lock, NULL);
+	pthread_cond_init(&g->cond, NULL);
+	pthread_once(&kick_once, kick_install);
+
+	t->group = g;
+	t->proc = proc;
+	t->host = pthread_self();
+	t->tid = getpid();
+	g->threads = g->leader = t;
+	g->next_tid = t->tid + 1;
+	g->wx_start = proc->mem.wx_start;
+	g->wx_end = proc->mem.wx_end;
+	proc->thread = t;
+	proc->mem.lock = &g->lock;
+
+	// It would see the stores of other threads as its own mistakes
+	if (proc->jit && proc->jit->verify) {
+		warn_log("JIT: Not verifying the translations of threads");
+		proc->jit->verify = false;
+	}
+	return 0;
+}
+
+/*
+ * Runs a thread other than the leader to its end, then lets the group know
+ * and frees it
+ */
+static void *thread_main(void *arg)
+{
+	struct thread *t = arg;
+	struct proc *proc = t->proc;
+	struct thgroup *g = t->group;
+	struct thread **prev;
+	int ret;
+	int err;
+
+	ret = proc_run(proc, UINT64_MAX);
+	err = errno;
+
+	pthread_mutex_lock(&g->lock);
+	if (ret == -1 && !g->exiting) {
+		dbg_log("Thread %d stopped at pc 0x%lx", t->tid, proc->pc);
+		g->failed = true;
+		g->trap = proc->trap;
+		g->pc = proc->pc;
+		g->err = err;
+		thread_end(g, t, 1);
+	}
+	for (prev = &g->threads; *prev != t; prev = &(*prev)->next)
+		;
+	*prev = t->next;
+	g->instret += proc->instret;
+	if (proc->jit)
+		jit_free(proc->jit);
+	bbcache_free(proc->bbcache);
+	free(proc);
+	free(t);
+	--g->live;
+	pthread_cond_broadcast(&g->cond);
+	pthread_mutex_unlock(&g->lock);
+	return NULL;
+}
+
+/*
+ * Ends the process with status `code`, unless it is already ending, and
+ * makes every thread but `self` stop. Called with the lock held.
+ */
+static void thread_end(struct thgroup *g, const struct thread *self,
+		       int code)
+{
+	if (!g->exiting) {
+		g->exit_code = code;
+		__atomic_store_n(&g->exiting, true, __ATOMIC_RELEASE);
+	}
+	__atomic_store_n(&g->gen, g->gen + 1, __ATOMIC_RELEASE);
+	thread_kick(g, self);
+}
+
+// Interrupts the system calls of every thread but `self`
+static void thread_kick(struct thgroup *g, const struct thread *self)
+{
+	for (const struct thread *t = g->threads; t; t = t->next)
+		if (t != self)
+			pthread_kill(t->host, KICK_SIGNAL);
+}
+
+/*
+ * Host address of the thread id at guest address `addr`, e.g. for
+ * CLONE_CHILD_CLEARTID, or NULL if it can't be written
+ */
+static uint32_t *tid_addr(struct proc *proc, rvaddr_t addr)
+{
+	struct iovec iov;
+
+	if ((addr & 0x3) || memiov(&proc->mem, addr, sizeof(uint32_t),
+	    MEM_WRITE, &iov, 1) != 1 || iov.iov_len != sizeof(uint32_t))
+		return NULL;
+	return iov.iov_base;
+}
+
+static void timespec_add(struct timespec *ts, long ns)
+{
+	ts->tv_nsec += ns;
+	ts->tv_sec += ts->tv_nsec / 1000000000;
+	ts->tv_nsec %= 1000000000;
+}
+
+static void kick_handler(int sig)
+{
+	(void)sig;
+}
+
+// Without SA_RESTART, so that kicked system calls fail with EINTR
+static void kick_install(void)
+{
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = kick_handler;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(KICK_SIGNAL, &sa, NULL) == -1)
+		panic("Cannot install the thread signal handler");
+}
@@ -0,0 +1,305 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "riscv.h"
+#include "debug.h"
+#include "insn.h"
+#include "trace.h"
+
+// Fastest compression level, so that the writer keeps up with the emulator
+#define TRACE_GZMODE "wb1"
+
+/*
+ * Encoded records start with a tag byte holding the INSN_* flags of the
+ * instruction, and TREC_JUMP if it doesn't follow the previous one, i.e. if
+ * pcdelta isn't 2 after an INSN_RVC record or 4 after any other. Then come
+ * pcdelta as a zigzag varint if TREC_JUMP is set, the instruction as 4 little
+ * endian bytes, rdval as a varint if INSN_WRD is set and addr as a varint if
+ * INSN_LOAD or INSN_STORE is set. rd is taken back from the instruction.
+ */
+#define TREC_JUMP 0x80
+#define TREC_MAXLEN (1 + 10 + 4 + 10 + 10)
+
+static void *trace_writer(void *arg) __attribute__((nonnull));
+static int trace_write(struct trace *trace, const void *buf, size_t len)
+	__attribute__((nonnull));
+static size_t trace_encode(struct trace *trace, const struct trace_rec *rec,
+			   size_t n) __attribute__((nonnull));
+static unsigned char *put_varint(unsigned char *out, uint64_t val)
+	__attribute__((nonnull));
+static int get_varint(gzFile in, uint64_t *val) __attribute__((nonnull));
+
+struct trace *trace_open(const char *path, rvaddr_t start)
+{
+	struct trace_hdr hdr = {
+		.magic = TRACE_MAGIC,
+		.version = TRACE_VERSION,
+		.start = start,
+	};
+	struct trace *trace;
+	int err;
+
+	if (!(trace = calloc(1, sizeof(*trace))))
+		return NULL;
+	pthread_mutex_init(&trace->lock, NULL);
+	pthread_cond_init(&trace->cond, NULL);
+	if (!(trace->ring = malloc(TRACE_NCHUNKS * TRACE_CHUNK *
+	    sizeof(*trace->ring))))
+		goto err_free;
+	if (!(trace->enc = malloc(TRACE_CHUNK * TREC_MAXLEN)))
+		goto err_free;
+	errno = 0;
+	if (!(trace->out = gzopen(path, TRACE_GZMODE))) {
+		if (errno == 0)
+			errno = ENOMEM;
+		goto err_free;
+	}
+	if (trace_write(trace, &hdr, sizeof(hdr)) == -1)
+		goto err_close;
+
+	trace->cur = trace->ring;
+	trace->chunk_end = trace->ring + TRACE_CHUNK;
+	trace->lastpc = start;
+	if ((err = pthread_create(&trace->writer, NULL, trace_writer,
+	    trace)) != 0) {
+		errno = err;
+		goto err_close;
+	}
+	return trace;
+
+err_close:
+	err = errno;
+	gzclose(trace->out);
+	errno = err;
+err_free:
+	pthread_cond_destroy(&trace->cond);
+	pthread_mutex_destroy(&trace->lock);
+	free(trace->enc);
+	free(trace->ring);
+	free(trace);
+	return NULL;
+}
+
+int trace_close(struct trace *trace)
+{
+	struct trace_rec *chunk;
+	int err;
+
+	pthread_mutex_lock(&trace->lock);
+	trace->done = true;
+	pthread_cond_broadcast(&trace->cond);
+	pthread_mutex_unlock(&trace->lock);
+	pthread_join(trace->writer, NULL);
+
+	// The chunk being filled was never pushed
+	chunk = trace->chunk_end - TRACE_CHUNK;
+	trace_write(trace, trace->enc, trace_encode(trace, chunk,
+		    (size_t)(trace->cur - chunk)));
+	if (gzclose(trace->out) != Z_OK && trace->err == 0)
+		trace->err = EIO;
+
+	err = trace->err;
+	pthread_cond_destroy(&trace->cond);
+	pthread_mutex_destroy(&trace->lock);
+	free(trace->enc);
+	free(trace->ring);
+	free(trace);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+
+void trace_push(struct trace *trace)
+{
+	pthread_mutex_lock(&trace->lock);
+	++trace->head;
+	pthread_cond_broadcast(&trace->cond);
+	while (trace->head - trace->tail == TRACE_NCHUNKS)
+		pthread_cond_wait(&trace->cond, &trace->lock);
+	pthread_mutex_unlock(&trace->lock);
+
+	trace->cur = trace->ring + (trace->head % TRACE_NCHUNKS) * TRACE_CHUNK;
+	trace->chunk_end = trace->cur + TRACE_CHUNK;
+}
+
+struct trace_reader *trace_ropen(const char *path)
+{
+	struct trace_reader *rd;
+	struct trace_hdr hdr;
+
+	if (!(rd = malloc(sizeof(*rd))))
+		return NULL;
+	errno = 0;
+	if (!(rd->in = gzopen(path, "rb"))) {
+		if (errno == 0)
+			errno = ENOMEM;
+		free(rd);
+		return NULL;
+	}
+	if (gzfread(&hdr, sizeof(hdr), 1, rd->in) != 1 ||
+	    memcmp(hdr.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+	    hdr.version != TRACE_VERSION) {
+		gzclose(rd->in);
+		free(rd);
+		errno = EINVAL;
+		return NULL;
+	}
+	rd->pc = hdr.start;
+	rd->rvc = false;
+	return rd;
+}
+
+int trace_read(struct trace_reader *rd, struct trace_rec *rec, rvaddr_t *pc)
+{
+	unsigned char insn[4];
+	uint64_t delta;
+	int tag;
+
+	if ((tag = gzgetc(rd->in)) == -1)
+		return gzeof(rd->in) ? 0 : -1;
+
+	memset(rec, 0, sizeof(*rec));
+	rec->flags = (uint8_t)(tag & ~TREC_JUMP);
+	if (tag & TREC_JUMP) {
+		if (get_varint(rd->in, &delta) == -1)
+			goto err_trunc;
+		rec->pcdelta = (int64_t)(delta >> 1 ^ -(delta & 1));
+	} else {
+		rec->pcdelta = rd->rvc ? 2 : 4;
+	}
+	if (gzread(rd->in, insn, sizeof(insn)) != sizeof(insn))
+		goto err_trunc;
+	rec->insn = (insn_t)insn[0] | (insn_t)insn[1] << 8 |
+		    (insn_t)insn[2] << 16 | (insn_t)insn[3] << 24;
+	rec->rd = (uint8_t)((rec->insn >> 7) & 0x1f);
+	if ((rec->flags & INSN_WRD) && get_varint(rd->in, &rec->rdval) == -1)
+		goto err_trunc;
+	if ((rec->flags & (INSN_LOAD | INSN_STORE)) &&
+	    get_varint(rd->in, &rec->addr) == -1)
+		goto err_trunc;
+
+	rd->pc += (rvaddr_t)rec->pcdelta;
+	rd->rvc = rec->flags & INSN_RVC;
+	*pc = rd->pc;
+	return 1;
+
+err_trunc:
+	errno = EINVAL;
+	return -1;
+}
+
+void trace_rclose(struct trace_reader *rd)
+{
+	gzclose(rd->in);
+	free(rd);
+}
+
+// Encodes and compresses the chunks in [tail, head[ until the trace is closed
+static void *trace_writer(void *arg)
+{
+	struct trace *trace = arg;
+	struct trace_rec *chunk;
+	size_t len;
+
+	pthread_mutex_lock(&trace->lock);
+	for (;;) {
+		while (trace->tail == trace->head && !trace->done)
+			pthread_cond_wait(&trace->cond, &trace->lock);
+		if (trace->tail == trace->head)
+			break;
+		chunk = trace->ring + (trace->tail % TRACE_NCHUNKS) *
+			TRACE_CHUNK;
+		pthread_mutex_unlock(&trace->lock);
+
+		len = trace_encode(trace, chunk, TRACE_CHUNK);
+		pthread_mutex_lock(&trace->lock);
+		// The chunk can be reused as soon as it is encoded
+		++trace->tail;
+		pthread_cond_broadcast(&trace->cond);
+		pthread_mutex_unlock(&trace->lock);
+
+		trace_write(trace, trace->enc, len);
+		pthread_mutex_lock(&trace->lock);
+	}
+	pthread_mutex_unlock(&trace->lock);
+	return NULL;
+}
+
+// Keeps the first error in `trace->err`, later writes are skipped
+static int trace_write(struct trace *trace, const void *buf, size_t len)
+{
+	int err;
+
+	pthread_mutex_lock(&trace->lock);
+	err = trace->err;
+	pthread_mutex_unlock(&trace->lock);
+	if (err)
+		return -1;
+	if (len == 0 || gzfwrite(buf, 1, len, trace->out) == len)
+		return 0;
+
+	gzerror(trace->out, &err);
+	err = err == Z_ERRNO ? errno : EIO;
+	pthread_mutex_lock(&trace->lock);
+	trace->err = err;
+	pthread_mutex_unlock(&trace->lock);
+	warn_log("Cannot write trace: %s", strerror(err));
+	return -1;
+}
+
+// Encodes `n` records to `trace->enc`, returns the number of bytes written
+static size_t trace_encode(struct trace *trace, const struct trace_rec *rec,
+			   size_t n)
+{
+	unsigned char *p = trace->enc;
+	uint64_t delta;
+	bool jump;
+
+	for (size_t i = 0; i < n; ++i, ++rec) {
+		jump = rec->pcdelta != (trace->enc_rvc ? 2 : 4);
+		trace->enc_rvc = rec->flags & INSN_RVC;
+		*p++ = (unsigned char)(rec->flags | (jump ? TREC_JUMP : 0));
+		if (jump) {
+			delta = (uint64_t)rec->pcdelta;
+			p = put_varint(p, delta << 1 ^ -(delta >> 63));
+		}
+		*p++ = (unsigned char)rec->insn;
+		*p++ = (unsigned char)(rec->insn >> 8);
+		*p++ = (unsigned char)(rec->insn >> 16);
+		*p++ = (unsigned char)(rec->insn >> 24);
+		if (rec->flags & INSN_WRD)
+			p = put_varint(p, rec->rdval);
+		if (rec->flags & (INSN_LOAD | INSN_STORE))
+			p = put_varint(p, rec->addr);
+	}
+	return (size_t)(p - trace->enc);
+}
+
+static unsigned char *put_varint(unsigned char *out, uint64_t val)
+{
+	while (val >= 0x80) {
+		*out++ = (unsigned char)(val | 0x80);
+		val >>= 7;
+	}
+	*out++ = (unsigned char)val;
+	return out;
+}
+
+static int get_varint(gzFile in, uint64_t *val)
+{
+	int c;
+
+	*val = 0;
+	for (unsigned shift = 0; shift < 64; shift += 7) {
+		if ((c = gzgetc(in)) == -1)
+			return -1;
+		*val |= (uint64_t)(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return 0;
+	}
+	return -1;
+}
@@ -0,0 +1,242 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "vkern.h"
+
+/*
+ * Every kernel is instantiated from the same expressions, once per set, on
+ * GCC vector types of the register width of the host (or on the element type
+ * itself for the scalar fallback), whose operations the compiler turns into
+ * the SIMD instructions the function is compiled for. Vectors are only ever
+ * loaded and stored with memcpy(), never passed, so the SSE2 code never sees
+ * an AVX2 type. Elements that don't fill a host register are done one by one.
+ */
+
+// Scalar element types, `u` is unsigned and `s` signed
+typedef uint8_t eu8;
+typedef uint16_t eu16;
+typedef uint32_t eu32;
+typedef uint64_t eu64;
+typedef int8_t es8;
+typedef int16_t es16;
+typedef int32_t es32;
+typedef int64_t es64;
+
+#define VK_TYPES(set, size)						\
+	typedef eu8 vu8_##set __attribute__((vector_size(size)));	\
+	typedef eu16 vu16_##set __attribute__((vector_size(size)));	\
+	typedef eu32 vu32_##set __attribute__((vector_size(size)));	\
+	typedef eu64 vu64_##set __attribute__((vector_size(size)));	\
+	typedef es8 vs8_##set __attribute__((vector_size(size)));	\
+	typedef es16 vs16_##set __attribute__((vector_size(size)));	\
+	typedef es32 vs32_##set __attribute__((vector_size(size)));	\
+	typedef es64 vs64_##set __attribute__((vector_size(size)));
+
+typedef eu8 vu8_scalar;
+typedef eu16 vu16_scalar;
+typedef eu32 vu32_scalar;
+typedef eu64 vu64_scalar;
+typedef es8 vs8_scalar;
+typedef es16 vs16_scalar;
+typedef es32 vs32_scalar;
+typedef es64 vs64_scalar;
+
+/*
+ * a ? b : c, element-wise. Vector comparisons give all ones or zero in each
+ * element, of the signed type of the same width.
+ */
+#define SEL_S(T, cond, a, b) ((cond) ? (a) : (b))
+#define SEL_V(T, cond, a, b) (((T)(cond) & (a)) | (~(T)(cond) & (b)))
+
+// Broadcasts `x` to every element of a T
+#define SPLAT_S(T, E, x) ((E)(x))
+#define SPLAT_V(T, E, x) ((T){0} + (E)(x))
+
+// The operations, on elements or vectors `a` and `b` of type T
+#define OP_ADD(T, a, b, bits, SEL) ((a) + (b))
+#define OP_SUB(T, a, b, bits, SEL) ((a) - (b))
+#define OP_RSUB(T, a, b, bits, SEL) ((b) - (a))
+#define OP_AND(T, a, b, bits, SEL) ((a) & (b))
+#define OP_OR(T, a, b, bits, SEL) ((a) | (b))
+#define OP_XOR(T, a, b, bits, SEL) ((a) ^ (b))
+#define OP_MIN(T, a, b, bits, SEL) SEL(T, (a) < (b), a, b)
+#define OP_MAX(T, a, b, bits, SEL) SEL(T, (a) > (b), a, b)
+#define OP_MUL(T, a, b, bits, SEL) ((a) * (b))
+#define OP_SHL(T, a, b, bits, SEL) ((a) << ((b) & ((bits) - 1)))
+#define OP_SHR(T, a, b, bits, SEL) ((a) >> ((b) & ((bits) - 1)))
+#define OP_MV(T, a, b, bits, SEL) (b)
+
+#define VK_VV(set, attr, name, OP, sg, bits, SEL)			\
+static attr void vv_##name##bits##_##set(void *vd, const void *vs2,	\
+					 const void *vs1, size_t n)	\
+{									\
+	unsigned char *d = vd;						\
+	const unsigned char *p = vs2;					\
+	const unsigned char *q = vs1;					\
+	size_t i;							\
+									\
+	n *= sizeof(e##sg##bits);					\
+	for (i = 0; i + sizeof(v##sg##bits##_##set) <= n;		\
+	     i += sizeof(v##sg##bits##_##set)) {			\
+		v##sg##bits##_##set a, b, r;				\
+									\
+		memcpy(&a, p + i, sizeof(a));				\
+		memcpy(&b, q + i, sizeof(b));				\
+		r = (v##sg##bits##_##set)OP(v##sg##bits##_##set, a, b,	\
+					    bits, SEL);			\
+		memcpy(d + i, &r, sizeof(r));				\
+	}								\
+	for (; i < n; i += sizeof(e##sg##bits)) {			\
+		e##sg##bits a, b, r;					\
+									\
+		memcpy(&a, p + i, sizeof(a));				\
+		memcpy(&b, q + i, sizeof(b));				\
+		r = (e##sg##bits)OP(e##sg##bits, a, b, bits, SEL_S);	\
+		memcpy(d + i, &r, sizeof(r));				\
+	}								\
+}
+
+#define VK_VX(set, attr, name, OP, sg, bits, SEL, SPLAT)		\
+static attr void vx_##name##bits##_##set(void *vd, const void *vs2,	\
+					 uint64_t x, size_t n)		\
+{									\
+	unsigned char *d = vd;						\
+	const unsigned char *p = vs2;					\
+	const v##sg##bits##_##set b = SPLAT(v##sg##bits##_##set,	\
+					    e##sg##bits, x);		\
+	const e##sg##bits e = (e##sg##bits)x;				\
+	size_t i;							\
+									\
+	n *= sizeof(e##sg##bits);					\
+	for (i = 0; i + sizeof(b) <= n; i += sizeof(b)) {		\
+		v##sg##bits##_##set a, r;				\
+									\
+		memcpy(&a, p + i, sizeof(a));				\
+		r = (v##sg##bits##_##set)OP(v##sg##bits##_##set, a, b,	\
+					    bits, SEL);			\
+		memcpy(d + i, &r, sizeof(r));				\
+	}								\
+	for (; i < n; i += sizeof(e)) {					\
+		e##sg##bits a, r;					\
+									\
+		memcpy(&a, p + i, sizeof(a));				\
+		r = (e##sg##bits)OP(e##sg##bits, a, e, bits, SEL_S);	\
+		memcpy(d + i, &r, sizeof(r));				\
+	}								\
+}
+
+#define VK_OP(set, attr, name, OP, sg, SEL, SPLAT)			\
+	VK_VV(set, attr, name, OP, sg, 8, SEL)				\
+	VK_VV(set, attr, name, OP, sg, 16, SEL)				\
+	VK_VV(set, attr, name, OP, sg, 32, SEL)				\
+	VK_VV(set, attr, name, OP, sg, 64, SEL)				\
+	VK_VX(set, attr, name, OP, sg, 8, SEL, SPLAT)			\
+	VK_VX(set, attr, name, OP, sg, 16, SEL, SPLAT)			\
+	VK_VX(set, attr, name, OP, sg, 32, SEL, SPLAT)			\
+	VK_VX(set, attr, name, OP, sg, 64, SEL, SPLAT)
+
+#define VK_ROW(kind, set, name, op)					\
+	[op] = {kind##_##name##8_##set, kind##_##name##16_##set,	\
+		kind##_##name##32_##set, kind##_##name##64_##set}
+
+#define VK_ROWS(kind, set)						\
+	VK_ROW(kind, set, add, VK_ADD),					\
+	VK_ROW(kind, set, sub, VK_SUB),					\
+	VK_ROW(kind, set, rsub, VK_RSUB),				\
+	VK_ROW(kind, set, and, VK_AND),					\
+	VK_ROW(kind, set, or, VK_OR),					\
+	VK_ROW(kind, set, xor, VK_XOR),					\
+	VK_ROW(kind, set, min, VK_MIN),					\
+	VK_ROW(kind, set, minu, VK_MINU),				\
+	VK_ROW(kind, set, max, VK_MAX),					\
+	VK_ROW(kind, set, maxu, VK_MAXU),				\
+	VK_ROW(kind, set, mul, VK_MUL),					\
+	VK_ROW(kind, set, sll, VK_SLL),					\
+	VK_ROW(kind, set, srl, VK_SRL),					\
+	VK_ROW(kind, set, sra, VK_SRA),					\
+	VK_ROW(kind, set, mv, VK_MV)
+
+// Defines the kernels of a set and its struct vkern, `vkern_<set>`
+#define VK_SET(set, attr, SEL, SPLAT)					\
+	VK_OP(set, attr, add, OP_ADD, u, SEL, SPLAT)			\
+	VK_OP(set, attr, sub, OP_SUB, u, SEL, SPLAT)			\
+	VK_OP(set, attr, rsub, OP_RSUB, u, SEL, SPLAT)			\
+	VK_OP(set, attr, and, OP_AND, u, SEL, SPLAT)			\
+	VK_OP(set, attr, or, OP_OR, u, SEL, SPLAT)			\
+	VK_OP(set, attr, xor, OP_XOR, u, SEL, SPLAT)			\
+	VK_OP(set, attr, min, OP_MIN, s, SEL, SPLAT)			\
+	VK_OP(set, attr, minu, OP_MIN, u, SEL, SPLAT)			\
+	VK_OP(set, attr, max, OP_MAX, s, SEL, SPLAT)			\
+	VK_OP(set, attr, maxu, OP_MAX, u, SEL, SPLAT)			\
+	VK_OP(set, attr, mul, OP_MUL, u, SEL, SPLAT)			\
+	VK_OP(set, attr, sll, OP_SHL, u, SEL, SPLAT)			\
+	VK_OP(set, attr, srl, OP_SHR, u, SEL, SPLAT)			\
+	VK_OP(set, attr, sra, OP_SHR, s, SEL, SPLAT)			\
+	VK_OP(set, attr, mv, OP_MV, u, SEL, SPLAT)			\
+	static const struct vkern vkern_##set = {			\
+		.name = #set,						\
+		.vv = {VK_ROWS(vv, set)},				\
+		.vx = {VK_ROWS(vx, set)},				\
+	};
+
+VK_SET(scalar, , SEL_S, SPLAT_S)
+#ifdef __x86_64__
+VK_TYPES(sse2, 16)
+VK_TYPES(avx2, 32)
+VK_SET(sse2, , SEL_V, SPLAT_V)
+VK_SET(avx2, __attribute__((target("avx2"))), SEL_V, SPLAT_V)
+#endif
+
+const struct vkern *vkern = &vkern_scalar;
+
+static bool vkern_supported(const struct vkern *set) __attribute__((cold));
+static void vkern_init(void) __attribute__((constructor, cold));
+
+int vkern_select(const char *name)
+{
+	static const struct vkern *const sets[] = {
+		&vkern_scalar,
+#ifdef __x86_64__
+		&vkern_sse2,
+		&vkern_avx2,
+#endif
+	};
+
+	for (size_t i = 0; i < sizeof(sets) / sizeof(*sets); ++i) {
+		if (strcmp(sets[i]->name, name) != 0)
+			continue;
+		if (!vkern_supported(sets[i])) {
+			errno = ENOTSUP;
+			return -1;
+		}
+		vkern = sets[i];
+		return 0;
+	}
+	errno = EINVAL;
+	return -1;
+}
+
+static bool vkern_supported(const struct vkern *set)
+{
+#ifdef __x86_64__
+	// Constructors may run before the CPU model is known
+	__builtin_cpu_init();
+	if (set == &vkern_avx2)
+		return __builtin_cpu_supports("avx2");
+	if (set == &vkern_sse2)
+		return __builtin_cpu_supports("sse2");
+#endif
+	return set == &vkern_scalar;
+}
+
+static void vkern_init(void)
+{
+#ifdef __x86_64__
+	if (vkern_supported(&vkern_avx2))
+		vkern = &vkern_avx2;
+	else if (vkern_supported(&vkern_sse2))
+		vkern = &vkern_sse2;
+#endif
+}
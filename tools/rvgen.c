@@ -0,0 +1,678 @@
+/*
+ * Generates RV64 executables for benchmarks and tests, without a RISC-V
+ * toolchain. Each one runs a loop of -n iterations over a body of one kind,
+ * which stresses one path of the emulator:
+ *
+ *   alu     -l random integer instructions, and with -m those of the M
+ *           extension too
+ *   ldst    -l loads and stores, -w percent of them stores, streaming through
+ *           -f KiB of .bss -s bytes apart, as wide as the stride is aligned
+ *           up to 8 bytes
+ *   branch  -l branches, each taken -p percent of the time at random
+ *   call    -l nested calls, each saving its return address on the stack
+ *   text    -f KiB of code, blocks of -l instructions that jump to each
+ *           other in a random order
+ *
+ * -n defaults to 1000000, or for text to as many iterations as run about
+ * TEXT_INSNS instructions, since each one runs all of its code.
+ *
+ * Programs then print a checksum of their registers in hex, and exit with 0,
+ * so that runs with different engines or options can be compared. -r seeds
+ * the random choices, the same options always give the same file.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <elf.h>
+#include "riscv.h"
+#include "insn.h"
+
+#define TEXT_BASE 0x10000
+#define TEXT_OFFSET 0x1000
+#define DATA_BASE 0x10000000
+#define DATA_MAX ((uint64_t)1 << 30)
+// Of jal and of the conditional branches, in bytes either way
+#define JAL_REACH ((int64_t)1 << 20)
+#define BRANCH_REACH ((int64_t)1 << 12)
+#define SYS_WRITE 64
+#define SYS_EXIT 93
+// Instructions text programs run by default, seconds rather than minutes
+#define TEXT_INSNS 1000000000
+
+enum kind {
+	KIND_ALU,
+	KIND_LDST,
+	KIND_BRANCH,
+	KIND_CALL,
+	KIND_TEXT,
+};
+
+struct genopts {
+	enum kind kind;
+	uint64_t iters; // 0 for the default
+	unsigned len;
+	uint64_t footprint; // In bytes, of .bss or code, 0 for the default
+	uint64_t stride;
+	unsigned stores; // Percent
+	unsigned taken; // Percent
+	bool muldiv;
+	uint64_t seed;
+};
+
+/*
+ * A program being generated. Allocation failures set `failed`, which is only
+ * checked once it is complete.
+ */
+struct gen {
+	insn_t *code;
+	size_t len;
+	size_t cap;
+	bool failed;
+	uint64_t state; // Of randbits()
+};
+
+// Registers the bodies compute in, s0 is the loop counter
+static const unsigned pool[] = {
+	REG_A0, REG_A1, REG_A2, REG_A3, REG_A4, REG_A5, REG_A6, REG_A7,
+	REG_T0, REG_T1, REG_T2, REG_T3, REG_T4, REG_T5,
+};
+#define NPOOL (sizeof(pool) / sizeof(*pool))
+
+static void usage(const char *argv0) __attribute__((nonnull, cold));
+static uint64_t randbits(uint64_t *state) __attribute__((nonnull));
+
+static insn_t rtype(insn_t match, unsigned rd, unsigned rs1, unsigned rs2);
+static insn_t itype(insn_t match, unsigned rd, unsigned rs1, int32_t imm);
+static insn_t stype(insn_t match, unsigned rs1, unsigned rs2, int32_t imm);
+static insn_t btype(insn_t match, unsigned rs1, unsigned rs2, int32_t imm);
+static insn_t utype(insn_t match, unsigned rd, int32_t imm);
+static insn_t jtype(unsigned rd, int32_t imm);
+
+static void emit(struct gen *g, insn_t insn) __attribute__((nonnull));
+static void emit_li(struct gen *g, unsigned rd, int32_t imm)
+	__attribute__((nonnull));
+static void emit_alu(struct gen *g, bool muldiv) __attribute__((nonnull));
+static void emit_jump(struct gen *g, unsigned rd, size_t target, bool far)
+	__attribute__((nonnull));
+static void emit_loop_end(struct gen *g, size_t head) __attribute__((nonnull));
+static void emit_exit(struct gen *g) __attribute__((nonnull));
+
+static void gen_alu(struct gen *g, const struct genopts *o)
+	__attribute__((nonnull));
+static void gen_ldst(struct gen *g, const struct genopts *o)
+	__attribute__((nonnull));
+static void gen_branch(struct gen *g, const struct genopts *o)
+	__attribute__((nonnull));
+static void gen_call(struct gen *g, const struct genopts *o)
+	__attribute__((nonnull));
+static void gen_text(struct gen *g, const struct genopts *o)
+	__attribute__((nonnull));
+static int writeelf(FILE *fp, const struct gen *g, uint64_t bss)
+	__attribute__((nonnull));
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [-m] [-k alu|ldst|branch|call|text] "
+		"[-n iterations] [-l length] [-f footprint KiB] [-s stride] "
+		"[-w stores %%] [-p taken %%] [-r seed] output\n", argv0);
+}
+
+// xorshift64*
+static uint64_t randbits(uint64_t *state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return *state * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+static insn_t rtype(insn_t match, unsigned rd, unsigned rs1, unsigned rs2)
+{
+	return match | rd << 7 | rs1 << 15 | rs2 << 20;
+}
+
+static insn_t itype(insn_t match, unsigned rd, unsigned rs1, int32_t imm)
+{
+	return match | rd << 7 | rs1 << 15 | ((insn_t)imm & 0xfff) << 20;
+}
+
+static insn_t stype(insn_t match, unsigned rs1, unsigned rs2, int32_t imm)
+{
+	return match | ((insn_t)imm & 0x1f) << 7 | rs1 << 15 | rs2 << 20 |
+	       ((insn_t)imm & 0xfe0) << 20;
+}
+
+static insn_t btype(insn_t match, unsigned rs1, unsigned rs2, int32_t imm)
+{
+	const insn_t u = (insn_t)imm;
+
+	return match | (u >> 12 & 0x1) << 31 | (u >> 5 & 0x3f) << 25 |
+	       rs2 << 20 | rs1 << 15 | (u >> 1 & 0xf) << 8 |
+	       (u >> 11 & 0x1) << 7;
+}
+
+static insn_t utype(insn_t match, unsigned rd, int32_t imm)
+{
+	return match | ((insn_t)imm & 0xfffff000) | rd << 7;
+}
+
+static insn_t jtype(unsigned rd, int32_t imm)
+{
+	const insn_t u = (insn_t)imm;
+
+	return MATCH_JAL | (u & 0x100000) << 11 | (u & 0x7fe) << 20 |
+	       (u & 0x800) << 9 | (u & 0xff000) | rd << 7;
+}
+
+static void emit(struct gen *g, insn_t insn)
+{
+	insn_t *code;
+	size_t cap;
+
+	if (g->len == g->cap) {
+		cap = g->cap ? 2 * g->cap : 1024;
+		if (!(code = realloc(g->code, cap * sizeof(*code)))) {
+			g->failed = true;
+			return;
+		}
+		g->code = code;
+		g->cap = cap;
+	}
+	g->code[g->len++] = insn;
+}
+
+// lui and addiw, or only one of them when it is enough
+static void emit_li(struct gen *g, unsigned rd, int32_t imm)
+{
+	const int32_t lo = (int32_t)((uint32_t)imm << 20) >> 20;
+	const int32_t hi = (int32_t)((uint32_t)imm - (uint32_t)lo);
+
+	if (!hi) {
+		emit(g, itype(MATCH_ADDI, rd, 0, lo));
+		return;
+	}
+	emit(g, utype(MATCH_LUI, rd, hi));
+	if (lo)
+		emit(g, itype(MATCH_ADDIW, rd, rd, lo));
+}
+
+/*
+ * A random integer instruction. Only t0-t5 are written by those that lose
+ * bits, e.g. slt, and or shifts, a0-a7 only get another register or an
+ * immediate added, subtracted or xored, which loses none: values then keep
+ * changing from one iteration to the next, and so does the checksum.
+ */
+static void emit_alu(struct gen *g, bool muldiv)
+{
+	static const insn_t aops[] = {MATCH_ADD, MATCH_SUB, MATCH_XOR};
+	static const insn_t rops[] = {
+		MATCH_ADD, MATCH_SUB, MATCH_XOR, MATCH_OR, MATCH_AND,
+		MATCH_SLL, MATCH_SRL, MATCH_SRA, MATCH_SLT, MATCH_SLTU,
+		MATCH_ADDW, MATCH_SUBW, MATCH_SLLW, MATCH_SRLW, MATCH_SRAW,
+	};
+	static const insn_t iops[] = {
+		MATCH_ADDI, MATCH_XORI, MATCH_ORI, MATCH_ANDI, MATCH_SLTI,
+		MATCH_ADDIW,
+	};
+	static const insn_t shops[] = {MATCH_SLLI, MATCH_SRLI, MATCH_SRAI};
+	static const insn_t shwops[] = {
+		MATCH_SLLIW, MATCH_SRLIW, MATCH_SRAIW,
+	};
+	static const insn_t mops[] = {
+		MATCH_MUL, MATCH_MULH, MATCH_MULHU, MATCH_MULW, MATCH_DIV,
+		MATCH_DIVU, MATCH_REM, MATCH_REMU, MATCH_DIVW, MATCH_REMUW,
+	};
+	const uint64_t r = randbits(&g->state);
+	const unsigned rs1 = pool[(r >> 8) % NPOOL];
+	const unsigned rs2 = pool[(r >> 16) % NPOOL];
+	const int32_t imm = (int32_t)(r >> 32 & 0xfff) - 0x800;
+	const unsigned sel = (unsigned)(r >> 40 & 0xff);
+	unsigned rd;
+
+	if (r & 0x1) {
+		rd = pool[(r >> 24) % 8];
+		if (sel % 4 == 3)
+			emit(g, itype(sel & 0x4 ? MATCH_XORI : MATCH_ADDI, rd, rd,
+				      imm));
+		else
+			emit(g, rtype(aops[sel % 4], rd, rd,
+				      rs2 == rd ? REG_T0 : rs2));
+		return;
+	}
+
+	// Mostly register ones, as compiled code is
+	rd = pool[8 + (r >> 24) % (NPOOL - 8)];
+	switch (r >> 1 & 0x7) {
+	case 0:
+	case 1:
+	case 2:
+		emit(g, rtype(rops[sel % (sizeof(rops) / sizeof(*rops))], rd,
+			      rs1, rs2));
+		break;
+	case 3:
+	case 4:
+		emit(g, itype(iops[sel % (sizeof(iops) / sizeof(*iops))], rd,
+			      rs1, imm));
+		break;
+	case 5:
+		emit(g, itype(shops[sel % 3], rd, rs1, imm & 0x3f));
+		break;
+	case 6:
+		emit(g, itype(shwops[sel % 3], rd, rs1, imm & 0x1f));
+		break;
+	default:
+		if (muldiv)
+			emit(g, rtype(mops[sel % (sizeof(mops) /
+						  sizeof(*mops))], rd, rs1,
+				      rs2));
+		else
+			emit(g, rtype(MATCH_ADD, rd, rs1, rs2));
+		break;
+	}
+}
+
+/*
+ * Jumps to instruction `target` with jal, or with auipc t6 and jalr if `far`
+ * is set, which takes two instructions however far it is
+ */
+static void emit_jump(struct gen *g, unsigned rd, size_t target, bool far)
+{
+	const int32_t off = (int32_t)((int64_t)target - (int64_t)g->len) * 4;
+	const int32_t lo = (int32_t)((uint32_t)off << 20) >> 20;
+
+	if (!far) {
+		emit(g, jtype(rd, off));
+		return;
+	}
+	emit(g, utype(MATCH_AUIPC, REG_T6, off - lo));
+	emit(g, itype(MATCH_JALR, rd, REG_T6, lo));
+}
+
+// Decrements s0 and goes back to instruction `head` until it is zero
+static void emit_loop_end(struct gen *g, size_t head)
+{
+	int64_t off;
+	bool far;
+
+	emit(g, itype(MATCH_ADDI, REG_S0, REG_S0, -1));
+	off = ((int64_t)head - (int64_t)g->len) * 4;
+	if (off >= -BRANCH_REACH) {
+		emit(g, btype(MATCH_BNE, REG_S0, 0, (int32_t)off));
+		return;
+	}
+	// The jump is after the beq
+	far = off - 4 < -JAL_REACH;
+	emit(g, btype(MATCH_BEQ, REG_S0, 0, far ? 12 : 8));
+	emit_jump(g, 0, head, far);
+}
+
+/*
+ * Prints the xor of the registers of the pool as 16 hex digits and a
+ * newline, then exits with 0
+ */
+static void emit_exit(struct gen *g)
+{
+	size_t loop;
+
+	for (size_t i = 1; i < NPOOL; ++i)
+		emit(g, rtype(MATCH_XOR, REG_A0, REG_A0, pool[i]));
+	emit(g, itype(MATCH_ADDI, REG_SP, REG_SP, -32));
+	emit(g, itype(MATCH_ADDI, REG_T0, 0, 16));
+	emit(g, itype(MATCH_ADDI, REG_T1, REG_SP, 0));
+	// The top digit of a0 to t2, '0' to '9' or 'a' to 'f'
+	loop = g->len;
+	emit(g, itype(MATCH_SRLI, REG_T2, REG_A0, 60));
+	emit(g, itype(MATCH_SLLI, REG_A0, REG_A0, 4));
+	emit(g, itype(MATCH_SLTIU, REG_T3, REG_T2, 10));
+	emit(g, itype(MATCH_ADDI, REG_T2, REG_T2, '0'));
+	emit(g, btype(MATCH_BNE, REG_T3, 0, 8));
+	emit(g, itype(MATCH_ADDI, REG_T2, REG_T2, 'a' - '0' - 10));
+	emit(g, stype(MATCH_SB, REG_T1, REG_T2, 0));
+	emit(g, itype(MATCH_ADDI, REG_T1, REG_T1, 1));
+	emit(g, itype(MATCH_ADDI, REG_T0, REG_T0, -1));
+	emit(g, btype(MATCH_BNE, REG_T0, 0,
+		      -(int32_t)(g->len - loop) * 4));
+	emit(g, itype(MATCH_ADDI, REG_T2, 0, '\n'));
+	emit(g, stype(MATCH_SB, REG_T1, REG_T2, 0));
+
+	emit(g, itype(MATCH_ADDI, REG_A0, 0, 1));
+	emit(g, itype(MATCH_ADDI, REG_A1, REG_SP, 0));
+	emit(g, itype(MATCH_ADDI, REG_A2, 0, 17));
+	emit(g, itype(MATCH_ADDI, REG_A7, 0, SYS_WRITE));
+	emit(g, MATCH_ECALL);
+	emit(g, itype(MATCH_ADDI, REG_A0, 0, 0));
+	emit(g, itype(MATCH_ADDI, REG_A7, 0, SYS_EXIT));
+	emit(g, MATCH_ECALL);
+}
+
+static void gen_alu(struct gen *g, const struct genopts *o)
+{
+	const size_t head = g->len;
+
+	for (unsigned i = 0; i < o->len; ++i)
+		emit_alu(g, o->muldiv);
+	emit_loop_end(g, head);
+	emit_exit(g);
+}
+
+/*
+ * s1 walks [s3, s2[ by s4 bytes, loads add to the registers of the pool and
+ * stores write them
+ */
+static void gen_ldst(struct gen *g, const struct genopts *o)
+{
+	static const insn_t loads[] = {MATCH_LB, MATCH_LH, MATCH_LW, MATCH_LD};
+	static const insn_t stores[] = {MATCH_SB, MATCH_SH, MATCH_SW, MATCH_SD};
+	unsigned width = 0;
+	unsigned reg;
+	size_t head;
+
+	// As wide as the stride is aligned, up to 8 bytes
+	while (width < 3 && o->stride % ((uint64_t)2 << width) == 0)
+		++width;
+	emit_li(g, REG_S3, DATA_BASE);
+	emit_li(g, REG_S2, (int32_t)(DATA_BASE + o->footprint));
+	emit_li(g, REG_S4, (int32_t)o->stride);
+	emit(g, itype(MATCH_ADDI, REG_S1, REG_S3, 0));
+
+	head = g->len;
+	for (unsigned i = 0; i < o->len; ++i) {
+		reg = pool[i % 8];
+		if (randbits(&g->state) % 100 < o->stores) {
+			emit(g, stype(stores[width], REG_S1, reg, 0));
+		} else {
+			emit(g, itype(loads[width], REG_T6, REG_S1, 0));
+			emit(g, rtype(MATCH_ADD, reg, reg, REG_T6));
+		}
+		emit(g, rtype(MATCH_ADD, REG_S1, REG_S1, REG_S4));
+		emit(g, btype(MATCH_BLTU, REG_S1, REG_S2, 8));
+		emit(g, itype(MATCH_ADDI, REG_S1, REG_S3, 0));
+	}
+	emit_loop_end(g, head);
+	emit_exit(g);
+}
+
+/*
+ * Each branch tests a byte of a xorshift generator in a0, so that it is taken
+ * as often as asked, and skips an increment when it is
+ */
+static void gen_branch(struct gen *g, const struct genopts *o)
+{
+	const int32_t below = (int32_t)(o->taken * 256 / 100);
+	unsigned reg, shift;
+	size_t head;
+
+	emit_li(g, REG_A0, (int32_t)(randbits(&g->state) & 0x7fffffff) | 1);
+	head = g->len;
+	emit(g, itype(MATCH_SLLI, REG_T0, REG_A0, 13));
+	emit(g, rtype(MATCH_XOR, REG_A0, REG_A0, REG_T0));
+	emit(g, itype(MATCH_SRLI, REG_T0, REG_A0, 7));
+	emit(g, rtype(MATCH_XOR, REG_A0, REG_A0, REG_T0));
+	emit(g, itype(MATCH_SLLI, REG_T0, REG_A0, 17));
+	emit(g, rtype(MATCH_XOR, REG_A0, REG_A0, REG_T0));
+	for (unsigned i = 0; i < o->len; ++i) {
+		reg = pool[1 + i % 7];
+		shift = i * 8 % 57;
+		emit(g, itype(MATCH_SRLI, REG_T1, REG_A0, (int32_t)shift));
+		emit(g, itype(MATCH_ANDI, REG_T1, REG_T1, 0xff));
+		emit(g, itype(MATCH_SLTIU, REG_T1, REG_T1, below));
+		emit(g, btype(MATCH_BNE, REG_T1, 0, 8));
+		emit(g, itype(MATCH_ADDI, reg, reg, (int32_t)i));
+	}
+	emit_loop_end(g, head);
+	emit_exit(g);
+}
+
+/*
+ * Functions f0 to f(len - 1), after the exit, each calls the next and the
+ * last one returns
+ */
+static void gen_call(struct gen *g, const struct genopts *o)
+{
+	const size_t fsize = 8;
+	size_t head, call, f;
+
+	head = g->len;
+	call = g->len;
+	emit(g, 0); // jal ra, f0
+	emit_loop_end(g, head);
+	emit_exit(g);
+
+	f = g->len;
+	if (call < g->len)
+		g->code[call] = jtype(REG_RA, (int32_t)(f - call) * 4);
+	for (unsigned i = 0; i + 1 < o->len; ++i) {
+		emit(g, itype(MATCH_ADDI, REG_SP, REG_SP, -16));
+		emit(g, stype(MATCH_SD, REG_SP, REG_RA, 8));
+		emit(g, itype(MATCH_ADDI, REG_A1, REG_A1, 1));
+		emit(g, rtype(MATCH_XOR, REG_A2, REG_A2, REG_A1));
+		emit(g, jtype(REG_RA, (int32_t)(fsize - 4) * 4));
+		emit(g, itype(MATCH_LD, REG_RA, REG_SP, 8));
+		emit(g, itype(MATCH_ADDI, REG_SP, REG_SP, 16));
+		emit(g, itype(MATCH_JALR, 0, REG_RA, 0));
+	}
+	emit(g, itype(MATCH_ADDI, REG_A1, REG_A1, 1));
+	emit(g, itype(MATCH_JALR, 0, REG_RA, 0));
+}
+
+/*
+ * Blocks of `len` instructions and a jump, laid out in order and run in a
+ * random one, with jumps that reach anywhere if the code is larger than jal
+ * can
+ */
+static void gen_text(struct gen *g, const struct genopts *o)
+{
+	const bool far = (int64_t)o->footprint > JAL_REACH;
+	const size_t blocksz = o->len + (far ? 2 : 1);
+	size_t nblocks = o->footprint / (4 * blocksz);
+	size_t *order, *pos;
+	size_t head, first, next, j;
+
+	if (nblocks == 0)
+		nblocks = 1;
+	order = malloc(nblocks * sizeof(*order));
+	pos = malloc(nblocks * sizeof(*pos));
+	if (!order || !pos) {
+		free(order);
+		free(pos);
+		g->failed = true;
+		return;
+	}
+	// Fisher-Yates
+	for (size_t i = 0; i < nblocks; ++i)
+		order[i] = i;
+	for (size_t i = nblocks - 1; i > 0; --i) {
+		j = randbits(&g->state) % (i + 1);
+		next = order[i];
+		order[i] = order[j];
+		order[j] = next;
+	}
+	for (size_t i = 0; i < nblocks; ++i)
+		pos[order[i]] = i;
+
+	head = g->len;
+	first = head + (far ? 2 : 1);
+	emit_jump(g, 0, first + order[0] * blocksz, far);
+	for (size_t i = 0; i < nblocks; ++i) {
+		for (unsigned k = 0; k < o->len; ++k)
+			emit_alu(g, o->muldiv);
+		if (pos[i] + 1 < nblocks)
+			next = first + order[pos[i] + 1] * blocksz;
+		else
+			next = first + nblocks * blocksz;
+		emit_jump(g, 0, next, far);
+	}
+	free(order);
+	free(pos);
+	emit_loop_end(g, head);
+	emit_exit(g);
+}
+
+// One PT_LOAD segment for the code, and one of `bss` bytes if it isn't 0
+static int writeelf(FILE *fp, const struct gen *g, uint64_t bss)
+{
+	Elf64_Ehdr elfh = {
+		.e_ident = {ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS64,
+			    ELFDATA2LSB, EV_CURRENT, ELFOSABI_SYSV},
+		.e_type = ET_EXEC,
+		.e_machine = EM_RISCV,
+		.e_version = EV_CURRENT,
+		.e_entry = TEXT_BASE,
+		.e_phoff = sizeof(Elf64_Ehdr),
+		.e_ehsize = sizeof(Elf64_Ehdr),
+		.e_phentsize = sizeof(Elf64_Phdr),
+		.e_phnum = bss ? 2 : 1,
+	};
+	Elf64_Phdr elfph[2] = {
+		{
+			.p_type = PT_LOAD,
+			.p_flags = PF_R | PF_X,
+			.p_offset = TEXT_OFFSET,
+			.p_vaddr = TEXT_BASE,
+			.p_paddr = TEXT_BASE,
+			.p_filesz = g->len * sizeof(*g->code),
+			.p_memsz = g->len * sizeof(*g->code),
+			.p_align = 0x1000,
+		},
+		{
+			.p_type = PT_LOAD,
+			.p_flags = PF_R | PF_W,
+			.p_vaddr = DATA_BASE,
+			.p_paddr = DATA_BASE,
+			.p_memsz = bss,
+			.p_align = 0x1000,
+		},
+	};
+
+	if (fwrite(&elfh, sizeof(elfh), 1, fp) != 1 ||
+	    fwrite(elfph, sizeof(*elfph), elfh.e_phnum, fp) != elfh.e_phnum ||
+	    fseek(fp, TEXT_OFFSET, SEEK_SET) == -1 ||
+	    fwrite(g->code, sizeof(*g->code), g->len, fp) != g->len)
+		return -1;
+	return fflush(fp);
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *const kinds[] = {
+		[KIND_ALU] = "alu",
+		[KIND_LDST] = "ldst",
+		[KIND_BRANCH] = "branch",
+		[KIND_CALL] = "call",
+		[KIND_TEXT] = "text",
+	};
+	struct genopts o = {
+		.kind = KIND_ALU,
+		.len = 16,
+		.stride = 8,
+		.stores = 25,
+		.taken = 50,
+		.seed = 1,
+	};
+	struct gen g = {0};
+	size_t k;
+	FILE *fp;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "mk:n:l:f:s:w:p:r:")) != -1) {
+		switch (opt) {
+		case 'm':
+			o.muldiv = true;
+			break;
+		case 'k':
+			for (k = 0; k < sizeof(kinds) / sizeof(*kinds); ++k)
+				if (!strcmp(optarg, kinds[k]))
+					break;
+			if (k == sizeof(kinds) / sizeof(*kinds)) {
+				usage(argv[0]);
+				return 1;
+			}
+			o.kind = (enum kind)k;
+			break;
+		case 'n':
+			o.iters = strtoull(optarg, NULL, 0);
+			break;
+		case 'l':
+			o.len = (unsigned)strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			o.footprint = strtoull(optarg, NULL, 0) << 10;
+			break;
+		case 's':
+			o.stride = strtoull(optarg, NULL, 0);
+			break;
+		case 'w':
+			o.stores = (unsigned)strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			o.taken = (unsigned)strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			o.seed = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!o.footprint)
+		o.footprint = o.kind == KIND_TEXT ? 1 << 20 : 64 << 10;
+	if (!o.iters && o.kind == KIND_TEXT)
+		o.iters = TEXT_INSNS / (o.footprint / 4) + 1;
+	else if (!o.iters)
+		o.iters = 1000000;
+	if (optind + 1 != argc || o.iters > INT32_MAX ||
+	    !o.len || o.len > 4096 || o.footprint > DATA_MAX ||
+	    !o.stride || o.stride > o.footprint || o.stores > 100 ||
+	    o.taken > 100) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	// Never zero, so that xorshift doesn't stay there
+	g.state = o.seed ? o.seed : 1;
+	for (size_t i = 0; i < NPOOL; ++i)
+		emit(&g, itype(MATCH_ADDI, pool[i], 0,
+			       (int32_t)(randbits(&g.state) & 0x7ff)));
+	emit_li(&g, REG_S0, (int32_t)o.iters);
+	switch (o.kind) {
+	case KIND_ALU:
+		gen_alu(&g, &o);
+		break;
+	case KIND_LDST:
+		gen_ldst(&g, &o);
+		break;
+	case KIND_BRANCH:
+		gen_branch(&g, &o);
+		break;
+	case KIND_CALL:
+		gen_call(&g, &o);
+		break;
+	case KIND_TEXT:
+		gen_text(&g, &o);
+		break;
+	}
+	if (g.failed) {
+		perror("rvgen");
+		free(g.code);
+		return 1;
+	}
+
+	if (!(fp = fopen(argv[optind], "wb"))) {
+		perror(argv[optind]);
+		free(g.code);
+		return 1;
+	}
+	if (writeelf(fp, &g, o.kind == KIND_LDST ? o.footprint : 0) == -1) {
+		perror(argv[optind]);
+		fclose(fp);
+		free(g.code);
+		return 1;
+	}
+	fclose(fp);
+	free(g.code);
+	return 0;
+}
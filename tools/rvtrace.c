@@ -0,0 +1,243 @@
+/*
+ * Decodes the execution traces written by `rvrun -t`, see trace.h. Prints one
+ * line per retired instruction, or with -s, statistics about the whole trace.
+ */
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "riscv.h"
+#include "insn.h"
+#include "trace.h"
+
+#define MIX_MAX 256
+#define HOT_MAX 10
+
+struct pccount {
+	rvaddr_t pc;
+	uint64_t n;
+};
+
+// Statistics of a trace
+struct stats {
+	uint64_t insns;
+	uint64_t loads;
+	uint64_t stores;
+	uint64_t terms; // Instructions that end a basic block
+	uint64_t taken; // Of them, those that didn't go to the next instruction
+	struct {
+		const char *name;
+		uint64_t n;
+	} mix[MIX_MAX];
+	size_t nmix;
+	struct pccount *pcs; // Open addressing, a zero `n` is a free slot
+	size_t pcs_size;
+	size_t npcs;
+};
+
+static void usage(const char *argv0) __attribute__((nonnull, cold));
+static const char *lowername(const char *name);
+static void print_rec(rvaddr_t pc, const struct trace_rec *rec)
+	__attribute__((nonnull));
+static int count_rec(struct stats *st, rvaddr_t pc,
+		     const struct trace_rec *rec) __attribute__((nonnull));
+static int count_pc(struct stats *st, rvaddr_t pc) __attribute__((nonnull));
+static void print_stats(struct stats *st) __attribute__((nonnull));
+static int cmp_pccount(const void *a, const void *b);
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [-s] [-n count] trace\n", argv0);
+}
+
+int main(int argc, char *argv[])
+{
+	struct stats st = {0};
+	struct trace_reader *rd;
+	struct trace_rec rec;
+	struct trace_rec prev = {0};
+	uint64_t limit = UINT64_MAX;
+	bool summary = false;
+	rvaddr_t pc, prevpc = 0;
+	int ret = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "sn:")) != -1) {
+		switch (opt) {
+		case 's':
+			summary = true;
+			break;
+		case 'n':
+			limit = strtoull(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind + 1 != argc) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (!(rd = trace_ropen(argv[optind]))) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	while (st.insns < limit && (ret = trace_read(rd, &rec, &pc)) == 1) {
+		if (st.insns > 0 && (prev.flags & INSN_TERM) &&
+		    pc != prevpc + (prev.flags & INSN_RVC ? 2 : 4))
+			++st.taken;
+		if (summary) {
+			if ((ret = count_rec(&st, pc, &rec)) == -1)
+				break;
+		} else {
+			print_rec(pc, &rec);
+		}
+		++st.insns;
+		prev = rec;
+		prevpc = pc;
+	}
+	trace_rclose(rd);
+	if (ret == -1) {
+		perror(argv[optind]);
+		free(st.pcs);
+		return 1;
+	}
+
+	if (summary)
+		print_stats(&st);
+	free(st.pcs);
+	return 0;
+}
+
+// Instruction name as in the ISA manual, from its opcodes.h one or NULL
+static const char *lowername(const char *name)
+{
+	static char buf[32];
+	size_t i;
+
+	if (!name)
+		return "???";
+	for (i = 0; name[i] && i < sizeof(buf) - 1; ++i)
+		buf[i] = name[i] == '_' ? '.' : (char)tolower(name[i]);
+	buf[i] = '\0';
+	return buf;
+}
+
+static void print_rec(rvaddr_t pc, const struct trace_rec *rec)
+{
+	printf("0x%08lx: %08x %-8s", pc, rec->insn, lowername(insn_name(rec->insn)));
+	if (rec->flags & INSN_WRD)
+		printf(" x%u = 0x%lx", rec->rd, rec->rdval);
+	if (rec->flags & (INSN_LOAD | INSN_STORE))
+		printf(" %c[0x%lx]", rec->flags & INSN_LOAD ? '<' : '>',
+		       rec->addr);
+	putchar('\n');
+}
+
+static int count_rec(struct stats *st, rvaddr_t pc,
+		     const struct trace_rec *rec)
+{
+	const char *name = insn_name(rec->insn);
+	size_t i;
+
+	if (rec->flags & INSN_LOAD)
+		++st->loads;
+	if (rec->flags & INSN_STORE)
+		++st->stores;
+	if (rec->flags & INSN_TERM)
+		++st->terms;
+
+	for (i = 0; i < st->nmix && st->mix[i].name != name; ++i)
+		;
+	if (i == st->nmix && st->nmix < MIX_MAX)
+		st->mix[st->nmix++].name = name;
+	if (i < st->nmix)
+		++st->mix[i].n;
+
+	return count_pc(st, pc);
+}
+
+static int count_pc(struct stats *st, rvaddr_t pc)
+{
+	struct pccount *old = st->pcs;
+	size_t old_size = st->pcs_size;
+	size_t i;
+
+	// Grows the table to keep it at most half full
+	if (2 * (st->npcs + 1) > st->pcs_size) {
+		st->pcs_size = old_size ? 2 * old_size : 1024;
+		if (!(st->pcs = calloc(st->pcs_size, sizeof(*st->pcs)))) {
+			st->pcs = old;
+			st->pcs_size = old_size;
+			return -1;
+		}
+		for (size_t j = 0; j < old_size; ++j) {
+			if (old[j].n == 0)
+				continue;
+			i = (old[j].pc >> 2) & (st->pcs_size - 1);
+			while (st->pcs[i].n)
+				i = (i + 1) & (st->pcs_size - 1);
+			st->pcs[i] = old[j];
+		}
+		free(old);
+	}
+
+	i = (pc >> 2) & (st->pcs_size - 1);
+	while (st->pcs[i].n && st->pcs[i].pc != pc)
+		i = (i + 1) & (st->pcs_size - 1);
+	if (st->pcs[i].n == 0) {
+		st->pcs[i].pc = pc;
+		++st->npcs;
+	}
+	++st->pcs[i].n;
+	return 0;
+}
+
+static void print_stats(struct stats *st)
+{
+	double total = st->insns ? (double)st->insns : 1;
+	struct pccount mix[MIX_MAX];
+	size_t n = 0;
+
+	printf("Instructions: %lu (%zu distinct pcs)\n", st->insns, st->npcs);
+	printf("Loads:        %lu (%.1f%%)\n", st->loads,
+	       100 * (double)st->loads / total);
+	printf("Stores:       %lu (%.1f%%)\n", st->stores,
+	       100 * (double)st->stores / total);
+	printf("Block ends:   %lu, %lu taken\n", st->terms, st->taken);
+
+	// Sorts the mix through the pc table's type, `pc` is the mix index
+	for (size_t i = 0; i < st->nmix; ++i)
+		mix[i] = (struct pccount){i, st->mix[i].n};
+	qsort(mix, st->nmix, sizeof(*mix), cmp_pccount);
+	printf("\nInstruction mix:\n");
+	for (size_t i = 0; i < st->nmix; ++i)
+		printf("  %-8s %12lu %6.2f%%\n",
+		       lowername(st->mix[mix[i].pc].name), mix[i].n,
+		       100 * (double)mix[i].n / total);
+
+	// Moves the used slots to the front and sorts them
+	for (size_t i = 0; i < st->pcs_size; ++i)
+		if (st->pcs[i].n)
+			st->pcs[n++] = st->pcs[i];
+	qsort(st->pcs, n, sizeof(*st->pcs), cmp_pccount);
+	printf("\nHottest pcs:\n");
+	for (size_t i = 0; i < n && i < HOT_MAX; ++i)
+		printf("  0x%08lx %12lu %6.2f%%\n", st->pcs[i].pc,
+		       st->pcs[i].n, 100 * (double)st->pcs[i].n / total);
+}
+
+// Sorts by decreasing count
+static int cmp_pccount(const void *a, const void *b)
+{
+	const struct pccount *x = a;
+	const struct pccount *y = b;
+
+	return (x->n < y->n) - (x->n > y->n);
+}